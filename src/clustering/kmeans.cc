@@ -0,0 +1,378 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kmeans.h"
+
+#include "distances/distances.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+/* Relative perturbation applied to the two halves of a split cluster.  */
+#define KMEANS_SPLIT_EPS (1.0f / 1024.0f)
+
+/* Upper bound of the number of floats in the per-thread partial sums.  With
+   many centroids, fewer threads are used for the update step rather than
+   running out of memory.  */
+#define KMEANS_MAX_PARTIAL_SUMS (size_t(1) << 28)
+
+namespace vector_search {
+
+KMeans::KMeans(size_t d, size_t k, const KMeansParams& params)
+    : d(d), k(k), params(params) {}
+
+/* Draw m distinct indexes in [0, n).  */
+static void
+sample_distinct(size_t n, size_t m, std::mt19937& rng,
+                std::vector<size_t>& out) {
+    std::vector<size_t> perm(n);
+
+    std::iota(perm.begin(), perm.end(), 0);
+    for (size_t i = 0; i < m; i++) {
+        std::uniform_int_distribution<size_t> pick(i, n - 1);
+        std::swap(perm[i], perm[pick(rng)]);
+    }
+    out.assign(perm.begin(), perm.begin() + m);
+}
+
+/* Sum and count the vectors assigned to each centroid.  The vectors are
+   split in one contiguous range per thread, each thread accumulates in its
+   own partial sums, the partial sums are then reduced per centroid.  No
+   locks or atomics are needed.  */
+static void
+compute_sums(size_t n, const float* x, const int64_t* ids, size_t k,
+             size_t d, std::vector<float>& sums,
+             std::vector<int64_t>& counts) {
+    size_t nchunks = std::min((size_t)get_num_threads(), n);
+
+    nchunks = std::min(nchunks, std::max((size_t)1,
+                                         KMEANS_MAX_PARTIAL_SUMS / (k * d)));
+    nchunks = std::max(nchunks, (size_t)1);
+
+    std::vector<float> partial_sums(nchunks * k * d, 0.0f);
+    std::vector<int64_t> partial_counts(nchunks * k, 0);
+
+    parallel_for(nchunks, 1, [&](size_t c0, size_t c1) {
+        for (size_t c = c0; c < c1; c++) {
+            float* psums = &partial_sums[c * k * d];
+            int64_t* pcounts = &partial_counts[c * k];
+
+            for (size_t i = c * n / nchunks; i < (c + 1) * n / nchunks; i++) {
+                float* sum = psums + ids[i] * d;
+                const float* xi = x + i * d;
+
+                for (size_t l = 0; l < d; l++)
+                    sum[l] += xi[l];
+                pcounts[ids[i]]++;
+            }
+        }
+    });
+
+    sums.assign(k * d, 0.0f);
+    counts.assign(k, 0);
+
+    parallel_for(k, 16, [&](size_t j0, size_t j1) {
+        for (size_t c = 0; c < nchunks; c++) {
+            for (size_t j = j0; j < j1; j++) {
+                const float* psum = &partial_sums[(c * k + j) * d];
+
+                for (size_t l = 0; l < d; l++)
+                    sums[j * d + l] += psum[l];
+                counts[j] += partial_counts[c * k + j];
+            }
+        }
+    });
+}
+
+/* Replace each empty cluster by one half of a cluster chosen with a
+   probability proportional to its size, as done by faiss.  Only the
+   clusters of two vectors or more can be split, the function stops when
+   none is left.  Returns the number of clusters split.  */
+static size_t
+split_empty_clusters(size_t n, size_t k, size_t d, float* centroids,
+                     std::vector<int64_t>& counts, std::mt19937& rng) {
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    size_t nsplit = 0;
+    size_t nsplittable = 0;
+
+    for (size_t j = 0; j < k; j++)
+        if (counts[j] > 1)
+            nsplittable++;
+
+    for (size_t ci = 0; ci < k; ci++) {
+        size_t cj;
+
+        if (counts[ci] != 0)
+            continue;
+
+        /* Every draw below would fail and the loop would never stop.  */
+        if (nsplittable == 0)
+            break;
+
+        for (cj = 0; true; cj = (cj + 1) % k) {
+            float p = (counts[cj] - 1.0f) / (float)(n - k);
+
+            if (uniform(rng) < p)
+                break;
+        }
+
+        memcpy(centroids + ci * d, centroids + cj * d, sizeof(float) * d);
+
+        /* Small symmetric perturbation of the two halves.  */
+        for (size_t l = 0; l < d; l++) {
+            if (l % 2 == 0) {
+                centroids[ci * d + l] *= 1 + KMEANS_SPLIT_EPS;
+                centroids[cj * d + l] *= 1 - KMEANS_SPLIT_EPS;
+            } else {
+                centroids[ci * d + l] *= 1 - KMEANS_SPLIT_EPS;
+                centroids[cj * d + l] *= 1 + KMEANS_SPLIT_EPS;
+            }
+        }
+
+        counts[ci] = counts[cj] / 2;
+        counts[cj] -= counts[ci];
+        nsplittable--;
+        if (counts[ci] > 1)
+            nsplittable++;
+        if (counts[cj] > 1)
+            nsplittable++;
+        nsplit++;
+    }
+    return nsplit;
+}
+
+/* k-means++ seeding: each new centroid is a training vector drawn with a
+   probability proportional to its squared distance to the nearest centroid
+   already chosen.  The vectors are split in one range per thread, each
+   thread keeps the total of its range up to date so that the draw only
+   scans one range.  */
+static void
+init_kmeanspp(size_t n, const float* x, size_t k, size_t d, float* centroids,
+              std::mt19937& rng) {
+    size_t nchunks = std::max(std::min((size_t)get_num_threads(), n),
+                              (size_t)1);
+    std::vector<float> mind(n, HUGE_VALF);
+    std::vector<double> totals(nchunks);
+    std::uniform_int_distribution<size_t> first(0, n - 1);
+    size_t pick = first(rng);
+
+    for (size_t c = 0; c < k; c++) {
+        const float* centroid = centroids + c * d;
+
+        memcpy(centroids + c * d, x + pick * d, sizeof(float) * d);
+        if (c == k - 1)
+            break;
+
+        parallel_for(nchunks, 1, [&](size_t c0, size_t c1) {
+            for (size_t ch = c0; ch < c1; ch++) {
+                double total = 0;
+
+                for (size_t i = ch * n / nchunks;
+                     i < (ch + 1) * n / nchunks; i++) {
+                    mind[i] = std::min(mind[i],
+                                       fvec_L2sqr(x + i * d, centroid, d));
+                    total += mind[i];
+                }
+                totals[ch] = total;
+            }
+        });
+
+        double total = 0;
+        for (size_t ch = 0; ch < nchunks; ch++)
+            total += totals[ch];
+
+        std::uniform_real_distribution<double> uniform(0.0, total);
+        double r = uniform(rng);
+        size_t ch = 0;
+
+        while (ch < nchunks - 1 && r > totals[ch])
+            r -= totals[ch++];
+
+        pick = (ch + 1) * n / nchunks - 1;
+        for (size_t i = ch * n / nchunks; i < (ch + 1) * n / nchunks; i++) {
+            r -= mind[i];
+            if (r <= 0) {
+                pick = i;
+                break;
+            }
+        }
+    }
+}
+
+float
+KMeans::train(size_t n, const float* x) {
+    std::mt19937 rng(params.seed);
+    std::vector<float> xsub;
+    std::vector<size_t> perm;
+
+    if (n < k) {
+        std::cout << "ERROR, KMeans needs at least k = " << k
+                  << " training vectors, got " << n << ".\n";
+        exit (-1);
+    }
+
+    /* Subsample the training set.  */
+    if (params.max_points_per_centroid
+        && n > k * params.max_points_per_centroid) {
+        size_t nsub = k * params.max_points_per_centroid;
+
+        sample_distinct(n, nsub, rng, perm);
+        xsub.resize(nsub * d);
+        for (size_t i = 0; i < nsub; i++)
+            memcpy(&xsub[i * d], x + perm[i] * d, sizeof(float) * d);
+        x = xsub.data();
+        n = nsub;
+    }
+
+    centroids.resize(k * d);
+    objective.clear();
+
+    if (params.kmeanspp_init) {
+        init_kmeanspp(n, x, k, d, centroids.data(), rng);
+    } else {
+        sample_distinct(n, k, rng, perm);
+        for (size_t j = 0; j < k; j++)
+            memcpy(&centroids[j * d], x + perm[j] * d, sizeof(float) * d);
+    }
+
+    std::vector<float> sums;
+    std::vector<int64_t> counts;
+
+    if (params.batch_size == 0) {
+        /* Full-batch Lloyd iterations.  */
+        std::vector<int64_t> ids(n);
+        std::vector<float> dists(n);
+
+        for (int it = 0; it < params.niter; it++) {
+            double obj = 0;
+
+            assign_to_nearest(x, n, centroids.data(), k, d, ids.data(),
+                              dists.data());
+
+            for (size_t i = 0; i < n; i++)
+                obj += dists[i];
+
+            compute_sums(n, x, ids.data(), k, d, sums, counts);
+
+            for (size_t j = 0; j < k; j++) {
+                if (counts[j] == 0)
+                    continue;
+                for (size_t l = 0; l < d; l++)
+                    centroids[j * d + l] = sums[j * d + l] / counts[j];
+            }
+
+            size_t nsplit = split_empty_clusters(n, k, d, centroids.data(),
+                                                 counts, rng);
+            objective.push_back(obj);
+
+            if (params.verbose)
+                std::cout << "Iteration " << it << " objective " << obj
+                          << " split " << nsplit << std::endl;
+        }
+        return objective.empty() ? 0 : objective.back();
+    }
+
+    /* Mini-batch iterations (Sculley, 2010).  Each centroid moves toward the
+       mean of its batch vectors with a learning rate of 1 / (number of
+       vectors assigned to it so far).  */
+    size_t bs = std::min(params.batch_size, n);
+    std::vector<int64_t> seen(k, 0);
+    std::vector<float> xb(bs * d);
+    std::vector<int64_t> ids(bs);
+    std::vector<float> dists(bs);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+
+    for (int it = 0; it < params.niter; it++) {
+        double obj = 0;
+
+        for (size_t i = 0; i < bs; i++)
+            memcpy(&xb[i * d], x + pick(rng) * d, sizeof(float) * d);
+
+        assign_to_nearest(xb.data(), bs, centroids.data(), k, d, ids.data(),
+                          dists.data());
+
+        for (size_t i = 0; i < bs; i++)
+            obj += dists[i];
+
+        compute_sums(bs, xb.data(), ids.data(), k, d, sums, counts);
+
+        parallel_for(k, 16, [&](size_t j0, size_t j1) {
+            for (size_t j = j0; j < j1; j++) {
+                if (counts[j] == 0)
+                    continue;
+
+                seen[j] += counts[j];
+                float eta = 1.0f / seen[j];
+
+                for (size_t l = 0; l < d; l++) {
+                    float& c = centroids[j * d + l];
+                    c += eta * (sums[j * d + l] - counts[j] * c);
+                }
+            }
+        });
+
+        /* Scale the batch objective to the size of the training set.  */
+        objective.push_back(obj * n / bs);
+
+        if (params.verbose)
+            std::cout << "Mini-batch iteration " << it
+                      << " estimated objective " << objective.back()
+                      << std::endl;
+    }
+
+    /* The clusters that are empty on the whole training set are split from
+       the others.  The counts of the mini-batches cannot be used: they sum
+       to niter * batch_size, which may be less than k.  The final objective
+       is computed on the whole training set.  */
+    std::vector<int64_t> all_ids(n);
+    std::vector<float> all_dists(n);
+    double obj = 0;
+
+    assign_to_nearest(x, n, centroids.data(), k, d, all_ids.data(),
+                      all_dists.data());
+
+    counts.assign(k, 0);
+    for (size_t i = 0; i < n; i++)
+        counts[all_ids[i]]++;
+
+    if (split_empty_clusters(n, k, d, centroids.data(), counts, rng) > 0)
+        assign_to_nearest(x, n, centroids.data(), k, d, all_ids.data(),
+                          all_dists.data());
+
+    for (size_t i = 0; i < n; i++)
+        obj += all_dists[i];
+    objective.push_back(obj);
+
+    return obj;
+}
+
+void
+KMeans::assign(size_t n, const float* x, int64_t* ids, float* dists) const {
+    std::vector<float> tmp;
+
+    if (!dists) {
+        tmp.resize(n);
+        dists = tmp.data();
+    }
+    assign_to_nearest(x, n, centroids.data(), k, d, ids, dists);
+}
+
+}  // namespace vector_search
@@ -0,0 +1,78 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLUSTERING_KMEANS_H
+#define CLUSTERING_KMEANS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vector_search {
+
+/// Parameters of the k-means training.
+struct KMeansParams {
+    /// number of Lloyd iterations
+    int niter = 25;
+
+    /// seed of the random number generator
+    int seed = 1234;
+
+    /// k-means++ initialization, otherwise k distinct random training
+    /// vectors are used as the initial centroids
+    bool kmeanspp_init = false;
+
+    /// number of training vectors sampled per iteration for mini-batch
+    /// k-means, 0 runs full-batch Lloyd iterations
+    size_t batch_size = 0;
+
+    /// the training set is subsampled to k * max_points_per_centroid
+    /// vectors, 0 to use all the vectors
+    size_t max_points_per_centroid = 256;
+
+    /// print the objective at each iteration
+    bool verbose = false;
+};
+
+/// K-means clustering with the squared L2 distance.  The assignment step
+/// uses the fused assign_to_nearest kernel, the centroid update step is
+/// spread over the training vectors with per-thread partial sums.
+struct KMeans {
+    size_t d;     ///< dimension of the vectors
+    size_t k;     ///< number of centroids
+    KMeansParams params;
+
+    /// k * d centroids, valid after train
+    std::vector<float> centroids;
+
+    /// sum of the squared distances of the training vectors to their
+    /// centroid, after each iteration
+    std::vector<float> objective;
+
+    KMeans(size_t d, size_t k, const KMeansParams& params = KMeansParams());
+
+    /// Train the centroids on the n vectors x.  Returns the final value of
+    /// the objective.
+    float train(size_t n, const float* x);
+
+    /// Index and squared distance of the nearest centroid of the n vectors
+    /// x.  dists may be null.
+    void assign(size_t n, const float* x, int64_t* ids, float* dists) const;
+};
+
+}  // namespace vector_search
+
+#endif /* CLUSTERING_KMEANS_H */
@@ -27,4 +27,37 @@ cosine_distance_ref (const float* x, const float* y, size_t d)
     return res;
 
 }
+
+template <size_t B>
+void
+cosine_distances_blocked_ref(float* dis, const float* x, const float* yb,
+                             size_t d, size_t n) {
+    float dotpdt[B], mag_vy[B], mag_vx = 0;
+
+    for (size_t i = 0; i < d; i++)
+        mag_vx += x[i] * x[i];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        for (size_t t = 0; t < B; t++)
+            dotpdt[t] = mag_vy[t] = 0;
+
+        for (size_t i = 0; i < d; i++) {
+            for (size_t t = 0; t < B; t++) {
+                dotpdt[t] += x[i] * yb[i * B + t];
+                mag_vy[t] += yb[i * B + t] * yb[i * B + t];
+            }
+        }
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = 1.0f - dotpdt[t] / sqrt(mag_vx * mag_vy[t]);
+    }
+}
+
+template void cosine_distances_blocked_ref<4>(float*, const float*,
+                                              const float*, size_t, size_t);
+template void cosine_distances_blocked_ref<8>(float*, const float*,
+                                              const float*, size_t, size_t);
+template void cosine_distances_blocked_ref<16>(float*, const float*,
+                                               const float*, size_t, size_t);
+
 } // namespace base 
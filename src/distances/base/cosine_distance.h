@@ -9,4 +9,11 @@
 
 namespace base {
 	float cosine_distance_ref (const float* x, const float* y, size_t d);
+
+/// Cosine distances between x and the n vectors of yb, in the blocked
+/// layout of B = 4, 8 or 16 vectors, see fvec_L2sqr_blocked_ref.
+template <size_t B>
+void
+cosine_distances_blocked_ref(float* dis, const float* x, const float* yb,
+                             size_t d, size_t n);
 }
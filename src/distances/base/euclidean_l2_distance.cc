@@ -10,8 +10,16 @@
 #include <altivec.h>   /* Required for the Power GCC built-ins  */
 
 #include "euclidean_l2_distance.h"
+#include "distances/prefetch.h"
 
 #include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+/* Number of dimensions between two checks of the partial sum in
+   fvec_L2sqr_bounded.  Must be the same in all the code versions.  */
+#define L2SQR_BOUNDED_BLOCK_SIZE 32
 
 namespace base {
 float
@@ -82,6 +90,182 @@ fvec_L2sqr_batch_4_ref(const float* x, const float* y0, const float* y1,
     dis3 = d3;
 }
 
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref(const float* x, const float* const* y, size_t d,
+                       float* dis) {
+    float dn[N];
+
+    for (size_t j = 0; j < N; j++)
+        dn[j] = 0;
+
+    for (size_t i = 0; i < d; ++i) {
+        for (size_t j = 0; j < N; j++) {
+            const float q = x[i] - y[j][i];
+            dn[j] += q * q;
+        }
+    }
+
+    for (size_t j = 0; j < N; j++)
+        dis[j] = dn[j];
+}
+
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref(const float* x, const float* y, const int64_t* ids,
+                       size_t d, float* dis) {
+    const float* yp[N];
+
+    for (size_t j = 0; j < N; j++)
+        yp[j] = y + ids[j] * d;
+
+    fvec_L2sqr_batch_N_ref<N>(x, yp, d, dis);
+}
+
+template void fvec_L2sqr_batch_N_ref<2>(const float*, const float* const*,
+                                        size_t, float*);
+template void fvec_L2sqr_batch_N_ref<4>(const float*, const float* const*,
+                                        size_t, float*);
+template void fvec_L2sqr_batch_N_ref<8>(const float*, const float* const*,
+                                        size_t, float*);
+template void fvec_L2sqr_batch_N_ref<16>(const float*, const float* const*,
+                                         size_t, float*);
+template void fvec_L2sqr_batch_N_ref<2>(const float*, const float*,
+                                        const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref<4>(const float*, const float*,
+                                        const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref<8>(const float*, const float*,
+                                        const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref<16>(const float*, const float*,
+                                         const int64_t*, size_t, float*);
+
+void
+fvec_L2sqr_by_ids_ref(float* dis, const float* x, const float* y,
+                      const int64_t* ids, size_t d, size_t n,
+                      size_t prefetch_ahead) {
+    size_t j;
+
+    for (j = 0; j < n && j < prefetch_ahead; j++)
+        prefetch_span(y + ids[j] * d, d * sizeof(float));
+
+    for (j = 0; j < n; j++) {
+        if (j + prefetch_ahead < n)
+            prefetch_span(y + ids[j + prefetch_ahead] * d, d * sizeof(float));
+        dis[j] = fvec_L2sqr_ref(x, y + ids[j] * d, d);
+    }
+}
+
+template <size_t B>
+void
+fvec_L2sqr_blocked_ref(float* dis, const float* x, const float* yb,
+                       size_t d, size_t n) {
+    float dn[B];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        for (size_t t = 0; t < B; t++)
+            dn[t] = 0;
+
+        for (size_t i = 0; i < d; i++) {
+            for (size_t t = 0; t < B; t++) {
+                const float q = x[i] - yb[i * B + t];
+                dn[t] += q * q;
+            }
+        }
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = dn[t];
+    }
+}
+
+template void fvec_L2sqr_blocked_ref<4>(float*, const float*, const float*,
+                                        size_t, size_t);
+template void fvec_L2sqr_blocked_ref<8>(float*, const float*, const float*,
+                                        size_t, size_t);
+template void fvec_L2sqr_blocked_ref<16>(float*, const float*, const float*,
+                                         size_t, size_t);
+
+float
+fvec_L2sqr_bounded_ref(const float* x, const float* y, size_t d,
+                       float threshold, size_t* dims_scanned) {
+    size_t i, j, base;
+    float res = 0;
+
+    base = (d / L2SQR_BOUNDED_BLOCK_SIZE) * L2SQR_BOUNDED_BLOCK_SIZE;
+
+    for (i = 0; i < base; i += L2SQR_BOUNDED_BLOCK_SIZE) {
+        for (j = i; j < i + L2SQR_BOUNDED_BLOCK_SIZE; j++) {
+            const float tmp = x[j] - y[j];
+            res += tmp * tmp;
+        }
+
+        if (res > threshold) {
+            if (dims_scanned)
+                *dims_scanned = i + L2SQR_BOUNDED_BLOCK_SIZE;
+            return res;
+        }
+    }
+
+    for (i = base; i < d; i++) {
+        const float tmp = x[i] - y[i];
+        res += tmp * tmp;
+    }
+
+    if (dims_scanned)
+        *dims_scanned = d;
+    return res;
+}
+
+void
+fvec_dim_order_by_variance_ref(const float* x, size_t n, size_t d,
+                               size_t* order) {
+    std::vector<double> sum(d, 0.0), sum2(d, 0.0), var(d, 0.0);
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t k = 0; k < d; k++) {
+            const double v = x[i * d + k];
+            sum[k] += v;
+            sum2[k] += v * v;
+        }
+    }
+
+    for (size_t k = 0; k < d; k++) {
+        const double mean = n ? sum[k] / n : 0.0;
+        var[k] = n ? sum2[k] / n - mean * mean : 0.0;
+    }
+
+    std::iota(order, order + d, 0);
+    std::stable_sort(order, order + d,
+                     [&var](size_t a, size_t b) { return var[a] > var[b]; });
+}
+
+void
+fvec_permute_dims_ref(const float* x, size_t n, size_t d,
+                      const size_t* order, float* out) {
+    for (size_t i = 0; i < n; i++)
+        for (size_t k = 0; k < d; k++)
+            out[i * d + k] = x[i * d + order[k]];
+}
+
+void
+assign_to_nearest_ref(const float* x, size_t n, const float* centroids,
+                      size_t k, size_t d, int64_t* ids, float* dists) {
+    for (size_t i = 0; i < n; i++) {
+        float dmin = HUGE_VALF;
+        int64_t imin = -1;
+
+        for (size_t j = 0; j < k; j++) {
+            float dis = fvec_L2sqr_ref(x + i * d, centroids + j * d, d);
+
+            if (dis < dmin) {
+                dmin = dis;
+                imin = j;
+            }
+        }
+        ids[i] = imin;
+        dists[i] = dmin;
+    }
+}
+
 int32_t
 ivec_L2sqr_ref(const int8_t* x, const int8_t* y, size_t d) {
     size_t i;
@@ -32,6 +32,70 @@ fvec_L2sqr_batch_4_ref(const float* x, const float* y0, const float* y1,
                        const float* y2, const float* y3, const size_t d,
                        float& dis0, float& dis1, float& dis2, float& dis3);
 
+/// Generalization of the batch_4 version to N = 2, 4, 8 or 16 database
+/// vectors.  The y vectors are given as an array of N pointers, the N
+/// distances are stored in dis[0..N-1].
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref(const float* x, const float* const* y, size_t d,
+                       float* dis);
+
+/// Gathered form of the above, the N vectors are y + ids[j] * d.  Used to
+/// evaluate IVF list entries or graph neighbors given by id.
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref(const float* x, const float* y, const int64_t* ids,
+                       size_t d, float* dis);
+
+/// Squared L2 distance with early abandoning.  The partial sum is checked
+/// every 32 dimensions and the function returns as soon as it exceeds
+/// threshold.  The returned value is then a lower bound of the distance
+/// that is larger than threshold; otherwise it is the exact distance.  If
+/// dims_scanned is not null, the number of dimensions processed is stored
+/// in it.
+float
+fvec_L2sqr_bounded_ref(const float* x, const float* y, size_t d,
+                       float threshold, size_t* dims_scanned = nullptr);
+
+/// Compute the order of the d dimensions of the n vectors x by decreasing
+/// variance.  Storing the vectors in that order makes
+/// fvec_L2sqr_bounded_ref exceed the threshold after fewer dimensions.
+void
+fvec_dim_order_by_variance_ref(const float* x, size_t n, size_t d,
+                               size_t* order);
+
+/// out[i * d + k] = x[i * d + order[k]] for the n vectors of x.  Queries
+/// must be permuted with the same order as the database.
+void
+fvec_permute_dims_ref(const float* x, size_t n, size_t d,
+                      const size_t* order, float* out);
+
+/// For each of the n vectors x, find the nearest of the k centroids.  The
+/// index and squared L2 distance of the nearest centroid are stored in
+/// ids[i] and dists[i].  Reference version composed of fvec_L2sqr_ref
+/// calls and a scalar minimum search.
+void
+assign_to_nearest_ref(const float* x, size_t n, const float* centroids,
+                      size_t k, size_t d, int64_t* ids, float* dists);
+
+/// Squared L2 distances between x and the n vectors y + ids[j] * d, stored in
+/// dis[0..n-1].  The vectors prefetch_ahead positions later are prefetched,
+/// all their cache lines, while the current one is compared, so that the
+/// misses of the gathered vectors overlap.
+void
+fvec_L2sqr_by_ids_ref(float* dis, const float* x, const float* y,
+                      const int64_t* ids, size_t d, size_t n,
+                      size_t prefetch_ahead);
+
+/// Squared L2 distances between x and the n vectors of yb, stored in
+/// dis[0..n-1].  yb holds the vectors in the blocked layout of B = 4, 8 or
+/// 16 vectors per block, see utils/blocked_layout.h, so that component i
+/// of the B vectors of a block is contiguous.
+template <size_t B>
+void
+fvec_L2sqr_blocked_ref(float* dis, const float* x, const float* yb, size_t d,
+                       size_t n);
+
 int32_t
 ivec_L2sqr_ref(const int8_t* x, const int8_t* y, size_t d);
 
@@ -42,5 +42,28 @@ size_t hamming_distance_ref(const uint8_t* vec1, const uint8_t* vec2,
     return distance;
 }
 
+// Dot products between ny binary codes and an integer vector given as
+// nplanes bit planes, plane p holding bit p of each component:
+// dis[i] = sum over p of popcount(code_i & plane_p) << p
+void bitplane_dot_ny_ref(uint32_t* dis, const uint8_t* planes,
+                         size_t nplanes, const uint8_t* codes,
+                         size_t code_size, size_t ny) {
+
+    for (size_t i = 0; i < ny; i++) {
+        const uint8_t* code = codes + i * code_size;
+        uint32_t dot = 0;
+
+        for (size_t p = 0; p < nplanes; p++) {
+            const uint8_t* plane = planes + p * code_size;
+            uint32_t count = 0;
+
+            for (size_t j = 0; j < code_size; j++)
+                count += std::bitset<8>(code[j] & plane[j]).count();
+            dot += count << p;
+        }
+        dis[i] = dot;
+    }
+}
+
 }
 
@@ -21,4 +21,7 @@ namespace base {
                                      const std::vector<uint8_t>& vec2);
 	size_t hamming_distance_ref (const uint8_t* vec1, const uint8_t* vec2,
                                  size_t size);
+	void bitplane_dot_ny_ref (uint32_t* dis, const uint8_t* planes,
+                              size_t nplanes, const uint8_t* codes,
+                              size_t code_size, size_t ny);
 }// namespace base 
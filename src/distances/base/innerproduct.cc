@@ -10,6 +10,7 @@
 #include <altivec.h>   /* Required for the Power GCC built-ins  */
 
 #include "innerproduct.h"
+#include "distances/prefetch.h"
 
 #include <cmath>
 
@@ -50,6 +51,103 @@ fvec_inner_product_batch_4_ref(const float* __restrict x,
     dis3 = d3;
 }
 
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref(const float* x, const float* const* y,
+                               size_t d, float* dis) {
+    float dn[N];
+
+    for (size_t j = 0; j < N; j++)
+        dn[j] = 0;
+
+    for (size_t i = 0; i < d; ++i) {
+        for (size_t j = 0; j < N; j++)
+            dn[j] += x[i] * y[j][i];
+    }
+
+    for (size_t j = 0; j < N; j++)
+        dis[j] = dn[j];
+}
+
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref(const float* x, const float* y,
+                               const int64_t* ids, size_t d, float* dis) {
+    const float* yp[N];
+
+    for (size_t j = 0; j < N; j++)
+        yp[j] = y + ids[j] * d;
+
+    fvec_inner_product_batch_N_ref<N>(x, yp, d, dis);
+}
+
+template void fvec_inner_product_batch_N_ref<2>(const float*,
+                                                const float* const*,
+                                                size_t, float*);
+template void fvec_inner_product_batch_N_ref<4>(const float*,
+                                                const float* const*,
+                                                size_t, float*);
+template void fvec_inner_product_batch_N_ref<8>(const float*,
+                                                const float* const*,
+                                                size_t, float*);
+template void fvec_inner_product_batch_N_ref<16>(const float*,
+                                                 const float* const*,
+                                                 size_t, float*);
+template void fvec_inner_product_batch_N_ref<2>(const float*, const float*,
+                                                const int64_t*, size_t,
+                                                float*);
+template void fvec_inner_product_batch_N_ref<4>(const float*, const float*,
+                                                const int64_t*, size_t,
+                                                float*);
+template void fvec_inner_product_batch_N_ref<8>(const float*, const float*,
+                                                const int64_t*, size_t,
+                                                float*);
+template void fvec_inner_product_batch_N_ref<16>(const float*, const float*,
+                                                 const int64_t*, size_t,
+                                                 float*);
+
+void
+fvec_inner_products_by_ids_ref(float* dis, const float* x, const float* y,
+                               const int64_t* ids, size_t d, size_t n,
+                               size_t prefetch_ahead) {
+    size_t j;
+
+    for (j = 0; j < n && j < prefetch_ahead; j++)
+        prefetch_span(y + ids[j] * d, d * sizeof(float));
+
+    for (j = 0; j < n; j++) {
+        if (j + prefetch_ahead < n)
+            prefetch_span(y + ids[j + prefetch_ahead] * d, d * sizeof(float));
+        dis[j] = fvec_inner_product_ref(x, y + ids[j] * d, d);
+    }
+}
+
+template <size_t B>
+void
+fvec_inner_products_blocked_ref(float* dis, const float* x, const float* yb,
+                                size_t d, size_t n) {
+    float dn[B];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        for (size_t t = 0; t < B; t++)
+            dn[t] = 0;
+
+        for (size_t i = 0; i < d; i++)
+            for (size_t t = 0; t < B; t++)
+                dn[t] += x[i] * yb[i * B + t];
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = dn[t];
+    }
+}
+
+template void fvec_inner_products_blocked_ref<4>(float*, const float*,
+                                                 const float*, size_t, size_t);
+template void fvec_inner_products_blocked_ref<8>(float*, const float*,
+                                                 const float*, size_t, size_t);
+template void fvec_inner_products_blocked_ref<16>(float*, const float*,
+                                                  const float*, size_t, size_t);
+
 int32_t
 ivec_inner_product_ref(const int8_t* x, const int8_t* y, size_t d) {
     size_t i;
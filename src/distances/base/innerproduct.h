@@ -25,6 +25,36 @@ fvec_inner_product_batch_4_ref(const float* x, const float* y0,
                                const float* y3, const size_t d, float& dis0,
                                float& dis1, float& dis2, float& dis3);
 
+/// Generalization of the batch_4 version to N = 2, 4, 8 or 16 database
+/// vectors.  The y vectors are given as an array of N pointers, the N
+/// inner products are stored in dis[0..N-1].
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref(const float* x, const float* const* y,
+                               size_t d, float* dis);
+
+/// Gathered form of the above, the N vectors are y + ids[j] * d.
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref(const float* x, const float* y,
+                               const int64_t* ids, size_t d, float* dis);
+
+/// Inner products between x and the n vectors y + ids[j] * d, stored in
+/// dis[0..n-1].  The vectors prefetch_ahead positions later are prefetched,
+/// all their cache lines, while the current one is compared, so that the
+/// misses of the gathered vectors overlap.
+void
+fvec_inner_products_by_ids_ref(float* dis, const float* x, const float* y,
+                               const int64_t* ids, size_t d, size_t n,
+                               size_t prefetch_ahead);
+
+/// Inner products between x and the n vectors of yb, in the blocked
+/// layout of B = 4, 8 or 16 vectors, see fvec_L2sqr_blocked_ref.
+template <size_t B>
+void
+fvec_inner_products_blocked_ref(float* dis, const float* x, const float* yb,
+                                size_t d, size_t n);
+
 int32_t
 ivec_inner_product_ref(const int8_t* x, const int8_t* y, size_t d);
 
@@ -40,5 +40,27 @@ fvec_Linf_ref(const float* x, const float* y, size_t d) {
        return res;
 }
 
+void
+fvec_madd_ref(size_t n, const float* a, float bf, const float* b, float* c) {
+    for (size_t i = 0; i < n; i++)
+        c[i] = a[i] + bf * b[i];
+}
+
+int
+fvec_madd_and_argmin_ref(size_t n, const float* a, float bf, const float* b,
+                         float* c) {
+    float vmin = 1e20;
+    int imin = -1;
+
+    for (size_t i = 0; i < n; i++) {
+        c[i] = a[i] + bf * b[i];
+        if (c[i] < vmin) {
+            vmin = c[i];
+            imin = i;
+        }
+    }
+    return imin;
+}
+
 }  // namespace base 
 
@@ -0,0 +1,218 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Distance functions called by the library classes (KMeans, the indexes).
+   They forward to the optimized or the intrinsic code version, selected by
+   LIBRARY_INTRINSIC_CODE in main-supported.h.  */
+
+#ifndef DISTANCES_DISTANCES_H
+#define DISTANCES_DISTANCES_H
+
+#include "../main-supported.h"
+
+#include "optimized/euclidean_l2_distance.h"
+#include "intrinsic/euclidean_l2_distance.h"
+#include "optimized/innerproduct.h"
+#include "intrinsic/innerproduct.h"
+#include "optimized/cosine_distance.h"
+#include "intrinsic/cosine_distance.h"
+#include "optimized/manhattan_l1_distance.h"
+#include "intrinsic/manhattan_l1_distance.h"
+#include "optimized/jaccard_distance.h"
+#include "intrinsic/jaccard_distance.h"
+#include "optimized/hamming_distance.h"
+#include "intrinsic/hamming_distance.h"
+#include "prefetch.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if LIBRARY_INTRINSIC_CODE
+#define LIBRARY_KERNEL(name) powerpc::name##_ref_ippc
+#else
+#define LIBRARY_KERNEL(name) powerpc::name##_ref_ppc
+#endif
+
+namespace vector_search {
+
+/// Squared L2 distance between two vectors
+inline float
+fvec_L2sqr(const float* x, const float* y, size_t d) {
+    return LIBRARY_KERNEL(fvec_L2sqr)(x, y, d);
+}
+
+/// squared norm of a vector
+inline float
+fvec_norm_L2sqr(const float* x, size_t d) {
+    return LIBRARY_KERNEL(fvec_norm_L2sqr)(x, d);
+}
+
+/// Squared L2 distances between x and the N vectors y[0..N-1]
+template <size_t N>
+inline void
+fvec_L2sqr_batch_N(const float* x, const float* const* y, size_t d,
+                   float* dis) {
+    LIBRARY_KERNEL(fvec_L2sqr_batch_N)<N>(x, y, d, dis);
+}
+
+/// Inner product of two vectors
+inline float
+fvec_inner_product(const float* x, const float* y, size_t d) {
+    return LIBRARY_KERNEL(fvec_inner_product)(x, y, d);
+}
+
+/// Inner products between x and the N vectors y[0..N-1]
+template <size_t N>
+inline void
+fvec_inner_product_batch_N(const float* x, const float* const* y, size_t d,
+                           float* dis) {
+    LIBRARY_KERNEL(fvec_inner_product_batch_N)<N>(x, y, d, dis);
+}
+
+/// Squared L2 distances between x and the ny vectors stored contiguously
+/// in y, computed 16 vectors at a time with the batch kernel
+inline void
+fvec_L2sqr_ny(float* dis, const float* x, const float* y, size_t d,
+              size_t ny) {
+    const float* yp[16];
+    size_t j = 0;
+
+    for (; j + 16 <= ny; j += 16) {
+        for (size_t t = 0; t < 16; t++)
+            yp[t] = y + (j + t) * d;
+        fvec_L2sqr_batch_N<16>(x, yp, d, dis + j);
+    }
+    for (; j < ny; j++)
+        dis[j] = fvec_L2sqr(x, y + j * d, d);
+}
+
+/// Inner products between x and the ny vectors stored contiguously in y
+inline void
+fvec_inner_products_ny(float* dis, const float* x, const float* y, size_t d,
+                       size_t ny) {
+    const float* yp[16];
+    size_t j = 0;
+
+    for (; j + 16 <= ny; j += 16) {
+        for (size_t t = 0; t < 16; t++)
+            yp[t] = y + (j + t) * d;
+        fvec_inner_product_batch_N<16>(x, yp, d, dis + j);
+    }
+    for (; j < ny; j++)
+        dis[j] = fvec_inner_product(x, y + j * d, d);
+}
+
+#if defined(__MMA__)
+/// Inner products of the nx vectors x by the ny vectors y, both stored by
+/// rows: dis[i * ny + j] = <x_i, y_j>.  Only available when compiled for
+/// Power10, the MMA kernel is used whatever LIBRARY_INTRINSIC_CODE.
+inline void
+fvec_inner_products_gemm(float* dis, const float* x, size_t nx,
+                         const float* y, size_t ny, size_t d) {
+    powerpc::fvec_inner_products_gemm_ippc(dis, x, nx, y, ny, d);
+}
+#endif
+
+/// Squared L2 distances between x and the n vectors y + ids[j] * d, such
+/// as graph neighbors or re-ranking candidates.  The vectors are
+/// prefetched prefetch_ahead positions ahead of their use.
+inline void
+fvec_L2sqr_by_ids(float* dis, const float* x, const float* y,
+                  const int64_t* ids, size_t d, size_t n,
+                  size_t prefetch_ahead = PREFETCH_AHEAD) {
+    LIBRARY_KERNEL(fvec_L2sqr_by_ids)(dis, x, y, ids, d, n, prefetch_ahead);
+}
+
+/// Inner products between x and the n vectors y + ids[j] * d, prefetched
+/// as above
+inline void
+fvec_inner_products_by_ids(float* dis, const float* x, const float* y,
+                           const int64_t* ids, size_t d, size_t n,
+                           size_t prefetch_ahead = PREFETCH_AHEAD) {
+    LIBRARY_KERNEL(fvec_inner_products_by_ids)(dis, x, y, ids, d, n,
+                                               prefetch_ahead);
+}
+
+/// Squared L2 distances between x and the n vectors of yb, stored in the
+/// blocked layout of B = 4, 8 or 16 vectors per block, see
+/// utils/blocked_layout.h
+template <size_t B>
+inline void
+fvec_L2sqr_blocked(float* dis, const float* x, const float* yb, size_t d,
+                   size_t n) {
+    LIBRARY_KERNEL(fvec_L2sqr_blocked)<B>(dis, x, yb, d, n);
+}
+
+/// Inner products between x and the n vectors of the blocked layout yb
+template <size_t B>
+inline void
+fvec_inner_products_blocked(float* dis, const float* x, const float* yb,
+                            size_t d, size_t n) {
+    LIBRARY_KERNEL(fvec_inner_products_blocked)<B>(dis, x, yb, d, n);
+}
+
+/// Cosine distances between x and the n vectors of the blocked layout yb
+template <size_t B>
+inline void
+cosine_distances_blocked(float* dis, const float* x, const float* yb,
+                         size_t d, size_t n) {
+    LIBRARY_KERNEL(cosine_distances_blocked)<B>(dis, x, yb, d, n);
+}
+
+/// L1 distance between two vectors
+inline float
+fvec_L1(const float* x, const float* y, size_t d) {
+    return LIBRARY_KERNEL(fvec_L1)(x, y, d);
+}
+
+/// Weighted Jaccard distance between two vectors of non-negative values
+inline float
+jaccard_distance(const float* x, const float* y, size_t d) {
+#if LIBRARY_INTRINSIC_CODE
+    /* The intrinsic version has no _ref in its name.  */
+    return powerpc::jaccard_distance_ippc(x, y, d);
+#else
+    return powerpc::jaccard_distance_ref_ppc(x, y, d);
+#endif
+}
+
+/// Number of differing bits between two binary codes of size bytes
+inline size_t
+hamming_distance(const uint8_t* x, const uint8_t* y, size_t size) {
+    return LIBRARY_KERNEL(hamming_distance)(x, y, size);
+}
+
+/// Dot products between ny binary codes of code_size bytes, stored
+/// contiguously, and a vector of unsigned integers given as nplanes bit
+/// planes of code_size bytes, plane p holding bit p of each component.
+inline void
+bitplane_dot_ny(uint32_t* dis, const uint8_t* planes, size_t nplanes,
+                const uint8_t* codes, size_t code_size, size_t ny) {
+    LIBRARY_KERNEL(bitplane_dot_ny)(dis, planes, nplanes, codes, code_size,
+                                    ny);
+}
+
+/// Index and squared L2 distance of the nearest of the k centroids for
+/// each of the n vectors x.
+inline void
+assign_to_nearest(const float* x, size_t n, const float* centroids, size_t k,
+                  size_t d, int64_t* ids, float* dists) {
+    LIBRARY_KERNEL(assign_to_nearest)(x, n, centroids, k, d, ids, dists);
+}
+
+}  // namespace vector_search
+
+#endif /* DISTANCES_DISTANCES_H */
@@ -19,8 +19,24 @@
 #include <altivec.h>   /* Required for the Power GCC built-ins  */
 
 #include "euclidean_l2_distance.h"
+#include "mma_tile.h"
+#include "distances/prefetch.h"
+#include "utils/parallel.h"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
+
+/* Must match the block size of base::fvec_L2sqr_bounded_ref.  */
+#define L2SQR_BOUNDED_BLOCK_SIZE 32
+
+/* assign_to_nearest computes tiles of ASSIGN_TILE_X vectors by
+   ASSIGN_TILE_C centroids, four MMA accumulators or 16 VSX accumulators.
+   ASSIGN_BLOCK_X vectors are processed against one centroid panel while it
+   is in the L1 cache.  */
+#define ASSIGN_TILE_X  MMA_TILE_X
+#define ASSIGN_TILE_C  MMA_TILE_Y
+#define ASSIGN_BLOCK_X 64
 
 namespace powerpc {
 //vectorized optimization for L2sqr using intrinsics
@@ -552,6 +568,388 @@ fvec_L2sqr_batch_4_ref_ippc (const float* x, const float* y0, const float* y1,
     dis3 = vd3[0] + vd3[1] + vd3[2] + vd3[3] + d3;
 }
 
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref_ippc (const float* x, const float* const* y,
+                             size_t d, float* dis) {
+    /* Same computation as fvec_L2sqr_batch_4_ref_ippc for N vectors.  The
+       x chunk is loaded once and reused for all N y vectors.  The loop over
+       d is unrolled so that N * unroll = 16 independent accumulators are in
+       flight for every N, which hides the vec_madd latency without running
+       out of the 64 VSX registers (16 accumulators, unroll x vectors and
+       the y loads).  */
+    static_assert(N > 0 && N <= 16, "batch size must be between 1 and 16");
+    constexpr size_t unroll = (N >= 16) ? 1 : 16 / N;
+    constexpr size_t factor = unroll * FLOAT_VEC_SIZE;
+    size_t base, vbase;
+
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[N][unroll];
+
+    for (size_t j = 0; j < N; j++)
+        for (size_t u = 0; u < unroll; u++)
+            vres[j][u] = vzero;
+
+    base = (d / factor) * factor;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (size_t i = 0; i < base; i += factor) {
+        vector float vx[unroll];
+
+        for (size_t u = 0; u < unroll; u++)
+            vx[u] = vec_xl(0, &x[i + u * FLOAT_VEC_SIZE]);
+
+        for (size_t j = 0; j < N; j++) {
+            for (size_t u = 0; u < unroll; u++) {
+                vector float vy = vec_xl(0, &y[j][i + u * FLOAT_VEC_SIZE]);
+                vector float diff = vec_sub(vx[u], vy);
+                vres[j][u] = vec_madd(diff, diff, vres[j][u]);
+            }
+        }
+    }
+
+    /* Remaining full vectors that do not fill an unrolled iteration.  */
+    for (size_t i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vector float vx = vec_xl(0, &x[i]);
+
+        for (size_t j = 0; j < N; j++) {
+            vector float diff = vec_sub(vx, vec_xl(0, &y[j][i]));
+            vres[j][0] = vec_madd(diff, diff, vres[j][0]);
+        }
+    }
+
+    for (size_t j = 0; j < N; j++) {
+        vector float vsum = vres[j][0];
+        float res = 0;
+
+        for (size_t u = 1; u < unroll; u++)
+            vsum = vec_add(vsum, vres[j][u]);
+
+        /* Handle the remainder of the elements in scalar mode.  */
+        for (size_t i = vbase; i < d; i++) {
+            const float tmp = x[i] - y[j][i];
+            res += tmp * tmp;
+        }
+
+        dis[j] = res + vec_extract(vsum, 0) + vec_extract(vsum, 1) +
+                 vec_extract(vsum, 2) + vec_extract(vsum, 3);
+    }
+}
+
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref_ippc (const float* x, const float* y,
+                             const int64_t* ids, size_t d, float* dis) {
+    const float* yp[N];
+
+    for (size_t j = 0; j < N; j++)
+        yp[j] = y + ids[j] * d;
+
+    fvec_L2sqr_batch_N_ref_ippc<N> (x, yp, d, dis);
+}
+
+template void fvec_L2sqr_batch_N_ref_ippc<2> (const float*,
+                                              const float* const*,
+                                              size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ippc<4> (const float*,
+                                              const float* const*,
+                                              size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ippc<8> (const float*,
+                                              const float* const*,
+                                              size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ippc<16> (const float*,
+                                               const float* const*,
+                                               size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ippc<2> (const float*, const float*,
+                                              const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ippc<4> (const float*, const float*,
+                                              const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ippc<8> (const float*, const float*,
+                                              const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ippc<16> (const float*, const float*,
+                                               const int64_t*, size_t,
+                                               float*);
+
+/* The four vectors prefetch_ahead positions after the current group are
+   prefetched before the group is compared.  */
+void
+fvec_L2sqr_by_ids_ref_ippc (float* dis, const float* x, const float* y,
+                            const int64_t* ids, size_t d, size_t n,
+                            size_t prefetch_ahead) {
+    size_t j;
+
+    for (j = 0; j < n && j < prefetch_ahead; j++)
+        prefetch_span(y + ids[j] * d, d * sizeof(float));
+
+    for (j = 0; j + 4 <= n; j += 4) {
+        for (size_t t = j + prefetch_ahead;
+             t < j + 4 + prefetch_ahead && t < n; t++)
+            prefetch_span(y + ids[t] * d, d * sizeof(float));
+        fvec_L2sqr_batch_N_ref_ippc<4>(x, y, ids + j, d, dis + j);
+    }
+    for (; j < n; j++)
+        dis[j] = fvec_L2sqr_ref_ippc(x, y + ids[j] * d, d);
+}
+
+template <size_t B>
+void
+fvec_L2sqr_blocked_ref_ippc (float* dis, const float* x, const float* yb,
+                             size_t d, size_t n) {
+    /* Row i of a block, component i of its B vectors, is B /
+       FLOAT_VEC_SIZE vectors whose lanes are compared to x[i] splatted.
+       Each lane accumulates the distance of one database vector, so
+       no horizontal sum is needed.  The loop over d is unrolled so that
+       at least four independent accumulators are in flight.  */
+    static_assert(B % FLOAT_VEC_SIZE == 0 && B <= 16,
+                  "block size must be 4, 8 or 16");
+    constexpr size_t nv = B / FLOAT_VEC_SIZE;
+    constexpr size_t unroll = (nv >= 4) ? 1 : 4 / nv;
+    size_t base = (d / unroll) * unroll;
+
+    const float* row;
+    vector float vx;
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[unroll][nv];
+    float res[B];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        size_t i;
+
+        for (size_t u = 0; u < unroll; u++)
+            for (size_t v = 0; v < nv; v++)
+                vres[u][v] = vzero;
+
+        for (i = 0; i < base; i += unroll) {
+            for (size_t u = 0; u < unroll; u++) {
+                vx = vec_splats (x[i + u]);
+                row = yb + (i + u) * B;
+
+                for (size_t v = 0; v < nv; v++) {
+                    vector float vy = vec_xl (0, row + v * FLOAT_VEC_SIZE);
+
+                    vector float diff = vec_sub (vx, vy);
+                    vres[u][v] = vec_madd (diff, diff, vres[u][v]);
+                }
+            }
+        }
+        for (; i < d; i++) {
+            vx = vec_splats (x[i]);
+            row = yb + i * B;
+
+            for (size_t v = 0; v < nv; v++) {
+                vector float vy = vec_xl (0, row + v * FLOAT_VEC_SIZE);
+
+                vector float diff = vec_sub (vx, vy);
+                vres[0][v] = vec_madd (diff, diff, vres[0][v]);
+            }
+        }
+
+        for (size_t v = 0; v < nv; v++) {
+            for (size_t u = 1; u < unroll; u++)
+                vres[0][v] = vec_add (vres[0][v], vres[u][v]);
+            vec_xst (vres[0][v], 0, &res[v * FLOAT_VEC_SIZE]);
+        }
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = res[t];
+    }
+}
+
+template void fvec_L2sqr_blocked_ref_ippc<4> (float*, const float*,
+                                              const float*, size_t, size_t);
+template void fvec_L2sqr_blocked_ref_ippc<8> (float*, const float*,
+                                              const float*, size_t, size_t);
+template void fvec_L2sqr_blocked_ref_ippc<16> (float*, const float*,
+                                               const float*, size_t, size_t);
+
+float
+fvec_L2sqr_bounded_ref_ippc (const float* x, const float* y, size_t d,
+                             float threshold) {
+    /* A block of L2SQR_BOUNDED_BLOCK_SIZE elements is eight vectors, spread
+       over four accumulators.  The accumulators are only reduced to a scalar
+       for the threshold check at the end of each block.  */
+    size_t i, k, base, vbase;
+    float res = 0;
+
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[4] = {vzero, vzero, vzero, vzero};
+    vector float vsum, diff;
+
+    base = (d / L2SQR_BOUNDED_BLOCK_SIZE) * L2SQR_BOUNDED_BLOCK_SIZE;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += L2SQR_BOUNDED_BLOCK_SIZE) {
+        for (k = 0; k < L2SQR_BOUNDED_BLOCK_SIZE / FLOAT_VEC_SIZE; k++) {
+            diff = vec_sub(vec_xl(0, &x[i + k * FLOAT_VEC_SIZE]),
+                           vec_xl(0, &y[i + k * FLOAT_VEC_SIZE]));
+            vres[k % 4] = vec_madd(diff, diff, vres[k % 4]);
+        }
+
+        vsum = vec_add(vec_add(vres[0], vres[1]), vec_add(vres[2], vres[3]));
+        res = vec_extract(vsum, 0) + vec_extract(vsum, 1) +
+              vec_extract(vsum, 2) + vec_extract(vsum, 3);
+
+        if (res > threshold)
+            return res;
+    }
+
+    /* Remaining full vectors.  */
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        diff = vec_sub(vec_xl(0, &x[i]), vec_xl(0, &y[i]));
+        vres[0] = vec_madd(diff, diff, vres[0]);
+    }
+
+    vsum = vec_add(vec_add(vres[0], vres[1]), vec_add(vres[2], vres[3]));
+    res = vec_extract(vsum, 0) + vec_extract(vsum, 1) +
+          vec_extract(vsum, 2) + vec_extract(vsum, 3);
+
+    /* Handle the remainder of the elements in scalar mode.  */
+    for (i = vbase; i < d; i++) {
+        const float tmp = x[i] - y[i];
+        res += tmp * tmp;
+    }
+
+    return res;
+}
+
+static void
+assign_block_ippc (const float* x, size_t i0, size_t i1, const float* panels,
+                   const float* cnorms, size_t npanels, size_t d,
+                   int64_t* ids, float* dists) {
+    const size_t nvc = ASSIGN_TILE_C / FLOAT_VEC_SIZE;
+    vector float vmin[ASSIGN_BLOCK_X];
+    vector signed int vimin[ASSIGN_BLOCK_X];
+    vector float vtwo = vec_splats (2.0f);
+    vector signed int vlane = {0, 1, 2, 3};
+#if defined(__MMA__)
+    /* The MMA outer products need the tile of x vectors packed dimension
+       by dimension as well.  */
+    std::vector<float> xpack(d * ASSIGN_TILE_X);
+#endif
+
+    for (size_t r = 0; r < i1 - i0; r++) {
+        vmin[r] = vec_splats (HUGE_VALF);
+        vimin[r] = vec_splats (-1);
+    }
+
+    for (size_t p = 0; p < npanels; p++) {
+        const float* panel = panels + p * d * ASSIGN_TILE_C;
+        vector signed int vidx[nvc];
+
+        for (size_t q = 0; q < nvc; q++)
+            vidx[q] = vec_add (vlane, vec_splats ((int)(p * ASSIGN_TILE_C
+                                                        + q * FLOAT_VEC_SIZE)));
+
+        for (size_t i = i0; i < i1; i += ASSIGN_TILE_X) {
+            const float* xp[ASSIGN_TILE_X];
+            vector float vacc[ASSIGN_TILE_X][nvc];
+
+            /* Rows past the end of the block repeat the last vector, their
+               results are dropped.  */
+            for (size_t t = 0; t < ASSIGN_TILE_X; t++)
+                xp[t] = x + std::min(i + t, i1 - 1) * d;
+
+#if defined(__MMA__)
+            for (size_t l = 0; l < d; l++)
+                for (size_t t = 0; t < ASSIGN_TILE_X; t++)
+                    xpack[l * ASSIGN_TILE_X + t] = xp[t][l];
+
+            mma_tile_inner_products (xpack.data(), panel, d, vacc);
+#else
+            for (size_t t = 0; t < ASSIGN_TILE_X; t++)
+                for (size_t q = 0; q < nvc; q++)
+                    vacc[t][q] = vec_splats (0.0f);
+
+            for (size_t l = 0; l < d; l++) {
+                vector float vc[nvc];
+
+                for (size_t q = 0; q < nvc; q++)
+                    vc[q] = vec_xl (0, &panel[l * ASSIGN_TILE_C
+                                              + q * FLOAT_VEC_SIZE]);
+
+                for (size_t t = 0; t < ASSIGN_TILE_X; t++) {
+                    vector float vx = vec_splats (xp[t][l]);
+
+                    for (size_t q = 0; q < nvc; q++)
+                        vacc[t][q] = vec_madd (vx, vc[q], vacc[t][q]);
+                }
+            }
+#endif
+
+            for (size_t t = 0; t < ASSIGN_TILE_X && i + t < i1; t++) {
+                size_t r = i + t - i0;
+
+                for (size_t q = 0; q < nvc; q++) {
+                    size_t c0 = p * ASSIGN_TILE_C + q * FLOAT_VEC_SIZE;
+                    vector float vcn = vec_xl (0, &cnorms[c0]);
+                    vector float vdist = vec_nmsub (vtwo, vacc[t][q], vcn);
+                    vector bool int vlt = vec_cmplt (vdist, vmin[r]);
+
+                    vmin[r] = vec_sel (vmin[r], vdist, vlt);
+                    vimin[r] = vec_sel (vimin[r], vidx[q], vlt);
+                }
+            }
+        }
+    }
+
+    /* Merge the lanes on (distance, index), a lane only sees increasing
+       centroid indexes so the first nearest centroid is returned, as in
+       the reference version.  */
+    for (size_t r = 0; r < i1 - i0; r++) {
+        float dmin = HUGE_VALF;
+        int imin = -1;
+
+        for (int j = 0; j < FLOAT_VEC_SIZE; j++) {
+            float lane_min = vec_extract (vmin[r], j);
+            int lane_imin = vec_extract (vimin[r], j);
+
+            if (lane_min < dmin || (lane_min == dmin && lane_imin < imin)) {
+                dmin = lane_min;
+                imin = lane_imin;
+            }
+        }
+
+        /* Rounding can make the distance slightly negative.  */
+        dmin += fvec_norm_L2sqr_ref_ippc (x + (i0 + r) * d, d);
+        ids[i0 + r] = imin;
+        dists[i0 + r] = std::max (0.0f, dmin);
+    }
+}
+
+void
+assign_to_nearest_ref_ippc (const float* x, size_t n, const float* centroids,
+                            size_t k, size_t d, int64_t* ids, float* dists) {
+    /* The squared distance is |x|^2 + |c|^2 - 2 x . c, |x|^2 does not change
+       which centroid is nearest and is only added at the end.  The
+       centroids are packed in panels of ASSIGN_TILE_C centroids stored
+       dimension by dimension, so one vector load gets the same dimension of
+       four centroids.  Padding centroids have an infinite norm so they are
+       never selected.  */
+    size_t npanels = (k + ASSIGN_TILE_C - 1) / ASSIGN_TILE_C;
+    std::vector<float> panels(npanels * d * ASSIGN_TILE_C, 0.0f);
+    std::vector<float> cnorms(npanels * ASSIGN_TILE_C, HUGE_VALF);
+
+    for (size_t j = 0; j < k; j++) {
+        const float* c = centroids + j * d;
+        float* panel = &panels[(j / ASSIGN_TILE_C) * d * ASSIGN_TILE_C];
+
+        for (size_t l = 0; l < d; l++)
+            panel[l * ASSIGN_TILE_C + j % ASSIGN_TILE_C] = c[l];
+        cnorms[j] = fvec_norm_L2sqr_ref_ippc (c, d);
+    }
+
+    vector_search::parallel_for ((n + ASSIGN_BLOCK_X - 1) / ASSIGN_BLOCK_X, 1,
+                                 [&](size_t b0, size_t b1) {
+        for (size_t b = b0; b < b1; b++) {
+            size_t i0 = b * ASSIGN_BLOCK_X;
+            size_t i1 = std::min(n, i0 + ASSIGN_BLOCK_X);
+
+            assign_block_ippc (x, i0, i1, panels.data(), cnorms.data(),
+                               npanels, d, ids, dists);
+        }
+    });
+}
+
 int32_t
 ivec_L2sqr_ref_ippc(const int8_t* x, const int8_t* y, size_t d) {
     size_t i;
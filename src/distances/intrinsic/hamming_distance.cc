@@ -61,6 +61,79 @@ size_t hamming_distance_ref_ippc (const uint8_t* vec1, const uint8_t* vec2,
     return distance;
 }
 
+/* Two codes are processed at a time so that each 16 bytes of the planes
+   are loaded once for both.  The popcounts of the bytes are summed into
+   one vector of words per plane and per code, weighted by the plane
+   shifts at the end.  */
+void bitplane_dot_ny_ref_ippc(uint32_t* dis, const uint8_t* planes,
+                              size_t nplanes, const uint8_t* codes,
+                              size_t code_size, size_t ny) {
+    size_t base;
+    size_t i = 0;
+
+    base = (code_size / CHAR_VEC_SIZE) * CHAR_VEC_SIZE;
+
+    for (; i + 2 <= ny; i += 2) {
+        const uint8_t* code0 = codes + i * code_size;
+        const uint8_t* code1 = code0 + code_size;
+        uint32_t dot0 = 0, dot1 = 0;
+
+        for (size_t p = 0; p < nplanes; p++) {
+            const uint8_t* plane = planes + p * code_size;
+            __vector unsigned int vcount0 = vec_splats((unsigned int)0);
+            __vector unsigned int vcount1 = vec_splats((unsigned int)0);
+            uint32_t count0, count1;
+
+            for (size_t j = 0; j < base; j += CHAR_VEC_SIZE) {
+                __vector unsigned char vp = vec_xl((long)j, (uint8_t*)plane);
+                __vector unsigned char vc0 = vec_xl((long)j, (uint8_t*)code0);
+                __vector unsigned char vc1 = vec_xl((long)j, (uint8_t*)code1);
+
+                vcount0 = vec_sum4s(vec_popcnt(vec_and(vc0, vp)), vcount0);
+                vcount1 = vec_sum4s(vec_popcnt(vec_and(vc1, vp)), vcount1);
+            }
+            count0 = vcount0[0] + vcount0[1] + vcount0[2] + vcount0[3];
+            count1 = vcount1[0] + vcount1[1] + vcount1[2] + vcount1[3];
+
+            // Handle any remaining elements (less than 16 bytes)
+            for (size_t j = base; j < code_size; j++) {
+                count0 += __builtin_popcount(code0[j] & plane[j]);
+                count1 += __builtin_popcount(code1[j] & plane[j]);
+            }
+
+            dot0 += count0 << p;
+            dot1 += count1 << p;
+        }
+        dis[i] = dot0;
+        dis[i + 1] = dot1;
+    }
+
+    for (; i < ny; i++) {
+        const uint8_t* code = codes + i * code_size;
+        uint32_t dot = 0;
+
+        for (size_t p = 0; p < nplanes; p++) {
+            const uint8_t* plane = planes + p * code_size;
+            __vector unsigned int vcount = vec_splats((unsigned int)0);
+            uint32_t count;
+
+            for (size_t j = 0; j < base; j += CHAR_VEC_SIZE) {
+                __vector unsigned char vp = vec_xl((long)j, (uint8_t*)plane);
+                __vector unsigned char vc = vec_xl((long)j, (uint8_t*)code);
+
+                vcount = vec_sum4s(vec_popcnt(vec_and(vc, vp)), vcount);
+            }
+            count = vcount[0] + vcount[1] + vcount[2] + vcount[3];
+
+            for (size_t j = base; j < code_size; j++)
+                count += __builtin_popcount(code[j] & plane[j]);
+
+            dot += count << p;
+        }
+        dis[i] = dot;
+    }
+}
+
 #else
     /* The test function will call the base code version of the function.
        Just need a function definition here for compiling.  */
@@ -70,6 +143,11 @@ size_t hamming_distance_ref_ippc(const uint8_t* vec1, const uint8_t* vec2,
     size_t distance = 0;
     return distance;
 }
+
+void bitplane_dot_ny_ref_ippc(uint32_t* dis, const uint8_t* planes,
+                              size_t nplanes, const uint8_t* codes,
+                              size_t code_size, size_t ny) {
+}
 #endif
 
 } //namespace powerpc
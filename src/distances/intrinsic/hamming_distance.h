@@ -24,6 +24,9 @@ namespace powerpc {
 
  size_t hamming_distance_ref_ippc(const uint8_t* vec1, const uint8_t* vec2,
                                   size_t size);
+ void bitplane_dot_ny_ref_ippc(uint32_t* dis, const uint8_t* planes,
+                               size_t nplanes, const uint8_t* codes,
+                               size_t code_size, size_t ny);
 
 }// HAMMING_POWERPC_H
 
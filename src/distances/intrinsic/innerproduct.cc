@@ -19,8 +19,13 @@
 #include <altivec.h>   /* Required for the Power GCC built-ins  */
 
 #include "innerproduct.h"
+#include "mma_tile.h"
+#include "distances/prefetch.h"
+#include "utils/parallel.h"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #define FLOAT_VEC_SIZE 4
 #define INT32_VEC_SIZE 4
@@ -381,6 +386,285 @@ fvec_inner_product_batch_4_ref_ippc(const float* __restrict x,
     }
 }
 
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref_ippc (const float* x, const float* const* y,
+                                     size_t d, float* dis) {
+    /* Same computation as fvec_inner_product_batch_4_ref_ippc for N
+       vectors.  The x chunk is loaded once and reused for all N y vectors,
+       the loop is unrolled so that N * unroll = 16 accumulators are in
+       flight for every N.  See fvec_L2sqr_batch_N_ref_ippc.  */
+    static_assert(N > 0 && N <= 16, "batch size must be between 1 and 16");
+    constexpr size_t unroll = (N >= 16) ? 1 : 16 / N;
+    constexpr size_t factor = unroll * FLOAT_VEC_SIZE;
+    size_t base, vbase;
+
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[N][unroll];
+
+    for (size_t j = 0; j < N; j++)
+        for (size_t u = 0; u < unroll; u++)
+            vres[j][u] = vzero;
+
+    base = (d / factor) * factor;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (size_t i = 0; i < base; i += factor) {
+        vector float vx[unroll];
+
+        for (size_t u = 0; u < unroll; u++)
+            vx[u] = vec_xl(0, &x[i + u * FLOAT_VEC_SIZE]);
+
+        for (size_t j = 0; j < N; j++) {
+            for (size_t u = 0; u < unroll; u++) {
+                vector float vy = vec_xl(0, &y[j][i + u * FLOAT_VEC_SIZE]);
+                vres[j][u] = vec_madd(vx[u], vy, vres[j][u]);
+            }
+        }
+    }
+
+    /* Remaining full vectors that do not fill an unrolled iteration.  */
+    for (size_t i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vector float vx = vec_xl(0, &x[i]);
+
+        for (size_t j = 0; j < N; j++)
+            vres[j][0] = vec_madd(vx, vec_xl(0, &y[j][i]), vres[j][0]);
+    }
+
+    for (size_t j = 0; j < N; j++) {
+        vector float vsum = vres[j][0];
+        float res = 0;
+
+        for (size_t u = 1; u < unroll; u++)
+            vsum = vec_add(vsum, vres[j][u]);
+
+        /* Handle the remainder of the elements in scalar mode.  */
+        for (size_t i = vbase; i < d; i++)
+            res += x[i] * y[j][i];
+
+        dis[j] = res + vec_extract(vsum, 0) + vec_extract(vsum, 1) +
+                 vec_extract(vsum, 2) + vec_extract(vsum, 3);
+    }
+}
+
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref_ippc (const float* x, const float* y,
+                                     const int64_t* ids, size_t d,
+                                     float* dis) {
+    const float* yp[N];
+
+    for (size_t j = 0; j < N; j++)
+        yp[j] = y + ids[j] * d;
+
+    fvec_inner_product_batch_N_ref_ippc<N> (x, yp, d, dis);
+}
+
+template void fvec_inner_product_batch_N_ref_ippc<2> (const float*,
+                                                      const float* const*,
+                                                      size_t, float*);
+template void fvec_inner_product_batch_N_ref_ippc<4> (const float*,
+                                                      const float* const*,
+                                                      size_t, float*);
+template void fvec_inner_product_batch_N_ref_ippc<8> (const float*,
+                                                      const float* const*,
+                                                      size_t, float*);
+template void fvec_inner_product_batch_N_ref_ippc<16> (const float*,
+                                                       const float* const*,
+                                                       size_t, float*);
+template void fvec_inner_product_batch_N_ref_ippc<2> (const float*,
+                                                      const float*,
+                                                      const int64_t*, size_t,
+                                                      float*);
+template void fvec_inner_product_batch_N_ref_ippc<4> (const float*,
+                                                      const float*,
+                                                      const int64_t*, size_t,
+                                                      float*);
+template void fvec_inner_product_batch_N_ref_ippc<8> (const float*,
+                                                      const float*,
+                                                      const int64_t*, size_t,
+                                                      float*);
+template void fvec_inner_product_batch_N_ref_ippc<16> (const float*,
+                                                       const float*,
+                                                       const int64_t*, size_t,
+                                                       float*);
+
+/* The four vectors prefetch_ahead positions after the current group are
+   prefetched before the group is compared.  */
+void
+fvec_inner_products_by_ids_ref_ippc (float* dis, const float* x, const float* y,
+                                     const int64_t* ids, size_t d, size_t n,
+                                     size_t prefetch_ahead) {
+    size_t j;
+
+    for (j = 0; j < n && j < prefetch_ahead; j++)
+        prefetch_span(y + ids[j] * d, d * sizeof(float));
+
+    for (j = 0; j + 4 <= n; j += 4) {
+        for (size_t t = j + prefetch_ahead;
+             t < j + 4 + prefetch_ahead && t < n; t++)
+            prefetch_span(y + ids[t] * d, d * sizeof(float));
+        fvec_inner_product_batch_N_ref_ippc<4>(x, y, ids + j, d, dis + j);
+    }
+    /* The last n % 4 vectors, with plain loops rather than
+       fvec_inner_product_ref_ippc, whose short vector path does not compute
+       an inner product.  */
+    for (; j < n; j++) {
+        const float* yj = y + ids[j] * d;
+        float res = 0;
+
+        for (size_t i = 0; i < d; i++)
+            res += x[i] * yj[i];
+        dis[j] = res;
+    }
+}
+
+#if defined(__MMA__)
+/* Number of x vectors computed against one y panel while it is in the L1
+   cache, a multiple of MMA_TILE_X.  */
+#define GEMM_BLOCK_X 64
+
+void
+fvec_inner_products_gemm_ippc (float* dis, const float* x, size_t nx,
+                               const float* y, size_t ny, size_t d) {
+    /* The y vectors are packed in panels of MMA_TILE_Y vectors stored
+       dimension by dimension, padded with zero vectors, as the centroids of
+       assign_to_nearest_ref_ippc.  */
+    const size_t nvy = MMA_TILE_Y / FLOAT_VEC_SIZE;
+    size_t npanels = (ny + MMA_TILE_Y - 1) / MMA_TILE_Y;
+    std::vector<float> panels(npanels * d * MMA_TILE_Y, 0.0f);
+
+    for (size_t j = 0; j < ny; j++) {
+        float* panel = &panels[(j / MMA_TILE_Y) * d * MMA_TILE_Y];
+
+        for (size_t l = 0; l < d; l++)
+            panel[l * MMA_TILE_Y + j % MMA_TILE_Y] = y[j * d + l];
+    }
+
+    vector_search::parallel_for ((nx + GEMM_BLOCK_X - 1) / GEMM_BLOCK_X, 1,
+                                 [&](size_t b0, size_t b1) {
+        std::vector<float> xpack(GEMM_BLOCK_X * d);
+        vector float vacc[MMA_TILE_X][nvy];
+        float res[MMA_TILE_X][MMA_TILE_Y];
+
+        for (size_t b = b0; b < b1; b++) {
+            size_t i0 = b * GEMM_BLOCK_X;
+            size_t i1 = std::min(nx, i0 + GEMM_BLOCK_X);
+            size_t ntiles = (i1 - i0 + MMA_TILE_X - 1) / MMA_TILE_X;
+
+            /* Each tile of x vectors is packed dimension by dimension.
+               Rows past the end of the block repeat the last vector, their
+               results are dropped.  */
+            for (size_t s = 0; s < ntiles; s++) {
+                float* tile = &xpack[s * d * MMA_TILE_X];
+
+                for (size_t t = 0; t < MMA_TILE_X; t++) {
+                    const float* xi = x + std::min(i0 + s * MMA_TILE_X + t,
+                                                   i1 - 1) * d;
+
+                    for (size_t l = 0; l < d; l++)
+                        tile[l * MMA_TILE_X + t] = xi[l];
+                }
+            }
+
+            for (size_t p = 0; p < npanels; p++) {
+                const float* panel = &panels[p * d * MMA_TILE_Y];
+                size_t j0 = p * MMA_TILE_Y;
+                size_t nj = std::min((size_t)MMA_TILE_Y, ny - j0);
+
+                for (size_t s = 0; s < ntiles; s++) {
+                    size_t i = i0 + s * MMA_TILE_X;
+
+                    mma_tile_inner_products (&xpack[s * d * MMA_TILE_X],
+                                             panel, d, vacc);
+
+                    for (size_t t = 0; t < MMA_TILE_X; t++)
+                        for (size_t q = 0; q < nvy; q++)
+                            vec_xst (vacc[t][q], 0,
+                                     &res[t][q * FLOAT_VEC_SIZE]);
+
+                    for (size_t t = 0; t < MMA_TILE_X && i + t < i1; t++)
+                        for (size_t j = 0; j < nj; j++)
+                            dis[(i + t) * ny + j0 + j] = res[t][j];
+                }
+            }
+        }
+    });
+}
+#endif
+
+template <size_t B>
+void
+fvec_inner_products_blocked_ref_ippc (float* dis, const float* x,
+                                      const float* yb, size_t d, size_t n) {
+    /* Row i of a block, component i of its B vectors, is B /
+       FLOAT_VEC_SIZE vectors whose lanes are compared to x[i] splatted.
+       Each lane accumulates the inner product of one database vector, so
+       no horizontal sum is needed.  The loop over d is unrolled so that
+       at least four independent accumulators are in flight.  */
+    static_assert(B % FLOAT_VEC_SIZE == 0 && B <= 16,
+                  "block size must be 4, 8 or 16");
+    constexpr size_t nv = B / FLOAT_VEC_SIZE;
+    constexpr size_t unroll = (nv >= 4) ? 1 : 4 / nv;
+    size_t base = (d / unroll) * unroll;
+
+    const float* row;
+    vector float vx;
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[unroll][nv];
+    float res[B];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        size_t i;
+
+        for (size_t u = 0; u < unroll; u++)
+            for (size_t v = 0; v < nv; v++)
+                vres[u][v] = vzero;
+
+        for (i = 0; i < base; i += unroll) {
+            for (size_t u = 0; u < unroll; u++) {
+                vx = vec_splats (x[i + u]);
+                row = yb + (i + u) * B;
+
+                for (size_t v = 0; v < nv; v++) {
+                    vector float vy = vec_xl (0, row + v * FLOAT_VEC_SIZE);
+
+                    vres[u][v] = vec_madd (vx, vy, vres[u][v]);
+                }
+            }
+        }
+        for (; i < d; i++) {
+            vx = vec_splats (x[i]);
+            row = yb + i * B;
+
+            for (size_t v = 0; v < nv; v++) {
+                vector float vy = vec_xl (0, row + v * FLOAT_VEC_SIZE);
+
+                vres[0][v] = vec_madd (vx, vy, vres[0][v]);
+            }
+        }
+
+        for (size_t v = 0; v < nv; v++) {
+            for (size_t u = 1; u < unroll; u++)
+                vres[0][v] = vec_add (vres[0][v], vres[u][v]);
+            vec_xst (vres[0][v], 0, &res[v * FLOAT_VEC_SIZE]);
+        }
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = res[t];
+    }
+}
+
+template void fvec_inner_products_blocked_ref_ippc<4> (float*, const float*,
+                                                       const float*, size_t,
+                                                       size_t);
+template void fvec_inner_products_blocked_ref_ippc<8> (float*, const float*,
+                                                       const float*, size_t,
+                                                       size_t);
+template void fvec_inner_products_blocked_ref_ippc<16> (float*, const float*,
+                                                        const float*, size_t,
+                                                        size_t);
+
 int32_t
 ivec_inner_product_ref_ippc(const int8_t* x, const int8_t* y, size_t d) {
     size_t i;
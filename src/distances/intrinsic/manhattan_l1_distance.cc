@@ -77,31 +77,46 @@ fvec_Linf_ref_ippc (const float* x, const float* y, size_t d) {
        }
        return res;
     */
-    /* Vector implmentaion uses vector size of FLOAT_VEC_SIZE.  If the input
-       array size is not a power of FLOAT_VEC_SIZE, do the remaining elements
-       in scalar mode.  */
-    size_t base;
-
-    vector float vx, vy;
-    vector float vtmp = {0, 0, 0, 0};
-    vector float vres = {0, 0, 0, 0};
-
-    base = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
-
-    for (size_t i = 0; i < base; i = i + FLOAT_VEC_SIZE) {
-        vx = vec_xl ((long)(i*sizeof(float)), (float *) x);
-        vy = vec_xl ((long)(i*sizeof(float)), (float *) y);
+    /* The loop is unrolled by 4 with a separate running maximum per
+       vector, the four vectors are only combined at the end.  The remaining
+       full vectors are done one at a time and the elements that do not fill
+       a vector in scalar mode.  */
+    size_t base, vbase;
+    const size_t factor = 4 * FLOAT_VEC_SIZE;
+
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres0 = vzero;
+    vector float vres1 = vzero;
+    vector float vres2 = vzero;
+    vector float vres3 = vzero;
+
+    base = (d / factor) * factor;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += factor) {
+        vres0 = vec_max (vres0, vec_abs (vec_sub (vec_xl (0, &x[i]),
+                                                  vec_xl (0, &y[i]))));
+        vres1 = vec_max (vres1, vec_abs (vec_sub (vec_xl (16, &x[i]),
+                                                  vec_xl (16, &y[i]))));
+        vres2 = vec_max (vres2, vec_abs (vec_sub (vec_xl (32, &x[i]),
+                                                  vec_xl (32, &y[i]))));
+        vres3 = vec_max (vres3, vec_abs (vec_sub (vec_xl (48, &x[i]),
+                                                  vec_xl (48, &y[i]))));
+    }
 
-        vtmp = vec_sub(vx, vy);
-        vtmp = vec_abs(vtmp);
-        res = std::fmax(res, vtmp[0]);
-        res = std::fmax(res, vtmp[1]);
-        res = std::fmax(res, vtmp[2]);
-        res = std::fmax(res, vtmp[3]);
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vres0 = vec_max (vres0, vec_abs (vec_sub (vec_xl (0, &x[i]),
+                                                  vec_xl (0, &y[i]))));
     }
 
+    vres0 = vec_max (vec_max (vres0, vres1), vec_max (vres2, vres3));
+    res = std::fmax (std::fmax (vec_extract (vres0, 0),
+                                vec_extract (vres0, 1)),
+                     std::fmax (vec_extract (vres0, 2),
+                                vec_extract (vres0, 3)));
+
     /* Handle any remaining data elements */
-    for (i = base; i < d; i++) {
+    for (i = vbase; i < d; i++) {
         res = std::fmax(res, std::fabs(x[i] - y[i]));
     }
 
@@ -118,24 +133,38 @@ fvec_madd_ref_ippc (size_t n, const float* a, float bf, const float* b,
            c[i] = a[i] + bf * b[i];
        }
    */
-    /* Vector implmentaion uses vector size of FLOAT_VEC_SIZE.  If the input
-       array size is not a power of FLOAT_VEC_SIZE, do the remaining elements
-       in scalar mode.  */
-    size_t base;
-    vector float va, vb, vc, vbf = {bf, bf, bf, bf};
-
-    base = (n / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
-
-    for (size_t i = 0; i < base; i = i + FLOAT_VEC_SIZE) {
-        va = vec_xl ((long)(i*sizeof(float)), (float *) a);
-        vb = vec_xl ((long)(i*sizeof(float)), (float *) b);
+    /* The loop is unrolled by 4 vectors.  The remaining full vectors are
+       done one at a time and the elements that do not fill a vector in
+       scalar mode.  */
+    size_t i, base, vbase;
+    const size_t factor = 4 * FLOAT_VEC_SIZE;
+    vector float vbf = vec_splats (bf);
+
+    base = (n / factor) * factor;
+    vbase = (n / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += factor) {
+        vector float vc0 = vec_madd (vec_xl (0, &b[i]), vbf, vec_xl (0, &a[i]));
+        vector float vc1 = vec_madd (vec_xl (16, &b[i]), vbf,
+                                     vec_xl (16, &a[i]));
+        vector float vc2 = vec_madd (vec_xl (32, &b[i]), vbf,
+                                     vec_xl (32, &a[i]));
+        vector float vc3 = vec_madd (vec_xl (48, &b[i]), vbf,
+                                     vec_xl (48, &a[i]));
+
+        vec_xst (vc0, 0, &c[i]);
+        vec_xst (vc1, 16, &c[i]);
+        vec_xst (vc2, 32, &c[i]);
+        vec_xst (vc3, 48, &c[i]);
+    }
 
-        vc = vec_madd (vb, vbf, va);
-        vec_xst (vc, (long)(i*sizeof(float)), c);
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vector float vc = vec_madd (vec_xl (0, &b[i]), vbf, vec_xl (0, &a[i]));
+        vec_xst (vc, 0, &c[i]);
     }
 
     /* Handle any remaining data elements */
-    for (size_t i = base; i < n; i++) {
+    for (i = vbase; i < n; i++) {
         c[i] = a[i] + bf * b[i];
     }
 }
@@ -158,34 +187,76 @@ fvec_madd_and_argmin_ref_ippc (size_t n, const float* a, float bf,
        }
        return imin;
     */
-    /* Vector implmentaion uses vector size of FLOAT_VEC_SIZE.  If the input
-       array size is not a power of FLOAT_VEC_SIZE, do the remaining elements
-       in scalar mode.  */
-    vector float va, vb, vc;
-    vector float vbf = {bf, bf, bf, bf};
+    /* Each vector lane keeps its own minimum and the index where it was
+       found.  A compare and two selects update all the lanes at once, there
+       is no compare and branch per element.  The loop is unrolled by 4 with
+       separate minimum and index vectors, the 16 lanes are merged at the
+       end.  Merging on (value, index) returns the first index of the
+       minimum, like the scalar code.  */
+    size_t i, base, vbase;
+    const size_t factor = 4 * FLOAT_VEC_SIZE;
     float vmin = 1.0e20;
     int imin = -1;
-    size_t base;
 
-    base = (n / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+    vector float vbf = vec_splats (bf);
+    vector float vc[4], vmins[4];
+    vector signed int vidx[4], vimin[4];
+    vector bool int vlt;
+    vector signed int vstep = vec_splats ((int) factor);
+    vector signed int vstep1 = vec_splats ((int) FLOAT_VEC_SIZE);
 
-    for (size_t i = 0; i < base; i = i + FLOAT_VEC_SIZE) {
-        va = vec_xl ((long)(i*sizeof(float)), (float *) a);
-        vb = vec_xl ((long)(i*sizeof(float)), (float *) b);
+    for (int u = 0; u < 4; u++) {
+        vector signed int vlane = {0, 1, 2, 3};
+
+        vmins[u] = vec_splats (vmin);
+        vimin[u] = vec_splats (imin);
+        vidx[u] = vec_add (vlane, vec_splats (u * FLOAT_VEC_SIZE));
+    }
+
+    base = (n / factor) * factor;
+    vbase = (n / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += factor) {
+        for (int u = 0; u < 4; u++) {
+            vc[u] = vec_madd (vec_xl (16 * u, &b[i]), vbf,
+                              vec_xl (16 * u, &a[i]));
+            vec_xst (vc[u], 16 * u, &c[i]);
+
+            vlt = vec_cmplt (vc[u], vmins[u]);
+            vmins[u] = vec_sel (vmins[u], vc[u], vlt);
+            vimin[u] = vec_sel (vimin[u], vidx[u], vlt);
+            vidx[u] = vec_add (vidx[u], vstep);
+        }
+    }
 
-	vc = vec_madd(vbf, vb, va);
+    /* Remaining full vectors, vidx[0] already holds the indexes of the
+       next vector.  */
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vc[0] = vec_madd (vec_xl (0, &b[i]), vbf, vec_xl (0, &a[i]));
+        vec_xst (vc[0], 0, &c[i]);
 
-        /* Checke each vector element */
+        vlt = vec_cmplt (vc[0], vmins[0]);
+        vmins[0] = vec_sel (vmins[0], vc[0], vlt);
+        vimin[0] = vec_sel (vimin[0], vidx[0], vlt);
+        vidx[0] = vec_add (vidx[0], vstep1);
+    }
+
+    /* Merge the lanes.  */
+    for (int u = 0; u < 4; u++) {
         for (int j = 0; j < FLOAT_VEC_SIZE; j++) {
-            if (vc[j] < vmin) {
-                vmin = c[i + j];
-                imin = i + j;
-             }
+            float lane_min = vec_extract (vmins[u], j);
+            int lane_imin = vec_extract (vimin[u], j);
+
+            if (lane_min < vmin || (lane_min == vmin && lane_imin < imin)) {
+                vmin = lane_min;
+                imin = lane_imin;
+            }
         }
     }
 
     /* Handle any remaining data elements */
-    for (size_t i = base; i < n; i++) {
+    for (i = vbase; i < n; i++) {
+        c[i] = a[i] + bf * b[i];
         if (c[i] < vmin) {
             vmin = c[i];
             imin = i;
@@ -32,10 +32,13 @@ fvec_L1_ref_ippc(const float* x, const float* y, size_t d);
 float
 fvec_Linf_ref_ippc(const float* x, const float* y, size_t d);
 
+/// c = a + bf * b
 void
 fvec_madd_ref_ippc(size_t n, const float* a, float bf, const float* b,
                    float* c);
 
+/// same as fvec_madd_ref_ippc, also returns the index of the smallest
+/// element of c (the first one in case of ties)
 int
 fvec_madd_and_argmin_ref_ippc(size_t n, const float* a, float bf,
                               const float* b, float* c);
@@ -0,0 +1,74 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Tile of inner products computed with the Power10 MMA outer product
+   instructions, shared by the intrinsic kernels that multiply a block of
+   vectors by another (assign_to_nearest, the GEMM of the linear
+   transforms).  Only used by the intrinsic .cc files, after altivec.h.  */
+
+#ifndef DISTANCES_INTRINSIC_MMA_TILE_H
+#define DISTANCES_INTRINSIC_MMA_TILE_H
+
+/* A tile is MMA_TILE_X x vectors by MMA_TILE_Y y vectors, four 4 x 4
+   accumulators.  */
+#define MMA_TILE_X  4
+#define MMA_TILE_Y  16
+
+#if defined(__MMA__)
+
+#include <cstddef>
+
+namespace powerpc {
+
+/* vacc[t][q] holds the inner products of x vector t with y vectors q * 4 to
+   q * 4 + 3.  xpack holds the MMA_TILE_X x vectors and panel the MMA_TILE_Y
+   y vectors, both stored dimension by dimension, so that each dimension is
+   one rank-one update of the four accumulators.  */
+static inline void
+mma_tile_inner_products (const float* xpack, const float* panel, size_t d,
+                         vector float vacc[MMA_TILE_X][MMA_TILE_Y / 4]) {
+    const size_t nvy = MMA_TILE_Y / 4;
+    __vector_quad acc[nvy];
+
+    for (size_t q = 0; q < nvy; q++)
+        __builtin_mma_xxsetaccz (&acc[q]);
+
+    for (size_t l = 0; l < d; l++) {
+        vector float vxf = vec_xl (0, &xpack[l * MMA_TILE_X]);
+        vector unsigned char vx = (vector unsigned char) vxf;
+
+        for (size_t q = 0; q < nvy; q++) {
+            vector float vy = vec_xl (0, &panel[l * MMA_TILE_Y + q * 4]);
+
+            __builtin_mma_xvf32gerpp (&acc[q], vx, (vector unsigned char) vy);
+        }
+    }
+
+    for (size_t q = 0; q < nvy; q++) {
+        vector float vres[MMA_TILE_X];
+
+        __builtin_mma_disassemble_acc (vres, &acc[q]);
+        for (size_t t = 0; t < MMA_TILE_X; t++)
+            vacc[t][q] = vres[t];
+    }
+}
+
+}  // namespace powerpc
+
+#endif /* __MMA__ */
+
+#endif /* DISTANCES_INTRINSIC_MMA_TILE_H */
@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include "cosine_distance.h"
+#include <altivec.h>   /* Required for the Power GCC built-ins  */
 
 #include <cmath>
 
@@ -242,6 +243,81 @@ cosine_distance_ref_ppc (const float* x, const float* y, size_t d)
     return res;
 }
 
+template <size_t B>
+void
+cosine_distances_blocked_ref_ppc(float* dis, const float* x, const float* yb,
+                                 size_t d, size_t n) {
+    /* Same structure as fvec_inner_products_blocked_ref_ppc, with a
+       second set of accumulators for the squared norms of the database
+       vectors.  The squared norm of x is computed once.  */
+    static_assert(B % FLOAT_VEC_SIZE == 0 && B <= 16,
+                  "block size must be 4, 8 or 16");
+    constexpr size_t nv = B / FLOAT_VEC_SIZE;
+    constexpr size_t unroll = (nv >= 4) ? 1 : 4 / nv;
+    size_t base = (d / unroll) * unroll;
+
+    vector float *vy;
+    vector float vx;
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[unroll][nv];
+    vector float vnorm[unroll][nv];
+    float res[B], norm[B], mag_vx = 0;
+
+    for (size_t i = 0; i < d; i++)
+        mag_vx += x[i] * x[i];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        size_t i;
+
+        for (size_t u = 0; u < unroll; u++)
+            for (size_t v = 0; v < nv; v++)
+                vres[u][v] = vnorm[u][v] = vzero;
+
+        for (i = 0; i < base; i += unroll) {
+            for (size_t u = 0; u < unroll; u++) {
+                vx = vec_splats(x[i + u]);
+                vy = (vector float *)(&yb[(i + u) * B]);
+
+                for (size_t v = 0; v < nv; v++) {
+                    vres[u][v] += vx * vy[v];
+                    vnorm[u][v] += vy[v] * vy[v];
+                }
+            }
+        }
+        for (; i < d; i++) {
+            vx = vec_splats(x[i]);
+            vy = (vector float *)(&yb[i * B]);
+
+            for (size_t v = 0; v < nv; v++) {
+                vres[0][v] += vx * vy[v];
+                vnorm[0][v] += vy[v] * vy[v];
+            }
+        }
+
+        for (size_t v = 0; v < nv; v++) {
+            for (size_t u = 1; u < unroll; u++) {
+                vres[0][v] += vres[u][v];
+                vnorm[0][v] += vnorm[u][v];
+            }
+            for (size_t l = 0; l < FLOAT_VEC_SIZE; l++) {
+                res[v * FLOAT_VEC_SIZE + l] = vres[0][v][l];
+                norm[v * FLOAT_VEC_SIZE + l] = vnorm[0][v][l];
+            }
+        }
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = 1.0f - res[t] / sqrt(mag_vx * norm[t]);
+    }
+}
+
+template void cosine_distances_blocked_ref_ppc<4>(float*, const float*,
+                                                  const float*, size_t, size_t);
+template void cosine_distances_blocked_ref_ppc<8>(float*, const float*,
+                                                  const float*, size_t, size_t);
+template void cosine_distances_blocked_ref_ppc<16>(float*, const float*,
+                                                   const float*, size_t,
+                                                   size_t);
+
 } // namespace powerpc
 
 #endif
@@ -23,6 +23,12 @@ namespace powerpc {
 
 float cosine_distance_ref_ppc(const float* x, const float* y, size_t d);
 
+/// Blocked layout cosine distances, see cosine_distances_blocked_ref
+template <size_t B>
+void
+cosine_distances_blocked_ref_ppc(float* dis, const float* x, const float* yb,
+                                 size_t d, size_t n);
+
 }
 
 #endif /* COSINE_POWERPC_H*/
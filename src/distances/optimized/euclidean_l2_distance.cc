@@ -19,13 +19,27 @@
 #include <altivec.h>   /* Required for the Power GCC built-ins  */
 
 #include "euclidean_l2_distance.h"
+#include "distances/prefetch.h"
+#include "utils/parallel.h"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 #define FLOAT_VEC_SIZE 4
 #define INT32_VEC_SIZE 4
 #define INT8_VEC_SIZE  16
 
+/* Must match the block size of base::fvec_L2sqr_bounded_ref.  */
+#define L2SQR_BOUNDED_BLOCK_SIZE 32
+
+/* assign_to_nearest computes tiles of ASSIGN_TILE_X vectors by
+   ASSIGN_TILE_C centroids, 16 vector accumulators.  ASSIGN_BLOCK_X vectors
+   are processed against one centroid panel while it is in the L1 cache.  */
+#define ASSIGN_TILE_X  4
+#define ASSIGN_TILE_C  16
+#define ASSIGN_BLOCK_X 64
+
 namespace powerpc {
 
 //vectorized optimization for L2sqr
@@ -537,6 +551,379 @@ fvec_L2sqr_batch_4_ref_ppc(const float* x, const float* y0, const float* y1,
     dis3 = vd3[0] + vd3[1] + vd3[2] + vd3[3] + d3;
 }
 
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref_ppc(const float* x, const float* const* y, size_t d,
+                           float* dis) {
+    /* Same computation as fvec_L2sqr_batch_4_ref_ppc for N vectors.  The
+       x chunk is loaded once and reused for all N y vectors.  The loop over
+       d is unrolled so that N * unroll = 16 independent accumulators are in
+       flight for every N, which fits in the 64 VSX registers.  */
+    static_assert(N > 0 && N <= 16, "batch size must be between 1 and 16");
+    constexpr size_t unroll = (N >= 16) ? 1 : 16 / N;
+    constexpr size_t factor = unroll * FLOAT_VEC_SIZE;
+    size_t base, vbase;
+
+    vector float *vx, *vy;
+    vector float vtmp;
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[N][unroll];
+
+    for (size_t j = 0; j < N; j++)
+        for (size_t u = 0; u < unroll; u++)
+            vres[j][u] = vzero;
+
+    base = (d / factor) * factor;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (size_t i = 0; i < base; i += factor) {
+        vx = (vector float *)(&x[i]);
+
+        for (size_t j = 0; j < N; j++) {
+            vy = (vector float *)(&y[j][i]);
+
+            for (size_t u = 0; u < unroll; u++) {
+                vtmp = vx[u] - vy[u];
+                vres[j][u] += vtmp * vtmp;
+            }
+        }
+    }
+
+    /* Remaining full vectors that do not fill an unrolled iteration.  */
+    for (size_t i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vx = (vector float *)(&x[i]);
+
+        for (size_t j = 0; j < N; j++) {
+            vy = (vector float *)(&y[j][i]);
+            vtmp = vx[0] - vy[0];
+            vres[j][0] += vtmp * vtmp;
+        }
+    }
+
+    for (size_t j = 0; j < N; j++) {
+        float res = 0;
+
+        for (size_t u = 1; u < unroll; u++)
+            vres[j][0] += vres[j][u];
+
+        /* Handle the remainder of the elements in scalar mode.  */
+        for (size_t i = vbase; i < d; i++) {
+            const float tmp = x[i] - y[j][i];
+            res += tmp * tmp;
+        }
+
+        dis[j] = res + vres[j][0][0] + vres[j][0][1] + vres[j][0][2]
+            + vres[j][0][3];
+    }
+}
+
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref_ppc(const float* x, const float* y, const int64_t* ids,
+                           size_t d, float* dis) {
+    const float* yp[N];
+
+    for (size_t j = 0; j < N; j++)
+        yp[j] = y + ids[j] * d;
+
+    fvec_L2sqr_batch_N_ref_ppc<N>(x, yp, d, dis);
+}
+
+template void fvec_L2sqr_batch_N_ref_ppc<2>(const float*, const float* const*,
+                                            size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ppc<4>(const float*, const float* const*,
+                                            size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ppc<8>(const float*, const float* const*,
+                                            size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ppc<16>(const float*, const float* const*,
+                                             size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ppc<2>(const float*, const float*,
+                                            const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ppc<4>(const float*, const float*,
+                                            const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ppc<8>(const float*, const float*,
+                                            const int64_t*, size_t, float*);
+template void fvec_L2sqr_batch_N_ref_ppc<16>(const float*, const float*,
+                                             const int64_t*, size_t, float*);
+
+/* The four vectors prefetch_ahead positions after the current group are
+   prefetched before the group is compared.  */
+void
+fvec_L2sqr_by_ids_ref_ppc(float* dis, const float* x, const float* y,
+                          const int64_t* ids, size_t d, size_t n,
+                          size_t prefetch_ahead) {
+    size_t j;
+
+    for (j = 0; j < n && j < prefetch_ahead; j++)
+        prefetch_span(y + ids[j] * d, d * sizeof(float));
+
+    for (j = 0; j + 4 <= n; j += 4) {
+        for (size_t t = j + prefetch_ahead;
+             t < j + 4 + prefetch_ahead && t < n; t++)
+            prefetch_span(y + ids[t] * d, d * sizeof(float));
+        fvec_L2sqr_batch_N_ref_ppc<4>(x, y, ids + j, d, dis + j);
+    }
+    for (; j < n; j++)
+        dis[j] = fvec_L2sqr_ref_ppc(x, y + ids[j] * d, d);
+}
+
+template <size_t B>
+void
+fvec_L2sqr_blocked_ref_ppc(float* dis, const float* x, const float* yb,
+                           size_t d, size_t n) {
+    /* Row i of a block, component i of its B vectors, is B /
+       FLOAT_VEC_SIZE vectors whose lanes are compared to x[i] splatted.
+       Each lane accumulates the distance of one database vector, so
+       no horizontal sum is needed.  The loop over d is unrolled so that
+       at least four independent accumulators are in flight.  */
+    static_assert(B % FLOAT_VEC_SIZE == 0 && B <= 16,
+                  "block size must be 4, 8 or 16");
+    constexpr size_t nv = B / FLOAT_VEC_SIZE;
+    constexpr size_t unroll = (nv >= 4) ? 1 : 4 / nv;
+    size_t base = (d / unroll) * unroll;
+
+    vector float *vy;
+    vector float vx, vtmp;
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[unroll][nv];
+    float res[B];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        size_t i;
+
+        for (size_t u = 0; u < unroll; u++)
+            for (size_t v = 0; v < nv; v++)
+                vres[u][v] = vzero;
+
+        for (i = 0; i < base; i += unroll) {
+            for (size_t u = 0; u < unroll; u++) {
+                vx = vec_splats(x[i + u]);
+                vy = (vector float *)(&yb[(i + u) * B]);
+
+                for (size_t v = 0; v < nv; v++) {
+                    vtmp = vx - vy[v];
+                    vres[u][v] += vtmp * vtmp;
+                }
+            }
+        }
+        for (; i < d; i++) {
+            vx = vec_splats(x[i]);
+            vy = (vector float *)(&yb[i * B]);
+
+            for (size_t v = 0; v < nv; v++) {
+                vtmp = vx - vy[v];
+                vres[0][v] += vtmp * vtmp;
+            }
+        }
+
+        for (size_t v = 0; v < nv; v++) {
+            for (size_t u = 1; u < unroll; u++)
+                vres[0][v] += vres[u][v];
+            for (size_t l = 0; l < FLOAT_VEC_SIZE; l++)
+                res[v * FLOAT_VEC_SIZE + l] = vres[0][v][l];
+        }
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = res[t];
+    }
+}
+
+template void fvec_L2sqr_blocked_ref_ppc<4>(float*, const float*, const float*,
+                                            size_t, size_t);
+template void fvec_L2sqr_blocked_ref_ppc<8>(float*, const float*, const float*,
+                                            size_t, size_t);
+template void fvec_L2sqr_blocked_ref_ppc<16>(float*, const float*, const float*,
+                                             size_t, size_t);
+
+float
+fvec_L2sqr_bounded_ref_ppc(const float* x, const float* y, size_t d,
+                           float threshold) {
+    /* A block of L2SQR_BOUNDED_BLOCK_SIZE elements is eight vectors, spread
+       over four accumulators.  The accumulators are only reduced to a scalar
+       for the threshold check at the end of each block.  */
+    size_t i, base, vbase;
+    float res = 0;
+
+    vector float *vx, *vy;
+    vector float vtmp0, vtmp1, vtmp2, vtmp3;
+    vector float vres0 = {0, 0, 0, 0};
+    vector float vres1 = {0, 0, 0, 0};
+    vector float vres2 = {0, 0, 0, 0};
+    vector float vres3 = {0, 0, 0, 0};
+    vector float vsum;
+
+    base = (d / L2SQR_BOUNDED_BLOCK_SIZE) * L2SQR_BOUNDED_BLOCK_SIZE;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += L2SQR_BOUNDED_BLOCK_SIZE) {
+        vx = (vector float *)(&x[i]);
+        vy = (vector float *)(&y[i]);
+
+        vtmp0 = vx[0] - vy[0];
+        vtmp1 = vx[1] - vy[1];
+        vtmp2 = vx[2] - vy[2];
+        vtmp3 = vx[3] - vy[3];
+        vres0 += vtmp0 * vtmp0;
+        vres1 += vtmp1 * vtmp1;
+        vres2 += vtmp2 * vtmp2;
+        vres3 += vtmp3 * vtmp3;
+
+        vtmp0 = vx[4] - vy[4];
+        vtmp1 = vx[5] - vy[5];
+        vtmp2 = vx[6] - vy[6];
+        vtmp3 = vx[7] - vy[7];
+        vres0 += vtmp0 * vtmp0;
+        vres1 += vtmp1 * vtmp1;
+        vres2 += vtmp2 * vtmp2;
+        vres3 += vtmp3 * vtmp3;
+
+        vsum = (vres0 + vres1) + (vres2 + vres3);
+        res = vsum[0] + vsum[1] + vsum[2] + vsum[3];
+
+        if (res > threshold)
+            return res;
+    }
+
+    /* Remaining full vectors.  */
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vx = (vector float *)(&x[i]);
+        vy = (vector float *)(&y[i]);
+
+        vtmp0 = vx[0] - vy[0];
+        vres0 += vtmp0 * vtmp0;
+    }
+
+    vsum = (vres0 + vres1) + (vres2 + vres3);
+    res = vsum[0] + vsum[1] + vsum[2] + vsum[3];
+
+    /* Handle any remaining data elements */
+    for (i = vbase; i < d; i++) {
+        const float tmp = x[i] - y[i];
+        res += tmp * tmp;
+    }
+
+    return res;
+}
+
+static void
+assign_block_ppc(const float* x, size_t i0, size_t i1, const float* panels,
+                 const float* cnorms, size_t npanels, size_t d, int64_t* ids,
+                 float* dists) {
+    const size_t nvc = ASSIGN_TILE_C / FLOAT_VEC_SIZE;
+    vector float vmin[ASSIGN_BLOCK_X];
+    vector signed int vimin[ASSIGN_BLOCK_X];
+    vector float vinf = vec_splats(HUGE_VALF);
+    vector float vzero = {0, 0, 0, 0};
+    vector float vtwo = {2, 2, 2, 2};
+    vector signed int vlane = {0, 1, 2, 3};
+
+    for (size_t r = 0; r < i1 - i0; r++) {
+        vmin[r] = vinf;
+        vimin[r] = vec_splats(-1);
+    }
+
+    for (size_t p = 0; p < npanels; p++) {
+        const float* panel = panels + p * d * ASSIGN_TILE_C;
+        vector float *vcn = (vector float *)(&cnorms[p * ASSIGN_TILE_C]);
+        vector signed int vidx[nvc];
+
+        for (size_t q = 0; q < nvc; q++)
+            vidx[q] = vlane + vec_splats((int)(p * ASSIGN_TILE_C
+                                               + q * FLOAT_VEC_SIZE));
+
+        for (size_t i = i0; i < i1; i += ASSIGN_TILE_X) {
+            const float* xp[ASSIGN_TILE_X];
+            vector float vacc[ASSIGN_TILE_X][nvc];
+
+            /* Rows past the end of the block repeat the last vector, their
+               results are dropped.  */
+            for (size_t t = 0; t < ASSIGN_TILE_X; t++) {
+                xp[t] = x + std::min(i + t, i1 - 1) * d;
+                for (size_t q = 0; q < nvc; q++)
+                    vacc[t][q] = vzero;
+            }
+
+            for (size_t l = 0; l < d; l++) {
+                vector float *vc = (vector float *)(&panel[l * ASSIGN_TILE_C]);
+
+                for (size_t t = 0; t < ASSIGN_TILE_X; t++) {
+                    vector float vx = vec_splats(xp[t][l]);
+
+                    for (size_t q = 0; q < nvc; q++)
+                        vacc[t][q] += vx * vc[q];
+                }
+            }
+
+            for (size_t t = 0; t < ASSIGN_TILE_X && i + t < i1; t++) {
+                size_t r = i + t - i0;
+
+                for (size_t q = 0; q < nvc; q++) {
+                    vector float vdist = vcn[q] - vtwo * vacc[t][q];
+                    vector bool int vlt = vec_cmplt(vdist, vmin[r]);
+
+                    vmin[r] = vec_sel(vmin[r], vdist, vlt);
+                    vimin[r] = vec_sel(vimin[r], vidx[q], vlt);
+                }
+            }
+        }
+    }
+
+    /* Merge the lanes on (distance, index), a lane only sees increasing
+       centroid indexes so the first nearest centroid is returned, as in
+       the reference version.  */
+    for (size_t r = 0; r < i1 - i0; r++) {
+        float dmin = HUGE_VALF;
+        int imin = -1;
+
+        for (int j = 0; j < FLOAT_VEC_SIZE; j++) {
+            if (vmin[r][j] < dmin
+                || (vmin[r][j] == dmin && vimin[r][j] < imin)) {
+                dmin = vmin[r][j];
+                imin = vimin[r][j];
+            }
+        }
+
+        /* Rounding can make the distance slightly negative.  */
+        dmin += fvec_norm_L2sqr_ref_ppc(x + (i0 + r) * d, d);
+        ids[i0 + r] = imin;
+        dists[i0 + r] = std::max(0.0f, dmin);
+    }
+}
+
+void
+assign_to_nearest_ref_ppc(const float* x, size_t n, const float* centroids,
+                          size_t k, size_t d, int64_t* ids, float* dists) {
+    /* The squared distance is |x|^2 + |c|^2 - 2 x . c, |x|^2 does not change
+       which centroid is nearest and is only added at the end.  The
+       centroids are packed in panels of ASSIGN_TILE_C centroids stored
+       dimension by dimension, so one vector load gets the same dimension of
+       four centroids.  Padding centroids have an infinite norm so they are
+       never selected.  */
+    size_t npanels = (k + ASSIGN_TILE_C - 1) / ASSIGN_TILE_C;
+    std::vector<float> panels(npanels * d * ASSIGN_TILE_C, 0.0f);
+    std::vector<float> cnorms(npanels * ASSIGN_TILE_C, HUGE_VALF);
+
+    for (size_t j = 0; j < k; j++) {
+        const float* c = centroids + j * d;
+        float* panel = &panels[(j / ASSIGN_TILE_C) * d * ASSIGN_TILE_C];
+
+        for (size_t l = 0; l < d; l++)
+            panel[l * ASSIGN_TILE_C + j % ASSIGN_TILE_C] = c[l];
+        cnorms[j] = fvec_norm_L2sqr_ref_ppc(c, d);
+    }
+
+    vector_search::parallel_for((n + ASSIGN_BLOCK_X - 1) / ASSIGN_BLOCK_X, 1,
+                                [&](size_t b0, size_t b1) {
+        for (size_t b = b0; b < b1; b++) {
+            size_t i0 = b * ASSIGN_BLOCK_X;
+            size_t i1 = std::min(n, i0 + ASSIGN_BLOCK_X);
+
+            assign_block_ppc(x, i0, i1, panels.data(), cnorms.data(), npanels,
+                             d, ids, dists);
+        }
+    });
+}
+
 int32_t
 ivec_L2sqr_ref_ppc(const int8_t* x, const int8_t* y, size_t d) {
     size_t i;
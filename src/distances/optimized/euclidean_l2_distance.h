@@ -44,6 +44,49 @@ fvec_L2sqr_batch_4_ref_ppc(const float* x, const float* y0, const float* y1,
                            const float* y2, const float* y3, const size_t d,
                            float& dis0, float& dis1, float& dis2, float& dis3);
 
+/// Generalization of fvec_L2sqr_batch_4_ref_ppc to N = 2, 4, 8 or 16
+/// database vectors, given as an array of N pointers.  The N distances are
+/// stored in dis[0..N-1].
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref_ppc(const float* x, const float* const* y, size_t d,
+                           float* dis);
+
+/// Gathered form of the above, the N vectors are y + ids[j] * d.
+template <size_t N>
+void
+fvec_L2sqr_batch_N_ref_ppc(const float* x, const float* y, const int64_t* ids,
+                           size_t d, float* dis);
+
+/// Squared L2 distance with early abandoning, see fvec_L2sqr_bounded_ref.
+float
+fvec_L2sqr_bounded_ref_ppc(const float* x, const float* y, size_t d,
+                           float threshold);
+
+/// Fused version of assign_to_nearest_ref.  The squared norms are
+/// computed once, the x . centroid products are computed in register
+/// blocked tiles of 4 vectors by 16 centroids and the running minimum is
+/// kept in vector registers.  The n vectors are spread over the
+/// parallel_for threads.
+void
+assign_to_nearest_ref_ppc(const float* x, size_t n, const float* centroids,
+                          size_t k, size_t d, int64_t* ids, float* dists);
+
+/// Gathered squared L2 distances with software prefetch, see
+/// fvec_L2sqr_by_ids_ref.  The distances are computed four at a
+/// time with the gathered batch kernel.
+void
+fvec_L2sqr_by_ids_ref_ppc(float* dis, const float* x, const float* y,
+                          const int64_t* ids, size_t d, size_t n,
+                          size_t prefetch_ahead);
+
+/// Blocked layout squared L2 distances, see fvec_L2sqr_blocked_ref.
+/// One vector load reads a component of FLOAT_VEC_SIZE database vectors.
+template <size_t B>
+void
+fvec_L2sqr_blocked_ref_ppc(float* dis, const float* x, const float* yb,
+                           size_t d, size_t n);
+
 int32_t
 ivec_L2sqr_ref_ppc(const int8_t* x, const int8_t* y, size_t d);
 
@@ -65,6 +65,43 @@ size_t hamming_distance_ref_ppc(const uint8_t* vec1, const uint8_t* vec2,
     return distance;
 }  
 
+void bitplane_dot_ny_ref_ppc(uint32_t* dis, const uint8_t* planes,
+                             size_t nplanes, const uint8_t* codes,
+                             size_t code_size, size_t ny) {
+    size_t base;
+
+    base = (code_size / CHAR_VEC_SIZE) * CHAR_VEC_SIZE;
+
+    vector unsigned char *vc, *vp;
+    vector unsigned int zero = {0, 0, 0, 0};
+
+    for (size_t i = 0; i < ny; i++) {
+        const uint8_t* code = codes + i * code_size;
+        uint32_t dot = 0;
+
+        for (size_t p = 0; p < nplanes; p++) {
+            const uint8_t* plane = planes + p * code_size;
+            vector unsigned int vcount = zero;
+            uint32_t count = 0;
+
+            // Popcounts of 16 bytes at a time, summed into 4 words
+            for (size_t j = 0; j < base; j += CHAR_VEC_SIZE) {
+                vc = (vector unsigned char *)(&code[j]);
+                vp = (vector unsigned char *)(&plane[j]);
+                vcount = vec_sum4s(vec_popcnt(vc[0] & vp[0]), vcount);
+            }
+            count = vcount[0] + vcount[1] + vcount[2] + vcount[3];
+
+            // Handle any remaining elements (less than 16 bytes)
+            for (size_t j = base; j < code_size; j++)
+                count += __builtin_popcount(code[j] & plane[j]);
+
+            dot += count << p;
+        }
+        dis[i] = dot;
+    }
+}
+
 #else
     /* The test function will call the base code version of the function.
        Just need a function definition here for compiling.  */
@@ -75,6 +112,11 @@ size_t hamming_distance_ref_ppc(const uint8_t* vec1, const uint8_t* vec2,
     return distance;
 }
 
+void bitplane_dot_ny_ref_ppc(uint32_t* dis, const uint8_t* planes,
+                             size_t nplanes, const uint8_t* codes,
+                             size_t code_size, size_t ny) {
+}
+
 #endif
 
 } //namespace powerpc
@@ -19,6 +19,7 @@
 #include <altivec.h>   /* Required for the Power GCC built-ins  */
 
 #include "innerproduct.h"
+#include "distances/prefetch.h"
 
 #include <cmath>
 
@@ -278,6 +279,194 @@ fvec_inner_product_batch_4_ref_ppc(const float* __restrict x,
     }
 }
 
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref_ppc(const float* x, const float* const* y,
+                                   size_t d, float* dis) {
+    /* Same computation as fvec_inner_product_batch_4_ref_ppc for N
+       vectors.  The x chunk is loaded once and reused for all N y vectors,
+       the loop is unrolled so that N * unroll = 16 accumulators are in
+       flight for every N.  See fvec_L2sqr_batch_N_ref_ppc.  */
+    static_assert(N > 0 && N <= 16, "batch size must be between 1 and 16");
+    constexpr size_t unroll = (N >= 16) ? 1 : 16 / N;
+    constexpr size_t factor = unroll * FLOAT_VEC_SIZE;
+    size_t base, vbase;
+
+    vector float *vx, *vy;
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[N][unroll];
+
+    for (size_t j = 0; j < N; j++)
+        for (size_t u = 0; u < unroll; u++)
+            vres[j][u] = vzero;
+
+    base = (d / factor) * factor;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (size_t i = 0; i < base; i += factor) {
+        vx = (vector float *)(&x[i]);
+
+        for (size_t j = 0; j < N; j++) {
+            vy = (vector float *)(&y[j][i]);
+
+            for (size_t u = 0; u < unroll; u++)
+                vres[j][u] += vx[u] * vy[u];
+        }
+    }
+
+    /* Remaining full vectors that do not fill an unrolled iteration.  */
+    for (size_t i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vx = (vector float *)(&x[i]);
+
+        for (size_t j = 0; j < N; j++) {
+            vy = (vector float *)(&y[j][i]);
+            vres[j][0] += vx[0] * vy[0];
+        }
+    }
+
+    for (size_t j = 0; j < N; j++) {
+        float res = 0;
+
+        for (size_t u = 1; u < unroll; u++)
+            vres[j][0] += vres[j][u];
+
+        /* Handle the remainder of the elements in scalar mode.  */
+        for (size_t i = vbase; i < d; i++)
+            res += x[i] * y[j][i];
+
+        dis[j] = res + vres[j][0][0] + vres[j][0][1] + vres[j][0][2]
+            + vres[j][0][3];
+    }
+}
+
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref_ppc(const float* x, const float* y,
+                                   const int64_t* ids, size_t d, float* dis) {
+    const float* yp[N];
+
+    for (size_t j = 0; j < N; j++)
+        yp[j] = y + ids[j] * d;
+
+    fvec_inner_product_batch_N_ref_ppc<N>(x, yp, d, dis);
+}
+
+template void fvec_inner_product_batch_N_ref_ppc<2>(const float*,
+                                                    const float* const*,
+                                                    size_t, float*);
+template void fvec_inner_product_batch_N_ref_ppc<4>(const float*,
+                                                    const float* const*,
+                                                    size_t, float*);
+template void fvec_inner_product_batch_N_ref_ppc<8>(const float*,
+                                                    const float* const*,
+                                                    size_t, float*);
+template void fvec_inner_product_batch_N_ref_ppc<16>(const float*,
+                                                     const float* const*,
+                                                     size_t, float*);
+template void fvec_inner_product_batch_N_ref_ppc<2>(const float*, const float*,
+                                                    const int64_t*, size_t,
+                                                    float*);
+template void fvec_inner_product_batch_N_ref_ppc<4>(const float*, const float*,
+                                                    const int64_t*, size_t,
+                                                    float*);
+template void fvec_inner_product_batch_N_ref_ppc<8>(const float*, const float*,
+                                                    const int64_t*, size_t,
+                                                    float*);
+template void fvec_inner_product_batch_N_ref_ppc<16>(const float*,
+                                                     const float*,
+                                                     const int64_t*, size_t,
+                                                     float*);
+
+/* The four vectors prefetch_ahead positions after the current group are
+   prefetched before the group is compared.  */
+void
+fvec_inner_products_by_ids_ref_ppc(float* dis, const float* x, const float* y,
+                                   const int64_t* ids, size_t d, size_t n,
+                                   size_t prefetch_ahead) {
+    size_t j;
+
+    for (j = 0; j < n && j < prefetch_ahead; j++)
+        prefetch_span(y + ids[j] * d, d * sizeof(float));
+
+    for (j = 0; j + 4 <= n; j += 4) {
+        for (size_t t = j + prefetch_ahead;
+             t < j + 4 + prefetch_ahead && t < n; t++)
+            prefetch_span(y + ids[t] * d, d * sizeof(float));
+        fvec_inner_product_batch_N_ref_ppc<4>(x, y, ids + j, d, dis + j);
+    }
+    for (; j < n; j++)
+        dis[j] = fvec_inner_product_ref_ppc(x, y + ids[j] * d, d);
+}
+
+template <size_t B>
+void
+fvec_inner_products_blocked_ref_ppc(float* dis, const float* x, const float* yb,
+                                    size_t d, size_t n) {
+    /* Row i of a block, component i of its B vectors, is B /
+       FLOAT_VEC_SIZE vectors whose lanes are compared to x[i] splatted.
+       Each lane accumulates the inner product of one database vector, so
+       no horizontal sum is needed.  The loop over d is unrolled so that
+       at least four independent accumulators are in flight.  */
+    static_assert(B % FLOAT_VEC_SIZE == 0 && B <= 16,
+                  "block size must be 4, 8 or 16");
+    constexpr size_t nv = B / FLOAT_VEC_SIZE;
+    constexpr size_t unroll = (nv >= 4) ? 1 : 4 / nv;
+    size_t base = (d / unroll) * unroll;
+
+    vector float *vy;
+    vector float vx;
+    vector float vzero = {0, 0, 0, 0};
+    vector float vres[unroll][nv];
+    float res[B];
+
+    for (size_t j0 = 0; j0 < n; j0 += B, yb += B * d) {
+        size_t i;
+
+        for (size_t u = 0; u < unroll; u++)
+            for (size_t v = 0; v < nv; v++)
+                vres[u][v] = vzero;
+
+        for (i = 0; i < base; i += unroll) {
+            for (size_t u = 0; u < unroll; u++) {
+                vx = vec_splats(x[i + u]);
+                vy = (vector float *)(&yb[(i + u) * B]);
+
+                for (size_t v = 0; v < nv; v++) {
+                    vres[u][v] += vx * vy[v];
+                }
+            }
+        }
+        for (; i < d; i++) {
+            vx = vec_splats(x[i]);
+            vy = (vector float *)(&yb[i * B]);
+
+            for (size_t v = 0; v < nv; v++) {
+                vres[0][v] += vx * vy[v];
+            }
+        }
+
+        for (size_t v = 0; v < nv; v++) {
+            for (size_t u = 1; u < unroll; u++)
+                vres[0][v] += vres[u][v];
+            for (size_t l = 0; l < FLOAT_VEC_SIZE; l++)
+                res[v * FLOAT_VEC_SIZE + l] = vres[0][v][l];
+        }
+
+        for (size_t t = 0; t < B && j0 + t < n; t++)
+            dis[j0 + t] = res[t];
+    }
+}
+
+template void fvec_inner_products_blocked_ref_ppc<4>(float*, const float*,
+                                                     const float*, size_t,
+                                                     size_t);
+template void fvec_inner_products_blocked_ref_ppc<8>(float*, const float*,
+                                                     const float*, size_t,
+                                                     size_t);
+template void fvec_inner_products_blocked_ref_ppc<16>(float*, const float*,
+                                                      const float*, size_t,
+                                                      size_t);
+
 int32_t
 ivec_inner_product_ref_ppc(const int8_t* x, const int8_t* y, size_t d) {
     size_t i;
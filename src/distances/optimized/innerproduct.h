@@ -35,6 +35,34 @@ fvec_inner_product_batch_4_ref_ppc(const float* x, const float* y0,
                                    float& dis0, float& dis1, float& dis2,
                                    float& dis3);
 
+/// Generalization of fvec_inner_product_batch_4_ref_ppc to N = 2, 4, 8 or
+/// 16 database vectors, given as an array of N pointers.  The N inner
+/// products are stored in dis[0..N-1].
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref_ppc(const float* x, const float* const* y,
+                                   size_t d, float* dis);
+
+/// Gathered form of the above, the N vectors are y + ids[j] * d.
+template <size_t N>
+void
+fvec_inner_product_batch_N_ref_ppc(const float* x, const float* y,
+                                   const int64_t* ids, size_t d, float* dis);
+
+/// Gathered inner products with software prefetch, see
+/// fvec_inner_products_by_ids_ref.  The distances are computed four at a
+/// time with the gathered batch kernel.
+void
+fvec_inner_products_by_ids_ref_ppc(float* dis, const float* x, const float* y,
+                                   const int64_t* ids, size_t d, size_t n,
+                                   size_t prefetch_ahead);
+
+/// Blocked layout inner products, see fvec_inner_products_blocked_ref
+template <size_t B>
+void
+fvec_inner_products_blocked_ref_ppc(float* dis, const float* x, const float* yb,
+                                    size_t d, size_t n);
+
 int32_t
 ivec_inner_product_ref_ppc(const int8_t* x, const int8_t* y, size_t d);
 
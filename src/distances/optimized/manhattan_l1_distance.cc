@@ -69,6 +69,204 @@ fvec_L1_ref_ppc(const float* x, const float* y, size_t d) {
     return res + vres[0] + vres[1] + vres[2] + vres[3];
 }
 
+float
+fvec_Linf_ref_ppc(const float* x, const float* y, size_t d) {
+    size_t i;
+    float res = 0;
+    /* PowerPC, vectorize the function using PowerPC GCC built-in calls.
+       Original code:
+
+       for (i = 0; i < d; i++) {
+         res = std::fmax(res, std::fabs(x[i] - y[i]));
+       }
+       return res;
+    */
+    /* The loop is unrolled by 4 with a separate running maximum per
+       vector, the four vectors are only combined at the end.  */
+    size_t base, vbase;
+    const size_t factor = 4 * FLOAT_VEC_SIZE;
+
+    vector float *vx, *vy;
+    vector float vres0 = {0, 0, 0, 0};
+    vector float vres1 = {0, 0, 0, 0};
+    vector float vres2 = {0, 0, 0, 0};
+    vector float vres3 = {0, 0, 0, 0};
+
+    base = (d / factor) * factor;
+    vbase = (d / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += factor) {
+        vx = (vector float *)(&x[i]);
+        vy = (vector float *)(&y[i]);
+
+        vres0 = vec_max(vres0, vec_abs(vx[0] - vy[0]));
+        vres1 = vec_max(vres1, vec_abs(vx[1] - vy[1]));
+        vres2 = vec_max(vres2, vec_abs(vx[2] - vy[2]));
+        vres3 = vec_max(vres3, vec_abs(vx[3] - vy[3]));
+    }
+
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        vx = (vector float *)(&x[i]);
+        vy = (vector float *)(&y[i]);
+
+        vres0 = vec_max(vres0, vec_abs(vx[0] - vy[0]));
+    }
+
+    vres0 = vec_max(vec_max(vres0, vres1), vec_max(vres2, vres3));
+    res = std::fmax(std::fmax(vres0[0], vres0[1]),
+                    std::fmax(vres0[2], vres0[3]));
+
+    /* Handle any remaining data elements */
+    for (i = vbase; i < d; i++) {
+        res = std::fmax(res, std::fabs(x[i] - y[i]));
+    }
+
+    return res;
+}
+
+void
+fvec_madd_ref_ppc(size_t n, const float* a, float bf, const float* b,
+                  float* c) {
+    /* PowerPC, vectorize the function using PowerPC GCC built-in calls.
+       Original code:
+
+       for (size_t i = 0; i < n; i++) {
+           c[i] = a[i] + bf * b[i];
+       }
+    */
+    /* The loop is unrolled by 4 vectors.  */
+    size_t i, base, vbase;
+    const size_t factor = 4 * FLOAT_VEC_SIZE;
+
+    vector float *va, *vb, *vc;
+    vector float vbf = {bf, bf, bf, bf};
+
+    base = (n / factor) * factor;
+    vbase = (n / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += factor) {
+        va = (vector float *)(&a[i]);
+        vb = (vector float *)(&b[i]);
+        vc = (vector float *)(&c[i]);
+
+        vc[0] = va[0] + vbf * vb[0];
+        vc[1] = va[1] + vbf * vb[1];
+        vc[2] = va[2] + vbf * vb[2];
+        vc[3] = va[3] + vbf * vb[3];
+    }
+
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        va = (vector float *)(&a[i]);
+        vb = (vector float *)(&b[i]);
+        vc = (vector float *)(&c[i]);
+
+        vc[0] = va[0] + vbf * vb[0];
+    }
+
+    /* Handle any remaining data elements */
+    for (i = vbase; i < n; i++) {
+        c[i] = a[i] + bf * b[i];
+    }
+}
+
+int
+fvec_madd_and_argmin_ref_ppc(size_t n, const float* a, float bf,
+                             const float* b, float* c) {
+    /* PowerPC, vectorize the function using PowerPC GCC built-in calls.
+       Original code:
+
+       float vmin = 1e20;
+       int imin = -1;
+
+       for (size_t i = 0; i < n; i++) {
+           c[i] = a[i] + bf * b[i];
+           if (c[i] < vmin) {
+               vmin = c[i];
+               imin = i;
+            }
+       }
+       return imin;
+    */
+    /* Each vector lane keeps its own minimum and the index where it was
+       found, updated with a compare and two selects rather than a compare
+       and branch per element.  Unrolled by 2, the 8 lanes are merged on
+       (value, index) at the end so the first index of the minimum is
+       returned, like the scalar code.  */
+    size_t i, base, vbase;
+    const size_t factor = 2 * FLOAT_VEC_SIZE;
+    float vmin = 1.0e20;
+    int imin = -1;
+
+    vector float *va, *vb, *vc;
+    vector float vbf = {bf, bf, bf, bf};
+    vector float vmin0 = {vmin, vmin, vmin, vmin};
+    vector float vmin1 = vmin0;
+    vector signed int vimin0 = {imin, imin, imin, imin};
+    vector signed int vimin1 = vimin0;
+    vector signed int vidx0 = {0, 1, 2, 3};
+    vector signed int vidx1 = {4, 5, 6, 7};
+    vector signed int vstep = {8, 8, 8, 8};
+    vector signed int vstep1 = {4, 4, 4, 4};
+    vector bool int vlt0, vlt1;
+
+    base = (n / factor) * factor;
+    vbase = (n / FLOAT_VEC_SIZE) * FLOAT_VEC_SIZE;
+
+    for (i = 0; i < base; i += factor) {
+        va = (vector float *)(&a[i]);
+        vb = (vector float *)(&b[i]);
+        vc = (vector float *)(&c[i]);
+
+        vc[0] = va[0] + vbf * vb[0];
+        vc[1] = va[1] + vbf * vb[1];
+
+        vlt0 = vec_cmplt(vc[0], vmin0);
+        vlt1 = vec_cmplt(vc[1], vmin1);
+        vmin0 = vec_sel(vmin0, vc[0], vlt0);
+        vmin1 = vec_sel(vmin1, vc[1], vlt1);
+        vimin0 = vec_sel(vimin0, vidx0, vlt0);
+        vimin1 = vec_sel(vimin1, vidx1, vlt1);
+        vidx0 += vstep;
+        vidx1 += vstep;
+    }
+
+    /* Remaining full vector, vidx0 holds its indexes.  */
+    for (i = base; i < vbase; i += FLOAT_VEC_SIZE) {
+        va = (vector float *)(&a[i]);
+        vb = (vector float *)(&b[i]);
+        vc = (vector float *)(&c[i]);
+
+        vc[0] = va[0] + vbf * vb[0];
+
+        vlt0 = vec_cmplt(vc[0], vmin0);
+        vmin0 = vec_sel(vmin0, vc[0], vlt0);
+        vimin0 = vec_sel(vimin0, vidx0, vlt0);
+        vidx0 += vstep1;
+    }
+
+    /* Merge the lanes.  */
+    for (int j = 0; j < FLOAT_VEC_SIZE; j++) {
+        if (vmin0[j] < vmin || (vmin0[j] == vmin && vimin0[j] < imin)) {
+            vmin = vmin0[j];
+            imin = vimin0[j];
+        }
+        if (vmin1[j] < vmin || (vmin1[j] == vmin && vimin1[j] < imin)) {
+            vmin = vmin1[j];
+            imin = vimin1[j];
+        }
+    }
+
+    /* Handle any remaining data elements */
+    for (i = vbase; i < n; i++) {
+        c[i] = a[i] + bf * b[i];
+        if (c[i] < vmin) {
+            vmin = c[i];
+            imin = i;
+        }
+    }
+    return imin;
+}
+
 }  // namespace powerpc 
 
 #endif
@@ -24,6 +24,21 @@ namespace powerpc {
     float
     fvec_L1_ref_ppc(const float* x, const float* y, size_t d);
 
+    /// infinity distance
+    float
+    fvec_Linf_ref_ppc(const float* x, const float* y, size_t d);
+
+    /// c = a + bf * b
+    void
+    fvec_madd_ref_ppc(size_t n, const float* a, float bf, const float* b,
+                      float* c);
+
+    /// same as fvec_madd_ref_ppc, also returns the index of the smallest
+    /// element of c (the first one in case of ties)
+    int
+    fvec_madd_and_argmin_ref_ppc(size_t n, const float* a, float bf,
+                                 const float* b, float* c);
+
 } // namespace powerpc 
 
 #endif
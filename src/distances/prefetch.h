@@ -0,0 +1,45 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Software prefetch of the vectors read by the gathered distance kernels,
+   shared by all the code versions.  */
+
+#ifndef DISTANCES_PREFETCH_H
+#define DISTANCES_PREFETCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Size of the cache lines prefetched, that of POWER.  */
+#define PREFETCH_CACHE_LINE 128
+
+/* Default number of vectors prefetched ahead of the one being compared by
+   the gathered kernels.  Enough misses in flight to cover the memory
+   latency, without evicting the vectors before their use.  */
+#define PREFETCH_AHEAD 8
+
+/* Prefetch all the cache lines of [p, p + size).  On POWER,
+   __builtin_prefetch is a dcbt.  */
+static inline void
+prefetch_span(const void* p, size_t size) {
+    uintptr_t line = (uintptr_t)p & ~(uintptr_t)(PREFETCH_CACHE_LINE - 1);
+    uintptr_t end = (uintptr_t)p + size;
+
+    for (; line < end; line += PREFETCH_CACHE_LINE)
+        __builtin_prefetch((const void*)line);
+}
+
+#endif /* DISTANCES_PREFETCH_H */
@@ -0,0 +1,151 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "async_searcher.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace vector_search {
+
+AsyncSearcher::AsyncSearcher(size_t d, BatchSearchFunction search,
+                             const AsyncSearchParams& params)
+    : d(d), params(params), search(std::move(search)) {
+    this->params.max_batch = std::max(this->params.max_batch, (size_t)1);
+    dispatcher = std::thread(&AsyncSearcher::dispatch_loop, this);
+}
+
+AsyncSearcher::~AsyncSearcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeup.notify_one();
+    dispatcher.join();
+}
+
+/* The dispatcher is only woken up by the first query of a batch, which
+   starts the wait, and by the query that fills the batch.  */
+void
+AsyncSearcher::submit(const float* x, size_t k, Callback callback) {
+    Request request;
+    size_t queued;
+
+    request.x.assign(x, x + d);
+    request.k = k;
+    request.callback = std::move(callback);
+    request.arrival = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(request));
+        queued = queue.size();
+    }
+    if (queued == 1 || queued == params.max_batch)
+        wakeup.notify_one();
+}
+
+std::future<AsyncSearchResult>
+AsyncSearcher::submit(const float* x, size_t k) {
+    auto promise = std::make_shared<std::promise<AsyncSearchResult>>();
+
+    submit(x, k, [promise, k](const float* distances,
+                              const int64_t* labels) {
+        AsyncSearchResult result;
+
+        result.distances.assign(distances, distances + k);
+        result.labels.assign(labels, labels + k);
+        promise->set_value(std::move(result));
+    });
+    return promise->get_future();
+}
+
+AsyncSearchStats
+AsyncSearcher::stats() const {
+    AsyncSearchStats s;
+
+    s.nq = nq;
+    s.nbatches = nbatches;
+    return s;
+}
+
+/* A batch is closed when it is full or when its oldest query has waited
+   max_wait_us.  The queries that arrive while a batch is searched are
+   already late when the search returns, so under load the batches are
+   closed at once, with up to max_batch queries.  */
+void
+AsyncSearcher::dispatch_loop() {
+    std::chrono::microseconds max_wait(params.max_wait_us);
+    std::vector<Request> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (;;) {
+        wakeup.wait(lock, [this] { return stop || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        auto deadline = queue.front().arrival + max_wait;
+
+        while (!stop && queue.size() < params.max_batch) {
+            if (wakeup.wait_until(lock, deadline)
+                == std::cv_status::timeout)
+                break;
+        }
+
+        size_t n = std::min(queue.size(), params.max_batch);
+
+        batch.clear();
+        for (size_t i = 0; i < n; i++) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+
+        lock.unlock();
+        search_batch(batch);
+        lock.lock();
+    }
+}
+
+/* The queries of a batch are searched for the largest k of the batch, the
+   first k results of a query are its k nearest neighbors.  */
+void
+AsyncSearcher::search_batch(std::vector<Request>& batch) {
+    size_t n = batch.size(), k = 0;
+
+    for (const Request& r : batch)
+        k = std::max(k, r.k);
+
+    batch_x.resize(n * d);
+    batch_distances.resize(n * k);
+    batch_labels.resize(n * k);
+    for (size_t i = 0; i < n; i++)
+        std::copy(batch[i].x.begin(), batch[i].x.end(),
+                  batch_x.begin() + i * d);
+
+    if (k > 0)
+        search(n, batch_x.data(), k, batch_distances.data(),
+               batch_labels.data());
+
+    for (size_t i = 0; i < n; i++)
+        batch[i].callback(batch_distances.data() + i * k,
+                          batch_labels.data() + i * k);
+
+    nq += n;
+    nbatches++;
+}
+
+}  // namespace vector_search
@@ -0,0 +1,136 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INDEX_ASYNC_SEARCHER_H
+#define INDEX_ASYNC_SEARCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vector_search {
+
+/// Batched search of an index: the k nearest neighbors of the nq queries x,
+/// nq * k distances and labels
+typedef std::function<void(size_t nq, const float* x, size_t k,
+                           float* distances, int64_t* labels)>
+    BatchSearchFunction;
+
+/// Limits of the micro-batches of an AsyncSearcher
+struct AsyncSearchParams {
+    size_t max_batch = 32;      ///< largest number of queries of a batch
+    size_t max_wait_us = 200;   ///< longest wait of a query for its batch
+};
+
+/// Counters of an AsyncSearcher
+struct AsyncSearchStats {
+    size_t nq = 0;              ///< number of queries searched
+    size_t nbatches = 0;        ///< number of batches searched
+};
+
+/// Results of a query submitted to an AsyncSearcher, best first
+struct AsyncSearchResult {
+    std::vector<float> distances;
+    std::vector<int64_t> labels;
+};
+
+/// Asynchronous single-query interface to the batched search of an index.
+/// The queries submitted by any number of threads are queued, and a
+/// dispatcher thread coalesces them into micro-batches, which the index
+/// searches with its many-to-many kernels.  A batch is searched when it
+/// has max_batch queries or when its oldest query has waited max_wait_us,
+/// and while a batch is searched the next one fills up, so the batches
+/// grow with the load.  The results are delivered through a callback,
+/// called on the dispatcher thread, or a future.
+struct AsyncSearcher {
+    /// Called with the k distances and labels of a query
+    typedef std::function<void(const float* distances,
+                               const int64_t* labels)>
+        Callback;
+
+    /// Searcher of queries of dimension d with search
+    AsyncSearcher(size_t d, BatchSearchFunction search,
+                  const AsyncSearchParams& params = AsyncSearchParams());
+
+    /// Searcher of index, any index with a batched search method
+    template <typename Index>
+    explicit AsyncSearcher(const Index& index,
+                           const AsyncSearchParams& params =
+                               AsyncSearchParams())
+        : AsyncSearcher(index.d,
+                        [&index](size_t nq, const float* x, size_t k,
+                                 float* distances, int64_t* labels) {
+                            index.search(nq, x, k, distances, labels);
+                        },
+                        params) {}
+
+    /// Searches the queries still queued, then stops the dispatcher
+    ~AsyncSearcher();
+
+    AsyncSearcher(const AsyncSearcher&) = delete;
+    AsyncSearcher& operator=(const AsyncSearcher&) = delete;
+
+    /// Queue the query x, copied, for its k nearest neighbors, and call
+    /// callback with them
+    void submit(const float* x, size_t k, Callback callback);
+
+    /// Same, the results are the value of the returned future
+    std::future<AsyncSearchResult> submit(const float* x, size_t k);
+
+    AsyncSearchStats stats() const;
+
+    size_t d;
+    AsyncSearchParams params;
+
+  private:
+    struct Request {
+        std::vector<float> x;
+        size_t k;
+        Callback callback;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    BatchSearchFunction search;
+    std::deque<Request> queue;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop = false;
+    std::thread dispatcher;
+
+    std::atomic<size_t> nq{0};
+    std::atomic<size_t> nbatches{0};
+
+    /// queries and results of the batch, used by the dispatcher only
+    std::vector<float> batch_x;
+    std::vector<float> batch_distances;
+    std::vector<int64_t> batch_labels;
+
+    void dispatch_loop();
+    void search_batch(std::vector<Request>& batch);
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_ASYNC_SEARCHER_H */
@@ -0,0 +1,554 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "index_flat.h"
+
+#include "distances/distances.h"
+#include "utils/arena.h"
+#include "utils/id_bitmap.h"
+#include "utils/parallel.h"
+#include "utils/range_result.h"
+#include "utils/topk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/* Number of queries compared together to a block of the database.  The
+   block stays in the cache while the queries of the tile are scanned, so
+   the database is read from memory once per tile rather than once per
+   query.  */
+#define FLAT_QUERY_TILE 32
+
+/* Size of the database blocks, about half of the L2 cache of a core.  */
+#define FLAT_BLOCK_BYTES (256 * 1024)
+
+/* The database blocks are a multiple of the batch size of the one to many
+   kernels.  */
+#define FLAT_BATCH 16
+
+/* Relative cost of the distance of a vector loaded by label, compared to
+   the distance of a vector of a sequential scan.  A filtered search
+   computes the distances of the allowed labels directly when this costs
+   less than scanning the words of the filter with an allowed label.  */
+#define FLAT_GATHER_COST 4
+
+namespace vector_search {
+
+IndexFlat::IndexFlat(size_t d, MetricType metric) : d(d), metric(metric) {
+    if (metric == METRIC_HAMMING) {
+        if (d % 8 != 0) {
+            std::cout << "ERROR, the dimension of a Hamming index must be a "
+                      << "multiple of 8, got " << d << ".\n";
+            exit (-1);
+        }
+        code_size = d / 8;
+    } else {
+        code_size = d * sizeof(float);
+    }
+}
+
+void
+IndexFlat::add(size_t n, const float* x) {
+    if (metric == METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlat::add of float vectors to a Hamming "
+                  << "index.\n";
+        exit (-1);
+    }
+    add_codes(n, (const uint8_t*)x);
+}
+
+void
+IndexFlat::add(size_t n, const uint8_t* x) {
+    if (metric != METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlat::add of binary codes to a float "
+                  << "index.\n";
+        exit (-1);
+    }
+    add_codes(n, x);
+}
+
+void
+IndexFlat::add_codes(size_t n, const uint8_t* x) {
+    codes.append(x, n * code_size);
+
+    if (metric == METRIC_COSINE) {
+        const float* xf = (const float*)x;
+
+        for (size_t i = 0; i < n; i++)
+            norms.push_back(fvec_norm_L2sqr(xf + i * d, d));
+    }
+
+    ntotal += n;
+    removed.resize((ntotal + 63) / 64, 0);
+}
+
+size_t
+IndexFlat::remove_ids(size_t n, const int64_t* ids) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        int64_t id = ids[i];
+
+        if (id < 0 || (size_t)id >= ntotal || is_removed(id))
+            continue;
+        removed[id >> 6] |= uint64_t(1) << (id & 63);
+        count++;
+    }
+    nremoved += count;
+    return count;
+}
+
+void
+IndexFlat::reset() {
+    codes.clear();
+    norms.clear();
+    removed.clear();
+    ntotal = 0;
+    nremoved = 0;
+}
+
+void
+IndexFlat::compute_distances(const void* x, float x_norm, size_t j0,
+                             size_t j1, float* dis) const {
+    const float* xf = (const float*)x;
+    size_t j = j0;
+
+    switch (metric) {
+    case METRIC_L2:
+        fvec_L2sqr_ny(dis, xf, get_vector(j0), d, j1 - j0);
+        break;
+
+    case METRIC_INNER_PRODUCT:
+    case METRIC_COSINE:
+        fvec_inner_products_ny(dis, xf, get_vector(j0), d, j1 - j0);
+
+        /* Same formula as cosine_distance_ref, with the norms of the
+           stored vectors computed once in add.  */
+        if (metric == METRIC_COSINE)
+            for (j = j0; j < j1; j++)
+                dis[j - j0] = 1.0f - dis[j - j0] / sqrtf(x_norm * norms[j]);
+        break;
+
+    case METRIC_L1:
+        for (; j < j1; j++)
+            dis[j - j0] = fvec_L1(xf, get_vector(j), d);
+        break;
+
+    case METRIC_JACCARD:
+        for (; j < j1; j++)
+            dis[j - j0] = jaccard_distance(xf, get_vector(j), d);
+        break;
+
+    case METRIC_HAMMING:
+        for (; j < j1; j++)
+            dis[j - j0] = hamming_distance((const uint8_t*)x, get_code(j),
+                                           code_size);
+        break;
+    }
+}
+
+void
+IndexFlat::compute_distances_by_ids(const void* x, float x_norm,
+                                    const int64_t* ids, size_t n,
+                                    float* dis) const {
+    const float* xf = (const float*)x;
+    size_t j = 0;
+
+    switch (metric) {
+    case METRIC_L2:
+        fvec_L2sqr_by_ids(dis, xf, get_vector(0), ids, d, n);
+        break;
+
+    case METRIC_INNER_PRODUCT:
+    case METRIC_COSINE:
+        fvec_inner_products_by_ids(dis, xf, get_vector(0), ids, d, n);
+
+        if (metric == METRIC_COSINE)
+            for (j = 0; j < n; j++)
+                dis[j] = 1.0f - dis[j] / sqrtf(x_norm * norms[ids[j]]);
+        break;
+
+    case METRIC_L1:
+        for (; j < n; j++)
+            dis[j] = fvec_L1(xf, get_vector(ids[j]), d);
+        break;
+
+    case METRIC_JACCARD:
+        for (; j < n; j++)
+            dis[j] = jaccard_distance(xf, get_vector(ids[j]), d);
+        break;
+
+    case METRIC_HAMMING:
+        for (; j < n; j++)
+            dis[j] = hamming_distance((const uint8_t*)x, get_code(ids[j]),
+                                      code_size);
+        break;
+    }
+}
+
+/* Compare the queries [q0, q1) to the stored vectors [j0, j1), one database
+   block at a time, and add the results to heaps[0 .. q1 - q0 - 1].  With a
+   filter, the blocks with no allowed label are skipped, and in the other
+   blocks the distances are computed for the 64-label words of the filter
+   that have an allowed label, whose bits are then visited one by one.  */
+void
+IndexFlat::scan(const uint8_t* x, const float* x_norms, size_t q0, size_t q1,
+                size_t j0, size_t j1, const IDBitmap* filter,
+                TopK* heaps) const {
+    size_t block = std::max((size_t)FLAT_BATCH,
+                            FLAT_BLOCK_BYTES / code_size / FLAT_BATCH
+                            * FLAT_BATCH);
+    ArenaScope scope;
+    float* dis = scope.alloc<float>(block);
+    uint64_t* masks = scope.alloc<uint64_t>(filter ? block / 64 + 2 : 0);
+
+    for (size_t b0 = j0; b0 < j1; b0 += block) {
+        size_t b1 = std::min(b0 + block, j1);
+
+        size_t wb = b0 / 64, we = (b1 + 63) / 64;
+
+        if (filter) {
+            if (!filter->any(b0, b1))
+                continue;
+
+            /* Allowed and not removed labels of the words of the block,
+               the bits outside of [b0, b1) cleared.  */
+            for (size_t w = wb; w < we; w++) {
+                uint64_t bits = filter->word(w) & ~removed[w];
+
+                if (w == wb)
+                    bits &= ~uint64_t(0) << (b0 & 63);
+                if (w == we - 1 && (b1 & 63))
+                    bits &= (uint64_t(1) << (b1 & 63)) - 1;
+                masks[w - wb] = bits;
+            }
+        }
+
+        for (size_t q = q0; q < q1; q++) {
+            TopK& heap = heaps[q - q0];
+            float threshold;
+
+            /* The distances are computed for each run of words with an
+               allowed label.  */
+            for (size_t w = wb; filter && w < we;) {
+                size_t r = w;
+
+                while (r < we && masks[r - wb])
+                    r++;
+                if (r == w) {
+                    w++;
+                    continue;
+                }
+
+                size_t s0 = std::max(b0, w * 64);
+                size_t s1 = std::min(b1, r * 64);
+
+                compute_distances(x + q * code_size, x_norms ? x_norms[q] : 0,
+                                  s0, s1, dis + (s0 - b0));
+                threshold = heap.threshold();
+                for (; w < r; w++) {
+                    for (uint64_t bits = masks[w - wb]; bits;
+                         bits &= bits - 1) {
+                        size_t j = w * 64 + __builtin_ctzll(bits);
+
+                        if (heap.better(dis[j - b0], threshold)) {
+                            heap.push(dis[j - b0], j);
+                            threshold = heap.threshold();
+                        }
+                    }
+                }
+            }
+            if (filter)
+                continue;
+
+            compute_distances(x + q * code_size, x_norms ? x_norms[q] : 0,
+                              b0, b1, dis);
+
+            threshold = heap.threshold();
+            for (size_t j = b0; j < b1; j++) {
+                if (!heap.better(dis[j - b0], threshold))
+                    continue;
+                if (nremoved && is_removed(j))
+                    continue;
+                heap.push(dis[j - b0], j);
+                threshold = heap.threshold();
+            }
+        }
+    }
+}
+
+void
+IndexFlat::search(size_t nq, const float* x, size_t k, float* distances,
+                  int64_t* labels, const IDBitmap* filter) const {
+    if (metric == METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlat::search with float queries in a "
+                  << "Hamming index.\n";
+        exit (-1);
+    }
+    search_codes(nq, (const uint8_t*)x, k, distances, labels, filter);
+}
+
+void
+IndexFlat::search(size_t nq, const uint8_t* x, size_t k, float* distances,
+                  int64_t* labels, const IDBitmap* filter) const {
+    if (metric != METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlat::search with binary queries in a "
+                  << "float index.\n";
+        exit (-1);
+    }
+    search_codes(nq, x, k, distances, labels, filter);
+}
+
+/* With enough queries, the query tiles are spread over the threads and each
+   thread scans the whole database.  Otherwise the database is split in one
+   slice per thread, each thread keeps its own heaps for all the queries and
+   the heaps are merged at the end, so that a single query still uses all
+   the memory bandwidth.  */
+void
+IndexFlat::search_codes(size_t nq, const uint8_t* x, size_t k,
+                        float* distances, int64_t* labels,
+                        const IDBitmap* filter) const {
+    bool largest = is_similarity_metric(metric);
+    size_t ntiles = (nq + FLAT_QUERY_TILE - 1) / FLAT_QUERY_TILE;
+    size_t nslices = get_num_threads();
+    ArenaScope scope;
+    float* x_norms = nullptr;
+
+    if (nq == 0 || k == 0)
+        return;
+
+    if (metric == METRIC_COSINE) {
+        x_norms = scope.alloc<float>(nq);
+        for (size_t q = 0; q < nq; q++)
+            x_norms[q] = fvec_norm_L2sqr((const float*)x + q * d, d);
+    }
+    const float* norms_ptr = x_norms;
+
+    if (filter && filter->count() * FLAT_GATHER_COST
+                  < filter->nonzero_words() * 64) {
+        int64_t* ids = scope.alloc<int64_t>(filter->count());
+        size_t nids = filter->get_ids(0, ntotal, ids);
+
+        if (nremoved)
+            nids = std::remove_if(ids, ids + nids,
+                                  [this](int64_t id) {
+                                      return is_removed(id);
+                                  })
+                   - ids;
+        search_ids(nq, x, norms_ptr, k, ids, nids, distances, labels);
+        return;
+    }
+
+    nslices = std::min(nslices, std::max((size_t)1, ntotal / FLAT_BATCH));
+
+    if (ntiles >= nslices) {
+        parallel_for(ntiles, 1, [&](size_t t0, size_t t1) {
+            ScratchVector<TopK> heaps(FLAT_QUERY_TILE, TopK(k, largest));
+
+            for (size_t t = t0; t < t1; t++) {
+                size_t q0 = t * FLAT_QUERY_TILE;
+                size_t q1 = std::min(q0 + FLAT_QUERY_TILE, nq);
+
+                for (TopK& heap : heaps)
+                    heap.clear();
+                scan(x, norms_ptr, q0, q1, 0, ntotal, filter, heaps.data());
+                for (size_t q = q0; q < q1; q++)
+                    heaps[q - q0].extract(distances + q * k, labels + q * k);
+            }
+        });
+        return;
+    }
+
+    ScratchVector<TopK> heaps(nslices * nq, TopK(k, largest));
+
+    parallel_for(nslices, 1, [&](size_t s0, size_t s1) {
+        for (size_t s = s0; s < s1; s++) {
+            size_t j0 = s * ntotal / nslices;
+            size_t j1 = (s + 1) * ntotal / nslices;
+
+            for (size_t q0 = 0; q0 < nq; q0 += FLAT_QUERY_TILE) {
+                size_t q1 = std::min(q0 + FLAT_QUERY_TILE, nq);
+
+                scan(x, norms_ptr, q0, q1, j0, j1, filter,
+                     &heaps[s * nq + q0]);
+            }
+        }
+    });
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        for (size_t q = q0; q < q1; q++) {
+            for (size_t s = 1; s < nslices; s++)
+                heaps[q].merge(heaps[s * nq + q]);
+            heaps[q].extract(distances + q * k, labels + q * k);
+        }
+    });
+}
+
+/* Search among the stored vectors ids only.  As in search_codes, the
+   queries are spread over the threads when there are enough of them,
+   otherwise the ids are split in one slice per thread.  */
+void
+IndexFlat::search_ids(size_t nq, const uint8_t* x, const float* x_norms,
+                      size_t k, const int64_t* ids, size_t nids,
+                      float* distances, int64_t* labels) const {
+    bool largest = is_similarity_metric(metric);
+    size_t nslices = std::min((size_t)get_num_threads(),
+                              std::max((size_t)1, nids / FLAT_BATCH));
+
+    auto search_slice = [&](size_t q, size_t i0, size_t i1, TopK& heap) {
+        const size_t nb = FLAT_BATCH * 16;
+        ArenaScope scope;
+        float* dis = scope.alloc<float>(nb);
+
+        for (size_t b0 = i0; b0 < i1; b0 += nb) {
+            size_t b1 = std::min(b0 + nb, i1);
+            float threshold;
+
+            compute_distances_by_ids(x + q * code_size,
+                                     x_norms ? x_norms[q] : 0,
+                                     ids + b0, b1 - b0, dis);
+            threshold = heap.threshold();
+            for (size_t i = b0; i < b1; i++) {
+                if (heap.better(dis[i - b0], threshold)) {
+                    heap.push(dis[i - b0], ids[i]);
+                    threshold = heap.threshold();
+                }
+            }
+        }
+    };
+
+    if (nq >= nslices) {
+        parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+            TopK heap(k, largest);
+
+            for (size_t q = q0; q < q1; q++) {
+                heap.clear();
+                search_slice(q, 0, nids, heap);
+                heap.extract(distances + q * k, labels + q * k);
+            }
+        });
+        return;
+    }
+
+    ScratchVector<TopK> heaps(nslices * nq, TopK(k, largest));
+
+    parallel_for(nslices, 1, [&](size_t s0, size_t s1) {
+        for (size_t s = s0; s < s1; s++)
+            for (size_t q = 0; q < nq; q++)
+                search_slice(q, s * nids / nslices,
+                             (s + 1) * nids / nslices,
+                             heaps[s * nq + q]);
+    });
+
+    for (size_t q = 0; q < nq; q++) {
+        for (size_t s = 1; s < nslices; s++)
+            heaps[q].merge(heaps[s * nq + q]);
+        heaps[q].extract(distances + q * k, labels + q * k);
+    }
+}
+
+void
+IndexFlat::range_search(size_t nq, const float* x, float radius,
+                        RangeSearchResult& result) const {
+    if (metric == METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlat::range_search with float queries in "
+                  << "a Hamming index.\n";
+        exit (-1);
+    }
+    range_search_codes(nq, (const uint8_t*)x, radius, result);
+}
+
+void
+IndexFlat::range_search(size_t nq, const uint8_t* x, float radius,
+                        RangeSearchResult& result) const {
+    if (metric != METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlat::range_search with binary queries in "
+                  << "a float index.\n";
+        exit (-1);
+    }
+    range_search_codes(nq, x, radius, result);
+}
+
+/* Compare the queries [q0, q1) to the stored vectors [j0, j1), one database
+   block at a time as in scan, and add the hits to partial.  */
+void
+IndexFlat::range_scan(const uint8_t* x, const float* x_norms, size_t q0,
+                      size_t q1, size_t j0, size_t j1, float radius,
+                      RangeSearchPartial& partial) const {
+    bool largest = is_similarity_metric(metric);
+    size_t block = std::max((size_t)FLAT_BATCH,
+                            FLAT_BLOCK_BYTES / code_size / FLAT_BATCH
+                            * FLAT_BATCH);
+    ArenaScope scope;
+    float* dis = scope.alloc<float>(block);
+
+    for (size_t b0 = j0; b0 < j1; b0 += block) {
+        size_t b1 = std::min(b0 + block, j1);
+
+        for (size_t q = q0; q < q1; q++) {
+            compute_distances(x + q * code_size, x_norms ? x_norms[q] : 0,
+                              b0, b1, dis);
+            partial.add_range(q, dis, b1 - b0, b0, radius, largest,
+                              nremoved ? removed.data() : nullptr);
+        }
+    }
+}
+
+/* The work is cut as in search_codes, in query tiles times database slices,
+   and the items are spread over the threads.  Each thread appends its hits
+   to its own partial result, which are merged at the end.  */
+void
+IndexFlat::range_search_codes(size_t nq, const uint8_t* x, float radius,
+                              RangeSearchResult& result) const {
+    size_t ntiles = (nq + FLAT_QUERY_TILE - 1) / FLAT_QUERY_TILE;
+    size_t nslices = get_num_threads();
+    ArenaScope scope;
+    float* x_norms = nullptr;
+
+    if (metric == METRIC_COSINE) {
+        x_norms = scope.alloc<float>(nq);
+        for (size_t q = 0; q < nq; q++)
+            x_norms[q] = fvec_norm_L2sqr((const float*)x + q * d, d);
+    }
+    const float* norms_ptr = x_norms;
+
+    nslices = std::min(nslices, std::max((size_t)1, ntotal / FLAT_BATCH));
+    if (ntiles >= nslices)
+        nslices = 1;
+
+    size_t nitems = ntiles * nslices;
+    size_t nchunks = std::min(nitems, (size_t)get_num_threads());
+    std::vector<RangeSearchPartial> partials(nchunks);
+
+    parallel_for(nchunks, 1, [&](size_t c0, size_t c1) {
+        for (size_t c = c0; c < c1; c++) {
+            for (size_t i = c * nitems / nchunks;
+                 i < (c + 1) * nitems / nchunks; i++) {
+                size_t t = i / nslices, s = i % nslices;
+                size_t q0 = t * FLAT_QUERY_TILE;
+                size_t q1 = std::min(q0 + FLAT_QUERY_TILE, nq);
+
+                range_scan(x, norms_ptr, q0, q1, s * ntotal / nslices,
+                           (s + 1) * ntotal / nslices, radius, partials[c]);
+            }
+        }
+    });
+
+    merge_range_results(nq, partials, result);
+}
+
+}  // namespace vector_search
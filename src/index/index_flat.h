@@ -0,0 +1,146 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_INDEX_FLAT_H
+#define INDEX_INDEX_FLAT_H
+
+#include "metric.h"
+#include "utils/aligned_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vector_search {
+
+struct IDBitmap;
+struct RangeSearchPartial;
+struct RangeSearchResult;
+struct TopK;
+
+/// Exact search index, which compares the queries to all the stored
+/// vectors.  The vectors are stored contiguously in an append-only aligned
+/// buffer and labelled by their insertion order.  Removed vectors are only
+/// marked in a bitmap and skipped by the searches.
+///
+/// With METRIC_HAMMING the vectors are binary codes of d bits, stored in
+/// d / 8 bytes, and are added and searched with the uint8_t overloads.
+/// The other metrics use d floats per vector.
+///
+/// The searches take an optional bitmap of the allowed labels.  When few
+/// labels are allowed, their distances are computed directly, otherwise the
+/// scan skips the blocks and the 64-label words with no allowed label.
+struct IndexFlat {
+    size_t d;               ///< dimension of the vectors (bits for Hamming)
+    MetricType metric;
+    size_t code_size;       ///< bytes per stored vector
+    size_t ntotal = 0;      ///< number of vectors added, removed included
+    size_t nremoved = 0;    ///< number of removed vectors
+
+    IndexFlat(size_t d, MetricType metric = METRIC_L2);
+
+    /// Append n float vectors, labelled ntotal .. ntotal + n - 1
+    void add(size_t n, const float* x);
+
+    /// Append n binary codes of d / 8 bytes (METRIC_HAMMING)
+    void add(size_t n, const uint8_t* codes);
+
+    /// k nearest stored vectors of each of the nq queries.  distances and
+    /// labels have nq * k entries, best first.  Missing results have the
+    /// label -1.  When filter is not null, only its labels are returned.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels, const IDBitmap* filter = nullptr) const;
+
+    /// Same as above for binary queries (METRIC_HAMMING)
+    void search(size_t nq, const uint8_t* x, size_t k, float* distances,
+                int64_t* labels, const IDBitmap* filter = nullptr) const;
+
+    /// All the stored vectors within radius of each of the nq queries: the
+    /// distance is smaller than radius, or larger for the similarity
+    /// metrics.  The L2 radius applies to the squared distance.
+    void range_search(size_t nq, const float* x, float radius,
+                      RangeSearchResult& result) const;
+
+    /// Same as above for binary queries (METRIC_HAMMING)
+    void range_search(size_t nq, const uint8_t* x, float radius,
+                      RangeSearchResult& result) const;
+
+    /// Mark the n given labels as removed.  Returns the number of vectors
+    /// that were not already removed.
+    size_t remove_ids(size_t n, const int64_t* ids);
+
+    bool is_removed(int64_t id) const {
+        return (removed[id >> 6] >> (id & 63)) & 1;
+    }
+
+    /// Remove all the vectors
+    void reset();
+
+    /// Place the stored vectors on the NUMA nodes according to policy
+    void set_memory_policy(const MemoryPolicy& policy) {
+        codes.set_policy(policy);
+    }
+
+    /// Stored vector of label id
+    const float* get_vector(int64_t id) const {
+        return (const float*)(codes.data() + id * code_size);
+    }
+
+    /// Stored binary code of label id (METRIC_HAMMING)
+    const uint8_t* get_code(int64_t id) const {
+        return codes.data() + id * code_size;
+    }
+
+    /// Distances between query x and the stored vectors [j0, j1), stored in
+    /// dis[0 .. j1 - j0 - 1].  x is a float vector or a binary code
+    /// depending on the metric.
+    void compute_distances(const void* x, float x_norm, size_t j0, size_t j1,
+                           float* dis) const;
+
+    /// Distances between query x and the n stored vectors ids
+    void compute_distances_by_ids(const void* x, float x_norm,
+                                  const int64_t* ids, size_t n,
+                                  float* dis) const;
+
+  private:
+    AlignedBuffer<uint8_t> codes;
+
+    /// squared norms of the stored vectors, for METRIC_COSINE
+    std::vector<float> norms;
+
+    /// one bit per stored vector, set when the vector is removed
+    std::vector<uint64_t> removed;
+
+    void add_codes(size_t n, const uint8_t* x);
+    void search_codes(size_t nq, const uint8_t* x, size_t k,
+                      float* distances, int64_t* labels,
+                      const IDBitmap* filter) const;
+    void search_ids(size_t nq, const uint8_t* x, const float* x_norms,
+                    size_t k, const int64_t* ids, size_t nids,
+                    float* distances, int64_t* labels) const;
+    void scan(const uint8_t* x, const float* x_norms, size_t q0, size_t q1,
+              size_t j0, size_t j1, const IDBitmap* filter,
+              TopK* heaps) const;
+    void range_search_codes(size_t nq, const uint8_t* x, float radius,
+                            RangeSearchResult& result) const;
+    void range_scan(const uint8_t* x, const float* x_norms, size_t q0,
+                    size_t q1, size_t j0, size_t j1, float radius,
+                    RangeSearchPartial& partial) const;
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_FLAT_H */
@@ -0,0 +1,194 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "index_flat_shards.h"
+#include "index_flat.h"
+
+#include "utils/arena.h"
+#include "utils/memory.h"
+#include "utils/numa.h"
+#include "utils/parallel.h"
+#include "utils/thread_pool.h"
+#include "utils/topk.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+namespace vector_search {
+
+/* A node without CPUs, memory only, is scanned by threads on all the
+   CPUs.  */
+IndexFlatShards::IndexFlatShards(size_t d, MetricType metric, size_t nshards)
+    : d(d), metric(metric) {
+    size_t num_nodes = numa_num_nodes();
+
+    if (nshards == 0)
+        nshards = num_nodes;
+
+    for (size_t node = 0; node < std::min(nshards, num_nodes); node++) {
+        std::vector<int> cpus = numa_node_cpus(node);
+
+        if (cpus.empty())
+            cpus = ThreadPool::cpu_order();
+        pools.push_back(std::make_shared<ThreadPool>(cpus));
+    }
+
+    for (size_t s = 0; s < nshards; s++) {
+        MemoryPolicy policy = get_default_memory_policy();
+
+        policy.node = num_nodes > 1 ? s % num_nodes : -1;
+        policy.interleave = false;
+        shards.emplace_back(new IndexFlat(d, metric));
+        shards.back()->set_memory_policy(policy);
+    }
+    ids.resize(nshards);
+}
+
+IndexFlatShards::~IndexFlatShards() = default;
+
+void
+IndexFlatShards::add(size_t n, const float* x) {
+    if (metric == METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlatShards::add of float vectors to a "
+                  << "Hamming index.\n";
+        exit (-1);
+    }
+    add_codes(n, (const uint8_t*)x);
+}
+
+void
+IndexFlatShards::add(size_t n, const uint8_t* x) {
+    if (metric != METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlatShards::add of binary codes to a "
+                  << "float index.\n";
+        exit (-1);
+    }
+    add_codes(n, x);
+}
+
+/* Each shard receives the vectors it lacks to hold its share of the new
+   total, so the shards stay balanced whatever the batch sizes.  */
+void
+IndexFlatShards::add_codes(size_t n, const uint8_t* x) {
+    size_t nshards = shards.size();
+    size_t total = ntotal + n, i0 = 0;
+    size_t code_size = shards[0]->code_size;
+
+    for (size_t s = 0; s < nshards && i0 < n; s++) {
+        IndexFlat& shard = *shards[s];
+        size_t target = total * (s + 1) / nshards - total * s / nshards;
+        size_t count = target > shard.ntotal ? target - shard.ntotal : 0;
+
+        count = std::min(count, n - i0);
+        if (metric == METRIC_HAMMING)
+            shard.add(count, x + i0 * code_size);
+        else
+            shard.add(count, (const float*)(x + i0 * code_size));
+        for (size_t i = i0; i < i0 + count; i++)
+            ids[s].push_back(ntotal + i);
+        i0 += count;
+    }
+    ntotal = total;
+}
+
+void
+IndexFlatShards::search(size_t nq, const float* x, size_t k,
+                        float* distances, int64_t* labels) const {
+    if (metric == METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlatShards::search of float queries in a "
+                  << "Hamming index.\n";
+        exit (-1);
+    }
+    search_codes(nq, (const uint8_t*)x, k, distances, labels);
+}
+
+void
+IndexFlatShards::search(size_t nq, const uint8_t* x, size_t k,
+                        float* distances, int64_t* labels) const {
+    if (metric != METRIC_HAMMING) {
+        std::cout << "ERROR, IndexFlatShards::search of binary queries in a "
+                  << "float index.\n";
+        exit (-1);
+    }
+    search_codes(nq, x, k, distances, labels);
+}
+
+/* The search of each shard is started as a single task on the pool of its
+   node.  The worker that takes it runs IndexFlat::search, whose
+   parallel_for calls stay on that pool.  The task of a shard only holds a
+   reference and the shard number, which std::function stores without
+   allocating.  */
+void
+IndexFlatShards::search_codes(size_t nq, const uint8_t* x, size_t k,
+                              float* distances, int64_t* labels) const {
+    size_t nshards = shards.size();
+    bool largest = is_similarity_metric(metric);
+    ArenaScope scope;
+    float* shard_distances = scope.alloc<float>(nshards * nq * k);
+    int64_t* shard_labels = scope.alloc<int64_t>(nshards * nq * k);
+    ScratchVector<std::function<void(size_t, size_t)>> searches(nshards);
+    ScratchVector<ThreadPool::Loop> loops(nshards);
+
+    auto search_shard = [&](size_t s) {
+        if (metric == METRIC_HAMMING)
+            shards[s]->search(nq, x, k, shard_distances + s * nq * k,
+                              shard_labels + s * nq * k);
+        else
+            shards[s]->search(nq, (const float*)x, k,
+                              shard_distances + s * nq * k,
+                              shard_labels + s * nq * k);
+    };
+
+    for (size_t s = 0; s < nshards; s++) {
+        searches[s] = [&search_shard, s](size_t, size_t) {
+            search_shard(s);
+        };
+        pools[s % pools.size()]->start(loops[s], 1, 1, searches[s]);
+    }
+    for (size_t s = 0; s < nshards; s++)
+        ThreadPool::wait(loops[s]);
+
+    parallel_for(nq, 16, [&](size_t q0, size_t q1) {
+        TopK heap(k, largest);
+
+        for (size_t q = q0; q < q1; q++) {
+            heap.clear();
+            for (size_t s = 0; s < nshards; s++) {
+                const float* sd = shard_distances + s * nq * k;
+                const int64_t* sl = shard_labels + s * nq * k;
+
+                for (size_t j = q * k; j < (q + 1) * k; j++) {
+                    if (sl[j] < 0)
+                        break;
+                    heap.push(sd[j], ids[s][sl[j]]);
+                }
+            }
+            heap.extract(distances + q * k, labels + q * k);
+        }
+    });
+}
+
+void
+IndexFlatShards::reset() {
+    for (size_t s = 0; s < shards.size(); s++) {
+        shards[s]->reset();
+        ids[s].clear();
+    }
+    ntotal = 0;
+}
+
+}  // namespace vector_search
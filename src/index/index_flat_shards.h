@@ -0,0 +1,91 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_INDEX_FLAT_SHARDS_H
+#define INDEX_INDEX_FLAT_SHARDS_H
+
+#include "metric.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vector_search {
+
+struct IndexFlat;
+struct ThreadPool;
+
+/// Exact search index sharded over the NUMA nodes.  The vectors are split
+/// over nshards IndexFlat.  Shard s is stored on node s % numa_num_nodes()
+/// and scanned by a pool of threads bound to the CPUs of that node, so the
+/// scans only read node-local memory.  A search is handed to all the shards
+/// at once and their results are merged.  The labels are global, in the
+/// order of insertion.
+///
+/// Without NUMA support, there is one node and the shards share its pool.
+struct IndexFlatShards {
+    size_t d;               ///< dimension of the vectors (bits for Hamming)
+    MetricType metric;
+    size_t ntotal = 0;      ///< number of vectors added
+
+    /// nshards = 0 selects one shard per NUMA node
+    IndexFlatShards(size_t d, MetricType metric = METRIC_L2,
+                    size_t nshards = 0);
+    ~IndexFlatShards();
+
+    size_t num_shards() const {
+        return shards.size();
+    }
+
+    /// Append n float vectors, spread evenly over the shards
+    void add(size_t n, const float* x);
+
+    /// Append n binary codes of d / 8 bytes (METRIC_HAMMING)
+    void add(size_t n, const uint8_t* codes);
+
+    /// k nearest vectors of each of the nq queries, as IndexFlat::search
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels) const;
+
+    /// Same as above for binary queries (METRIC_HAMMING)
+    void search(size_t nq, const uint8_t* x, size_t k, float* distances,
+                int64_t* labels) const;
+
+    /// Remove all the vectors
+    void reset();
+
+    const IndexFlat& get_shard(size_t s) const {
+        return *shards[s];
+    }
+
+  private:
+    std::vector<std::unique_ptr<IndexFlat>> shards;
+
+    /// global labels of the vectors of each shard
+    std::vector<std::vector<int64_t>> ids;
+
+    /// pool of the node of each shard, shared by the shards of a node
+    std::vector<std::shared_ptr<ThreadPool>> pools;
+
+    void add_codes(size_t n, const uint8_t* x);
+    void search_codes(size_t nq, const uint8_t* x, size_t k,
+                      float* distances, int64_t* labels) const;
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_FLAT_SHARDS_H */
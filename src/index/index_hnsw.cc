@@ -0,0 +1,514 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "index_hnsw.h"
+
+#include "distances/distances.h"
+#include "distances/prefetch.h"
+#include "utils/arena.h"
+#include "utils/id_bitmap.h"
+#include "utils/parallel.h"
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+namespace vector_search {
+
+IndexHNSW::IndexHNSW(size_t d, size_t M, MetricType metric)
+    : d(d), metric(metric), M(M), M0(2 * M), level_rng(1234) {
+    if (metric != METRIC_L2 && metric != METRIC_INNER_PRODUCT) {
+        std::cout << "ERROR, IndexHNSW supports the L2 and inner product "
+                  << "metrics only.\n";
+        exit (-1);
+    }
+    if (M < 2) {
+        std::cout << "ERROR, IndexHNSW needs M >= 2, got " << M << ".\n";
+        exit (-1);
+    }
+}
+
+float
+IndexHNSW::distance(const float* x, size_t i) const {
+    if (metric == METRIC_L2)
+        return fvec_L2sqr(x, get_vector(i), d);
+    return -fvec_inner_product(x, get_vector(i), d);
+}
+
+/* Distances between x and the n nodes ids.  The gathered kernels prefetch
+   the vectors PREFETCH_AHEAD neighbors ahead of the ones being compared, so
+   that the cache misses of the scattered nodes overlap with the arithmetic
+   instead of being all issued up front.  */
+void
+IndexHNSW::distances_batch(const float* x, const int64_t* ids, size_t n,
+                           float* dis) const {
+    if (metric == METRIC_L2) {
+        fvec_L2sqr_by_ids(dis, x, vectors.data(), ids, d, n);
+    } else {
+        fvec_inner_products_by_ids(dis, x, vectors.data(), ids, d, n);
+        for (size_t j = 0; j < n; j++)
+            dis[j] = -dis[j];
+    }
+}
+
+/* Levels follow a geometric distribution, a node reaches level l + 1 with
+   a probability of 1 / M.  */
+int
+IndexHNSW::random_level() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double u = 1.0 - uniform(level_rng);
+
+    return (int)(-log(u) / log((double)M));
+}
+
+void
+IndexHNSW::add(size_t n, const float* x) {
+    size_t n0 = ntotal;
+    size_t first = n0;
+
+    if (n == 0)
+        return;
+
+    /* The storage of the new nodes is allocated before the insertions, which
+       then only modify the neighbor lists.  */
+    vectors.append(x, n * d);
+    levels.resize(n0 + n);
+    offsets.resize(n0 + n);
+
+    size_t nslots = neighbors.size();
+    for (size_t i = n0; i < n0 + n; i++) {
+        levels[i] = random_level();
+        offsets[i] = nslots;
+        nslots += M0 + levels[i] * M;
+    }
+    neighbors.resize(nslots, -1);
+
+    std::vector<std::mutex> new_locks(n0 + n);
+    locks.swap(new_locks);
+    ntotal = n0 + n;
+
+    if (entry_point < 0) {
+        entry_point = n0;
+        max_level = levels[n0];
+        first++;
+    }
+
+    parallel_for(ntotal - first, 1, [&](size_t i0, size_t i1) {
+        VisitedTable visited(ntotal);
+
+        for (size_t i = i0; i < i1; i++)
+            insert(first + i, visited);
+    });
+}
+
+void
+IndexHNSW::insert(size_t pt, VisitedTable& visited) {
+    const float* x = get_vector(pt);
+    int level = levels[pt];
+    ScratchVector<Node> candidates;
+
+    /* A node above the current top level becomes the entry point, the
+       other insertions wait for it.  */
+    std::unique_lock<std::mutex> entry(entry_lock);
+    int64_t ep = entry_point;
+    int top = max_level;
+
+    if (level <= top)
+        entry.unlock();
+
+    float d_ep = distance(x, ep);
+
+    for (int l = top; l > level; l--)
+        ep = greedy_search(x, ep, &d_ep, l, true);
+
+    for (int l = std::min(level, top); l >= 0; l--) {
+        size_t begin, end, j;
+
+        visited.advance();
+        search_layer(x, ep, d_ep, ef_construction, l, true, visited,
+                     candidates);
+
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [pt](const Node& c) {
+                                            return c.second == (int64_t)pt;
+                                        }),
+                         candidates.end());
+        if (candidates.empty())
+            continue;
+
+        ep = candidates[0].second;
+        d_ep = candidates[0].first;
+        select_neighbors(candidates, M);
+
+        neighbor_range(pt, l, &begin, &end);
+        {
+            std::lock_guard<std::mutex> lock(locks[pt]);
+
+            for (j = 0; j < candidates.size(); j++)
+                neighbors[begin + j] = candidates[j].second;
+        }
+
+        for (const Node& c : candidates)
+            add_link(c.second, pt, l);
+    }
+
+    if (level > top) {
+        entry_point = pt;
+        max_level = level;
+    }
+}
+
+/* Move from ep to its nearest neighbor at level l until no neighbor is
+   nearer to x.  */
+int64_t
+IndexHNSW::greedy_search(const float* x, int64_t ep, float* d_ep, int l,
+                         bool locked) const {
+    ArenaScope scope;
+    int64_t* ids = scope.alloc<int64_t>(M0);
+    float* dis = scope.alloc<float>(M0);
+    bool changed = true;
+
+    while (changed) {
+        size_t begin, end, nn = 0;
+
+        changed = false;
+        neighbor_range(ep, l, &begin, &end);
+        {
+            std::unique_lock<std::mutex> lock(locks[ep], std::defer_lock);
+
+            if (locked)
+                lock.lock();
+            for (size_t j = begin; j < end && neighbors[j] >= 0; j++)
+                ids[nn++] = neighbors[j];
+        }
+
+        distances_batch(x, ids, nn, dis);
+
+        for (size_t j = 0; j < nn; j++) {
+            if (dis[j] < *d_ep) {
+                *d_ep = dis[j];
+                ep = ids[j];
+                changed = true;
+            }
+        }
+    }
+    return ep;
+}
+
+/* Best-first search at level l from ep.  results gets the ef nearest nodes
+   found, nearest first.  The unvisited neighbors of each expanded node are
+   evaluated together by distances_batch.  With a filter, the nodes it does
+   not allow are expanded but not kept in results.  */
+void
+IndexHNSW::search_layer(const float* x, int64_t ep, float d_ep, size_t ef,
+                        int l, bool locked, VisitedTable& visited,
+                        ScratchVector<Node>& results,
+                        const IDBitmap* filter) const {
+    std::priority_queue<Node, ScratchVector<Node>, std::greater<Node>>
+        candidates;
+    std::priority_queue<Node, ScratchVector<Node>> top;
+    ArenaScope scope;
+    int64_t* ids = scope.alloc<int64_t>(M0);
+    float* dis = scope.alloc<float>(M0);
+
+    visited.set(ep);
+    candidates.push(Node(d_ep, ep));
+    if (!filter || filter->get(ep))
+        top.push(Node(d_ep, ep));
+
+    while (!candidates.empty()) {
+        Node c = candidates.top();
+        size_t begin, end, nn = 0;
+
+        if (top.size() >= ef && c.first > top.top().first)
+            break;
+        candidates.pop();
+
+        neighbor_range(c.second, l, &begin, &end);
+        {
+            std::unique_lock<std::mutex> lock(locks[c.second],
+                                              std::defer_lock);
+
+            if (locked)
+                lock.lock();
+            for (size_t j = begin; j < end && neighbors[j] >= 0; j++) {
+                int64_t v = neighbors[j];
+
+                if (!visited.get(v)) {
+                    visited.set(v);
+                    ids[nn++] = v;
+                }
+            }
+        }
+
+        distances_batch(x, ids, nn, dis);
+
+        for (size_t j = 0; j < nn; j++) {
+            if (top.size() < ef || dis[j] < top.top().first) {
+                candidates.push(Node(dis[j], ids[j]));
+                if (filter && !filter->get(ids[j]))
+                    continue;
+                top.push(Node(dis[j], ids[j]));
+                if (top.size() > ef)
+                    top.pop();
+            }
+        }
+    }
+
+    results.resize(top.size());
+    for (size_t i = top.size(); i > 0; i--) {
+        results[i - 1] = top.top();
+        top.pop();
+    }
+}
+
+/* Keep at most m of the candidates, nearest first, dropping a candidate
+   when it is nearer to an already kept neighbor than to the node, so that
+   the neighbors point in different directions.  */
+void
+IndexHNSW::select_neighbors(ScratchVector<Node>& candidates,
+                            size_t m) const {
+    ScratchVector<Node> kept;
+
+    if (candidates.size() <= m)
+        return;
+
+    for (const Node& c : candidates) {
+        const float* xc = get_vector(c.second);
+        bool good = true;
+
+        for (const Node& r : kept) {
+            if (distance(xc, r.second) < c.first) {
+                good = false;
+                break;
+            }
+        }
+        if (good) {
+            kept.push_back(c);
+            if (kept.size() >= m)
+                break;
+        }
+    }
+    candidates.swap(kept);
+}
+
+/* Add dst to the neighbors of src at level l.  When the list is full, the
+   list is rebuilt from the old neighbors and dst with select_neighbors.  */
+void
+IndexHNSW::add_link(size_t src, size_t dst, int l) {
+    std::lock_guard<std::mutex> lock(locks[src]);
+    const float* xs = get_vector(src);
+    ScratchVector<Node> candidates;
+    size_t begin, end, j;
+
+    neighbor_range(src, l, &begin, &end);
+
+    for (j = begin; j < end; j++) {
+        if (neighbors[j] == (int32_t)dst)
+            return;
+        if (neighbors[j] < 0) {
+            neighbors[j] = dst;
+            return;
+        }
+    }
+
+    for (j = begin; j < end; j++)
+        candidates.push_back(Node(distance(xs, neighbors[j]), neighbors[j]));
+    candidates.push_back(Node(distance(xs, dst), dst));
+    std::sort(candidates.begin(), candidates.end());
+    select_neighbors(candidates, end - begin);
+
+    for (j = 0; j < end - begin; j++)
+        neighbors[begin + j] = j < candidates.size() ? candidates[j].second
+                                                     : -1;
+}
+
+/* The search of one query, greedy_search on the upper levels then
+   search_layer on level 0, as a coroutine.  Each step is cut in three,
+   separated by suspensions: prefetch the neighbor list of the node, then
+   the visited tags of the neighbors, then the vectors of the unvisited
+   ones, whose distances are computed when the task resumes.  */
+SearchTask
+IndexHNSW::search_task(const float* x, size_t k, size_t ef,
+                       const IDBitmap* filter, VisitedHashSet& visited,
+                       float* distances, int64_t* labels) const {
+    std::priority_queue<Node, ScratchVector<Node>, std::greater<Node>>
+        candidates;
+    std::priority_queue<Node, ScratchVector<Node>> top;
+    ScratchVector<int64_t> ids(M0);
+    ScratchVector<float> dis(M0);
+    ScratchVector<Node> results;
+    int64_t ep = entry_point;
+    size_t begin, end, i = 0;
+
+    if (ep >= 0) {
+        prefetch_span(get_vector(ep), d * sizeof(float));
+        co_await SuspendForPrefetch();
+
+        float d_ep = distance(x, ep);
+
+        for (int l = max_level; l > 0; l--) {
+            bool changed = true;
+
+            while (changed) {
+                size_t nn = 0;
+
+                changed = false;
+                neighbor_range(ep, l, &begin, &end);
+                prefetch_span(neighbors.data() + begin,
+                              (end - begin) * sizeof(int32_t));
+                co_await SuspendForPrefetch();
+
+                for (size_t j = begin; j < end && neighbors[j] >= 0; j++) {
+                    ids[nn++] = neighbors[j];
+                    prefetch_span(get_vector(neighbors[j]),
+                                  d * sizeof(float));
+                }
+                co_await SuspendForPrefetch();
+
+                distances_batch(x, ids.data(), nn, dis.data());
+                for (size_t j = 0; j < nn; j++) {
+                    if (dis[j] < d_ep) {
+                        d_ep = dis[j];
+                        ep = ids[j];
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        visited.set(ep);
+        candidates.push(Node(d_ep, ep));
+        if (!filter || filter->get(ep))
+            top.push(Node(d_ep, ep));
+
+        while (!candidates.empty()) {
+            Node c = candidates.top();
+            size_t nn = 0;
+
+            if (top.size() >= ef && c.first > top.top().first)
+                break;
+            candidates.pop();
+
+            neighbor_range(c.second, 0, &begin, &end);
+            prefetch_span(neighbors.data() + begin,
+                          (end - begin) * sizeof(int32_t));
+            co_await SuspendForPrefetch();
+
+            for (size_t j = begin; j < end && neighbors[j] >= 0; j++)
+                visited.prefetch(neighbors[j]);
+            co_await SuspendForPrefetch();
+
+            for (size_t j = begin; j < end && neighbors[j] >= 0; j++) {
+                int64_t v = neighbors[j];
+
+                if (!visited.get(v)) {
+                    visited.set(v);
+                    ids[nn++] = v;
+                    prefetch_span(get_vector(v), d * sizeof(float));
+                }
+            }
+            if (nn == 0)
+                continue;
+            co_await SuspendForPrefetch();
+
+            distances_batch(x, ids.data(), nn, dis.data());
+            for (size_t j = 0; j < nn; j++) {
+                if (top.size() < ef || dis[j] < top.top().first) {
+                    candidates.push(Node(dis[j], ids[j]));
+                    if (filter && !filter->get(ids[j]))
+                        continue;
+                    top.push(Node(dis[j], ids[j]));
+                    if (top.size() > ef)
+                        top.pop();
+                }
+            }
+        }
+
+        results.resize(top.size());
+        for (size_t r = top.size(); r > 0; r--) {
+            results[r - 1] = top.top();
+            top.pop();
+        }
+    }
+
+    for (; i < k && i < results.size(); i++) {
+        distances[i] = metric == METRIC_L2 ? results[i].first
+                                           : -results[i].first;
+        labels[i] = results[i].second;
+    }
+    for (; i < k; i++) {
+        distances[i] = metric == METRIC_L2 ? HUGE_VALF : -HUGE_VALF;
+        labels[i] = -1;
+    }
+}
+
+void
+IndexHNSW::search(size_t nq, const float* x, size_t k, float* distances,
+                  int64_t* labels, const IDBitmap* filter) const {
+    size_t ef = std::max(ef_search, k);
+
+    if (interleave > 1) {
+        parallel_for(nq, interleave, [&](size_t q0, size_t q1) {
+            run_interleaved(q1 - q0, interleave, [&](size_t i, size_t slot) {
+                size_t q = q0 + i;
+
+                return search_task(x + q * d, k, ef, filter,
+                                   thread_visited_set(slot),
+                                   distances + q * k, labels + q * k);
+            });
+        });
+        return;
+    }
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        VisitedTable& visited = thread_visited_table(ntotal);
+        ScratchVector<Node> results;
+
+        for (size_t q = q0; q < q1; q++) {
+            const float* xq = x + q * d;
+            size_t i = 0;
+
+            results.clear();
+            if (entry_point >= 0) {
+                int64_t ep = entry_point;
+                float d_ep = distance(xq, ep);
+
+                for (int l = max_level; l > 0; l--)
+                    ep = greedy_search(xq, ep, &d_ep, l, false);
+
+                visited.advance();
+                search_layer(xq, ep, d_ep, ef, 0, false, visited, results,
+                             filter);
+            }
+
+            for (; i < k && i < results.size(); i++) {
+                distances[q * k + i] = metric == METRIC_L2
+                                       ? results[i].first
+                                       : -results[i].first;
+                labels[q * k + i] = results[i].second;
+            }
+            for (; i < k; i++) {
+                distances[q * k + i] = metric == METRIC_L2 ? HUGE_VALF
+                                                           : -HUGE_VALF;
+                labels[q * k + i] = -1;
+            }
+        }
+    });
+}
+
+}  // namespace vector_search
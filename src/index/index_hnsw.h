@@ -0,0 +1,138 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_INDEX_HNSW_H
+#define INDEX_INDEX_HNSW_H
+
+#include "metric.h"
+#include "utils/aligned_buffer.h"
+#include "utils/arena.h"
+#include "utils/interleave.h"
+#include "utils/visited_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace vector_search {
+
+struct IDBitmap;
+
+/// Hierarchical Navigable Small World graph index (Malkov and Yashunin,
+/// 2016).  The neighbor lists of all the levels of a node are stored
+/// contiguously in one array, level 0 first, unused slots are -1.  The
+/// insertions are spread over the threads, each neighbor list is
+/// protected by its own lock.  Supports METRIC_L2 and
+/// METRIC_INNER_PRODUCT.
+///
+/// search must not run concurrently with add.
+struct IndexHNSW {
+    size_t d;                   ///< dimension of the vectors
+    MetricType metric;
+    size_t M;                   ///< neighbors per node on the upper levels
+    size_t M0;                  ///< neighbors per node on level 0, 2 * M
+    size_t ef_construction = 40;///< size of the candidate list of add
+    size_t ef_search = 16;      ///< size of the candidate list of search
+    size_t interleave = 1;      ///< queries interleaved per thread by search
+    size_t ntotal = 0;          ///< number of vectors added
+
+    int64_t entry_point = -1;   ///< node of the highest level
+    int max_level = -1;         ///< level of the entry point
+
+    IndexHNSW(size_t d, size_t M = 32, MetricType metric = METRIC_L2);
+
+    /// Add n vectors, labelled ntotal .. ntotal + n - 1
+    void add(size_t n, const float* x);
+
+    /// k nearest neighbors of the nq queries, best first.  Uses a candidate
+    /// list of max(ef_search, k) nodes.  With interleave > 1, each thread
+    /// runs interleave queries at once as coroutines, which suspend while
+    /// the neighbor lists and vectors they need next are prefetched.
+    /// The interleaved queries keep their visited nodes in hash sets of
+    /// about 16 bytes per visited node, rather than in the 4 * ntotal
+    /// bytes table of the sequential search, so the memory per thread is
+    /// one such table plus interleave hash sets.
+    /// When filter is not null, only its labels are returned: the other
+    /// nodes are traversed but not kept in the candidate list.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels, const IDBitmap* filter = nullptr) const;
+
+    /// Level of node i
+    int node_level(size_t i) const {
+        return levels[i];
+    }
+
+    /// Neighbors of node i at level l, slots [begin, end) of neighbors
+    void neighbor_range(size_t i, int l, size_t* begin, size_t* end) const {
+        *begin = offsets[i] + (l == 0 ? 0 : M0 + (l - 1) * M);
+        *end = *begin + (l == 0 ? M0 : M);
+    }
+
+    const float* get_vector(size_t i) const {
+        return vectors.data() + i * d;
+    }
+
+  private:
+    typedef std::pair<float, int64_t> Node;
+
+    AlignedBuffer<float> vectors;
+    std::vector<int> levels;
+    std::vector<size_t> offsets;
+    AlignedBuffer<int32_t> neighbors;
+
+    /// one lock per node, held while its neighbor lists are read or
+    /// modified by add.  Two node locks are never held at once.
+    mutable std::vector<std::mutex> locks;
+
+    /// protects entry_point and max_level during add
+    std::mutex entry_lock;
+
+    std::mt19937 level_rng;
+
+    /// The internal distances are smaller for better nodes, the inner
+    /// product is negated.
+    float distance(const float* x, size_t i) const;
+
+    void distances_batch(const float* x, const int64_t* ids, size_t n,
+                         float* dis) const;
+
+    int random_level();
+
+    void insert(size_t pt, VisitedTable& visited);
+
+    int64_t greedy_search(const float* x, int64_t ep, float* d_ep, int l,
+                          bool locked) const;
+
+    void search_layer(const float* x, int64_t ep, float d_ep, size_t ef,
+                      int l, bool locked, VisitedTable& visited,
+                      ScratchVector<Node>& results,
+                      const IDBitmap* filter = nullptr) const;
+
+    void select_neighbors(ScratchVector<Node>& candidates, size_t m) const;
+
+    SearchTask search_task(const float* x, size_t k, size_t ef,
+                           const IDBitmap* filter, VisitedHashSet& visited,
+                           float* distances, int64_t* labels) const;
+
+    void add_link(size_t src, size_t dst, int l);
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_HNSW_H */
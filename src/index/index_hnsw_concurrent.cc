@@ -0,0 +1,382 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "index_hnsw_concurrent.h"
+
+#include "distances/distances.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+namespace vector_search {
+
+IndexHNSWConcurrent::NodeLinks::NodeLinks(int level)
+    : level(level), lists(new std::atomic<NeighborList*>[level + 1]) {
+    for (int l = 0; l <= level; l++)
+        lists[l].store(nullptr, std::memory_order_relaxed);
+}
+
+IndexHNSWConcurrent::IndexHNSWConcurrent(size_t d, size_t M,
+                                         MetricType metric)
+    : d(d), metric(metric), M(M), M0(2 * M), vectors(d), nodes(1),
+      level_rng(1234) {
+    if (metric != METRIC_L2 && metric != METRIC_INNER_PRODUCT) {
+        std::cout << "ERROR, IndexHNSWConcurrent supports the L2 and inner "
+                  << "product metrics only.\n";
+        exit (-1);
+    }
+    if (M < 2) {
+        std::cout << "ERROR, IndexHNSWConcurrent needs M >= 2, got " << M
+                  << ".\n";
+        exit (-1);
+    }
+}
+
+IndexHNSWConcurrent::~IndexHNSWConcurrent() {
+    for (size_t i = 0; i < nodes.size(); i++) {
+        NodeLinks* node = nodes.row(i)[0];
+
+        for (int l = 0; l <= node->level; l++)
+            delete node->lists[l].load(std::memory_order_relaxed);
+        delete node;
+    }
+}
+
+float
+IndexHNSWConcurrent::distance(const float* x, size_t i) const {
+    if (metric == METRIC_L2)
+        return fvec_L2sqr(x, get_vector(i), d);
+    return -fvec_inner_product(x, get_vector(i), d);
+}
+
+/* The vectors are not contiguous, they are compared four at a time with
+   the batch kernels.  */
+void
+IndexHNSWConcurrent::distances_batch(const float* x, const int64_t* ids,
+                                     size_t n, float* dis) const {
+    const float* y[4];
+    size_t j = 0;
+
+    for (; j + 4 <= n; j += 4) {
+        for (size_t t = 0; t < 4; t++)
+            y[t] = get_vector(ids[j + t]);
+        if (metric == METRIC_L2)
+            fvec_L2sqr_batch_N<4>(x, y, d, dis + j);
+        else
+            fvec_inner_product_batch_N<4>(x, y, d, dis + j);
+    }
+    for (; j < n; j++)
+        dis[j] = metric == METRIC_L2 ? fvec_L2sqr(x, get_vector(ids[j]), d)
+                 : fvec_inner_product(x, get_vector(ids[j]), d);
+
+    if (metric != METRIC_L2)
+        for (j = 0; j < n; j++)
+            dis[j] = -dis[j];
+}
+
+/* Levels follow a geometric distribution, a node reaches level l + 1 with
+   a probability of 1 / M.  */
+int
+IndexHNSWConcurrent::random_level() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double u = 1.0 - uniform(level_rng);
+
+    return (int)(-log(u) / log((double)M));
+}
+
+/* Each vector is stored, linked into the graph, then published by ntotal.
+   The entry point is published after ntotal, so that a search that loads
+   the entry point then ntotal sees the entry point below ntotal.  */
+void
+IndexHNSWConcurrent::add(size_t n, const float* x) {
+    std::lock_guard<std::mutex> lock(add_mutex);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t pt = ntotal.load(std::memory_order_relaxed);
+        int64_t ep = entry_point.load(std::memory_order_relaxed);
+        NodeLinks* node = new NodeLinks(random_level());
+
+        vectors.append(x + i * d, 1);
+        nodes.append(&node, 1);
+        if (add_visited.tags.size() <= pt)
+            add_visited.tags.resize(std::max(2 * add_visited.tags.size(),
+                                             pt + 1), 0);
+
+        insert(pt);
+
+        ntotal.store(pt + 1, std::memory_order_release);
+        if (ep < 0 || node->level > node_level(ep))
+            entry_point.store(pt, std::memory_order_release);
+    }
+}
+
+void
+IndexHNSWConcurrent::insert(size_t pt) {
+    const float* x = get_vector(pt);
+    int level = node_level(pt);
+    int64_t ep = entry_point.load(std::memory_order_relaxed);
+    ScratchVector<Node> candidates;
+
+    if (ep < 0)
+        return;
+
+    int top = node_level(ep);
+    float d_ep = distance(x, ep);
+
+    for (int l = top; l > level; l--)
+        ep = greedy_search(x, ep, &d_ep, l, pt);
+
+    for (int l = std::min(level, top); l >= 0; l--) {
+        add_visited.advance();
+        search_layer(x, ep, d_ep, ef_construction, l, pt, add_visited,
+                     candidates);
+        if (candidates.empty())
+            continue;
+
+        ep = candidates[0].second;
+        d_ep = candidates[0].first;
+        select_neighbors(candidates, M);
+        set_neighbors(pt, l, candidates);
+
+        for (const Node& c : candidates)
+            add_link(c.second, pt, l);
+    }
+}
+
+/* Move from ep to its nearest neighbor at level l until no neighbor below
+   limit is nearer to x.  */
+int64_t
+IndexHNSWConcurrent::greedy_search(const float* x, int64_t ep, float* d_ep,
+                                   int l, size_t limit) const {
+    ArenaScope scope;
+    int64_t* ids = scope.alloc<int64_t>(M0);
+    float* dis = scope.alloc<float>(M0);
+    bool changed = true;
+
+    while (changed) {
+        const NeighborList* list = neighbor_list(ep, l);
+        size_t nn = 0;
+
+        changed = false;
+        if (!list)
+            break;
+
+        size_t size = list->size.load(std::memory_order_acquire);
+        for (size_t j = 0; j < size; j++)
+            if ((size_t)list->ids[j] < limit)
+                ids[nn++] = list->ids[j];
+
+        distances_batch(x, ids, nn, dis);
+
+        for (size_t j = 0; j < nn; j++) {
+            if (dis[j] < *d_ep) {
+                *d_ep = dis[j];
+                ep = ids[j];
+                changed = true;
+            }
+        }
+    }
+    return ep;
+}
+
+/* Best-first search at level l from ep, among the nodes below limit.
+   results gets the ef nearest nodes found, nearest first.  */
+void
+IndexHNSWConcurrent::search_layer(const float* x, int64_t ep, float d_ep,
+                                  size_t ef, int l, size_t limit,
+                                  VisitedTable& visited,
+                                  ScratchVector<Node>& results) const {
+    std::priority_queue<Node, ScratchVector<Node>, std::greater<Node>>
+        candidates;
+    std::priority_queue<Node, ScratchVector<Node>> top;
+    ArenaScope scope;
+    int64_t* ids = scope.alloc<int64_t>(M0);
+    float* dis = scope.alloc<float>(M0);
+
+    visited.set(ep);
+    candidates.push(Node(d_ep, ep));
+    top.push(Node(d_ep, ep));
+
+    while (!candidates.empty()) {
+        Node c = candidates.top();
+        const NeighborList* list;
+        size_t nn = 0;
+
+        if (c.first > top.top().first && top.size() >= ef)
+            break;
+        candidates.pop();
+
+        list = neighbor_list(c.second, l);
+        if (!list)
+            continue;
+
+        size_t size = list->size.load(std::memory_order_acquire);
+        for (size_t j = 0; j < size; j++) {
+            int64_t v = list->ids[j];
+
+            if ((size_t)v < limit && !visited.get(v)) {
+                visited.set(v);
+                ids[nn++] = v;
+            }
+        }
+
+        distances_batch(x, ids, nn, dis);
+
+        for (size_t j = 0; j < nn; j++) {
+            if (top.size() < ef || dis[j] < top.top().first) {
+                candidates.push(Node(dis[j], ids[j]));
+                top.push(Node(dis[j], ids[j]));
+                if (top.size() > ef)
+                    top.pop();
+            }
+        }
+    }
+
+    results.resize(top.size());
+    for (size_t i = top.size(); i > 0; i--) {
+        results[i - 1] = top.top();
+        top.pop();
+    }
+}
+
+/* Keep at most m of the candidates, nearest first, dropping a candidate
+   when it is nearer to an already kept neighbor than to the node.  */
+void
+IndexHNSWConcurrent::select_neighbors(ScratchVector<Node>& candidates,
+                                      size_t m) const {
+    ScratchVector<Node> kept;
+
+    if (candidates.size() <= m)
+        return;
+
+    for (const Node& c : candidates) {
+        const float* xc = get_vector(c.second);
+        bool good = true;
+
+        for (const Node& r : kept) {
+            if (distance(xc, r.second) < c.first) {
+                good = false;
+                break;
+            }
+        }
+        if (good) {
+            kept.push_back(c);
+            if (kept.size() >= m)
+                break;
+        }
+    }
+    candidates.swap(kept);
+}
+
+/* Replace the neighbor list of node i at level l by a new list, the old
+   one is retired.  */
+void
+IndexHNSWConcurrent::set_neighbors(size_t i, int l,
+                                   const ScratchVector<Node>& neighbors) {
+    NeighborList* list = new NeighborList(l == 0 ? M0 : M);
+    NeighborList* old;
+
+    for (size_t j = 0; j < neighbors.size(); j++)
+        list->ids[j] = neighbors[j].second;
+    list->size.store(neighbors.size(), std::memory_order_relaxed);
+
+    old = nodes.row(i)[0]->lists[l].exchange(list,
+                                             std::memory_order_acq_rel);
+    if (old)
+        epochs.retire(old);
+}
+
+/* Add dst to the neighbors of src at level l, in place when the list has
+   room.  A full list is rebuilt from the old neighbors and dst with
+   select_neighbors.  */
+void
+IndexHNSWConcurrent::add_link(size_t src, size_t dst, int l) {
+    NeighborList* list =
+        nodes.row(src)[0]->lists[l].load(std::memory_order_relaxed);
+    const float* xs = get_vector(src);
+    ScratchVector<Node> candidates;
+    size_t size = list ? list->size.load(std::memory_order_relaxed) : 0;
+
+    for (size_t j = 0; j < size; j++)
+        if (list->ids[j] == (int32_t)dst)
+            return;
+
+    if (list && size < list->ids.size()) {
+        list->ids[size] = dst;
+        list->size.store(size + 1, std::memory_order_release);
+        return;
+    }
+
+    for (size_t j = 0; j < size; j++)
+        candidates.push_back(Node(distance(xs, list->ids[j]),
+                                  list->ids[j]));
+    candidates.push_back(Node(distance(xs, dst), dst));
+    std::sort(candidates.begin(), candidates.end());
+    select_neighbors(candidates, l == 0 ? M0 : M);
+    set_neighbors(src, l, candidates);
+}
+
+/* All the queries see the nodes published when the search started.  The
+   entry point is loaded before ntotal, see add.  */
+void
+IndexHNSWConcurrent::search(size_t nq, const float* x, size_t k,
+                            float* distances, int64_t* labels) const {
+    size_t ef = std::max(ef_search, k);
+    int64_t entry = entry_point.load(std::memory_order_acquire);
+    size_t limit = ntotal.load(std::memory_order_acquire);
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        EpochGuard guard(epochs);
+        VisitedTable& visited = thread_visited_table(limit);
+        ScratchVector<Node> results;
+
+        for (size_t q = q0; q < q1; q++) {
+            const float* xq = x + q * d;
+            size_t i = 0;
+
+            results.clear();
+            if (entry >= 0) {
+                int64_t ep = entry;
+                float d_ep = distance(xq, ep);
+
+                for (int l = node_level(ep); l > 0; l--)
+                    ep = greedy_search(xq, ep, &d_ep, l, limit);
+
+                visited.advance();
+                search_layer(xq, ep, d_ep, ef, 0, limit, visited, results);
+            }
+
+            for (; i < k && i < results.size(); i++) {
+                distances[q * k + i] = metric == METRIC_L2
+                                       ? results[i].first
+                                       : -results[i].first;
+                labels[q * k + i] = results[i].second;
+            }
+            for (; i < k; i++) {
+                distances[q * k + i] = metric == METRIC_L2 ? HUGE_VALF
+                                                           : -HUGE_VALF;
+                labels[q * k + i] = -1;
+            }
+        }
+    });
+}
+
+}  // namespace vector_search
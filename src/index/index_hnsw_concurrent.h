@@ -0,0 +1,153 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INDEX_INDEX_HNSW_CONCURRENT_H
+#define INDEX_INDEX_HNSW_CONCURRENT_H
+
+#include "metric.h"
+#include "utils/arena.h"
+#include "utils/epoch.h"
+#include "utils/segmented_array.h"
+#include "utils/visited_table.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace vector_search {
+
+/// HNSW graph index that is searched while vectors are added, the
+/// searches never wait for the insertions.  Same graph as IndexHNSW.
+/// Supports METRIC_L2 and METRIC_INNER_PRODUCT.
+///
+/// The vectors and the nodes are stored in SegmentedArrays, which never
+/// move a published row.  A neighbor list has room for M0 or M neighbors
+/// and publishes its size with a release store, so a neighbor is added in
+/// place.  A full list is rebuilt with the neighbor selection heuristic
+/// into a new list, which replaces it, and the old list is freed by
+/// epoch-based reclamation once the searches that may read it are done.
+/// The insertions are serialized between them.
+///
+/// A search sees the nodes added before it started, labels below the
+/// value of ntotal it loads, and ignores the neighbors added since.
+struct IndexHNSWConcurrent {
+    size_t d;                   ///< dimension of the vectors
+    MetricType metric;
+    size_t M;                   ///< neighbors per node on the upper levels
+    size_t M0;                  ///< neighbors per node on level 0, 2 * M
+    size_t ef_construction = 40;///< size of the candidate list of add
+    size_t ef_search = 16;      ///< size of the candidate list of search
+
+    /// number of vectors visible to the searches
+    std::atomic<size_t> ntotal{0};
+
+    /// node of the highest level, -1 when empty
+    std::atomic<int64_t> entry_point{-1};
+
+    IndexHNSWConcurrent(size_t d, size_t M = 32,
+                        MetricType metric = METRIC_L2);
+    ~IndexHNSWConcurrent();
+
+    /// Add n vectors, labelled ntotal .. ntotal + n - 1, each published
+    /// once inserted.  May run concurrently with searches and other calls
+    /// of add.
+    void add(size_t n, const float* x);
+
+    /// k nearest neighbors of the nq queries among the vectors added when
+    /// the search started, best first.  Uses a candidate list of
+    /// max(ef_search, k) nodes.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels) const;
+
+    const float* get_vector(size_t i) const {
+        return vectors.row(i);
+    }
+
+    /// Number of replaced neighbor lists not freed yet
+    size_t retired_lists() const {
+        return epochs.pending();
+    }
+
+  private:
+    typedef std::pair<float, int64_t> Node;
+
+    struct NeighborList {
+        std::atomic<size_t> size{0};    ///< neighbors published
+        std::vector<int32_t> ids;       ///< capacity, never reallocated
+
+        explicit NeighborList(size_t capacity) : ids(capacity, -1) {}
+    };
+
+    /// neighbor lists of the levels 0 .. level of a node, null while empty
+    struct NodeLinks {
+        int level;
+        std::unique_ptr<std::atomic<NeighborList*>[]> lists;
+
+        explicit NodeLinks(int level);
+    };
+
+    SegmentedArray<float> vectors;
+    SegmentedArray<NodeLinks*> nodes;
+
+    mutable EpochManager epochs;
+
+    /// serializes the calls of add, and protects the members below
+    std::mutex add_mutex;
+    VisitedTable add_visited;
+    std::mt19937 level_rng;
+
+    /// The internal distances are smaller for better nodes, the inner
+    /// product is negated.
+    float distance(const float* x, size_t i) const;
+
+    void distances_batch(const float* x, const int64_t* ids, size_t n,
+                         float* dis) const;
+
+    int random_level();
+
+    int node_level(size_t i) const {
+        return nodes.row(i)[0]->level;
+    }
+
+    const NeighborList* neighbor_list(size_t i, int l) const {
+        return nodes.row(i)[0]->lists[l].load(std::memory_order_acquire);
+    }
+
+    void insert(size_t pt);
+
+    int64_t greedy_search(const float* x, int64_t ep, float* d_ep, int l,
+                          size_t limit) const;
+
+    void search_layer(const float* x, int64_t ep, float d_ep, size_t ef,
+                      int l, size_t limit, VisitedTable& visited,
+                      ScratchVector<Node>& results) const;
+
+    void select_neighbors(ScratchVector<Node>& candidates, size_t m) const;
+
+    void set_neighbors(size_t i, int l, const ScratchVector<Node>& neighbors);
+
+    void add_link(size_t src, size_t dst, int l);
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_HNSW_CONCURRENT_H */
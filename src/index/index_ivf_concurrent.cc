@@ -0,0 +1,224 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "index_ivf_concurrent.h"
+
+#include "distances/distances.h"
+#include "utils/arena.h"
+#include "utils/parallel.h"
+#include "utils/topk.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+/* Number of vectors scanned at a time, so that the distances stay in the
+   L1 cache.  */
+#define IVF_CONCURRENT_SCAN_CHUNK 1024
+
+/* Capacity of a new inverted list, in vectors.  */
+#define IVF_CONCURRENT_MIN_CAPACITY 64
+
+namespace vector_search {
+
+IndexIVFFlatConcurrent::InvertedList::InvertedList(size_t d,
+                                                   size_t capacity)
+    : capacity(capacity) {
+    codes.reserve(capacity * d);
+    ids.reserve(capacity);
+}
+
+IndexIVFFlatConcurrent::IndexIVFFlatConcurrent(size_t d, size_t nlist,
+                                               MetricType metric)
+    : d(d), nlist(nlist), metric(metric), quantizer(d, metric),
+      lists(new std::atomic<InvertedList*>[nlist]) {
+    if (metric != METRIC_L2 && metric != METRIC_INNER_PRODUCT) {
+        std::cout << "ERROR, IndexIVFFlatConcurrent supports the L2 and "
+                  << "inner product metrics only.\n";
+        exit (-1);
+    }
+    for (size_t l = 0; l < nlist; l++)
+        lists[l].store(nullptr, std::memory_order_relaxed);
+}
+
+IndexIVFFlatConcurrent::~IndexIVFFlatConcurrent() {
+    for (size_t l = 0; l < nlist; l++)
+        delete lists[l].load(std::memory_order_relaxed);
+}
+
+void
+IndexIVFFlatConcurrent::train(size_t n, const float* x) {
+    KMeans kmeans(d, nlist, cp);
+
+    kmeans.train(n, x);
+    quantizer.reset();
+    quantizer.add(nlist, kmeans.centroids.data());
+    is_trained = true;
+}
+
+/* The lists that cannot hold their new vectors are first replaced by
+   larger copies.  The vectors are then written after the published ones,
+   the sizes of the lists are published, and ntotal last, so that a search
+   that sees a label below ntotal finds it in its list.  */
+void
+IndexIVFFlatConcurrent::add(size_t n, const float* x) {
+    std::vector<int64_t> assign(n);
+    std::vector<float> dis(n);
+    std::vector<size_t> counts(nlist, 0);
+
+    if (!is_trained) {
+        std::cout << "ERROR, IndexIVFFlatConcurrent::add before train.\n";
+        exit (-1);
+    }
+
+    if (metric == METRIC_L2)
+        assign_to_nearest(x, n, quantizer.get_vector(0), nlist, d,
+                          assign.data(), dis.data());
+    else
+        quantizer.search(n, x, 1, dis.data(), assign.data());
+
+    std::lock_guard<std::mutex> lock(add_mutex);
+    size_t n0 = ntotal.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < n; i++)
+        counts[assign[i]]++;
+
+    for (size_t l = 0; l < nlist; l++) {
+        InvertedList* list = lists[l].load(std::memory_order_relaxed);
+        size_t m = list ? list->ids.size() : 0;
+
+        if (counts[l] == 0 || (list && m + counts[l] <= list->capacity))
+            continue;
+
+        size_t capacity = std::max({m + counts[l],
+                                    list ? 2 * list->capacity : 0,
+                                    (size_t)IVF_CONCURRENT_MIN_CAPACITY});
+        InvertedList* grown = new InvertedList(d, capacity);
+
+        if (list) {
+            grown->codes.append(list->codes.data(), m * d);
+            grown->ids.append(list->ids.data(), m);
+        }
+        grown->size.store(m, std::memory_order_relaxed);
+        lists[l].store(grown, std::memory_order_release);
+        if (list)
+            epochs.retire(list);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        InvertedList* list = lists[assign[i]].load(std::memory_order_relaxed);
+        int64_t label = n0 + i;
+
+        list->codes.append(x + i * d, d);
+        list->ids.append(&label, 1);
+    }
+
+    for (size_t l = 0; l < nlist; l++) {
+        if (counts[l]) {
+            InvertedList* list = lists[l].load(std::memory_order_relaxed);
+
+            list->size.store(list->ids.size(), std::memory_order_release);
+        }
+    }
+    ntotal.store(n0 + n, std::memory_order_release);
+}
+
+size_t
+IndexIVFFlatConcurrent::list_size(size_t l) const {
+    EpochGuard guard(epochs);
+    const InvertedList* list = lists[l].load(std::memory_order_acquire);
+
+    return list ? list->size.load(std::memory_order_acquire) : 0;
+}
+
+/* Scan the vectors of list whose labels are below limit.  */
+void
+IndexIVFFlatConcurrent::scan_list(const float* x, const InvertedList* list,
+                                  size_t limit, TopK& heap) const {
+    size_t m = list->size.load(std::memory_order_acquire);
+    const float* codes = list->codes.data();
+    const int64_t* ids = list->ids.data();
+    float dis[IVF_CONCURRENT_SCAN_CHUNK];
+
+    m = std::lower_bound(ids, ids + m, (int64_t)limit) - ids;
+
+    for (size_t b0 = 0; b0 < m; b0 += IVF_CONCURRENT_SCAN_CHUNK) {
+        size_t b1 = std::min(b0 + IVF_CONCURRENT_SCAN_CHUNK, m);
+        float threshold;
+
+        if (metric == METRIC_L2)
+            fvec_L2sqr_ny(dis, x, codes + b0 * d, d, b1 - b0);
+        else
+            fvec_inner_products_ny(dis, x, codes + b0 * d, d, b1 - b0);
+
+        threshold = heap.threshold();
+        for (size_t j = b0; j < b1; j++) {
+            if (heap.better(dis[j - b0], threshold)) {
+                heap.push(dis[j - b0], ids[j]);
+                threshold = heap.threshold();
+            }
+        }
+    }
+}
+
+/* The queries are spread over the threads.  All the queries see the
+   vectors published when the search started, the lists are loaded under
+   an EpochGuard so that a list replaced meanwhile is not freed while it
+   is scanned.  */
+void
+IndexIVFFlatConcurrent::search(size_t nq, const float* x, size_t k,
+                               float* distances, int64_t* labels) const {
+    bool largest = is_similarity_metric(metric);
+    size_t np = std::min(nprobe, nlist);
+    size_t limit = ntotal.load(std::memory_order_acquire);
+    ArenaScope scope;
+    float* coarse_dis = scope.alloc<float>(nq * np);
+    int64_t* coarse_ids = scope.alloc<int64_t>(nq * np);
+
+    if (nq == 0 || k == 0)
+        return;
+
+    if (!is_trained) {
+        std::cout << "ERROR, IndexIVFFlatConcurrent::search before "
+                  << "train.\n";
+        exit (-1);
+    }
+
+    quantizer.search(nq, x, np, coarse_dis, coarse_ids);
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        EpochGuard guard(epochs);
+        TopK heap(k, largest);
+
+        for (size_t q = q0; q < q1; q++) {
+            heap.clear();
+            for (size_t p = 0; p < np; p++) {
+                int64_t l = coarse_ids[q * np + p];
+                const InvertedList* list;
+
+                if (l < 0)
+                    continue;
+                list = lists[l].load(std::memory_order_acquire);
+                if (list)
+                    scan_list(x + q * d, list, limit, heap);
+            }
+            heap.extract(distances + q * k, labels + q * k);
+        }
+    });
+}
+
+}  // namespace vector_search
@@ -0,0 +1,116 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INDEX_INDEX_IVF_CONCURRENT_H
+#define INDEX_INDEX_IVF_CONCURRENT_H
+
+#include "index_flat.h"
+#include "metric.h"
+#include "clustering/kmeans.h"
+#include "utils/aligned_buffer.h"
+#include "utils/epoch.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace vector_search {
+
+struct TopK;
+
+/// Inverted file index that is searched while vectors are added, the
+/// searches never wait for the insertions.  Supports METRIC_L2 and
+/// METRIC_INNER_PRODUCT.
+///
+/// Each inverted list has room for more vectors than it holds.  add()
+/// writes the new vectors after the published ones, then publishes the
+/// new size of the list with a release store.  A full list is copied to a
+/// list twice as large, which replaces it, and the old list is freed by
+/// epoch-based reclamation once the searches that may scan it are done.
+/// The insertions are serialized between them.
+///
+/// A search sees the vectors added before it started, labels below the
+/// value of ntotal it loads first: within a list the labels are
+/// increasing, so it scans the prefix of the list below that label.
+struct IndexIVFFlatConcurrent {
+    size_t d;               ///< dimension of the vectors
+    size_t nlist;           ///< number of inverted lists
+    MetricType metric;
+    size_t nprobe = 1;      ///< number of lists scanned per query
+    bool is_trained = false;
+
+    /// number of vectors visible to the searches
+    std::atomic<size_t> ntotal{0};
+
+    /// parameters of the training of the coarse quantizer
+    KMeansParams cp;
+
+    /// the nlist centroids, with the metric of the index
+    IndexFlat quantizer;
+
+    IndexIVFFlatConcurrent(size_t d, size_t nlist,
+                           MetricType metric = METRIC_L2);
+    ~IndexIVFFlatConcurrent();
+
+    /// Train the coarse quantizer on the n vectors x, before any search or
+    /// add
+    void train(size_t n, const float* x);
+
+    /// Add n vectors, labelled ntotal .. ntotal + n - 1.  May run
+    /// concurrently with searches and other calls of add.
+    void add(size_t n, const float* x);
+
+    /// k nearest neighbors of the nq queries, among the vectors of the
+    /// nprobe lists nearest to each query that were added when the search
+    /// started.  distances and labels have nq * k entries, best first.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels) const;
+
+    /// Number of vectors of list l, including the ones being added
+    size_t list_size(size_t l) const;
+
+    /// Number of replaced lists not freed yet
+    size_t retired_lists() const {
+        return epochs.pending();
+    }
+
+  private:
+    struct InvertedList {
+        std::atomic<size_t> size{0};    ///< vectors published
+        size_t capacity;
+        AlignedBuffer<float> codes;     ///< capacity * d, never reallocated
+        AlignedBuffer<int64_t> ids;
+
+        InvertedList(size_t d, size_t capacity);
+    };
+
+    std::unique_ptr<std::atomic<InvertedList*>[]> lists;
+
+    /// serializes the calls of add
+    std::mutex add_mutex;
+
+    mutable EpochManager epochs;
+
+    void scan_list(const float* x, const InvertedList* list, size_t limit,
+                   TopK& heap) const;
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_IVF_CONCURRENT_H */
@@ -0,0 +1,428 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "index_ivf_flat.h"
+
+#include "distances/distances.h"
+#include "distances/prefetch.h"
+#include "utils/arena.h"
+#include "utils/id_bitmap.h"
+#include "utils/parallel.h"
+#include "utils/range_result.h"
+#include "utils/topk.h"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+/* Number of vectors scanned at a time, so that the distances stay in the
+   L1 cache.  Large lists are also split in chunks of this size when a
+   single query is spread over the threads.  */
+#define IVF_SCAN_CHUNK 1024
+
+/* Relative cost of the distance of a vector loaded by label, compared to
+   the distance of a vector of a list scan.  */
+#define IVF_GATHER_COST 4
+
+/* Bytes prefetched at the start of the vectors and of the labels of a list
+   by an interleaved search, before it suspends.  The hardware prefetcher
+   follows the rest of the scan.  */
+#define IVF_PREFETCH_BYTES 2048
+
+namespace vector_search {
+
+IndexIVFFlat::IndexIVFFlat(size_t d, size_t nlist, MetricType metric)
+    : d(d), nlist(nlist), metric(metric), quantizer(d, metric),
+      list_codes(nlist), list_ids(nlist) {
+    if (metric != METRIC_L2 && metric != METRIC_INNER_PRODUCT) {
+        std::cout << "ERROR, IndexIVFFlat supports the L2 and inner product "
+                  << "metrics only.\n";
+        exit (-1);
+    }
+}
+
+void
+IndexIVFFlat::train(size_t n, const float* x) {
+    KMeans kmeans(d, nlist, cp);
+
+    kmeans.train(n, x);
+    quantizer.reset();
+    quantizer.add(nlist, kmeans.centroids.data());
+    is_trained = true;
+}
+
+void
+IndexIVFFlat::add(size_t n, const float* x) {
+    std::vector<int64_t> assign(n);
+    std::vector<float> dis(n);
+
+    if (!is_trained) {
+        std::cout << "ERROR, IndexIVFFlat::add before train.\n";
+        exit (-1);
+    }
+
+    /* The L2 assignment uses the fused kernel, otherwise the nearest
+       centroid is searched in the quantizer.  */
+    if (metric == METRIC_L2)
+        assign_to_nearest(x, n, quantizer.get_vector(0), nlist, d,
+                          assign.data(), dis.data());
+    else
+        quantizer.search(n, x, 1, dis.data(), assign.data());
+
+    for (size_t i = 0; i < n; i++) {
+        locations.push_back((uint64_t)assign[i] << 32
+                            | list_ids[assign[i]].size());
+        list_codes[assign[i]].append(x + i * d, d);
+        list_ids[assign[i]].push_back(ntotal + i);
+    }
+    ntotal += n;
+}
+
+void
+IndexIVFFlat::reset() {
+    for (size_t l = 0; l < nlist; l++) {
+        list_codes[l].clear();
+        list_ids[l].clear();
+    }
+    locations.clear();
+    ntotal = 0;
+}
+
+/* Add the vectors [j0, j1) of list l to the results of query x.  With a
+   filter, the offsets of the allowed vectors of each chunk are collected
+   first, without branches.  A chunk with no allowed vector is skipped, and
+   a chunk with few of them computes their distances only.  */
+void
+IndexIVFFlat::scan_list(const float* x, size_t l, size_t j0, size_t j1,
+                        const IDBitmap* filter, TopK& heap) const {
+    const float* codes = list_codes[l].data();
+    const int64_t* ids = list_ids[l].data();
+    float dis[IVF_SCAN_CHUNK];
+    uint32_t allowed[IVF_SCAN_CHUNK];
+
+    for (size_t b0 = j0; b0 < j1; b0 += IVF_SCAN_CHUNK) {
+        size_t b1 = std::min(b0 + IVF_SCAN_CHUNK, j1);
+        size_t na = 0;
+        float threshold;
+
+        if (filter) {
+            for (size_t j = b0; j < b1; j++) {
+                allowed[na] = j;
+                na += filter->get(ids[j]);
+            }
+            if (na == 0)
+                continue;
+        }
+
+        if (filter && na * IVF_GATHER_COST < b1 - b0) {
+            for (size_t i = 0; i < na; i++)
+                dis[i] = metric == METRIC_L2
+                         ? fvec_L2sqr(x, codes + allowed[i] * d, d)
+                         : fvec_inner_product(x, codes + allowed[i] * d, d);
+            threshold = heap.threshold();
+            for (size_t i = 0; i < na; i++) {
+                if (heap.better(dis[i], threshold)) {
+                    heap.push(dis[i], ids[allowed[i]]);
+                    threshold = heap.threshold();
+                }
+            }
+            continue;
+        }
+
+        if (metric == METRIC_L2)
+            fvec_L2sqr_ny(dis, x, codes + b0 * d, d, b1 - b0);
+        else
+            fvec_inner_products_ny(dis, x, codes + b0 * d, d, b1 - b0);
+
+        threshold = heap.threshold();
+        if (filter) {
+            for (size_t i = 0; i < na; i++) {
+                size_t j = allowed[i];
+
+                if (heap.better(dis[j - b0], threshold)) {
+                    heap.push(dis[j - b0], ids[j]);
+                    threshold = heap.threshold();
+                }
+            }
+            continue;
+        }
+        for (size_t j = b0; j < b1; j++) {
+            if (heap.better(dis[j - b0], threshold)) {
+                heap.push(dis[j - b0], ids[j]);
+                threshold = heap.threshold();
+            }
+        }
+    }
+}
+
+/* The scan of the np lists of one query, as a coroutine, which prefetches
+   the start of each list and suspends before scanning it.  */
+SearchTask
+IndexIVFFlat::search_task(const float* x, const int64_t* lists, size_t np,
+                          size_t k, const IDBitmap* filter, float* distances,
+                          int64_t* labels) const {
+    TopK heap(k, is_similarity_metric(metric));
+
+    for (size_t p = 0; p < np; p++) {
+        int64_t l = lists[p];
+
+        if (l < 0 || list_size(l) == 0)
+            continue;
+        prefetch_span(list_codes[l].data(),
+                      std::min(list_size(l) * d * sizeof(float),
+                               (size_t)IVF_PREFETCH_BYTES));
+        prefetch_span(list_ids[l].data(),
+                      std::min(list_size(l) * sizeof(int64_t),
+                               (size_t)IVF_PREFETCH_BYTES));
+        co_await SuspendForPrefetch();
+
+        scan_list(x, l, 0, list_size(l), filter, heap);
+    }
+    heap.extract(distances, labels);
+}
+
+/* With enough queries, the queries are spread over the threads, and with
+   interleave > 1 each thread runs them as interleaved coroutines.  Otherwise
+   the probed lists of each query are cut in chunks of IVF_SCAN_CHUNK
+   vectors, the chunks are spread over the threads, each thread keeps its
+   own heap and the heaps are merged at the end.  */
+void
+IndexIVFFlat::search(size_t nq, const float* x, size_t k, float* distances,
+                     int64_t* labels, const IDBitmap* filter) const {
+    bool largest = is_similarity_metric(metric);
+    size_t np = std::min(nprobe, nlist);
+    ArenaScope scope;
+    float* coarse_dis = scope.alloc<float>(nq * np);
+    int64_t* coarse_ids = scope.alloc<int64_t>(nq * np);
+
+    if (nq == 0 || k == 0)
+        return;
+
+    if (!is_trained) {
+        std::cout << "ERROR, IndexIVFFlat::search before train.\n";
+        exit (-1);
+    }
+
+    /* The probed lists hold about ntotal * np / nlist vectors.  */
+    if (filter && filter->count() * IVF_GATHER_COST * nlist
+                  <= ntotal * np) {
+        int64_t* ids = scope.alloc<int64_t>(filter->count());
+        size_t nids = filter->get_ids(0, ntotal, ids);
+
+        search_ids(nq, x, k, ids, nids, distances, labels);
+        return;
+    }
+
+    quantizer.search(nq, x, np, coarse_dis, coarse_ids);
+
+    if (nq >= (size_t)get_num_threads() && interleave > 1) {
+        parallel_for(nq, interleave, [&](size_t q0, size_t q1) {
+            run_interleaved(q1 - q0, interleave, [&](size_t i, size_t) {
+                size_t q = q0 + i;
+
+                return search_task(x + q * d, coarse_ids + q * np, np, k,
+                                   filter, distances + q * k,
+                                   labels + q * k);
+            });
+        });
+        return;
+    }
+
+    if (nq >= (size_t)get_num_threads()) {
+        parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+            TopK heap(k, largest);
+
+            for (size_t q = q0; q < q1; q++) {
+                heap.clear();
+                for (size_t p = 0; p < np; p++) {
+                    int64_t l = coarse_ids[q * np + p];
+
+                    if (l >= 0)
+                        scan_list(x + q * d, l, 0, list_size(l), filter,
+                                  heap);
+                }
+                heap.extract(distances + q * k, labels + q * k);
+            }
+        });
+        return;
+    }
+
+    struct chunk_t {
+        size_t list, j0, j1;
+    };
+
+    ScratchVector<chunk_t> chunks;
+
+    for (size_t q = 0; q < nq; q++) {
+        TopK result(k, largest);
+        std::mutex result_mutex;
+
+        chunks.clear();
+        for (size_t p = 0; p < np; p++) {
+            int64_t l = coarse_ids[q * np + p];
+
+            if (l < 0)
+                continue;
+            for (size_t j0 = 0; j0 < list_size(l); j0 += IVF_SCAN_CHUNK)
+                chunks.push_back({(size_t)l, j0,
+                                  std::min(j0 + IVF_SCAN_CHUNK,
+                                           list_size(l))});
+        }
+
+        parallel_for(chunks.size(), 1, [&](size_t c0, size_t c1) {
+            TopK heap(k, largest);
+
+            for (size_t c = c0; c < c1; c++)
+                scan_list(x + q * d, chunks[c].list, chunks[c].j0,
+                          chunks[c].j1, filter, heap);
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.merge(heap);
+        });
+
+        result.extract(distances + q * k, labels + q * k);
+    }
+}
+
+/* Search among the vectors ids only, located with locations.  The queries
+   are spread over the threads, or with few queries the ids are split in
+   chunks of IVF_SCAN_CHUNK.  */
+void
+IndexIVFFlat::search_ids(size_t nq, const float* x, size_t k,
+                         const int64_t* ids, size_t nids, float* distances,
+                         int64_t* labels) const {
+    bool largest = is_similarity_metric(metric);
+
+    auto scan_ids = [&](const float* xq, size_t i0, size_t i1, TopK& heap) {
+        float threshold = heap.threshold();
+
+        for (size_t i = i0; i < i1; i++) {
+            const float* y = get_vector(ids[i]);
+            float dis = metric == METRIC_L2 ? fvec_L2sqr(xq, y, d)
+                                            : fvec_inner_product(xq, y, d);
+
+            if (heap.better(dis, threshold)) {
+                heap.push(dis, ids[i]);
+                threshold = heap.threshold();
+            }
+        }
+    };
+
+    if (nq >= (size_t)get_num_threads()) {
+        parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+            TopK heap(k, largest);
+
+            for (size_t q = q0; q < q1; q++) {
+                heap.clear();
+                scan_ids(x + q * d, 0, nids, heap);
+                heap.extract(distances + q * k, labels + q * k);
+            }
+        });
+        return;
+    }
+
+    for (size_t q = 0; q < nq; q++) {
+        TopK result(k, largest);
+        std::mutex result_mutex;
+
+        parallel_for(nids, IVF_SCAN_CHUNK, [&](size_t i0, size_t i1) {
+            TopK heap(k, largest);
+
+            scan_ids(x + q * d, i0, i1, heap);
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.merge(heap);
+        });
+
+        result.extract(distances + q * k, labels + q * k);
+    }
+}
+
+/* Add the vectors [j0, j1) of list l within radius of query q, x, to
+   partial.  */
+void
+IndexIVFFlat::range_scan_list(const float* x, size_t q, size_t l, size_t j0,
+                              size_t j1, float radius,
+                              RangeSearchPartial& partial) const {
+    const float* codes = list_codes[l].data();
+    const int64_t* ids = list_ids[l].data();
+    float dis[IVF_SCAN_CHUNK];
+
+    for (size_t b0 = j0; b0 < j1; b0 += IVF_SCAN_CHUNK) {
+        size_t b1 = std::min(b0 + IVF_SCAN_CHUNK, j1);
+
+        if (metric == METRIC_L2)
+            fvec_L2sqr_ny(dis, x, codes + b0 * d, d, b1 - b0);
+        else
+            fvec_inner_products_ny(dis, x, codes + b0 * d, d, b1 - b0);
+        partial.add_labels(q, dis, b1 - b0, ids + b0, radius,
+                           metric != METRIC_L2);
+    }
+}
+
+/* The probed lists of all the queries are cut in chunks of IVF_SCAN_CHUNK
+   vectors, and the chunks are spread over the threads in contiguous
+   ranges.  Each thread appends its hits to its own partial result, which
+   are merged at the end.  */
+void
+IndexIVFFlat::range_search(size_t nq, const float* x, float radius,
+                           RangeSearchResult& result) const {
+    size_t np = std::min(nprobe, nlist);
+    ArenaScope scope;
+    float* coarse_dis = scope.alloc<float>(nq * np);
+    int64_t* coarse_ids = scope.alloc<int64_t>(nq * np);
+
+    if (!is_trained) {
+        std::cout << "ERROR, IndexIVFFlat::range_search before train.\n";
+        exit (-1);
+    }
+
+    quantizer.search(nq, x, np, coarse_dis, coarse_ids);
+
+    struct chunk_t {
+        size_t query, list, j0, j1;
+    };
+    ScratchVector<chunk_t> chunks;
+
+    for (size_t q = 0; q < nq; q++) {
+        for (size_t p = 0; p < np; p++) {
+            int64_t l = coarse_ids[q * np + p];
+
+            if (l < 0)
+                continue;
+            for (size_t j0 = 0; j0 < list_size(l); j0 += IVF_SCAN_CHUNK)
+                chunks.push_back({q, (size_t)l, j0,
+                                  std::min(j0 + IVF_SCAN_CHUNK,
+                                           list_size(l))});
+        }
+    }
+
+    size_t nparts = std::min(chunks.size(), (size_t)get_num_threads());
+    std::vector<RangeSearchPartial> partials(nparts);
+
+    parallel_for(nparts, 1, [&](size_t t0, size_t t1) {
+        for (size_t t = t0; t < t1; t++)
+            for (size_t c = t * chunks.size() / nparts;
+                 c < (t + 1) * chunks.size() / nparts; c++)
+                range_scan_list(x + chunks[c].query * d, chunks[c].query,
+                                chunks[c].list, chunks[c].j0, chunks[c].j1,
+                                radius, partials[t]);
+    });
+
+    merge_range_results(nq, partials, result);
+}
+
+}  // namespace vector_search
@@ -0,0 +1,123 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_INDEX_IVF_FLAT_H
+#define INDEX_INDEX_IVF_FLAT_H
+
+#include "index_flat.h"
+#include "metric.h"
+#include "clustering/kmeans.h"
+#include "utils/aligned_buffer.h"
+#include "utils/interleave.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vector_search {
+
+struct IDBitmap;
+struct RangeSearchPartial;
+struct RangeSearchResult;
+struct TopK;
+
+/// Inverted file index.  A coarse quantizer of nlist centroids, trained
+/// with KMeans, partitions the vectors into nlist inverted lists, each
+/// stored contiguously.  A search compares each query to the centroids and
+/// scans the vectors of its nprobe nearest lists.  Supports METRIC_L2 and
+/// METRIC_INNER_PRODUCT.
+///
+/// A filtered search that would scan more vectors than the filter allows
+/// computes the distances of the allowed labels directly instead, without
+/// the coarse quantizer, and is then exact.
+struct IndexIVFFlat {
+    size_t d;               ///< dimension of the vectors
+    size_t nlist;           ///< number of inverted lists
+    MetricType metric;
+    size_t nprobe = 1;      ///< number of lists scanned per query
+    size_t interleave = 1;  ///< queries interleaved per thread by search
+    size_t ntotal = 0;      ///< number of vectors added
+    bool is_trained = false;
+
+    /// parameters of the training of the coarse quantizer
+    KMeansParams cp;
+
+    /// the nlist centroids, with the metric of the index
+    IndexFlat quantizer;
+
+    IndexIVFFlat(size_t d, size_t nlist, MetricType metric = METRIC_L2);
+
+    /// Train the coarse quantizer on the n vectors x
+    void train(size_t n, const float* x);
+
+    /// Add n vectors to their nearest list, labelled ntotal .. ntotal + n - 1
+    void add(size_t n, const float* x);
+
+    /// k nearest neighbors of the nq queries, among the vectors of the
+    /// nprobe lists nearest to each query.  distances and labels have
+    /// nq * k entries, best first.  When filter is not null, only its
+    /// labels are returned.  With interleave > 1 and enough queries, each
+    /// thread runs interleave queries at once as coroutines, which suspend
+    /// while the start of the next list they scan is prefetched.  An
+    /// interleaved query only holds its k results, so the memory per
+    /// thread grows as interleave * k.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels, const IDBitmap* filter = nullptr) const;
+
+    /// All the vectors of the nprobe lists nearest to each query within
+    /// radius of the query: the squared L2 distance is smaller than radius,
+    /// or the inner product is larger.
+    void range_search(size_t nq, const float* x, float radius,
+                      RangeSearchResult& result) const;
+
+    /// Number of vectors of list l
+    size_t list_size(size_t l) const {
+        return list_ids[l].size();
+    }
+
+    /// Remove all the vectors, the quantizer is kept
+    void reset();
+
+    /// Stored vector of label id
+    const float* get_vector(int64_t id) const {
+        return list_codes[locations[id] >> 32].data()
+               + (locations[id] & 0xffffffff) * d;
+    }
+
+  private:
+    /// per list, the vectors stored contiguously and their labels
+    std::vector<AlignedBuffer<float>> list_codes;
+    std::vector<std::vector<int64_t>> list_ids;
+
+    /// per label, its list in the upper 32 bits and its offset in the list
+    std::vector<uint64_t> locations;
+
+    void scan_list(const float* x, size_t l, size_t j0, size_t j1,
+                   const IDBitmap* filter, TopK& heap) const;
+    void range_scan_list(const float* x, size_t q, size_t l, size_t j0,
+                         size_t j1, float radius,
+                         RangeSearchPartial& partial) const;
+    void search_ids(size_t nq, const float* x, size_t k,
+                    const int64_t* ids, size_t nids, float* distances,
+                    int64_t* labels) const;
+    SearchTask search_task(const float* x, const int64_t* lists, size_t np,
+                           size_t k, const IDBitmap* filter,
+                           float* distances, int64_t* labels) const;
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_IVF_FLAT_H */
@@ -0,0 +1,116 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "index_rabitq.h"
+
+#include "distances/distances.h"
+#include "utils/arena.h"
+#include "utils/parallel.h"
+#include "utils/topk.h"
+
+#include <algorithm>
+#include <mutex>
+
+/* Number of codes estimated at a time, the estimates and the bounds of a
+   block stay in the L1 cache.  */
+#define RABITQ_SCAN_BLOCK 256
+
+namespace vector_search {
+
+IndexRaBitQ::IndexRaBitQ(size_t d, bool rerank)
+    : d(d), rerank(rerank), rq(d) {}
+
+void
+IndexRaBitQ::train(size_t n, const float* x) {
+    rq.train(n, x);
+}
+
+void
+IndexRaBitQ::add(size_t n, const float* x) {
+    std::vector<uint8_t> new_codes(n * rq.code_size());
+
+    factors.resize(ntotal + n);
+    rq.encode(n, x, new_codes.data(), factors.data() + ntotal);
+    codes.append(new_codes.data(), new_codes.size());
+    if (rerank)
+        vectors.append(x, n * d);
+    ntotal += n;
+}
+
+/* The queries are spread over the threads.  The estimates of the codes of
+   a block are computed together, then each code either pushes its
+   estimate, or, with rerank, is compared exactly when its lower bound
+   beats the current threshold of the heap.  The threshold only decreases,
+   so the discarded codes could not have entered the k best, up to the
+   confidence of the bounds.  */
+void
+IndexRaBitQ::search(size_t nq, const float* x, size_t k, float* distances,
+                    int64_t* labels, RaBitQSearchStats* stats) const {
+    size_t cs = rq.code_size();
+    std::mutex stats_mutex;
+    size_t total_exact = 0;
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        TopK heap(k);
+        RaBitQQuery query;
+        ArenaScope scope;
+        float* est = scope.alloc<float>(RABITQ_SCAN_BLOCK);
+        float* lower = scope.alloc<float>(RABITQ_SCAN_BLOCK);
+        size_t nexact = 0;
+
+        for (size_t q = q0; q < q1; q++) {
+            const float* xq = x + q * d;
+
+            rq.prepare_query(xq, query);
+            heap.clear();
+
+            for (size_t j0 = 0; j0 < ntotal; j0 += RABITQ_SCAN_BLOCK) {
+                size_t n = std::min((size_t)RABITQ_SCAN_BLOCK, ntotal - j0);
+
+                rq.estimate(query, n, codes.data() + j0 * cs,
+                            factors.data() + j0, est,
+                            rerank ? lower : nullptr);
+
+                if (!rerank) {
+                    for (size_t j = 0; j < n; j++)
+                        heap.push(est[j], j0 + j);
+                    continue;
+                }
+
+                for (size_t j = 0; j < n; j++) {
+                    const float* y = vectors.data() + (j0 + j) * d;
+
+                    if (lower[j] >= heap.threshold())
+                        continue;
+                    heap.push(fvec_L2sqr(xq, y, d), j0 + j);
+                    nexact++;
+                }
+            }
+            heap.extract(distances + q * k, labels + q * k);
+        }
+
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        total_exact += nexact;
+    });
+
+    if (stats) {
+        stats->nq += nq;
+        stats->nestimated += nq * ntotal;
+        stats->nexact += total_exact;
+    }
+}
+
+}  // namespace vector_search
@@ -0,0 +1,70 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_INDEX_RABITQ_H
+#define INDEX_INDEX_RABITQ_H
+
+#include "quantization/rabitq.h"
+#include "utils/aligned_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vector_search {
+
+/// Counters of IndexRaBitQ::search, summed over the calls
+struct RaBitQSearchStats {
+    size_t nq = 0;              ///< number of queries
+    size_t nestimated = 0;      ///< number of codes scanned
+    size_t nexact = 0;          ///< number of exact distances computed
+};
+
+/// Exhaustive search on RaBitQ codes with squared L2 distances.  The codes
+/// are scanned in blocks with the bit plane kernel.  With rerank, a code is
+/// only compared exactly to the query when the lower bound of its distance
+/// is below the k-th exact distance found so far, the other candidates are
+/// discarded.  Without rerank, the k best estimated distances are returned
+/// and the full precision vectors are not kept.
+struct IndexRaBitQ {
+    size_t d;                   ///< dimension of the vectors
+    size_t ntotal = 0;          ///< number of vectors added
+    bool rerank;                ///< keep the vectors, return exact distances
+    RaBitQuantizer rq;
+
+    explicit IndexRaBitQ(size_t d, bool rerank = true);
+
+    /// Train the quantizer on the n vectors x
+    void train(size_t n, const float* x);
+
+    /// Append n vectors, labelled ntotal .. ntotal + n - 1
+    void add(size_t n, const float* x);
+
+    /// k nearest stored vectors of each of the nq queries.  distances and
+    /// labels have nq * k entries, best first.  Missing results have the
+    /// label -1.  The counts are added to stats when it is not null.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels, RaBitQSearchStats* stats = nullptr) const;
+
+  private:
+    AlignedBuffer<uint8_t> codes;
+    std::vector<RaBitQFactors> factors;
+    AlignedBuffer<float> vectors;   ///< when rerank
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_RABITQ_H */
@@ -0,0 +1,412 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "index_segmented.h"
+
+#include "index_flat.h"
+#include "index_hnsw.h"
+#include "index_ivf_flat.h"
+#include "utils/arena.h"
+#include "utils/id_bitmap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace vector_search {
+
+/* A segment holds its vectors in exactly one of flat, ivf and hnsw, under
+   the offsets 0 .. size() - 1.  The bits of live are cleared by the
+   deletes, the segment is searched with live as filter once one of its
+   vectors is deleted.  */
+struct IndexSegmented::Segment {
+    std::vector<int64_t> labels;    ///< per offset
+    IDBitmap live;
+    size_t ndeleted = 0;
+    std::unique_ptr<IndexFlat> flat;
+    std::unique_ptr<IndexIVFFlat> ivf;
+    std::unique_ptr<IndexHNSW> hnsw;
+
+    explicit Segment(size_t capacity) : live(capacity) {}
+
+    size_t size() const {
+        return labels.size();
+    }
+
+    const float* get_vector(size_t i) const {
+        if (flat)
+            return flat->get_vector(i);
+        if (ivf)
+            return ivf->get_vector(i);
+        return hnsw->get_vector(i);
+    }
+
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* offsets) const {
+        const IDBitmap* filter = ndeleted ? &live : nullptr;
+
+        if (flat)
+            flat->search(nq, x, k, distances, offsets, filter);
+        else if (ivf)
+            ivf->search(nq, x, k, distances, offsets, filter);
+        else
+            hnsw->search(nq, x, k, distances, offsets, filter);
+    }
+};
+
+struct IndexSegmented::Job {
+    std::vector<Segment*> inputs;
+    std::vector<IDBitmap> copied;
+};
+
+IndexSegmented::IndexSegmented(size_t d, MetricType metric,
+                               const SegmentedIndexParams& params)
+    : d(d), metric(metric), params(params) {
+    if (metric != METRIC_L2 && metric != METRIC_INNER_PRODUCT) {
+        std::cout << "ERROR, IndexSegmented supports the L2 and inner "
+                  << "product metrics only.\n";
+        exit (-1);
+    }
+    this->params.mutable_size = std::max(params.mutable_size, (size_t)1);
+    this->params.list_size = std::max(params.list_size, (size_t)1);
+
+    active.reset(new Segment(this->params.mutable_size));
+    active->flat.reset(new IndexFlat(d, metric));
+    compactor = std::thread(&IndexSegmented::compact_loop, this);
+}
+
+IndexSegmented::~IndexSegmented() {
+    {
+        std::lock_guard<std::shared_mutex> lock(mutex);
+        stop = true;
+    }
+    wakeup.notify_all();
+    compactor.join();
+}
+
+/* The vectors are copied to the mutable segment in runs that fit in it,
+   the segment is sealed when it is full.  */
+void
+IndexSegmented::add(size_t n, const float* x, const int64_t* labels) {
+    std::lock_guard<std::shared_mutex> lock(mutex);
+    size_t i = 0;
+
+    while (i < n) {
+        if (active->size() == params.mutable_size)
+            seal();
+
+        size_t base = active->size();
+        size_t m = std::min(n - i, params.mutable_size - base);
+
+        for (size_t j = 0; j < m; j++) {
+            auto it = locations.find(labels[i + j]);
+
+            if (it != locations.end())
+                erase(it->second);
+            locations[labels[i + j]] = Location{active.get(), base + j};
+            active->labels.push_back(labels[i + j]);
+            active->live.set(base + j);
+        }
+        active->flat->add(m, x + i * d);
+        i += m;
+    }
+}
+
+size_t
+IndexSegmented::remove(size_t n, const int64_t* labels) {
+    std::lock_guard<std::shared_mutex> lock(mutex);
+    size_t nremoved = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        auto it = locations.find(labels[i]);
+
+        if (it == locations.end())
+            continue;
+        erase(it->second);
+        locations.erase(it);
+        nremoved++;
+    }
+    return nremoved;
+}
+
+/* Called with the lock held.  A sealed segment with too many deleted
+   vectors wakes up the compaction thread.  */
+void
+IndexSegmented::erase(const Location& location) {
+    Segment* segment = location.segment;
+
+    segment->live.unset(location.offset);
+    segment->ndeleted++;
+    if (segment != active.get()
+        && segment->ndeleted > params.max_deleted * segment->size())
+        wakeup.notify_one();
+}
+
+/* Called with the lock held.  The sealed segment keeps its flat index
+   until the compaction thread has built its index.  */
+void
+IndexSegmented::seal() {
+    if (active->size() == 0)
+        return;
+
+    sealed.push_back(std::move(active));
+    active.reset(new Segment(params.mutable_size));
+    active->flat.reset(new IndexFlat(d, metric));
+    wakeup.notify_one();
+}
+
+/* Merge the k results of a segment, best first, whose offsets are mapped
+   to labels by segment_labels, into the k best results of a query so far.
+   tmp_distances and tmp_labels have k entries.  */
+static void
+merge_results(size_t k, bool largest, const float* seg_distances,
+              const int64_t* seg_offsets,
+              const std::vector<int64_t>& segment_labels, float* distances,
+              int64_t* labels, float* tmp_distances, int64_t* tmp_labels) {
+    size_t i = 0, j = 0;
+
+    for (size_t r = 0; r < k; r++) {
+        bool seg_valid = j < k && seg_offsets[j] >= 0;
+        bool valid = i < k && labels[i] >= 0;
+
+        if (seg_valid
+            && (!valid || (largest ? seg_distances[j] > distances[i]
+                                   : seg_distances[j] < distances[i]))) {
+            tmp_distances[r] = seg_distances[j];
+            tmp_labels[r] = segment_labels[seg_offsets[j]];
+            j++;
+        } else if (valid) {
+            tmp_distances[r] = distances[i];
+            tmp_labels[r] = labels[i];
+            i++;
+        } else {
+            tmp_distances[r] = largest ? -HUGE_VALF : HUGE_VALF;
+            tmp_labels[r] = -1;
+        }
+    }
+    memcpy(distances, tmp_distances, k * sizeof(float));
+    memcpy(labels, tmp_labels, k * sizeof(int64_t));
+}
+
+/* The segments are searched one after the other, each search spread over
+   the threads by the index of the segment, and their results are merged
+   into the results of the queries.  */
+void
+IndexSegmented::search(size_t nq, const float* x, size_t k,
+                       float* distances, int64_t* labels) const {
+    bool largest = is_similarity_metric(metric);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    ArenaScope scope;
+    float* seg_distances = scope.alloc<float>(nq * k);
+    int64_t* seg_offsets = scope.alloc<int64_t>(nq * k);
+    float* tmp_distances = scope.alloc<float>(k);
+    int64_t* tmp_labels = scope.alloc<int64_t>(k);
+
+    for (size_t i = 0; i < nq * k; i++) {
+        distances[i] = largest ? -HUGE_VALF : HUGE_VALF;
+        labels[i] = -1;
+    }
+
+    auto search_segment = [&](const Segment& segment) {
+        if (segment.ndeleted == segment.size())
+            return;
+        segment.search(nq, x, k, seg_distances, seg_offsets);
+        for (size_t q = 0; q < nq; q++)
+            merge_results(k, largest, seg_distances + q * k,
+                          seg_offsets + q * k, segment.labels,
+                          distances + q * k, labels + q * k, tmp_distances,
+                          tmp_labels);
+    };
+
+    search_segment(*active);
+    for (const auto& segment : sealed)
+        search_segment(*segment);
+}
+
+void
+IndexSegmented::flush() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    seal();
+    idle.wait(lock, [this]() {
+        Job job;
+
+        return !busy && !pick_job(job);
+    });
+}
+
+SegmentedIndexStats
+IndexSegmented::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    SegmentedIndexStats s;
+
+    s.ntotal = locations.size();
+    s.nstored = active->size();
+    for (const auto& segment : sealed)
+        s.nstored += segment->size();
+    s.nsegments = sealed.size();
+    s.ncompactions = ncompactions;
+    return s;
+}
+
+/* Called with the lock held.  In order of priority: a sealed segment
+   without its index, a segment with too many deleted vectors, and the two
+   smallest segments when there are too many.  */
+bool
+IndexSegmented::pick_job(Job& job) const {
+    for (const auto& segment : sealed) {
+        if (segment->flat) {
+            job.inputs.push_back(segment.get());
+            return true;
+        }
+    }
+
+    for (const auto& segment : sealed) {
+        if (segment->ndeleted > params.max_deleted * segment->size()) {
+            job.inputs.push_back(segment.get());
+            return true;
+        }
+    }
+
+    if (sealed.size() > params.max_segments && sealed.size() >= 2) {
+        std::vector<Segment*> order;
+
+        for (const auto& segment : sealed)
+            order.push_back(segment.get());
+        std::partial_sort(order.begin(), order.begin() + 2, order.end(),
+                          [](const Segment* a, const Segment* b) {
+                              return a->size() - a->ndeleted
+                                     < b->size() - b->ndeleted;
+                          });
+        job.inputs.assign(order.begin(), order.begin() + 2);
+        return true;
+    }
+    return false;
+}
+
+/* Runs without the lock.  The inputs are sealed, so their vectors and
+   labels do not change, and the vectors to copy were taken from their
+   bitmaps under the lock.  */
+std::unique_ptr<IndexSegmented::Segment>
+IndexSegmented::build(const Job& job) const {
+    std::vector<float> x;
+    std::vector<int64_t> labels;
+
+    for (size_t k = 0; k < job.inputs.size(); k++) {
+        const Segment* input = job.inputs[k];
+
+        for (size_t i = 0; i < input->size(); i++) {
+            if (!job.copied[k].get(i))
+                continue;
+            x.insert(x.end(), input->get_vector(i),
+                     input->get_vector(i) + d);
+            labels.push_back(input->labels[i]);
+        }
+    }
+
+    size_t n = labels.size();
+    if (n == 0)
+        return nullptr;
+
+    std::unique_ptr<Segment> output(new Segment(n));
+
+    output->labels.swap(labels);
+    output->live.set_range(0, n);
+
+    if (params.sealed_type == SEGMENT_IVF_FLAT) {
+        size_t nlist = std::max(n / params.list_size, (size_t)1);
+
+        output->ivf.reset(new IndexIVFFlat(d, nlist, metric));
+        output->ivf->train(n, x.data());
+        output->ivf->add(n, x.data());
+        output->ivf->nprobe = params.nprobe;
+    } else {
+        output->hnsw.reset(new IndexHNSW(d, params.hnsw_m, metric));
+        output->hnsw->ef_construction = params.ef_construction;
+        output->hnsw->add(n, x.data());
+        output->hnsw->ef_search = params.ef_search;
+    }
+    return output;
+}
+
+/* Called with the lock held.  The vectors deleted while the output was
+   built are deleted in the output, the labels of the others now point to
+   the output.  */
+void
+IndexSegmented::install(const Job& job, std::unique_ptr<Segment> output) {
+    size_t o = 0;
+
+    for (size_t k = 0; k < job.inputs.size(); k++) {
+        Segment* input = job.inputs[k];
+
+        for (size_t i = 0; i < input->size(); i++) {
+            if (!job.copied[k].get(i))
+                continue;
+            if (input->live.get(i)) {
+                locations[input->labels[i]] = Location{output.get(), o};
+            } else {
+                output->live.unset(o);
+                output->ndeleted++;
+            }
+            o++;
+        }
+    }
+
+    sealed.erase(std::remove_if(sealed.begin(), sealed.end(),
+                                [&job](const std::unique_ptr<Segment>& s) {
+                                    return std::find(job.inputs.begin(),
+                                                     job.inputs.end(),
+                                                     s.get())
+                                           != job.inputs.end();
+                                }),
+                 sealed.end());
+    if (output)
+        sealed.push_back(std::move(output));
+    ncompactions++;
+}
+
+void
+IndexSegmented::compact_loop() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    while (!stop) {
+        Job job;
+
+        if (!pick_job(job)) {
+            busy = false;
+            idle.notify_all();
+            wakeup.wait(lock);
+            continue;
+        }
+
+        busy = true;
+        for (Segment* input : job.inputs)
+            job.copied.push_back(input->live);
+
+        lock.unlock();
+        std::unique_ptr<Segment> output = build(job);
+        lock.lock();
+
+        install(job, std::move(output));
+    }
+    busy = false;
+    idle.notify_all();
+}
+
+}  // namespace vector_search
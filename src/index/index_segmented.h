@@ -0,0 +1,158 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INDEX_INDEX_SEGMENTED_H
+#define INDEX_INDEX_SEGMENTED_H
+
+#include "metric.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vector_search {
+
+/// Index of the sealed segments of an IndexSegmented
+enum SegmentIndexType {
+    SEGMENT_IVF_FLAT = 0,       ///< IndexIVFFlat
+    SEGMENT_HNSW,               ///< IndexHNSW
+};
+
+/// Parameters of an IndexSegmented
+struct SegmentedIndexParams {
+    /// vectors of the mutable segment, which is sealed when it is full
+    size_t mutable_size = 10000;
+
+    SegmentIndexType sealed_type = SEGMENT_IVF_FLAT;
+
+    size_t list_size = 256;     ///< mean vectors per list of an IVF segment
+    size_t nprobe = 8;          ///< lists scanned per IVF segment
+    size_t hnsw_m = 32;         ///< M of an HNSW segment
+    size_t ef_construction = 40;///< ef_construction of an HNSW segment
+    size_t ef_search = 64;      ///< ef_search of an HNSW segment
+
+    /// number of sealed segments above which the two smallest are merged
+    size_t max_segments = 8;
+
+    /// fraction of deleted vectors above which a sealed segment is rebuilt
+    /// without them
+    double max_deleted = 0.2;
+};
+
+/// Counters of an IndexSegmented
+struct SegmentedIndexStats {
+    size_t ntotal = 0;          ///< vectors not deleted
+    size_t nstored = 0;         ///< vectors stored, deleted included
+    size_t nsegments = 0;       ///< sealed segments
+    size_t ncompactions = 0;    ///< segments built by the compaction thread
+};
+
+/// Index with deletes and updates, organized like a log-structured merge
+/// tree.  The vectors are added to a small mutable segment, searched with
+/// the flat kernels.  When it is full, the mutable segment is sealed and
+/// replaced by an empty one, and a background compaction thread builds an
+/// IndexIVFFlat or an IndexHNSW of the sealed segment.  Supports
+/// METRIC_L2 and METRIC_INNER_PRODUCT.
+///
+/// A delete only clears the bit of the vector in the bitmap of its
+/// segment, which the searches of the segment take as filter, and an
+/// update is a delete followed by an add.  The compaction thread rebuilds
+/// the sealed segments whose deleted fraction exceeds max_deleted without
+/// their deleted vectors, and merges the smallest segments when there are
+/// more than max_segments, so that the cost of a search stays bounded as
+/// the vectors are deleted.
+///
+/// A search fans out to all the segments and merges their k best results.
+/// The searches run concurrently with each other, add and remove wait for
+/// them.  The compaction thread builds the new segments without holding
+/// the lock, which it only takes to swap them in.
+struct IndexSegmented {
+    size_t d;                   ///< dimension of the vectors
+    MetricType metric;
+    SegmentedIndexParams params;
+
+    IndexSegmented(size_t d, MetricType metric = METRIC_L2,
+                   const SegmentedIndexParams& params =
+                       SegmentedIndexParams());
+
+    /// Stops the compaction thread
+    ~IndexSegmented();
+
+    IndexSegmented(const IndexSegmented&) = delete;
+    IndexSegmented& operator=(const IndexSegmented&) = delete;
+
+    /// Add the n vectors x with the given labels.  The vector of a label
+    /// already in the index is replaced.
+    void add(size_t n, const float* x, const int64_t* labels);
+
+    /// Delete the vectors of the n labels.  Returns the number of labels
+    /// that were in the index.
+    size_t remove(size_t n, const int64_t* labels);
+
+    /// k nearest neighbors of the nq queries, best first.  distances and
+    /// labels have nq * k entries, missing results have the label -1.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels) const;
+
+    /// Seal the mutable segment and wait until the compaction thread has
+    /// nothing left to do
+    void flush();
+
+    SegmentedIndexStats stats() const;
+
+  private:
+    struct Segment;
+
+    /// position of a label, its segment and its offset in the segment
+    struct Location {
+        Segment* segment;
+        size_t offset;
+    };
+
+    /// the segments of a compaction, and the vectors of each that it
+    /// copies, the ones not deleted when it started
+    struct Job;
+
+    std::unique_ptr<Segment> active;
+    std::vector<std::unique_ptr<Segment>> sealed;
+    std::unordered_map<int64_t, Location> locations;
+
+    /// shared by the searches, exclusive for the modifications
+    mutable std::shared_mutex mutex;
+    std::condition_variable_any wakeup;     ///< work for the compaction
+    std::condition_variable_any idle;       ///< compaction done
+    bool stop = false;
+    bool busy = false;
+    size_t ncompactions = 0;
+    std::thread compactor;
+
+    void seal();
+    void erase(const Location& location);
+    bool pick_job(Job& job) const;
+    std::unique_ptr<Segment> build(const Job& job) const;
+    void install(const Job& job, std::unique_ptr<Segment> output);
+    void compact_loop();
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_SEGMENTED_H */
@@ -0,0 +1,494 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "index_vamana_disk.h"
+
+#include "distances/distances.h"
+#include "utils/arena.h"
+#include "utils/parallel.h"
+#include "utils/visited_table.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <unistd.h>
+
+/* Identifies the index files, "VAMANA01".  */
+#define VAMANA_MAGIC 0x31304e414d414d56ULL
+
+/* Number of threads of the pread pool.  */
+#define VAMANA_PREAD_THREADS 16
+
+namespace vector_search {
+
+/* Header of the index file, in its first sector.  The nodes follow, one
+   per sectors_per_node sectors, then the scalar quantizer and the codes.  */
+struct VamanaHeader {
+    uint64_t magic;
+    uint64_t d;
+    uint64_t n;
+    uint64_t R;
+    int64_t medoid;
+    uint64_t sectors_per_node;
+};
+
+/* Candidate list of a graph search: the size nearest nodes found so far,
+   sorted by distance, with a flag set when the node was expanded.  */
+struct CandidateList {
+    struct Candidate {
+        float dis;
+        int64_t id;
+        bool expanded;
+    };
+
+    size_t size;
+    ScratchVector<Candidate> list;
+
+    explicit CandidateList(size_t size) : size(size) {
+        list.reserve(size + 1);
+    }
+
+    void insert(float dis, int64_t id) {
+        if (list.size() == size && dis >= list.back().dis)
+            return;
+
+        auto pos = std::upper_bound(list.begin(), list.end(), dis,
+                                    [](float v, const Candidate& c) {
+                                        return v < c.dis;
+                                    });
+        list.insert(pos, Candidate{dis, id, false});
+        if (list.size() > size)
+            list.pop_back();
+    }
+
+    /* Nearest unexpanded candidate, marked expanded, or -1.  */
+    int64_t pop_unexpanded() {
+        for (Candidate& c : list) {
+            if (!c.expanded) {
+                c.expanded = true;
+                return c.id;
+            }
+        }
+        return -1;
+    }
+};
+
+/* In memory graph of the build, R slots per node.  */
+struct VamanaGraph {
+    size_t n, d, R;
+    const float* x;
+    std::vector<int32_t> neighbors;
+    std::vector<uint32_t> degrees;
+    std::vector<std::mutex> locks;
+
+    VamanaGraph(size_t n, size_t d, size_t R, const float* x)
+        : n(n), d(d), R(R), x(x), neighbors(n * R), degrees(n, 0),
+          locks(n) {}
+
+    float distance(size_t i, size_t j) const {
+        return fvec_L2sqr(x + i * d, x + j * d, d);
+    }
+
+    /* Copy of the neighbors of node i.  */
+    void get_neighbors(size_t i, std::vector<int32_t>& out) {
+        std::lock_guard<std::mutex> lock(locks[i]);
+
+        out.assign(neighbors.begin() + i * R,
+                   neighbors.begin() + i * R + degrees[i]);
+    }
+
+    /* Greedy search for vector xq from start.  visited gets the expanded
+       nodes with their distances.  */
+    void greedy_search(const float* xq, int64_t start, size_t L,
+                       VisitedTable& vt,
+                       std::vector<std::pair<float, int64_t>>& visited) {
+        CandidateList candidates(L);
+        std::vector<int32_t> nbrs;
+        int64_t c;
+
+        vt.advance();
+        visited.clear();
+        vt.set(start);
+        candidates.insert(fvec_L2sqr(xq, x + start * d, d), start);
+
+        while ((c = candidates.pop_unexpanded()) >= 0) {
+            visited.emplace_back(fvec_L2sqr(xq, x + c * d, d), c);
+            get_neighbors(c, nbrs);
+            for (int32_t v : nbrs) {
+                if (vt.get(v))
+                    continue;
+                vt.set(v);
+                candidates.insert(fvec_L2sqr(xq, x + v * d, d), v);
+            }
+        }
+    }
+
+    /* Robust pruning: keep the nearest candidate p*, drop the candidates c
+       with alpha * d(p*, c) <= d(p, c), repeat until R neighbors are kept.
+       candidates has the distances to p.  */
+    void robust_prune(size_t p, std::vector<std::pair<float, int64_t>>& cands,
+                      float alpha, std::vector<int32_t>& out) const {
+        std::sort(cands.begin(), cands.end());
+        cands.erase(std::unique(cands.begin(), cands.end(),
+                                [](const std::pair<float, int64_t>& a,
+                                   const std::pair<float, int64_t>& b) {
+                                    return a.second == b.second;
+                                }),
+                    cands.end());
+
+        std::vector<bool> pruned(cands.size(), false);
+        out.clear();
+
+        for (size_t i = 0; i < cands.size() && out.size() < R; i++) {
+            if (pruned[i] || cands[i].second == (int64_t)p)
+                continue;
+            out.push_back(cands[i].second);
+
+            for (size_t j = i + 1; j < cands.size(); j++) {
+                if (pruned[j])
+                    continue;
+                if (alpha * distance(cands[i].second, cands[j].second)
+                    <= cands[j].first)
+                    pruned[j] = true;
+            }
+        }
+    }
+
+    void set_neighbors(size_t i, const std::vector<int32_t>& nbrs) {
+        std::lock_guard<std::mutex> lock(locks[i]);
+
+        std::copy(nbrs.begin(), nbrs.end(), neighbors.begin() + i * R);
+        degrees[i] = nbrs.size();
+    }
+
+    /* Add the edge j -> p, pruning the neighbors of j when it is full.  */
+    void add_reverse_edge(size_t j, size_t p, float alpha) {
+        std::lock_guard<std::mutex> lock(locks[j]);
+        int32_t* nbrs = &neighbors[j * R];
+
+        for (size_t t = 0; t < degrees[j]; t++)
+            if (nbrs[t] == (int32_t)p)
+                return;
+
+        if (degrees[j] < R) {
+            nbrs[degrees[j]++] = p;
+            return;
+        }
+
+        std::vector<std::pair<float, int64_t>> cands;
+        std::vector<int32_t> pruned;
+
+        for (size_t t = 0; t < degrees[j]; t++)
+            cands.emplace_back(distance(j, nbrs[t]), nbrs[t]);
+        cands.emplace_back(distance(j, p), p);
+        robust_prune(j, cands, alpha, pruned);
+
+        std::copy(pruned.begin(), pruned.end(), nbrs);
+        degrees[j] = pruned.size();
+    }
+};
+
+IndexVamanaDisk::IndexVamanaDisk(size_t d, size_t R) : d(d), R(R), sq(d) {}
+
+IndexVamanaDisk::~IndexVamanaDisk() {
+    close_file();
+}
+
+void
+IndexVamanaDisk::close_file() {
+    pool.reset();
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+}
+
+/* Nearest vector to the mean of the n vectors.  */
+static int64_t
+find_medoid(size_t n, size_t d, const float* x) {
+    std::vector<double> sum(d, 0);
+    std::vector<float> mean(d);
+    std::vector<std::pair<float, int64_t>> best(n);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t l = 0; l < d; l++)
+            sum[l] += x[i * d + l];
+    for (size_t l = 0; l < d; l++)
+        mean[l] = sum[l] / n;
+
+    parallel_for(n, 1024, [&](size_t i0, size_t i1) {
+        for (size_t i = i0; i < i1; i++)
+            best[i] = std::make_pair(fvec_L2sqr(mean.data(), x + i * d, d),
+                                     (int64_t)i);
+    });
+    return std::min_element(best.begin(), best.end())->second;
+}
+
+void
+IndexVamanaDisk::build(size_t n, const float* x, const std::string& path) {
+    VamanaGraph graph(n, d, R, x);
+    std::mt19937 rng(1234);
+    std::vector<size_t> order(n);
+
+    if (n == 0) {
+        std::cout << "ERROR, IndexVamanaDisk::build with no vectors.\n";
+        exit (-1);
+    }
+
+    /* Random initial graph of degree R.  */
+    for (size_t i = 0; i < n; i++) {
+        std::uniform_int_distribution<size_t> pick(0, n - 1);
+
+        for (size_t t = 0; t < std::min(R, n - 1); t++) {
+            size_t j = pick(rng);
+
+            if (j != i)
+                graph.neighbors[i * R + graph.degrees[i]++] = j;
+        }
+    }
+
+    medoid = find_medoid(n, d, x);
+
+    /* A first pass with alpha = 1, then a pass with alpha, each over the
+       vectors in a random order spread over the threads.  */
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    for (float pass_alpha : {1.0f, alpha}) {
+        parallel_for(n, 64, [&](size_t i0, size_t i1) {
+            VisitedTable vt(n);
+            std::vector<std::pair<float, int64_t>> visited;
+            std::vector<int32_t> nbrs, pruned;
+
+            for (size_t i = i0; i < i1; i++) {
+                size_t p = order[i];
+
+                graph.greedy_search(x + p * d, medoid, L_build, vt, visited);
+                graph.get_neighbors(p, nbrs);
+                for (int32_t v : nbrs)
+                    visited.emplace_back(graph.distance(p, v), v);
+
+                graph.robust_prune(p, visited, pass_alpha, pruned);
+                graph.set_neighbors(p, pruned);
+
+                for (int32_t j : pruned)
+                    graph.add_reverse_edge(j, p, pass_alpha);
+            }
+        });
+    }
+
+    ntotal = n;
+    sectors_per_node = (d * sizeof(float) + sizeof(uint32_t)
+                        + R * sizeof(int32_t) + SECTOR_SIZE - 1)
+                       / SECTOR_SIZE;
+
+    sq = ScalarQuantizer(d);
+    sq.train(n, x);
+    codes.resize(n * d);
+    sq.encode(n, x, codes.data());
+
+    /* Write the header, the nodes, then the quantizer and the codes.  */
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    std::vector<char> sector(sectors_per_node * SECTOR_SIZE);
+    VamanaHeader header = {VAMANA_MAGIC, d, n, R, medoid, sectors_per_node};
+
+    if (!file.is_open()) {
+        std::cout << "ERROR, could not create " << path << ".\n";
+        exit (-1);
+    }
+
+    std::fill(sector.begin(), sector.end(), 0);
+    memcpy(sector.data(), &header, sizeof(header));
+    file.write(sector.data(), SECTOR_SIZE);
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t degree = graph.degrees[i];
+
+        std::fill(sector.begin(), sector.end(), 0);
+        memcpy(sector.data(), x + i * d, d * sizeof(float));
+        memcpy(sector.data() + d * sizeof(float), &degree, sizeof(degree));
+        memcpy(sector.data() + d * sizeof(float) + sizeof(degree),
+               &graph.neighbors[i * R], degree * sizeof(int32_t));
+        file.write(sector.data(), sector.size());
+    }
+
+    file.write((const char*)sq.vmin.data(), d * sizeof(float));
+    file.write((const char*)sq.vdiff.data(), d * sizeof(float));
+    file.write((const char*)codes.data(), codes.size());
+
+    if (!file) {
+        std::cout << "ERROR, could not write " << path << ".\n";
+        exit (-1);
+    }
+    file.close();
+
+    load(path);
+}
+
+void
+IndexVamanaDisk::load(const std::string& path) {
+    VamanaHeader header;
+
+    close_file();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read((char*)&header, sizeof(header))
+        || header.magic != VAMANA_MAGIC) {
+        std::cout << "ERROR, " << path << " is not a Vamana index file.\n";
+        exit (-1);
+    }
+    d = header.d;
+    ntotal = header.n;
+    R = header.R;
+    medoid = header.medoid;
+    sectors_per_node = header.sectors_per_node;
+
+    sq = ScalarQuantizer(d);
+    codes.resize(ntotal * d);
+    file.seekg((1 + ntotal * sectors_per_node) * SECTOR_SIZE);
+    file.read((char*)sq.vmin.data(), d * sizeof(float));
+    file.read((char*)sq.vdiff.data(), d * sizeof(float));
+    file.read((char*)codes.data(), codes.size());
+    if (!file) {
+        std::cout << "ERROR, could not read the codes of " << path << ".\n";
+        exit (-1);
+    }
+
+    /* The nodes are read bypassing the page cache when the file system
+       supports it.  */
+#ifdef O_DIRECT
+    fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+#endif
+    if (fd < 0)
+        fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "ERROR, could not open " << path << ": "
+                  << strerror(errno) << ".\n";
+        exit (-1);
+    }
+
+    pool.reset(new PreadPool(fd, VAMANA_PREAD_THREADS));
+}
+
+void
+IndexVamanaDisk::search(size_t nq, const float* x, size_t k,
+                        float* distances, int64_t* labels,
+                        DiskSearchStats* stats) const {
+    size_t L = std::max(search_list, k);
+    size_t W = std::max(beam_width, (size_t)1);
+    size_t node_bytes = sectors_per_node * SECTOR_SIZE;
+    std::mutex stats_mutex;
+
+    if (fd < 0) {
+        std::cout << "ERROR, IndexVamanaDisk::search before build or load.\n";
+        exit (-1);
+    }
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        std::unique_ptr<SectorReader> reader =
+            make_sector_reader(fd, W, pool.get());
+        ArenaScope scope;
+        char* buf = (char*)scope.arena.allocate(W * node_bytes, SECTOR_SIZE);
+        std::vector<ReadRequest> requests;
+        ScratchVector<int64_t> ids;
+        ScratchVector<std::pair<float, int64_t>> exact;
+        DiskSearchStats local;
+
+        for (size_t q = q0; q < q1; q++) {
+            const float* xq = x + q * d;
+            CandidateList candidates(L);
+            VisitedTable& visited = thread_visited_table(ntotal);
+            size_t i = 0;
+
+            exact.clear();
+            visited.set(medoid);
+            candidates.insert(sq.L2sqr_to_code(xq, &codes[medoid * d]),
+                              medoid);
+
+            for (;;) {
+                int64_t c;
+
+                /* One round trip: read the W nearest unexpanded nodes.  */
+                ids.clear();
+                requests.clear();
+                while (ids.size() < W
+                       && (c = candidates.pop_unexpanded()) >= 0) {
+                    requests.push_back({(1 + c * sectors_per_node)
+                                        * SECTOR_SIZE, node_bytes,
+                                        buf + ids.size() * node_bytes});
+                    ids.push_back(c);
+                }
+                if (ids.empty())
+                    break;
+
+                reader->read(requests);
+                local.n_ios += ids.size();
+                local.n_hops++;
+
+                for (size_t r = 0; r < ids.size(); r++) {
+                    const char* node = buf + r * node_bytes;
+                    const float* vec = (const float*)node;
+                    uint32_t degree;
+
+                    memcpy(&degree, node + d * sizeof(float), sizeof(degree));
+                    const int32_t* nbrs =
+                        (const int32_t*)(node + d * sizeof(float)
+                                         + sizeof(degree));
+
+                    exact.emplace_back(fvec_L2sqr(xq, vec, d), ids[r]);
+
+                    for (uint32_t t = 0; t < degree; t++) {
+                        int64_t v = nbrs[t];
+
+                        if (visited.get(v))
+                            continue;
+                        visited.set(v);
+                        candidates.insert(
+                            sq.L2sqr_to_code(xq, &codes[v * d]), v);
+                    }
+                }
+            }
+
+            std::sort(exact.begin(), exact.end());
+            for (; i < k && i < exact.size(); i++) {
+                distances[q * k + i] = exact[i].first;
+                labels[q * k + i] = exact[i].second;
+            }
+            for (; i < k; i++) {
+                distances[q * k + i] = HUGE_VALF;
+                labels[q * k + i] = -1;
+            }
+            local.nq++;
+        }
+
+        if (stats) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+
+            stats->nq += local.nq;
+            stats->n_ios += local.n_ios;
+            stats->n_hops += local.n_hops;
+        }
+    });
+}
+
+}  // namespace vector_search
@@ -0,0 +1,88 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_INDEX_VAMANA_DISK_H
+#define INDEX_INDEX_VAMANA_DISK_H
+
+#include "quantization/scalar_quantizer.h"
+#include "utils/aligned_buffer.h"
+#include "utils/sector_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vector_search {
+
+/// I/O counters of IndexVamanaDisk::search, summed over the queries
+struct DiskSearchStats {
+    size_t nq = 0;          ///< number of queries
+    size_t n_ios = 0;       ///< number of sector reads
+    size_t n_hops = 0;      ///< number of batches of reads (round trips)
+};
+
+/// Disk-resident Vamana graph index (DiskANN, Subramanya et al., 2019),
+/// with the squared L2 distance.  Each node is stored in its own sector
+/// of the index file: its full precision vector, its degree and its R
+/// neighbors.  Only the 8-bit scalar quantized vectors are kept in memory,
+/// to navigate the graph.
+///
+/// The beam search reads the beam_width nearest unexpanded candidates in
+/// one batch of reads, computes the exact distance of the nodes read and
+/// the quantized distances of their neighbors, and repeats until the
+/// search_list nearest candidates are expanded.  The results are ranked
+/// by their exact distances.
+struct IndexVamanaDisk {
+    size_t d;                   ///< dimension of the vectors
+    size_t R;                   ///< maximum degree of the graph
+    size_t L_build = 64;        ///< candidate list size of the build
+    float alpha = 1.2f;         ///< pruning factor of the second pass
+    size_t search_list = 32;    ///< candidate list size of search
+    size_t beam_width = 4;      ///< reads issued per round trip
+    size_t ntotal = 0;          ///< number of vectors
+    int64_t medoid = -1;        ///< entry point of the searches
+    size_t sectors_per_node = 0;
+
+    ScalarQuantizer sq;
+    AlignedBuffer<uint8_t> codes;   ///< in memory quantized vectors
+
+    IndexVamanaDisk(size_t d, size_t R = 32);
+    ~IndexVamanaDisk();
+
+    /// Build the graph of the n vectors x in memory, write it to path and
+    /// open it for searching
+    void build(size_t n, const float* x, const std::string& path);
+
+    /// Open an index file written by build
+    void load(const std::string& path);
+
+    /// k nearest neighbors of the nq queries.  The I/O counters are added
+    /// to stats when it is not null.
+    void search(size_t nq, const float* x, size_t k, float* distances,
+                int64_t* labels, DiskSearchStats* stats = nullptr) const;
+
+  private:
+    int fd = -1;
+    std::unique_ptr<PreadPool> pool;
+
+    void close_file();
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_INDEX_VAMANA_DISK_H */
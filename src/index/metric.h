@@ -0,0 +1,40 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_METRIC_H
+#define INDEX_METRIC_H
+
+namespace vector_search {
+
+/// Distance used by the indexes
+enum MetricType {
+    METRIC_L2 = 0,          ///< squared L2 distance
+    METRIC_INNER_PRODUCT,   ///< inner product, a similarity
+    METRIC_COSINE,          ///< 1 - cosine similarity
+    METRIC_L1,              ///< L1 distance
+    METRIC_JACCARD,         ///< weighted Jaccard distance
+    METRIC_HAMMING,         ///< Hamming distance between binary codes
+};
+
+/// true for the metrics whose best results have the largest values
+inline bool
+is_similarity_metric(MetricType metric) {
+    return metric == METRIC_INNER_PRODUCT;
+}
+
+}  // namespace vector_search
+
+#endif /* INDEX_METRIC_H */
@@ -0,0 +1,123 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "reranker.h"
+
+#include "distances/distances.h"
+#include "distances/prefetch.h"
+#include "utils/arena.h"
+#include "utils/mmap_vectors.h"
+#include "utils/parallel.h"
+#include "utils/topk.h"
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+
+/* Number of candidates prefetched ahead of the one being scored, enough
+   to cover the latency of a page cache or memory access.  */
+#define RERANK_PREFETCH_AHEAD 8
+
+namespace vector_search {
+
+Reranker::Reranker(size_t d, const float* base, size_t stride,
+                   MetricType metric)
+    : d(d), metric(metric), base(base), stride(stride) {
+    if (metric != METRIC_L2 && metric != METRIC_INNER_PRODUCT) {
+        std::cout << "ERROR, Reranker supports the L2 and inner product "
+                  << "metrics only.\n";
+        exit (-1);
+    }
+}
+
+Reranker::Reranker(const MmapVectors& store, MetricType metric)
+    : Reranker(store.d, store.n ? store.get_vector(0) : nullptr,
+               store.stride, metric) {}
+
+/* The queries are spread over the threads.  The valid candidates of a
+   query are scored four at a time with the batch kernels, while the
+   vectors of the candidates RERANK_PREFETCH_AHEAD positions later are
+   prefetched.  The by_ids kernels do not apply, the vectors are stride
+   floats apart, d + 1 in a memory mapped .fvecs file.  */
+void
+Reranker::rerank(size_t nq, const float* x, size_t ncand,
+                 const int64_t* candidates, size_t k, float* distances,
+                 int64_t* labels, RerankStats* stats) const {
+    bool largest = is_similarity_metric(metric);
+    auto start = std::chrono::steady_clock::now();
+    std::mutex stats_mutex;
+    size_t total = 0;
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        TopK heap(k, largest);
+        ArenaScope scope;
+        int64_t* ids = scope.alloc<int64_t>(ncand);
+        float* dis = scope.alloc<float>(ncand);
+        const float* y[4];
+        size_t scored = 0;
+
+        for (size_t q = q0; q < q1; q++) {
+            const float* xq = x + q * d;
+            size_t n = 0, j;
+
+            for (size_t c = 0; c < ncand; c++)
+                if (candidates[q * ncand + c] >= 0)
+                    ids[n++] = candidates[q * ncand + c];
+
+            for (j = 0; j < n && j < RERANK_PREFETCH_AHEAD; j++)
+                prefetch_span(get_vector(ids[j]), d * sizeof(float));
+
+            for (j = 0; j + 4 <= n; j += 4) {
+                for (size_t t = 0; t < 4; t++) {
+                    size_t ahead = j + t + RERANK_PREFETCH_AHEAD;
+
+                    if (ahead < n)
+                        prefetch_span(get_vector(ids[ahead]),
+                                      d * sizeof(float));
+                    y[t] = get_vector(ids[j + t]);
+                }
+                if (metric == METRIC_L2)
+                    fvec_L2sqr_batch_N<4>(xq, y, d, dis + j);
+                else
+                    fvec_inner_product_batch_N<4>(xq, y, d, dis + j);
+            }
+            for (; j < n; j++)
+                dis[j] = metric == METRIC_L2
+                         ? fvec_L2sqr(xq, get_vector(ids[j]), d)
+                         : fvec_inner_product(xq, get_vector(ids[j]), d);
+
+            heap.clear();
+            for (j = 0; j < n; j++)
+                heap.push(dis[j], ids[j]);
+            heap.extract(distances + q * k, labels + q * k);
+            scored += n;
+        }
+
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        total += scored;
+    });
+
+    if (stats) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        stats->nq += nq;
+        stats->ncandidates += total;
+        stats->seconds += elapsed.count();
+    }
+}
+
+}  // namespace vector_search
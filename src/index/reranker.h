@@ -0,0 +1,73 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INDEX_RERANKER_H
+#define INDEX_RERANKER_H
+
+#include "metric.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vector_search {
+
+struct MmapVectors;
+
+/// Counters of Reranker::rerank, summed over the calls
+struct RerankStats {
+    size_t nq = 0;              ///< number of queries
+    size_t ncandidates = 0;     ///< number of candidates scored
+    double seconds = 0;         ///< time spent in rerank
+};
+
+/// Exact re-ranking of the candidates of a search on compressed codes.
+/// The full precision vectors of the candidates are gathered from a store,
+/// typically memory mapped, prefetched ahead of their use and compared to
+/// the query four at a time with the batch kernels.  Supports METRIC_L2
+/// and METRIC_INNER_PRODUCT.
+struct Reranker {
+    size_t d;                   ///< dimension of the vectors
+    MetricType metric;
+
+    /// Vectors stored at base + i * stride
+    Reranker(size_t d, const float* base, size_t stride,
+             MetricType metric = METRIC_L2);
+
+    /// Vectors of a memory mapped .fvecs file
+    explicit Reranker(const MmapVectors& store,
+                      MetricType metric = METRIC_L2);
+
+    /// The k best of the ncand candidates of each of the nq queries, with
+    /// their exact distances.  candidates has nq * ncand labels, -1 for
+    /// missing candidates.  distances and labels have nq * k entries, best
+    /// first.  The time and the counts are added to stats when it is not
+    /// null.
+    void rerank(size_t nq, const float* x, size_t ncand,
+                const int64_t* candidates, size_t k, float* distances,
+                int64_t* labels, RerankStats* stats = nullptr) const;
+
+  private:
+    const float* base;
+    size_t stride;
+
+    const float* get_vector(int64_t i) const {
+        return base + i * stride;
+    }
+};
+
+}  // namespace vector_search
+
+#endif /* INDEX_RERANKER_H */
@@ -0,0 +1,2213 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "main-bench.h"
+
+#include "clustering/kmeans.h"
+#include "distances/distances.h"
+#include "index/async_searcher.h"
+#include "index/index_flat.h"
+#include "index/index_flat_shards.h"
+#include "index/index_hnsw.h"
+#include "index/index_hnsw_concurrent.h"
+#include "index/index_ivf_concurrent.h"
+#include "index/index_ivf_flat.h"
+#include "index/index_rabitq.h"
+#include "index/index_segmented.h"
+#include "index/index_vamana_disk.h"
+#include "index/reranker.h"
+#include "quantization/binary_quantizer.h"
+#include "quantization/product_quantizer.h"
+#include "quantization/rabitq.h"
+#include "quantization/scalar_quantizer.h"
+#include "quantization/vector_transform.h"
+#include "utils/arena.h"
+#include "utils/blocked_layout.h"
+#include "utils/id_bitmap.h"
+#include "utils/io.h"
+#include "utils/memory.h"
+#include "utils/mmap_vectors.h"
+#include "utils/numa.h"
+#include "utils/parallel.h"
+#include "utils/range_result.h"
+#include "utils/thread_pool.h"
+#include "utils/topk.h"
+
+#include "distances/base/euclidean_l2_distance.h"
+#include "distances/base/innerproduct.h"
+#include "distances/base/manhattan_l1_distance.h"
+#include "distances/base/cosine_distance.h"
+#include "distances/base/jaccard_distance.h"
+#include "distances/base/hamming_distance.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Number of iterations of the k-means benchmark.  The mini-batch runs do
+   more iterations on batches of BENCH_KMEANS_BATCH_SIZE vectors.  */
+#define BENCH_KMEANS_NITER            10
+#define BENCH_KMEANS_MINIBATCH_NITER  100
+#define BENCH_KMEANS_BATCH_SIZE       8192
+
+/* Number of queries of the flat index benchmark that are checked against a
+   scan with the base functions, and searched one at a time to measure the
+   memory bandwidth of a single query.  */
+#define BENCH_FLAT_CHECK_QUERIES      10
+
+/* Largest ef_search of the HNSW benchmark, and the recall whose latency
+   is reported.  */
+#define BENCH_HNSW_MAX_EF             1024
+#define BENCH_HNSW_TARGET_RECALL      0.95
+
+/* Index file of the Vamana benchmark, and its largest search list.  */
+#define BENCH_VAMANA_FILE             "results/vamana_disk.index"
+#define BENCH_VAMANA_MAX_LIST         256
+
+/* nprobe of the IndexIVFFlat searches of the filtered search benchmark.  */
+#define BENCH_FILTER_NPROBE           16
+
+/* The radii of the range search benchmark are the medians over the queries
+   of the distance between their 10th and 11th nearest neighbors, then
+   100th and 101st, and 1000th and 1001st.  */
+#define BENCH_RANGE_MAX_RANK          1000
+
+/* Vector file of the re-ranking benchmark with the synthetic data set, and
+   its largest number of candidates per query, in multiples of k.  */
+#define BENCH_RERANK_FILE             "results/rerank_base.fvecs"
+#define BENCH_RERANK_MAX_FACTOR       16
+
+/* Largest oversampling factor of the binary quantization benchmark.  */
+#define BENCH_BINARY_MAX_OVERSAMPLE   64
+
+/* The transform benchmark reduces the dimension by PCA down to d /
+   BENCH_PCA_MAX_REDUCTION, and quantizes the vectors with sub-quantizers
+   of BENCH_PQ_DSUB dimensions.  */
+#define BENCH_PCA_MAX_REDUCTION       8
+#define BENCH_PQ_DSUB                 8
+#define BENCH_OPQ_NITER               10
+
+/* Passes over the database of the NUMA bandwidth measures, the best one
+   is reported.  */
+#define BENCH_NUMA_REPEAT             5
+
+/* Number of dependent loads timed for the latency, and of independent
+   vector gathers timed for the throughput, of the working set benchmark.  */
+#define BENCH_WS_CHASE                (1 << 20)
+#define BENCH_WS_GATHERS              (1 << 20)
+
+/* Number of queries of the blocked layout benchmark.  */
+#define BENCH_BLOCKED_NQ              100
+
+/* nprobe, ef_search and candidates per query of the searches of the arena
+   benchmark.  */
+#define BENCH_ARENA_NPROBE            16
+#define BENCH_ARENA_EF                64
+#define BENCH_ARENA_RERANK_FACTOR     4
+
+/* Duration of each open-loop run of the asynchronous search benchmark, and
+   number of single queries timed for its reference throughput.  */
+#define BENCH_ASYNC_SECONDS           2
+#define BENCH_ASYNC_SINGLE_QUERIES    200
+
+/* nprobe and ef_search of the searches of the interleaved search
+   benchmark, and largest number of queries interleaved.  */
+#define BENCH_INTERLEAVE_NPROBE       16
+#define BENCH_INTERLEAVE_EF           64
+#define BENCH_INTERLEAVE_MAX          16
+
+/* nprobe, ef_search and vectors per add call of the concurrent insert
+   benchmark.  */
+#define BENCH_CONCURRENT_NPROBE       16
+#define BENCH_CONCURRENT_EF           64
+#define BENCH_CONCURRENT_BATCH        100
+
+/* Rounds of the segmented index benchmark, and percentages of the vectors
+   deleted and updated per round.  */
+#define BENCH_SEGMENTS_ROUNDS         5
+#define BENCH_SEGMENTS_DELETE_PCT     10
+#define BENCH_SEGMENTS_UPDATE_PCT     5
+
+using vector_search::MetricType;
+
+/* Heap allocations of the program while bench_counting is set, counted by
+   the replacements of the global operator new and delete below.  The arena
+   benchmark uses them to check that the searches do not allocate.  */
+static std::atomic<bool> bench_counting(false);
+static std::atomic<size_t> bench_allocations(0);
+
+void *
+operator new (size_t size)
+{
+    void *p;
+
+    if (bench_counting.load(std::memory_order_relaxed))
+        bench_allocations++;
+    p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *
+operator new[] (size_t size)
+{
+    return operator new(size);
+}
+
+void *
+operator new (size_t size, std::align_val_t align)
+{
+    size_t a = (size_t)align;
+    void *p;
+
+    if (bench_counting.load(std::memory_order_relaxed))
+        bench_allocations++;
+    p = aligned_alloc(a, (size + a - 1) / a * a);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *
+operator new[] (size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+/* The other forms of delete call this one, which is not inlined so that
+   the compiler does not see free() applied to the result of new.  */
+__attribute__((noinline)) void
+operator delete (void *p) noexcept
+{
+    free(p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+    operator delete(p);
+}
+
+void
+operator delete (void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void
+operator delete[] (void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void
+operator delete (void *p, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+
+void
+operator delete[] (void *p, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+
+void
+operator delete (void *p, size_t, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+
+void
+operator delete[] (void *p, size_t, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+
+static double
+elapsed_seconds (std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+/* Generate n vectors drawn around nclusters random centers, with a unit
+   Gaussian noise.  The centers are spread uniformly in [-10, 10]^d.  */
+void
+make_clustered_data (size_t n, size_t d, size_t nclusters, int seed,
+                     std::vector<float> &x)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> center_dist(-10.0f, 10.0f);
+    std::uniform_int_distribution<size_t> cluster_dist(0, nclusters - 1);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    std::vector<float> centers(nclusters * d);
+
+    for (size_t i = 0; i < nclusters * d; i++)
+        centers[i] = center_dist(rng);
+
+    x.resize(n * d);
+    for (size_t i = 0; i < n; i++) {
+        const float *center = &centers[cluster_dist(rng) * d];
+
+        for (size_t l = 0; l < d; l++)
+            x[i * d + l] = center[l] + noise(rng);
+    }
+}
+
+/* Database and query vectors drawn around the same centers, the queries
+   are the last nq vectors generated.  */
+static void
+make_base_and_queries (size_t nb, size_t nq, size_t d, std::vector<float> &xb,
+                       std::vector<float> &xq)
+{
+    make_clustered_data(nb + nq, d, BENCH_DATA_CLUSTERS, 1234, xb);
+    xq.assign(xb.begin() + nb * d, xb.end());
+    xb.resize(nb * d);
+}
+
+void
+bench_kmeans (const struct bench_params_t &params)
+{
+    using namespace std;
+    struct config_t {
+        const char *name;
+        bool kmeanspp_init;
+        size_t batch_size;
+        int niter;
+    };
+    const config_t configs[] = {
+        {"random init, full batch", false, 0, BENCH_KMEANS_NITER},
+        {"k-means++ init, full batch", true, 0, BENCH_KMEANS_NITER},
+        {"random init, mini-batch", false, BENCH_KMEANS_BATCH_SIZE,
+         BENCH_KMEANS_MINIBATCH_NITER},
+        {"k-means++ init, mini-batch", true, BENCH_KMEANS_BATCH_SIZE,
+         BENCH_KMEANS_MINIBATCH_NITER},
+    };
+    vector<float> x;
+
+    make_clustered_data(params.nb, params.d, BENCH_DATA_CLUSTERS, 1234, x);
+
+    cout << "KMeans benchmark, " << params.nb << " x " << params.d
+         << " vectors, " << params.ncentroids << " centroids, "
+         << vector_search::get_num_threads() << " threads\n";
+    cout << left << setw(30) << "configuration" << setw(8) << "niter"
+         << setw(14) << "train (s)" << setw(14) << "per iter (s)"
+         << "objective\n";
+
+    for (const config_t &config : configs) {
+        vector_search::KMeansParams kp;
+
+        kp.niter = config.niter;
+        kp.kmeanspp_init = config.kmeanspp_init;
+        kp.batch_size = config.batch_size;
+        kp.max_points_per_centroid = 0;
+
+        vector_search::KMeans kmeans(params.d, params.ncentroids, kp);
+        auto start = chrono::steady_clock::now();
+        float obj = kmeans.train(params.nb, x.data());
+        double seconds = elapsed_seconds(start);
+
+        cout << left << setw(30) << config.name << setw(8) << config.niter
+             << setw(14) << seconds << setw(14) << seconds / config.niter
+             << obj << "\n";
+    }
+}
+
+/* Sign bits of the n vectors x, packed in d / 8 bytes per vector.  */
+static void
+make_binary_codes (const std::vector<float> &x, size_t n, size_t d,
+                   std::vector<uint8_t> &codes)
+{
+    codes.assign(n * d / 8, 0);
+    for (size_t i = 0; i < n; i++)
+        for (size_t l = 0; l < d; l++)
+            if (x[i * d + l] > 0)
+                codes[i * d / 8 + l / 8] |= 1 << (l % 8);
+}
+
+static const char *
+metric_name (MetricType metric)
+{
+    switch (metric) {
+    case vector_search::METRIC_L2:            return "L2";
+    case vector_search::METRIC_INNER_PRODUCT: return "inner product";
+    case vector_search::METRIC_COSINE:        return "cosine";
+    case vector_search::METRIC_L1:            return "L1";
+    case vector_search::METRIC_JACCARD:       return "Jaccard";
+    case vector_search::METRIC_HAMMING:       return "Hamming";
+    }
+    return "unknown";
+}
+
+/* Distance computed with the base functions.  */
+static float
+base_distance (MetricType metric, const void *x, const void *y, size_t d)
+{
+    const float *xf = (const float *)x;
+    const float *yf = (const float *)y;
+
+    switch (metric) {
+    case vector_search::METRIC_L2:
+        return base::fvec_L2sqr_ref(xf, yf, d);
+    case vector_search::METRIC_INNER_PRODUCT:
+        return base::fvec_inner_product_ref(xf, yf, d);
+    case vector_search::METRIC_COSINE:
+        return base::cosine_distance_ref(xf, yf, d);
+    case vector_search::METRIC_L1:
+        return base::fvec_L1_ref(xf, yf, d);
+    case vector_search::METRIC_JACCARD:
+        return base::jaccard_distance_ref(xf, yf, d);
+    case vector_search::METRIC_HAMMING:
+        return base::hamming_distance_ref((const uint8_t *)x,
+                                          (const uint8_t *)y, d / 8);
+    }
+    return 0;
+}
+
+void
+bench_flat (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    const MetricType metrics[] = {
+        METRIC_L2, METRIC_INNER_PRODUCT, METRIC_COSINE, METRIC_L1,
+        METRIC_JACCARD, METRIC_HAMMING,
+    };
+    size_t nb = params.nb, nq = params.nq, d = params.d, k = params.k;
+    size_t ncheck = min(nq, (size_t)BENCH_FLAT_CHECK_QUERIES);
+    vector<float> xb, xq, xb_abs, xq_abs;
+    vector<uint8_t> cb, cq;
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+
+    make_base_and_queries(nb, nq, d, xb, xq);
+
+    /* The weighted Jaccard distance is defined on non-negative values.  */
+    xb_abs.resize(xb.size());
+    xq_abs.resize(xq.size());
+    for (size_t i = 0; i < xb.size(); i++)
+        xb_abs[i] = fabsf(xb[i]);
+    for (size_t i = 0; i < xq.size(); i++)
+        xq_abs[i] = fabsf(xq[i]);
+
+    cout << "IndexFlat benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, k = " << k << ", "
+         << get_num_threads() << " threads\n";
+    cout << left << setw(16) << "metric" << setw(14) << "search (s)"
+         << setw(14) << "QPS" << setw(16) << "1-query GB/s"
+         << "recall vs base\n";
+
+    for (MetricType metric : metrics) {
+        const uint8_t *base_data, *query_data;
+
+        if (metric == METRIC_HAMMING) {
+            if (d % 8 != 0)
+                continue;
+            make_binary_codes(xb, nb, d, cb);
+            make_binary_codes(xq, nq, d, cq);
+            base_data = cb.data();
+            query_data = cq.data();
+        } else if (metric == METRIC_JACCARD) {
+            base_data = (const uint8_t *)xb_abs.data();
+            query_data = (const uint8_t *)xq_abs.data();
+        } else {
+            base_data = (const uint8_t *)xb.data();
+            query_data = (const uint8_t *)xq.data();
+        }
+
+        IndexFlat index(d, metric);
+        size_t code_size = index.code_size;
+        auto search = [&](size_t n, const uint8_t *x, float *D, int64_t *I) {
+            if (metric == METRIC_HAMMING)
+                index.search(n, x, k, D, I);
+            else
+                index.search(n, (const float *)x, k, D, I);
+        };
+
+        if (metric == METRIC_HAMMING)
+            index.add(nb, base_data);
+        else
+            index.add(nb, (const float *)base_data);
+
+        auto start = chrono::steady_clock::now();
+        search(nq, query_data, distances.data(), labels.data());
+        double seconds = elapsed_seconds(start);
+
+        /* One query at a time, the database is read once per query.  */
+        vector<float> D1(k);
+        vector<int64_t> I1(k);
+        start = chrono::steady_clock::now();
+        for (size_t q = 0; q < ncheck; q++)
+            search(1, query_data + q * code_size, D1.data(), I1.data());
+        double single_seconds = elapsed_seconds(start);
+
+        /* Compare the labels found to a scan with the base functions.  */
+        size_t found = 0;
+        vector<float> Dref(k);
+        vector<int64_t> Iref(k);
+        for (size_t q = 0; q < ncheck; q++) {
+            TopK heap(k, is_similarity_metric(metric));
+
+            for (size_t j = 0; j < nb; j++)
+                heap.push(base_distance(metric, query_data + q * code_size,
+                                        base_data + j * code_size, d), j);
+            heap.extract(Dref.data(), Iref.data());
+            for (size_t i = 0; i < k; i++)
+                for (size_t l = 0; l < k; l++)
+                    if (Iref[i] == labels[q * k + l]) {
+                        found++;
+                        break;
+                    }
+        }
+
+        cout << left << setw(16) << metric_name(metric) << setw(14)
+             << seconds << setw(14) << nq / seconds << setw(16)
+             << (double)ncheck * nb * code_size / single_seconds / 1e9
+             << (double)found / (ncheck * k) << "\n";
+    }
+}
+
+/* Load the data set of params.dataset, or generate the synthetic one and
+   compute its ground truth with IndexFlat.  gt has nq rows of gt_k labels.
+   xt is left empty when the data set has no training vectors.  */
+static void
+load_bench_dataset (const struct bench_params_t &params, size_t &d,
+                    size_t &nb, size_t &nq, size_t &nt, size_t &gt_k,
+                    std::vector<float> &xb, std::vector<float> &xq,
+                    std::vector<float> &xt, std::vector<int64_t> &gt)
+{
+    using namespace std;
+    using namespace vector_search;
+
+    if (params.dataset.empty()) {
+        d = params.d;
+        nb = params.nb;
+        nq = params.nq;
+        nt = 0;
+        gt_k = params.k;
+        make_base_and_queries(nb, nq, d, xb, xq);
+
+        IndexFlat flat(d, METRIC_L2);
+        vector<float> D(nq * gt_k);
+
+        flat.add(nb, xb.data());
+        gt.resize(nq * gt_k);
+        flat.search(nq, xq.data(), gt_k, D.data(), gt.data());
+        return;
+    }
+
+    size_t dq, dgt;
+    string learn = params.dataset + "_learn.fvecs";
+
+    xb = fvecs_read(params.dataset + "_base.fvecs", &d, &nb);
+    xq = fvecs_read(params.dataset + "_query.fvecs", &dq, &nq);
+    vector<int32_t> gt32 = ivecs_read(params.dataset + "_groundtruth.ivecs",
+                                      &gt_k, &dgt);
+    if (dq != d || dgt != nq) {
+        cout << "ERROR, the files of " << params.dataset
+             << " do not match.\n";
+        exit(-1);
+    }
+    gt.assign(gt32.begin(), gt32.end());
+
+    nt = 0;
+    if (file_exists(learn)) {
+        size_t dt;
+
+        xt = fvecs_read(learn, &dt, &nt);
+        if (dt != d) {
+            cout << "ERROR, the dimension of " << learn
+                 << " does not match.\n";
+            exit(-1);
+        }
+    }
+}
+
+/* Fraction of the k true nearest neighbors that are found, gt has gt_k
+   labels per query.  */
+static double
+recall_at_k (size_t nq, size_t k, const int64_t *gt, size_t gt_k,
+             const int64_t *labels)
+{
+    size_t found = 0;
+
+    for (size_t q = 0; q < nq; q++)
+        for (size_t i = 0; i < k; i++)
+            for (size_t l = 0; l < k; l++)
+                if (gt[q * gt_k + i] == labels[q * k + l]) {
+                    found++;
+                    break;
+                }
+    return (double)found / (nq * k);
+}
+
+void
+bench_ivf (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    size_t nlist = params.ncentroids;
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    IndexIVFFlat index(d, nlist, METRIC_L2);
+
+    cout << "IndexIVFFlat benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, k = " << k << ", nlist = " << nlist << ", "
+         << get_num_threads() << " threads\n";
+
+    auto start = chrono::steady_clock::now();
+    if (nt)
+        index.train(nt, xt.data());
+    else
+        index.train(nb, xb.data());
+    cout << "train: " << elapsed_seconds(start) << " s\n";
+
+    start = chrono::steady_clock::now();
+    index.add(nb, xb.data());
+    cout << "add: " << elapsed_seconds(start) << " s\n";
+
+    cout << left << setw(10) << "nprobe" << setw(14) << "search (s)"
+         << setw(14) << "QPS" << "recall@" << k << "\n";
+
+    for (size_t nprobe = 1; nprobe <= nlist; nprobe *= 2) {
+        index.nprobe = nprobe;
+        start = chrono::steady_clock::now();
+        index.search(nq, xq.data(), k, distances.data(), labels.data());
+        double seconds = elapsed_seconds(start);
+
+        double recall = recall_at_k(nq, k, gt.data(), gt_k, labels.data());
+        cout << left << setw(10) << nprobe << setw(14) << seconds
+             << setw(14) << nq / seconds << recall << "\n";
+        if (recall == 1.0)
+            break;
+    }
+}
+
+void
+bench_hnsw (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+    bool target_reached = false;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    IndexHNSW index(d, params.hnsw_m, METRIC_L2);
+
+    index.ef_construction = params.ef_construction;
+
+    cout << "IndexHNSW benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, k = " << k << ", M = " << params.hnsw_m
+         << ", ef_construction = " << params.ef_construction << ", "
+         << get_num_threads() << " threads\n";
+
+    auto start = chrono::steady_clock::now();
+    index.add(nb, xb.data());
+    cout << "add: " << elapsed_seconds(start) << " s, max level "
+         << index.max_level << "\n";
+
+    cout << left << setw(12) << "ef_search" << setw(14) << "QPS"
+         << setw(16) << "latency (us)" << "recall@" << k << "\n";
+
+    for (size_t ef = 16; ef <= BENCH_HNSW_MAX_EF; ef *= 2) {
+        index.ef_search = ef;
+
+        start = chrono::steady_clock::now();
+        index.search(nq, xq.data(), k, distances.data(), labels.data());
+        double seconds = elapsed_seconds(start);
+
+        /* Latency: the queries are searched one at a time.  */
+        start = chrono::steady_clock::now();
+        for (size_t q = 0; q < nq; q++)
+            index.search(1, xq.data() + q * d, k, distances.data() + q * k,
+                         labels.data() + q * k);
+        double latency = elapsed_seconds(start) / nq * 1e6;
+
+        double recall = recall_at_k(nq, k, gt.data(), gt_k, labels.data());
+        cout << left << setw(12) << ef << setw(14) << nq / seconds
+             << setw(16) << latency << recall << "\n";
+
+        if (!target_reached && recall >= BENCH_HNSW_TARGET_RECALL) {
+            cout << "recall " << BENCH_HNSW_TARGET_RECALL
+                 << " reached with ef_search = " << ef << ", latency "
+                 << latency << " us\n";
+            target_reached = true;
+        }
+        if (recall == 1.0)
+            break;
+    }
+}
+
+void
+bench_vamana (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+
+    cout << "IndexVamanaDisk benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, k = " << k << ", R = " << params.degree
+         << ", beam width = " << params.beam_width << ", "
+         << get_num_threads() << " threads\n";
+
+    {
+        IndexVamanaDisk builder(d, params.degree);
+
+        auto start = chrono::steady_clock::now();
+        builder.build(nb, xb.data(), BENCH_VAMANA_FILE);
+        cout << "build: " << elapsed_seconds(start) << " s, "
+             << builder.sectors_per_node << " sector(s) per node\n";
+    }
+
+    /* The searches run on the index read back from the file.  */
+    IndexVamanaDisk index(d);
+    index.load(BENCH_VAMANA_FILE);
+    index.beam_width = params.beam_width;
+
+    cout << left << setw(12) << "list size" << setw(14) << "QPS"
+         << setw(16) << "latency (us)" << setw(12) << "IOs/query"
+         << setw(12) << "hops/query" << "recall@" << k << "\n";
+
+    for (size_t L = max(k, (size_t)16); L <= BENCH_VAMANA_MAX_LIST; L *= 2) {
+        DiskSearchStats stats;
+
+        index.search_list = L;
+
+        auto start = chrono::steady_clock::now();
+        index.search(nq, xq.data(), k, distances.data(), labels.data(),
+                     &stats);
+        double seconds = elapsed_seconds(start);
+
+        /* Latency: the queries are searched one at a time.  */
+        start = chrono::steady_clock::now();
+        for (size_t q = 0; q < nq; q++)
+            index.search(1, xq.data() + q * d, k, distances.data() + q * k,
+                         labels.data() + q * k);
+        double latency = elapsed_seconds(start) / nq * 1e6;
+
+        double recall = recall_at_k(nq, k, gt.data(), gt_k, labels.data());
+        cout << left << setw(12) << L << setw(14) << nq / seconds
+             << setw(16) << latency
+             << setw(12) << (double)stats.n_ios / stats.nq
+             << setw(12) << (double)stats.n_hops / stats.nq << recall << "\n";
+        if (recall == 1.0)
+            break;
+    }
+}
+
+void
+bench_filter (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+    mt19937 rng(1234);
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = params.k;
+    size_t nlist = params.ncentroids;
+    vector<float> distances(nq * k), ref_distances(nq * k);
+    vector<int64_t> labels(nq * k), ref_labels(nq * k);
+    IndexFlat flat(d, METRIC_L2);
+    IndexIVFFlat ivf(d, nlist, METRIC_L2);
+
+    cout << "Filtered search benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, k = " << k << ", nlist = " << nlist
+         << ", nprobe = " << BENCH_FILTER_NPROBE << ", "
+         << get_num_threads() << " threads\n";
+
+    flat.add(nb, xb.data());
+    if (nt)
+        ivf.train(nt, xt.data());
+    else
+        ivf.train(nb, xb.data());
+    ivf.add(nb, xb.data());
+    ivf.nprobe = BENCH_FILTER_NPROBE;
+
+    cout << left << setw(10) << "filter" << setw(14) << "selectivity"
+         << setw(14) << "flat (s)" << setw(14) << "flat recall"
+         << setw(14) << "IVF (s)" << "IVF recall@" << k << "\n";
+
+    /* The random filters allow each label with the selectivity as
+       probability, the range filters a contiguous range of labels, like
+       the vectors of one tenant.  */
+    for (double selectivity : {0.5, 0.1, 0.01, 0.001}) {
+        for (int range = 0; range < 2; range++) {
+            IDBitmap filter(nb);
+            bernoulli_distribution allow(selectivity);
+
+            if (range)
+                filter.set_range(0, (size_t)(nb * selectivity));
+            else
+                for (size_t i = 0; i < nb; i++)
+                    if (allow(rng))
+                        filter.set(i);
+
+            /* Reference: exact search in an index of the allowed vectors
+               only.  */
+            vector<int64_t> ids;
+            IndexFlat subset(d, METRIC_L2);
+
+            filter.get_ids(0, nb, ids);
+            for (int64_t id : ids)
+                subset.add(1, xb.data() + id * d);
+            subset.search(nq, xq.data(), k, ref_distances.data(),
+                          ref_labels.data());
+            for (int64_t &label : ref_labels)
+                if (label >= 0)
+                    label = ids[label];
+
+            auto start = chrono::steady_clock::now();
+            flat.search(nq, xq.data(), k, distances.data(), labels.data(),
+                        &filter);
+            double flat_seconds = elapsed_seconds(start);
+            double flat_recall = recall_at_k(nq, k, ref_labels.data(), k,
+                                             labels.data());
+
+            start = chrono::steady_clock::now();
+            ivf.search(nq, xq.data(), k, distances.data(), labels.data(),
+                       &filter);
+            double ivf_seconds = elapsed_seconds(start);
+            double ivf_recall = recall_at_k(nq, k, ref_labels.data(), k,
+                                            labels.data());
+
+            cout << left << setw(10) << (range ? "range" : "random")
+                 << setw(14) << (double)filter.count() / nb
+                 << setw(14) << flat_seconds << setw(14) << flat_recall
+                 << setw(14) << ivf_seconds << ivf_recall << "\n";
+        }
+    }
+}
+
+void
+bench_range (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t nlist = params.ncentroids;
+    size_t max_rank = min((size_t)BENCH_RANGE_MAX_RANK + 1, nb);
+    size_t ncheck = min(nq, (size_t)BENCH_FLAT_CHECK_QUERIES);
+    vector<float> distances(nq * max_rank);
+    vector<int64_t> labels(nq * max_rank);
+    IndexFlat flat(d, METRIC_L2);
+    IndexIVFFlat ivf(d, nlist, METRIC_L2);
+
+    cout << "Range search benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, nlist = " << nlist << ", nprobe = "
+         << BENCH_FILTER_NPROBE << ", " << get_num_threads()
+         << " threads\n";
+
+    flat.add(nb, xb.data());
+    if (nt)
+        ivf.train(nt, xt.data());
+    else
+        ivf.train(nb, xb.data());
+    ivf.add(nb, xb.data());
+    ivf.nprobe = BENCH_FILTER_NPROBE;
+
+    flat.search(nq, xq.data(), max_rank, distances.data(), labels.data());
+
+    cout << left << setw(14) << "radius" << setw(14) << "hits/query"
+         << setw(14) << "flat (s)" << setw(16) << "flat Mhits/s"
+         << setw(14) << "IVF (s)" << "IVF recall\n";
+
+    for (size_t rank = 10; rank < max_rank; rank *= 10) {
+        vector<float> kth(nq);
+        RangeSearchResult flat_res, ivf_res;
+
+        for (size_t q = 0; q < nq; q++)
+            kth[q] = (distances[q * max_rank + rank - 1]
+                      + distances[q * max_rank + rank]) / 2;
+        nth_element(kth.begin(), kth.begin() + nq / 2, kth.end());
+        float radius = kth[nq / 2];
+
+        auto start = chrono::steady_clock::now();
+        flat.range_search(nq, xq.data(), radius, flat_res);
+        double flat_seconds = elapsed_seconds(start);
+
+        start = chrono::steady_clock::now();
+        ivf.range_search(nq, xq.data(), radius, ivf_res);
+        double ivf_seconds = elapsed_seconds(start);
+
+        /* The first queries are checked against a scan with the base
+           function.  */
+        for (size_t q = 0; q < ncheck; q++) {
+            size_t count = 0;
+
+            for (size_t j = 0; j < nb; j++)
+                count += base::fvec_L2sqr_ref(xq.data() + q * d,
+                                              xb.data() + j * d, d) < radius;
+            if (count != flat_res.lims[q + 1] - flat_res.lims[q])
+                cout << "query " << q << ": " << count << " hits expected, "
+                     << flat_res.lims[q + 1] - flat_res.lims[q]
+                     << " found\n";
+        }
+
+        double nhits = flat_res.lims[nq];
+        cout << left << setw(14) << radius << setw(14) << nhits / nq
+             << setw(14) << flat_seconds
+             << setw(16) << nhits / flat_seconds / 1e6
+             << setw(14) << ivf_seconds
+             << (nhits ? ivf_res.lims[nq] / nhits : 1.0) << "\n";
+    }
+}
+
+void
+bench_rerank (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    size_t max_cand = min(k * BENCH_RERANK_MAX_FACTOR, nb);
+    vector<float> cand_dis(nq * max_cand), distances(nq * k);
+    vector<int64_t> cand_ids(nq * max_cand), labels(nq * k);
+    vector<uint8_t> codes(nb * d);
+    ScalarQuantizer sq(d);
+
+    /* The vectors are re-ranked from the base file of the data set, or
+       from a copy of the synthetic vectors.  */
+    string path = params.dataset.empty() ? string(BENCH_RERANK_FILE)
+                                         : params.dataset + "_base.fvecs";
+    if (params.dataset.empty())
+        fvecs_write(path, d, nb, xb.data());
+    MmapVectors store(path);
+    Reranker reranker(store, METRIC_L2);
+
+    cout << "Re-ranking benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, k = " << k << ", first pass on 8-bit scalar "
+         << "codes, " << get_num_threads() << " threads\n";
+
+    sq.train(nt ? nt : nb, nt ? xt.data() : xb.data());
+    sq.encode(nb, xb.data(), codes.data());
+
+    /* First pass: the max_cand nearest codes of each query, best first,
+       the smaller candidate lists are their prefixes.  */
+    auto start = chrono::steady_clock::now();
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        TopK heap(max_cand);
+
+        for (size_t q = q0; q < q1; q++) {
+            heap.clear();
+            for (size_t j = 0; j < nb; j++) {
+                float dis = sq.L2sqr_to_code(xq.data() + q * d,
+                                             codes.data() + j * d);
+
+                if (dis < heap.threshold())
+                    heap.push(dis, j);
+            }
+            heap.extract(cand_dis.data() + q * max_cand,
+                         cand_ids.data() + q * max_cand);
+        }
+    });
+    double first_seconds = elapsed_seconds(start);
+
+    vector<int64_t> first(nq * k);
+    for (size_t q = 0; q < nq; q++)
+        copy(cand_ids.begin() + q * max_cand,
+             cand_ids.begin() + q * max_cand + k, first.begin() + q * k);
+
+    cout << "first pass: " << first_seconds / nq * 1e6 << " us/query, "
+         << "recall@" << k << " "
+         << recall_at_k(nq, k, gt.data(), gt_k, first.data()) << "\n";
+    cout << left << setw(14) << "candidates" << setw(16) << "rerank (s)"
+         << setw(20) << "latency added (us)" << "recall@" << k << "\n";
+
+    for (size_t ncand = k; ncand <= max_cand; ncand *= 2) {
+        vector<int64_t> cands(nq * ncand);
+        RerankStats stats, single;
+
+        for (size_t q = 0; q < nq; q++)
+            copy(cand_ids.begin() + q * max_cand,
+                 cand_ids.begin() + q * max_cand + ncand,
+                 cands.begin() + q * ncand);
+
+        reranker.rerank(nq, xq.data(), ncand, cands.data(), k,
+                        distances.data(), labels.data(), &stats);
+
+        /* Latency: the queries are re-ranked one at a time.  */
+        for (size_t q = 0; q < nq; q++)
+            reranker.rerank(1, xq.data() + q * d, ncand,
+                            cands.data() + q * ncand, k,
+                            distances.data() + q * k, labels.data() + q * k,
+                            &single);
+
+        cout << left << setw(14) << ncand << setw(16) << stats.seconds
+             << setw(20) << single.seconds / single.nq * 1e6
+             << recall_at_k(nq, k, gt.data(), gt_k, labels.data()) << "\n";
+    }
+}
+
+void
+bench_binary (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    Reranker reranker(d, xb.data(), d, METRIC_L2);
+
+    cout << "Binary quantization benchmark, " << nb << " x " << d
+         << " vectors, " << nq << " queries, k = " << k << ", "
+         << get_num_threads() << " threads\n";
+
+    for (bool rotate : {false, true}) {
+        BinaryQuantizer bq(d, rotate);
+        vector<uint8_t> cb(nb * bq.code_size()), cq(nq * bq.code_size());
+        IndexFlat index(8 * bq.code_size(), METRIC_HAMMING);
+
+        auto start = chrono::steady_clock::now();
+        bq.train(nt ? nt : nb, nt ? xt.data() : xb.data());
+        bq.encode(nb, xb.data(), cb.data());
+        bq.encode(nq, xq.data(), cq.data());
+        index.add(nb, cb.data());
+
+        cout << (rotate ? "random rotation" : "no rotation") << ", encode: "
+             << elapsed_seconds(start) << " s, " << bq.code_size()
+             << " bytes per code, " << d * sizeof(float) / bq.code_size()
+             << "x smaller\n";
+        cout << left << setw(12) << "oversample" << setw(16)
+             << "hamming (us)" << setw(16) << "rerank (us)"
+             << "recall@" << k << "\n";
+
+        for (size_t factor = 1; factor <= BENCH_BINARY_MAX_OVERSAMPLE;
+             factor *= 2) {
+            size_t ncand = min(k * factor, nb);
+            vector<float> cand_dis(nq * ncand);
+            vector<int64_t> cand_ids(nq * ncand);
+            RerankStats stats;
+
+            start = chrono::steady_clock::now();
+            index.search(nq, cq.data(), ncand, cand_dis.data(),
+                         cand_ids.data());
+            double first_seconds = elapsed_seconds(start);
+
+            reranker.rerank(nq, xq.data(), ncand, cand_ids.data(), k,
+                            distances.data(), labels.data(), &stats);
+
+            cout << left << setw(12) << factor
+                 << setw(16) << first_seconds / nq * 1e6
+                 << setw(16) << stats.seconds / nq * 1e6
+                 << recall_at_k(nq, k, gt.data(), gt_k, labels.data())
+                 << "\n";
+            if (ncand == nb)
+                break;
+        }
+    }
+}
+
+void
+bench_rabitq (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    size_t ntrain = nt ? nt : nb;
+    const float* xtrain = nt ? xt.data() : xb.data();
+
+    cout << "RaBitQ benchmark, " << nb << " x " << d << " vectors, " << nq
+         << " queries, k = " << k << ", " << get_num_threads()
+         << " threads\n";
+    cout << left << setw(24) << "method" << setw(16) << "bytes/code"
+         << setw(12) << "QPS" << setw(16) << "exact/query"
+         << "recall@" << k << "\n";
+
+    /* Baseline: exhaustive search on the 8-bit scalar codes.  */
+    ScalarQuantizer sq(d);
+    vector<uint8_t> sq_codes(nb * d);
+
+    sq.train(ntrain, xtrain);
+    sq.encode(nb, xb.data(), sq_codes.data());
+
+    auto start = chrono::steady_clock::now();
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        TopK heap(k);
+
+        for (size_t q = q0; q < q1; q++) {
+            heap.clear();
+            for (size_t j = 0; j < nb; j++) {
+                float dis = sq.L2sqr_to_code(xq.data() + q * d,
+                                             sq_codes.data() + j * d);
+
+                if (dis < heap.threshold())
+                    heap.push(dis, j);
+            }
+            heap.extract(distances.data() + q * k, labels.data() + q * k);
+        }
+    });
+    double seconds = elapsed_seconds(start);
+
+    cout << left << setw(24) << "SQ8" << setw(16) << sq.code_size()
+         << setw(12) << nq / seconds << setw(16) << 0
+         << recall_at_k(nq, k, gt.data(), gt_k, labels.data()) << "\n";
+
+    /* RaBitQ on the estimates only, then with the exact distances of the
+       candidates that the lower bounds do not discard.  */
+    for (bool rerank : {false, true}) {
+        IndexRaBitQ index(d, rerank);
+        RaBitQSearchStats stats;
+
+        index.train(ntrain, xtrain);
+        index.add(nb, xb.data());
+
+        start = chrono::steady_clock::now();
+        index.search(nq, xq.data(), k, distances.data(), labels.data(),
+                     &stats);
+        seconds = elapsed_seconds(start);
+
+        cout << left << setw(24)
+             << (rerank ? "RaBitQ bounded rerank" : "RaBitQ estimates")
+             << setw(16) << index.rq.code_size() + sizeof(RaBitQFactors)
+             << setw(12) << nq / seconds
+             << setw(16) << (double)stats.nexact / stats.nq
+             << recall_at_k(nq, k, gt.data(), gt_k, labels.data()) << "\n";
+    }
+}
+
+/* Exhaustive search of the PQ codes with the distance tables of the
+   queries.  */
+static void
+pq_search (const vector_search::ProductQuantizer &pq, size_t nb,
+           const uint8_t *codes, size_t nq, const float *xq, size_t k,
+           int64_t *labels)
+{
+    using namespace vector_search;
+
+    parallel_for(nq, 1, [&](size_t q0, size_t q1) {
+        std::vector<float> table(pq.M * PQ_KSUB), distances(k);
+        TopK heap(k);
+
+        for (size_t q = q0; q < q1; q++) {
+            pq.compute_distance_table(xq + q * pq.d, table.data());
+            heap.clear();
+            for (size_t j = 0; j < nb; j++) {
+                float dis = pq.L2sqr_to_code(table.data(),
+                                             codes + j * pq.code_size());
+
+                if (dis < heap.threshold())
+                    heap.push(dis, j);
+            }
+            heap.extract(distances.data(), labels + q * k);
+        }
+    });
+}
+
+void
+bench_transform (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    size_t ntrain = nt ? nt : nb;
+    const float* xtrain = nt ? xt.data() : xb.data();
+
+    cout << "Vector transform benchmark, " << nb << " x " << d
+         << " vectors, " << nq << " queries, k = " << k << ", "
+         << get_num_threads() << " threads\n";
+
+    /* Flat search after a PCA reduction.  The query time includes the
+       transform of the queries.  */
+    cout << left << setw(12) << "dim" << setw(14) << "train (s)"
+         << setw(12) << "variance" << setw(12) << "QPS" << "recall@" << k
+         << "\n";
+
+    for (size_t d_out = d; d_out >= d / BENCH_PCA_MAX_REDUCTION && d_out;
+         d_out /= 2) {
+        IndexFlat index(d_out, METRIC_L2);
+        PCATransform pca(d, d_out);
+        vector<float> tb(nb * d_out), tq(nq * d_out);
+        double train_seconds = 0;
+
+        auto start = chrono::steady_clock::now();
+        if (d_out < d) {
+            pca.train(ntrain, xtrain);
+            train_seconds = elapsed_seconds(start);
+            pca.apply(nb, xb.data(), tb.data());
+        } else {
+            tb = xb;
+        }
+        index.add(nb, tb.data());
+
+        start = chrono::steady_clock::now();
+        if (d_out < d)
+            pca.apply(nq, xq.data(), tq.data());
+        else
+            tq = xq;
+        index.search(nq, tq.data(), k, distances.data(), labels.data());
+        double seconds = elapsed_seconds(start);
+
+        cout << left << setw(12) << d_out << setw(14) << train_seconds
+             << setw(12) << (d_out < d ? pca.explained_variance() : 1)
+             << setw(12) << nq / seconds
+             << recall_at_k(nq, k, gt.data(), gt_k, labels.data()) << "\n";
+    }
+
+    if (d % BENCH_PQ_DSUB != 0) {
+        cout << "Dimension not a multiple of " << BENCH_PQ_DSUB
+             << ", skipping the product quantization tests.\n";
+        return;
+    }
+
+    /* PQ alone, after a random rotation and after the OPQ rotation.  */
+    size_t M = d / BENCH_PQ_DSUB;
+
+    cout << "PQ with " << M << " sub-quantizers\n";
+    cout << left << setw(18) << "transform" << setw(14) << "train (s)"
+         << setw(16) << "recon. error" << "recall@" << k << "\n";
+
+    for (int kind = 0; kind < 3; kind++) {
+        unique_ptr<LinearTransform> transform;
+        ProductQuantizer pq(d, M);
+        vector<float> tb(nb * d), tq(nq * d), recons(nb * d);
+        vector<uint8_t> codes(nb * M);
+        const char* name = "none";
+
+        auto start = chrono::steady_clock::now();
+        if (kind == 1) {
+            transform.reset(new RandomRotation(d));
+            name = "random rotation";
+        } else if (kind == 2) {
+            OPQTransform* opq = new OPQTransform(d, M);
+
+            opq->niter = BENCH_OPQ_NITER;
+            transform.reset(opq);
+            name = "OPQ";
+        }
+
+        if (transform) {
+            vector<float> ttrain(ntrain * d);
+
+            transform->train(ntrain, xtrain);
+            transform->apply(ntrain, xtrain, ttrain.data());
+            pq.train(ntrain, ttrain.data());
+            transform->apply(nb, xb.data(), tb.data());
+            transform->apply(nq, xq.data(), tq.data());
+        } else {
+            pq.train(ntrain, xtrain);
+            tb = xb;
+            tq = xq;
+        }
+        double train_seconds = elapsed_seconds(start);
+
+        pq.encode(nb, tb.data(), codes.data());
+        pq.decode(nb, codes.data(), recons.data());
+
+        double error = 0;
+        for (size_t i = 0; i < nb; i++)
+            error += base::fvec_L2sqr_ref(&tb[i * d], &recons[i * d], d);
+
+        pq_search(pq, nb, codes.data(), nq, tq.data(), k, labels.data());
+
+        cout << left << setw(18) << name << setw(14) << train_seconds
+             << setw(16) << error / nb
+             << recall_at_k(nq, k, gt.data(), gt_k, labels.data()) << "\n";
+    }
+}
+
+/* Best bandwidth in GB/s of pool scanning the n vectors of code_size bytes
+   at y with one of the one to one kernels.  */
+static double
+numa_bandwidth (vector_search::ThreadPool &pool, int kernel, size_t n,
+                size_t d, const float *x, const float *y)
+{
+    using namespace std;
+    size_t code_size = d * sizeof(float);
+    double best = 0;
+    atomic<size_t> sink(0);
+
+    function<void(size_t, size_t)> scan = [&](size_t i0, size_t i1) {
+        float sum = 0;
+
+        for (size_t i = i0; i < i1; i++) {
+            const float *yi = y + i * d;
+
+            if (kernel == 0)
+                sum += base::fvec_L2sqr_ref(x, yi, d);
+            else if (kernel == 1)
+                sum += base::fvec_inner_product_ref(x, yi, d);
+            else if (kernel == 2)
+                sum += base::fvec_L1_ref(x, yi, d);
+            else
+                sum += base::hamming_distance_ref((const uint8_t *)x,
+                                                  (const uint8_t *)yi,
+                                                  code_size);
+        }
+        sink += sum > 0;
+    };
+
+    for (int r = 0; r < BENCH_NUMA_REPEAT; r++) {
+        vector_search::ThreadPool::Loop loop;
+
+        auto start = chrono::steady_clock::now();
+        pool.start(loop, n, 1024, scan);
+        vector_search::ThreadPool::wait(loop);
+        best = max(best, n * code_size / elapsed_seconds(start) / 1e9);
+    }
+    return best;
+}
+
+void
+bench_numa (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    static const char *kernels[] = {"L2", "inner product", "L1", "Hamming"};
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+    int num_nodes = numa_num_nodes();
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+
+    cout << "NUMA benchmark, " << nb << " x " << d << " vectors, " << nq
+         << " queries, k = " << k << ", " << num_nodes << " nodes\n";
+
+    /* Scan bandwidth of the threads of each node, reading the database
+       placed on each node.  The diagonal is the local bandwidth.  */
+    vector<unique_ptr<ThreadPool>> pools;
+
+    for (int node = 0; node < num_nodes; node++) {
+        vector<int> cpus = numa_node_cpus(node);
+
+        pools.emplace_back(cpus.empty() ? nullptr : new ThreadPool(cpus));
+    }
+
+    cout << "Scan bandwidth (GB/s), threads on node x memory on node\n";
+    cout << left << setw(16) << "kernel" << setw(10) << "threads";
+    for (int mem = 0; mem < num_nodes; mem++)
+        cout << setw(10) << "mem " + to_string(mem);
+    cout << "\n";
+
+    vector<AlignedBuffer<float>> placed(num_nodes);
+    for (int mem = 0; mem < num_nodes; mem++) {
+        MemoryPolicy policy;
+
+        policy.node = num_nodes > 1 ? mem : -1;
+        placed[mem].set_policy(policy);
+        placed[mem].append(xb.data(), nb * d);
+        if (num_nodes > 1
+            && numa_node_of_address(placed[mem].data()) != mem)
+            cout << "Memory of node " << mem << " placed on node "
+                 << numa_node_of_address(placed[mem].data()) << "\n";
+    }
+
+    for (int kernel = 0; kernel < 4; kernel++) {
+        for (int node = 0; node < num_nodes; node++) {
+            if (!pools[node])
+                continue;
+            cout << left << setw(16) << kernels[kernel] << setw(10) << node;
+            for (int mem = 0; mem < num_nodes; mem++)
+                cout << setw(10) << setprecision(3)
+                     << numa_bandwidth(*pools[node], kernel, nb, d,
+                                       xq.data(), placed[mem].data());
+            cout << "\n";
+        }
+    }
+    cout << setprecision(6);
+    placed.clear();
+    pools.clear();
+
+    /* Searches of the whole data set with the default first touch
+       placement, with pages interleaved over the nodes, and sharded with
+       one shard and one pool of threads per node.  */
+    cout << left << setw(24) << "flat index" << setw(10) << "threads"
+         << setw(14) << "QPS" << "recall@" << k << "\n";
+
+    for (int placement = 0; placement < 3; placement++) {
+        const char *name;
+        size_t nthreads;
+        double seconds;
+
+        if (placement < 2) {
+            IndexFlat index(d, METRIC_L2);
+            MemoryPolicy policy;
+
+            policy.interleave = placement == 1;
+            index.set_memory_policy(policy);
+            index.add(nb, xb.data());
+
+            auto start = chrono::steady_clock::now();
+            index.search(nq, xq.data(), k, distances.data(), labels.data());
+            seconds = elapsed_seconds(start);
+            name = placement == 0 ? "first touch" : "interleaved";
+            nthreads = get_num_threads();
+        } else {
+            IndexFlatShards index(d, METRIC_L2);
+
+            index.add(nb, xb.data());
+
+            auto start = chrono::steady_clock::now();
+            index.search(nq, xq.data(), k, distances.data(), labels.data());
+            seconds = elapsed_seconds(start);
+            name = "sharded per node";
+            nthreads = 0;
+            for (int node = 0; node < num_nodes; node++)
+                nthreads += numa_node_cpus(node).size();
+        }
+
+        cout << left << setw(24) << name << setw(10) << nthreads
+             << setw(14) << nq / seconds
+             << recall_at_k(nq, k, gt.data(), gt_k, labels.data()) << "\n";
+    }
+}
+
+/* Counter of the data TLB read misses of the calling thread in user space,
+   -1 when the performance counters are not available.  */
+static int
+open_dtlb_counter ()
+{
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB
+                  | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                  | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void
+start_counter (int fd)
+{
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+static long long
+stop_counter (int fd)
+{
+    long long count = -1;
+
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count))
+            count = -1;
+    }
+#endif
+    return count;
+}
+
+/* Random accesses to a working set of vectors, as the neighbor expansions
+   of a graph search or the gathers of a re-ranking, with each page size.
+   The first word of each vector holds the next vector of a random cycle,
+   so the chase measures the latency of dependent loads.  The gathers are
+   independent, and measure the throughput of the distance computations on
+   scattered vectors.  */
+void
+bench_working_set (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    static const char *names[] = {"none", "thp", "2mb", "1gb"};
+    size_t d = params.d;
+    size_t nvec = (params.working_set << 20) / (d * sizeof(float));
+    mt19937 rng(1234);
+    vector<uint32_t> cycle(nvec), gathers(BENCH_WS_GATHERS);
+    vector<float> query(d, 0.5f);
+    int fd = open_dtlb_counter();
+
+    if (nvec < 2) {
+        cout << "Working set smaller than two vectors.\n";
+        return;
+    }
+
+    /* Sattolo's shuffle, a single cycle through all the vectors.  */
+    for (size_t i = 0; i < nvec; i++)
+        cycle[i] = i;
+    for (size_t i = nvec - 1; i > 0; i--)
+        swap(cycle[i], cycle[uniform_int_distribution<size_t>(0, i - 1)(rng)]);
+    for (auto &g : gathers)
+        g = uniform_int_distribution<size_t>(0, nvec - 1)(rng);
+
+    cout << "Working set benchmark, " << params.working_set << " MiB, "
+         << nvec << " x " << d << " vectors, 1 thread\n";
+    if (fd < 0)
+        cout << "No TLB miss counter, the performance counters are not "
+             << "available.\n";
+    cout << left << setw(8) << "pages" << setw(12) << "page (kB)"
+         << setw(12) << "thp (MiB)" << setw(14) << "chase (ns)"
+         << setw(16) << "gather (ns)" << setw(20) << "dTLB misses/gather"
+         << "checksum\n";
+
+    for (int mode = HUGE_PAGES_NONE; mode <= HUGE_PAGES_1GB; mode++) {
+        MemoryPolicy policy = get_default_memory_policy();
+        AlignedBuffer<float> vectors;
+        size_t page_size, thp_bytes;
+        uint32_t next = 0;
+        float sum = 0;
+
+        policy.huge_pages = (HugePages)mode;
+        vectors.set_policy(policy);
+        vectors.resize(nvec * d, 1.0f);
+        for (size_t i = 0; i < nvec; i++)
+            memcpy(&vectors[i * d], &cycle[i], sizeof(uint32_t));
+        memory_page_info(vectors.data(), page_size, thp_bytes);
+
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < BENCH_WS_CHASE; i++)
+            memcpy(&next, &vectors[(size_t)next * d], sizeof(uint32_t));
+        double chase = elapsed_seconds(start) / BENCH_WS_CHASE;
+
+        start_counter(fd);
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < BENCH_WS_GATHERS; i++)
+            sum += base::fvec_L2sqr_ref(query.data(),
+                                        &vectors[(size_t)gathers[i] * d], d);
+        double gather = elapsed_seconds(start) / BENCH_WS_GATHERS;
+        long long misses = stop_counter(fd);
+
+        cout << left << setw(8) << names[mode] << setw(12)
+             << page_size / 1024 << setw(12) << thp_bytes / (1 << 20)
+             << setw(14) << chase * 1e9 << setw(16) << gather * 1e9;
+        if (misses >= 0)
+            cout << setw(20) << (double)misses / BENCH_WS_GATHERS;
+        else
+            cout << setw(20) << "n/a";
+
+        /* The checksum uses the results of both loops, so that they are
+           not removed.  */
+        cout << sum + next << "\n";
+    }
+
+    if (fd >= 0)
+        close(fd);
+}
+
+/* Distances between x and the n vectors of the blocked layout yb, metric 0
+   for L2, 1 for the inner product and 2 for the cosine distance.  */
+template <size_t B>
+static void
+blocked_distances (int metric, float *dis, const float *x, const float *yb,
+                   size_t d, size_t n)
+{
+    using namespace vector_search;
+
+    if (metric == 0)
+        fvec_L2sqr_blocked<B>(dis, x, yb, d, n);
+    else if (metric == 1)
+        fvec_inner_products_blocked<B>(dis, x, yb, d, n);
+    else
+        cosine_distances_blocked<B>(dis, x, yb, d, n);
+}
+
+/* Distances of each query to all the database vectors, on one thread, with
+   the row-major batch kernels and with the kernels of the blocked layout.
+   The cosine distances of the row-major layout are inner products scaled by
+   precomputed norms, as in IndexFlat.  */
+void
+bench_blocked (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    static const char *metrics[] = {"L2", "inner product", "cosine"};
+    static const size_t blocks[] = {4, 8, 16};
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+    nq = min(nq, (size_t)BENCH_BLOCKED_NQ);
+
+    vector<float> norms(nb), ref(nb), dis(nb);
+    vector<const float *> y(nb);
+    AlignedBuffer<float> yb[3];
+
+    for (size_t j = 0; j < nb; j++) {
+        y[j] = xb.data() + j * d;
+        norms[j] = fvec_norm_L2sqr(y[j], d);
+    }
+    for (size_t b = 0; b < 3; b++) {
+        yb[b].resize(blocked_size(nb, d, blocks[b]));
+        fvec_to_blocked(yb[b].data(), xb.data(), d, nb, blocks[b]);
+    }
+
+    cout << "Blocked layout benchmark, " << nb << " x " << d << " vectors, "
+         << nq << " queries, 1 thread\n";
+    cout << left << setw(16) << "metric" << setw(14) << "layout"
+         << setw(14) << "time (ms)" << setw(14) << "Gdims/s"
+         << "max error\n";
+
+    for (int metric = 0; metric < 3; metric++) {
+        for (int layout = 0; layout < 5; layout++) {
+            float max_err = 0;
+
+            auto start = chrono::steady_clock::now();
+            for (size_t q = 0; q < nq; q++) {
+                const float *x = xq.data() + q * d;
+                float *out = layout == 0 ? ref.data() : dis.data();
+                size_t j = 0;
+
+                if (layout == 0) {
+                    /* Row-major, four vectors at a time.  */
+                    for (; j + 4 <= nb; j += 4) {
+                        if (metric == 0)
+                            fvec_L2sqr_batch_N<4>(x, &y[j], d, out + j);
+                        else
+                            fvec_inner_product_batch_N<4>(x, &y[j], d,
+                                                          out + j);
+                    }
+                    for (; j < nb; j++)
+                        out[j] = metric == 0 ? fvec_L2sqr(x, y[j], d)
+                                 : fvec_inner_product(x, y[j], d);
+                } else if (layout == 1) {
+                    /* Row-major, sixteen vectors at a time.  */
+                    if (metric == 0)
+                        fvec_L2sqr_ny(out, x, xb.data(), d, nb);
+                    else
+                        fvec_inner_products_ny(out, x, xb.data(), d, nb);
+                } else if (blocks[layout - 2] == 4) {
+                    blocked_distances<4>(metric, out, x, yb[0].data(), d, nb);
+                } else if (blocks[layout - 2] == 8) {
+                    blocked_distances<8>(metric, out, x, yb[1].data(), d, nb);
+                } else {
+                    blocked_distances<16>(metric, out, x, yb[2].data(), d,
+                                          nb);
+                }
+
+                if (layout <= 1 && metric == 2) {
+                    float x_norm = fvec_norm_L2sqr(x, d);
+
+                    for (j = 0; j < nb; j++)
+                        out[j] = 1.0f - out[j] / sqrtf(x_norm * norms[j]);
+                }
+
+                /* The row-major batch_4 distances of the last query are
+                   the reference of the other layouts.  */
+                if (layout == 0 || q + 1 < nq)
+                    continue;
+                for (j = 0; j < nb; j++)
+                    max_err = max(max_err, fabsf(out[j] - ref[j])
+                                  / max(1.0f, fabsf(ref[j])));
+            }
+            double seconds = elapsed_seconds(start);
+
+            cout << left << setw(16) << (layout == 0 ? metrics[metric] : "")
+                 << setw(14)
+                 << (layout == 0 ? string("row batch_4")
+                     : layout == 1 ? string("row batch_16")
+                     : "blocked " + to_string(blocks[layout - 2]))
+                 << setw(14) << seconds * 1e3 / nq
+                 << setw(14) << (double)nq * nb * d / seconds * 1e-9
+                 << (layout == 0 ? string("-") : to_string(max_err))
+                 << "\n";
+        }
+    }
+}
+
+/* Heap allocations per query of search(q0, n), which searches the n
+   queries from q0.  The nq queries are searched one at a time on the
+   calling thread, then together on all the threads, each time after a
+   first pass that sizes the arenas and the pools.  */
+static void
+count_allocations (size_t nq,
+                   const std::function<void(size_t, size_t)> &search,
+                   double &single, double &batch, double &latency)
+{
+    {
+        vector_search::InlineParallelScope inline_scope;
+
+        for (size_t q = 0; q < nq; q++)
+            search(q, 1);
+
+        bench_allocations = 0;
+        bench_counting = true;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < nq; q++)
+            search(q, 1);
+        latency = elapsed_seconds(start) / nq * 1e6;
+        bench_counting = false;
+        single = (double)bench_allocations / nq;
+    }
+
+    search(0, nq);
+    bench_allocations = 0;
+    bench_counting = true;
+    search(0, nq);
+    bench_counting = false;
+    batch = (double)bench_allocations / nq;
+}
+
+/* Heap allocations of the search paths of the library at the steady state,
+   one query at a time and in batches.  */
+void
+bench_arena (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+    mt19937 rng(1234);
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    size_t ncand = min(k * BENCH_ARENA_RERANK_FACTOR, nb);
+    vector<float> distances(nq * ncand);
+    vector<int64_t> labels(nq * ncand), candidates(nq * ncand);
+    IndexFlat flat(d, METRIC_L2), flat_cosine(d, METRIC_COSINE);
+    IndexIVFFlat ivf(d, params.ncentroids, METRIC_L2);
+    IndexHNSW hnsw(d, params.hnsw_m, METRIC_L2);
+    IndexRaBitQ rabitq(d, true);
+    Reranker reranker(d, xb.data(), d, METRIC_L2);
+    IDBitmap filter(nb);
+
+    cout << "Arena benchmark, " << nb << " x " << d << " vectors, " << nq
+         << " queries, k = " << k << ", " << get_num_threads()
+         << " threads\n";
+
+    flat.add(nb, xb.data());
+    flat_cosine.add(nb, xb.data());
+    ivf.train(nt ? nt : nb, nt ? xt.data() : xb.data());
+    ivf.add(nb, xb.data());
+    ivf.nprobe = BENCH_ARENA_NPROBE;
+    hnsw.ef_construction = params.ef_construction;
+    hnsw.add(nb, xb.data());
+    hnsw.ef_search = BENCH_ARENA_EF;
+    rabitq.train(nt ? nt : nb, nt ? xt.data() : xb.data());
+    rabitq.add(nb, xb.data());
+    for (size_t j = 0; j < nb; j++)
+        if (rng() % 100 == 0)
+            filter.set(j);
+    flat.search(nq, xq.data(), ncand, distances.data(), candidates.data());
+
+    const pair<const char *, function<void(size_t, size_t)>> searches[] = {
+        {"flat L2", [&](size_t q0, size_t n) {
+             flat.search(n, xq.data() + q0 * d, k, distances.data(),
+                         labels.data());
+         }},
+        {"flat cosine", [&](size_t q0, size_t n) {
+             flat_cosine.search(n, xq.data() + q0 * d, k, distances.data(),
+                                labels.data());
+         }},
+        {"flat 1% filter", [&](size_t q0, size_t n) {
+             flat.search(n, xq.data() + q0 * d, k, distances.data(),
+                         labels.data(), &filter);
+         }},
+        {"IVF flat", [&](size_t q0, size_t n) {
+             ivf.search(n, xq.data() + q0 * d, k, distances.data(),
+                        labels.data());
+         }},
+        {"HNSW", [&](size_t q0, size_t n) {
+             hnsw.search(n, xq.data() + q0 * d, k, distances.data(),
+                         labels.data());
+         }},
+        {"RaBitQ", [&](size_t q0, size_t n) {
+             rabitq.search(n, xq.data() + q0 * d, k, distances.data(),
+                           labels.data());
+         }},
+        {"re-ranking", [&](size_t q0, size_t n) {
+             reranker.rerank(n, xq.data() + q0 * d, ncand,
+                             candidates.data() + q0 * ncand, k,
+                             distances.data(), labels.data());
+         }},
+    };
+
+    cout << left << setw(16) << "search" << setw(18) << "allocs/query"
+         << setw(18) << "batch allocs/q" << "latency (us)\n";
+
+    size_t scratch_start = scratch_heap_allocations();
+
+    for (const auto &search : searches) {
+        double single, batch, latency;
+
+        count_allocations(nq, search.second, single, batch, latency);
+        cout << left << setw(16) << search.first << setw(18) << single
+             << setw(18) << batch << latency << "\n";
+    }
+
+    cout << "arena and pool heap allocations: "
+         << scratch_heap_allocations() - scratch_start << "\n";
+}
+
+/* Open-loop load: queries submitted to searcher at rate per second, with
+   exponential inter-arrival times, for BENCH_ASYNC_SECONDS.  The arrivals
+   do not wait for the results, so a saturated searcher shows as a growing
+   latency.  latencies gets the time from the scheduled arrival of each
+   query to its callback, in microseconds.  */
+static double
+open_loop_run (vector_search::AsyncSearcher &searcher, const float *xq,
+               size_t nq, size_t k, double rate,
+               std::vector<double> &latencies)
+{
+    using namespace std;
+    mt19937 rng(1234);
+    exponential_distribution<double> gap(rate);
+    size_t n = max((size_t)1, (size_t)(rate * BENCH_ASYNC_SECONDS));
+    size_t d = searcher.d;
+    vector<chrono::steady_clock::time_point> arrivals(n);
+    atomic<size_t> done(0);
+    double t = 0;
+
+    latencies.assign(n, 0);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) {
+        t += gap(rng);
+        arrivals[i] = start + chrono::duration_cast<chrono::nanoseconds>(
+                                  chrono::duration<double>(t));
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        this_thread::sleep_until(arrivals[i]);
+        searcher.submit(xq + (i % nq) * d, k,
+                        [&, i](const float *, const int64_t *) {
+                            chrono::duration<double, micro> latency =
+                                chrono::steady_clock::now() - arrivals[i];
+
+                            latencies[i] = latency.count();
+                            done++;
+                        });
+    }
+    while (done < n)
+        this_thread::sleep_for(chrono::microseconds(100));
+
+    return n / elapsed_seconds(start);
+}
+
+/* Latency percentiles and throughput of single queries submitted to an
+   AsyncSearcher over a flat index, under open-loop loads relative to the
+   throughput of the queries searched one at a time.  max_batch 1 searches
+   each query alone, as the queries arrive.  */
+void
+bench_async (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    static const size_t configs[][2] = {{1, 0}, {16, 100}, {64, 500}};
+    static const double loads[] = {0.5, 1, 2, 4};
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    size_t nsingle = min(nq, (size_t)BENCH_ASYNC_SINGLE_QUERIES);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    vector<double> latencies;
+    IndexFlat index(d, METRIC_L2);
+
+    index.add(nb, xb.data());
+
+    auto start = chrono::steady_clock::now();
+    for (size_t q = 0; q < nsingle; q++)
+        index.search(1, xq.data() + q * d, k, distances.data(),
+                     labels.data());
+    double single_qps = nsingle / elapsed_seconds(start);
+
+    start = chrono::steady_clock::now();
+    index.search(nq, xq.data(), k, distances.data(), labels.data());
+    double batch_qps = nq / elapsed_seconds(start);
+
+    cout << "Asynchronous search benchmark, flat index, " << nb << " x "
+         << d << " vectors, k = " << k << ", " << get_num_threads()
+         << " threads\n";
+    cout << "QPS one query at a time: " << single_qps << ", in one batch of "
+         << nq << ": " << batch_qps << "\n";
+    cout << left << setw(11) << "max_batch" << setw(14) << "max_wait (us)"
+         << setw(14) << "offered QPS" << setw(12) << "QPS"
+         << setw(12) << "mean batch" << setw(12) << "p50 (us)"
+         << "p99 (us)\n";
+
+    for (const auto &config : configs) {
+        for (double load : loads) {
+            AsyncSearchParams async_params;
+            double rate = load * single_qps, qps;
+
+            async_params.max_batch = config[0];
+            async_params.max_wait_us = config[1];
+            {
+                AsyncSearcher searcher(index, async_params);
+
+                qps = open_loop_run(searcher, xq.data(), nq, k, rate,
+                                    latencies);
+
+                AsyncSearchStats stats = searcher.stats();
+
+                sort(latencies.begin(), latencies.end());
+                cout << left << setw(11) << config[0] << setw(14)
+                     << config[1] << setw(14) << (size_t)rate << setw(12)
+                     << (size_t)qps << setw(12)
+                     << (double)stats.nq / max(stats.nbatches, (size_t)1)
+                     << setw(12) << latencies[latencies.size() / 2]
+                     << latencies[latencies.size() * 99 / 100] << "\n";
+            }
+        }
+    }
+}
+
+/* Single thread throughput of the HNSW and IVF searches with 1, 2, 4 ...
+   BENCH_INTERLEAVE_MAX queries interleaved as coroutines, relative to the
+   queries searched one after the other.  The gains show when the vectors
+   do not fit in the caches.  */
+void
+bench_interleave (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    IndexIVFFlat ivf(d, params.ncentroids, METRIC_L2);
+    IndexHNSW hnsw(d, params.hnsw_m, METRIC_L2);
+
+    ivf.train(nt ? nt : nb, nt ? xt.data() : xb.data());
+    ivf.add(nb, xb.data());
+    ivf.nprobe = BENCH_INTERLEAVE_NPROBE;
+    hnsw.ef_construction = params.ef_construction;
+    hnsw.add(nb, xb.data());
+    hnsw.ef_search = BENCH_INTERLEAVE_EF;
+
+    cout << "Interleaved search benchmark, " << nb << " x " << d
+         << " vectors (" << nb * d * sizeof(float) / (1 << 20) << " MB), "
+         << nq << " queries, k = " << k << ", 1 thread\n";
+    cout << left << setw(12) << "interleave" << setw(12) << "HNSW QPS"
+         << setw(10) << "speedup" << setw(10) << "recall"
+         << setw(12) << "IVF QPS" << setw(10) << "speedup" << "recall\n";
+
+    InlineParallelScope inline_scope;
+    double hnsw_base = 0, ivf_base = 0;
+
+    for (size_t w = 1; w <= BENCH_INTERLEAVE_MAX; w *= 2) {
+        double hnsw_qps, ivf_qps, hnsw_recall, ivf_recall;
+
+        hnsw.interleave = w;
+        auto start = chrono::steady_clock::now();
+        hnsw.search(nq, xq.data(), k, distances.data(), labels.data());
+        hnsw_qps = nq / elapsed_seconds(start);
+        hnsw_recall = recall_at_k(nq, k, gt.data(), gt_k, labels.data());
+
+        ivf.interleave = w;
+        start = chrono::steady_clock::now();
+        ivf.search(nq, xq.data(), k, distances.data(), labels.data());
+        ivf_qps = nq / elapsed_seconds(start);
+        ivf_recall = recall_at_k(nq, k, gt.data(), gt_k, labels.data());
+
+        if (w == 1) {
+            hnsw_base = hnsw_qps;
+            ivf_base = ivf_qps;
+        }
+        cout << left << setw(12) << w << setw(12) << (size_t)hnsw_qps
+             << setw(10) << hnsw_qps / hnsw_base << setw(10) << hnsw_recall
+             << setw(12) << (size_t)ivf_qps << setw(10) << ivf_qps / ivf_base
+             << ivf_recall << "\n";
+    }
+}
+
+/* Latencies, in microseconds, of single queries searched one after the
+   other on the calling thread, cycling over the nq queries xq, until stop
+   is set and at least nq queries are done.  */
+template <typename Index>
+static void
+search_latencies (const Index &index, const float *xq, size_t nq, size_t k,
+                  const std::atomic<bool> &stop,
+                  std::vector<double> &latencies)
+{
+    using namespace std;
+    vector<float> distances(k);
+    vector<int64_t> labels(k);
+
+    latencies.clear();
+    for (size_t i = 0; i < nq || !stop; i++) {
+        auto start = chrono::steady_clock::now();
+
+        index.search(1, xq + (i % nq) * index.d, k, distances.data(),
+                     labels.data());
+        latencies.push_back(elapsed_seconds(start) * 1e6);
+    }
+    sort(latencies.begin(), latencies.end());
+}
+
+/* Half of the vectors are added to index, then the single query latencies
+   are measured alone and while a writer thread adds the other half in
+   batches of BENCH_CONCURRENT_BATCH.  The recall is measured once all the
+   vectors are added.  */
+template <typename Index>
+static void
+concurrent_run (const char *name, Index &index, size_t nb,
+                const float *xb, size_t nq, const float *xq, size_t k,
+                const int64_t *gt, size_t gt_k)
+{
+    using namespace std;
+    size_t d = index.d, nb0 = nb / 2;
+    vector<double> idle, loaded;
+    vector<float> distances(nq * k);
+    vector<int64_t> labels(nq * k);
+    atomic<bool> stop(true);
+    double insert_seconds = 0;
+
+    index.add(nb0, xb);
+    search_latencies(index, xq, nq, k, stop, idle);
+
+    stop = false;
+    thread writer([&]() {
+        auto start = chrono::steady_clock::now();
+
+        for (size_t i = nb0; i < nb; i += BENCH_CONCURRENT_BATCH)
+            index.add(min((size_t)BENCH_CONCURRENT_BATCH, nb - i),
+                      xb + i * d);
+        insert_seconds = elapsed_seconds(start);
+        stop = true;
+    });
+    search_latencies(index, xq, nq, k, stop, loaded);
+    writer.join();
+
+    index.search(nq, xq, k, distances.data(), labels.data());
+
+    cout << left << setw(8) << name << setw(12) << idle[idle.size() / 2]
+         << setw(12) << idle[idle.size() * 99 / 100]
+         << setw(12) << loaded[loaded.size() / 2]
+         << setw(12) << loaded[loaded.size() * 99 / 100]
+         << setw(12) << loaded.size()
+         << setw(14) << (size_t)((nb - nb0) / insert_seconds)
+         << setw(10) << recall_at_k(nq, k, gt, gt_k, labels.data())
+         << index.retired_lists() << "\n";
+}
+
+/* Search latency of the concurrent IVF and HNSW indexes while vectors are
+   inserted by another thread, compared to the latency without inserts.  */
+void
+bench_concurrent (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = min(params.k, gt_k);
+    IndexIVFFlatConcurrent ivf(d, params.ncentroids, METRIC_L2);
+    IndexHNSWConcurrent hnsw(d, params.hnsw_m, METRIC_L2);
+
+    ivf.train(nt ? nt : nb, nt ? xt.data() : xb.data());
+    ivf.nprobe = BENCH_CONCURRENT_NPROBE;
+    hnsw.ef_construction = params.ef_construction;
+    hnsw.ef_search = BENCH_CONCURRENT_EF;
+
+    cout << "Concurrent insert benchmark, " << nb / 2 << " + "
+         << nb - nb / 2 << " x " << d << " vectors, k = " << k
+         << ", latencies in us\n";
+    cout << left << setw(8) << "index" << setw(12) << "idle p50"
+         << setw(12) << "idle p99" << setw(12) << "insert p50"
+         << setw(12) << "insert p99" << setw(12) << "queries"
+         << setw(14) << "inserts/s" << setw(10) << "recall"
+         << "retired\n";
+
+    concurrent_run("IVF", ivf, nb, xb.data(), nq, xq.data(), k, gt.data(),
+                   gt_k);
+    concurrent_run("HNSW", hnsw, nb, xb.data(), nq, xq.data(), k,
+                   gt.data(), gt_k);
+}
+
+/* Search throughput and recall of an IndexSegmented as a growing fraction
+   of its vectors is deleted, with the default compaction and with the
+   rebuild of the segments with deleted vectors disabled.  Each round
+   deletes BENCH_SEGMENTS_DELETE_PCT % of the vectors and updates
+   BENCH_SEGMENTS_UPDATE_PCT %, which adds them again under the same
+   label, then waits for the compaction.  The recall is measured against
+   an exact search over the vectors not deleted.  */
+void
+bench_segments (const struct bench_params_t &params)
+{
+    using namespace std;
+    using namespace vector_search;
+    size_t d, nb, nq, nt, gt_k;
+    vector<float> xb, xq, xt;
+    vector<int64_t> gt;
+    mt19937 rng(1234);
+
+    load_bench_dataset(params, d, nb, nq, nt, gt_k, xb, xq, xt, gt);
+
+    size_t k = params.k;
+    vector<float> distances(nq * k), gt_distances(nq * k);
+    vector<int64_t> labels(nq * k), gt_labels(nq * k), ids(nb), perm(nb);
+    SegmentedIndexParams compacted_params, purge_off_params;
+    IndexFlat flat(d, METRIC_L2);
+    IDBitmap live(nb);
+
+    compacted_params.mutable_size = max(nb / 16, (size_t)1000);
+    purge_off_params = compacted_params;
+    purge_off_params.max_deleted = 1;
+
+    IndexSegmented compacted(d, METRIC_L2, compacted_params);
+    IndexSegmented purge_off(d, METRIC_L2, purge_off_params);
+    IndexSegmented *indexes[] = {&purge_off, &compacted};
+
+    for (size_t i = 0; i < nb; i++)
+        ids[i] = perm[i] = i;
+    shuffle(perm.begin(), perm.end(), rng);
+    live.set_range(0, nb);
+    flat.add(nb, xb.data());
+    for (IndexSegmented *index : indexes) {
+        index->add(nb, xb.data(), ids.data());
+        index->flush();
+    }
+
+    cout << "Segmented index benchmark, " << nb << " x " << d
+         << " vectors, mutable segment of " << compacted_params.mutable_size
+         << ", k = " << k << ", " << get_num_threads() << " threads\n";
+    cout << left << setw(10) << "deleted" << setw(12) << "stored"
+         << setw(10) << "QPS" << setw(10) << "recall"
+         << setw(12) << "stored" << setw(10) << "segments"
+         << setw(10) << "QPS" << "recall\n";
+    cout << left << setw(10) << "" << setw(32) << "(no rebuild)"
+         << "(compaction)\n";
+
+    size_t ndeleted = 0, nupdate = nb * BENCH_SEGMENTS_UPDATE_PCT / 100;
+
+    for (size_t round = 0; round <= BENCH_SEGMENTS_ROUNDS; round++) {
+        if (round > 0) {
+            size_t ndelete = nb * BENCH_SEGMENTS_DELETE_PCT / 100;
+            const int64_t *updated = perm.data() + ndeleted + ndelete;
+            vector<float> xu(nupdate * d);
+
+            for (size_t i = 0; i < nupdate; i++)
+                memcpy(&xu[i * d], &xb[updated[i] * d], d * sizeof(float));
+            for (size_t i = 0; i < ndelete; i++)
+                live.unset(perm[ndeleted + i]);
+            for (IndexSegmented *index : indexes) {
+                index->remove(ndelete, perm.data() + ndeleted);
+                index->add(nupdate, xu.data(), updated);
+                index->flush();
+            }
+            ndeleted += ndelete;
+        }
+
+        flat.search(nq, xq.data(), k, gt_distances.data(), gt_labels.data(),
+                    &live);
+        cout << left << setw(10) << (double)ndeleted / nb;
+
+        for (IndexSegmented *index : indexes) {
+            SegmentedIndexStats stats = index->stats();
+            auto start = chrono::steady_clock::now();
+
+            index->search(nq, xq.data(), k, distances.data(), labels.data());
+            double qps = nq / elapsed_seconds(start);
+
+            cout << setw(12) << stats.nstored;
+            if (index == &compacted)
+                cout << setw(10) << stats.nsegments;
+            cout << setw(10) << (size_t)qps
+                 << setw(index == &compacted ? 0 : 10)
+                 << recall_at_k(nq, k, gt_labels.data(), k, labels.data());
+        }
+        cout << "\n";
+    }
+}
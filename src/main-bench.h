@@ -0,0 +1,108 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Benchmarks of the library classes (KMeans, the indexes).  Unlike the
+   function tests in main-tests.cc, each benchmark runs once on a synthetic
+   data set and reports its own figures on stdout.  */
+
+#ifndef MAIN_BENCH_H
+#define MAIN_BENCH_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum bench_id {
+    BENCH_KMEANS = 0,
+    BENCH_FLAT,
+    BENCH_IVF,
+    BENCH_HNSW,
+    BENCH_VAMANA,
+    BENCH_FILTER,
+    BENCH_RANGE,
+    BENCH_RERANK,
+    BENCH_BINARY,
+    BENCH_RABITQ,
+    BENCH_TRANSFORM,
+    BENCH_NUMA,
+    BENCH_WORKING_SET,
+    BENCH_BLOCKED,
+    BENCH_ARENA,
+    BENCH_ASYNC,
+    BENCH_INTERLEAVE,
+    BENCH_CONCURRENT,
+    BENCH_SEGMENTS,
+    BENCH_ID_MAX,
+};
+
+/* Default sizes of the benchmark data sets.  */
+#define BENCH_NB            100000
+#define BENCH_DIM           128
+#define BENCH_NCENTROIDS    1024
+#define BENCH_NQ            1000
+#define BENCH_K             10
+#define BENCH_HNSW_M        32
+#define BENCH_EF_CONSTRUCTION 40
+#define BENCH_DEGREE        32
+#define BENCH_BEAM_WIDTH    4
+#define BENCH_WORKING_SET_MB 1024
+
+/* Number of Gaussian clusters in the synthetic data set.  */
+#define BENCH_DATA_CLUSTERS 256
+
+struct bench_params_t {
+    size_t nb = BENCH_NB;                   /* Number of database vectors.  */
+    size_t d = BENCH_DIM;                   /* Dimension.  */
+    size_t ncentroids = BENCH_NCENTROIDS;   /* Centroids of the trainers.  */
+    size_t nq = BENCH_NQ;                   /* Number of queries.  */
+    size_t k = BENCH_K;                     /* Results per query.  */
+    size_t hnsw_m = BENCH_HNSW_M;           /* Neighbors per HNSW node.  */
+    size_t ef_construction = BENCH_EF_CONSTRUCTION;
+    size_t degree = BENCH_DEGREE;           /* Degree of the Vamana graph.  */
+    size_t beam_width = BENCH_BEAM_WIDTH;   /* Reads per round trip.  */
+    size_t working_set = BENCH_WORKING_SET_MB; /* MiB of random gathers.  */
+
+    /* Prefix of the files of a local data set, for instance sift/sift for
+       sift/sift_base.fvecs, sift/sift_query.fvecs,
+       sift/sift_groundtruth.ivecs and the optional sift/sift_learn.fvecs.
+       When empty, the synthetic data set is used.  */
+    std::string dataset;
+};
+
+void make_clustered_data (size_t n, size_t d, size_t nclusters, int seed,
+                          std::vector<float> &x);
+
+void bench_kmeans (const struct bench_params_t &params);
+void bench_flat (const struct bench_params_t &params);
+void bench_ivf (const struct bench_params_t &params);
+void bench_hnsw (const struct bench_params_t &params);
+void bench_vamana (const struct bench_params_t &params);
+void bench_filter (const struct bench_params_t &params);
+void bench_range (const struct bench_params_t &params);
+void bench_rerank (const struct bench_params_t &params);
+void bench_binary (const struct bench_params_t &params);
+void bench_rabitq (const struct bench_params_t &params);
+void bench_transform (const struct bench_params_t &params);
+void bench_numa (const struct bench_params_t &params);
+void bench_working_set (const struct bench_params_t &params);
+void bench_blocked (const struct bench_params_t &params);
+void bench_arena (const struct bench_params_t &params);
+void bench_async (const struct bench_params_t &params);
+void bench_interleave (const struct bench_params_t &params);
+void bench_concurrent (const struct bench_params_t &params);
+void bench_segments (const struct bench_params_t &params);
+
+#endif /* MAIN_BENCH_H */
@@ -17,6 +17,8 @@
 #include <iomanip>
 #include <iostream>
 #include "main-helpers.h"
+#include "utils/memory.h"
+#include "utils/parallel.h"
 #include <cstring>
 #include <string>
 
@@ -45,6 +47,54 @@
 #define COSINE_DISTANCE_REF_OPT                             1016
 #define HAMMING_DISTANCE_REF_OPT                            1017
 #define JACCARD_DISTANCE_REF_OPT                            1018
+#define FVEC_L2SQR_BATCH_N_REF_OPT                          1019
+#define FVEC_INNER_PRODUCT_BATCH_N_REF_OPT                  1020
+#define FVEC_L2SQR_BOUNDED_REF_OPT                          1021
+#define RUN_CUSTOM_OPT                                      1022
+#define FVEC_LINF_REF_OPT                                   1023
+#define FVEC_MADD_REF_OPT                                   1024
+#define FVEC_MADD_AND_ARGMIN_REF_OPT                        1025
+#define ASSIGN_TO_NEAREST_REF_OPT                           1026
+#define THREADS_OPT                                         1027
+#define BENCH_KMEANS_OPT                                    1028
+#define NB_OPT                                              1029
+#define DIM_OPT                                             1030
+#define NCENTROIDS_OPT                                      1031
+#define BENCH_FLAT_OPT                                      1032
+#define NQ_OPT                                              1033
+#define K_OPT                                               1034
+#define BENCH_IVF_OPT                                       1035
+#define DATASET_OPT                                         1036
+#define BENCH_HNSW_OPT                                      1037
+#define HNSW_M_OPT                                          1038
+#define EF_CONSTRUCTION_OPT                                 1039
+#define BENCH_VAMANA_OPT                                    1040
+#define BEAM_WIDTH_OPT                                      1041
+#define DEGREE_OPT                                          1042
+#define BENCH_FILTER_OPT                                    1043
+#define BENCH_RANGE_OPT                                     1044
+#define BENCH_RERANK_OPT                                    1045
+#define BENCH_BINARY_OPT                                    1046
+#define BITPLANE_DOT_NY_REF_OPT                             1047
+#define BENCH_RABITQ_OPT                                    1048
+#define BENCH_TRANSFORM_OPT                                 1049
+#define AFFINITY_OPT                                        1050
+#define BENCH_NUMA_OPT                                      1051
+#define HUGE_PAGES_OPT                                      1052
+#define BENCH_WORKING_SET_OPT                               1053
+#define WORKING_SET_OPT                                     1054
+#define FVEC_L2SQR_BY_IDS_REF_OPT                           1055
+#define FVEC_INNER_PRODUCTS_BY_IDS_REF_OPT                  1056
+#define FVEC_L2SQR_BLOCKED_REF_OPT                          1057
+#define FVEC_INNER_PRODUCTS_BLOCKED_REF_OPT                 1058
+#define COSINE_DISTANCES_BLOCKED_REF_OPT                    1059
+#define BENCH_BLOCKED_OPT                                   1060
+#define BENCH_ARENA_OPT                                     1061
+#define BENCH_ASYNC_OPT                                     1062
+#define BENCH_INTERLEAVE_OPT                                1063
+#define BENCH_CONCURRENT_OPT                                1064
+#define BENCH_SEGMENTS_OPT                                  1065
+#define KMEANS_MINIBATCH_REF_OPT                            1066
 
 
 // undocumented option for developers use
@@ -77,19 +127,44 @@ const struct option longopts[] =
                                      FVEC_L2SQR_NY_TRANSPOSED_REF_OPT},
     {"fvec_L2sqr_batch_4_ref", no_argument, &long_opt,
                                FVEC_L2SQR_BATCH_4_REF_OPT},
+    {"fvec_L2sqr_batch_N_ref", no_argument, &long_opt,
+                               FVEC_L2SQR_BATCH_N_REF_OPT},
+    {"fvec_L2sqr_by_ids_ref", no_argument, &long_opt,
+                              FVEC_L2SQR_BY_IDS_REF_OPT},
+    {"fvec_L2sqr_blocked_ref", no_argument, &long_opt,
+                               FVEC_L2SQR_BLOCKED_REF_OPT},
+    {"fvec_L2sqr_bounded_ref", no_argument, &long_opt,
+                               FVEC_L2SQR_BOUNDED_REF_OPT},
+    {"assign_to_nearest_ref", no_argument, &long_opt,
+                              ASSIGN_TO_NEAREST_REF_OPT},
+    {"kmeans_minibatch_ref", no_argument, &long_opt,
+                             KMEANS_MINIBATCH_REF_OPT},
     {"ivec_L2sqr_ref", no_argument, &long_opt, IVEC_L2SQR_REF_OPT},
     {"fvec_inner_product_ref", no_argument, &long_opt,
                                FVEC_INNER_PRODUCT_REF_OPT},
     {"fvec_inner_products_batch_4_ref", no_argument, &long_opt,
                                         FVEC_INNER_PRODUCT_BATCH_4_REF_OPT},
+    {"fvec_inner_product_batch_N_ref", no_argument, &long_opt,
+                                       FVEC_INNER_PRODUCT_BATCH_N_REF_OPT},
+    {"fvec_inner_products_by_ids_ref", no_argument, &long_opt,
+                                       FVEC_INNER_PRODUCTS_BY_IDS_REF_OPT},
+    {"fvec_inner_products_blocked_ref", no_argument, &long_opt,
+                                        FVEC_INNER_PRODUCTS_BLOCKED_REF_OPT},
     {"ivec_inner_products_ref", no_argument, &long_opt,
                                 IVEC_INNER_PRODUCT_REF_OPT},
 
     {"fvec_L1_ref", no_argument, &long_opt,
                                FVEC_L1_REF_OPT},
+    {"fvec_Linf_ref", no_argument, &long_opt, FVEC_LINF_REF_OPT},
+    {"fvec_madd_ref", no_argument, &long_opt, FVEC_MADD_REF_OPT},
+    {"fvec_madd_and_argmin_ref", no_argument, &long_opt,
+                                 FVEC_MADD_AND_ARGMIN_REF_OPT},
     
     {"cosine_distance_ref",no_argument, &long_opt, COSINE_DISTANCE_REF_OPT },
+    {"cosine_distances_blocked_ref", no_argument, &long_opt,
+                                     COSINE_DISTANCES_BLOCKED_REF_OPT},
     {"hamming_distance_ref", no_argument, &long_opt, HAMMING_DISTANCE_REF_OPT},
+    {"bitplane_dot_ny_ref", no_argument, &long_opt, BITPLANE_DOT_NY_REF_OPT},
     {"jaccard_distance_ref",no_argument, &long_opt, JACCARD_DISTANCE_REF_OPT},
 
     /* The code versions to run.  */
@@ -98,6 +173,48 @@ const struct option longopts[] =
     {"run_intrinsic_code", no_argument, &long_opt,
                                 RUN_INTRINSIC_CODE},
 
+    /* Run the selected function on the vectors in dataset/train.csv.  */
+    {"run_custom", no_argument, &long_opt, RUN_CUSTOM_OPT},
+
+    /* Number of threads of the multi-threaded functions.  */
+    {"threads", required_argument, &long_opt, THREADS_OPT},
+    {"affinity", no_argument, &long_opt, AFFINITY_OPT},
+
+    /* Page size of the vector, code and graph storage.  */
+    {"huge_pages", required_argument, &long_opt, HUGE_PAGES_OPT},
+
+    /* Benchmarks of the library classes and their data set sizes.  */
+    {"bench_kmeans", no_argument, &long_opt, BENCH_KMEANS_OPT},
+    {"nb", required_argument, &long_opt, NB_OPT},
+    {"dim", required_argument, &long_opt, DIM_OPT},
+    {"ncentroids", required_argument, &long_opt, NCENTROIDS_OPT},
+    {"bench_flat", no_argument, &long_opt, BENCH_FLAT_OPT},
+    {"nq", required_argument, &long_opt, NQ_OPT},
+    {"k", required_argument, &long_opt, K_OPT},
+    {"bench_ivf", no_argument, &long_opt, BENCH_IVF_OPT},
+    {"dataset", required_argument, &long_opt, DATASET_OPT},
+    {"bench_hnsw", no_argument, &long_opt, BENCH_HNSW_OPT},
+    {"hnsw_m", required_argument, &long_opt, HNSW_M_OPT},
+    {"ef_construction", required_argument, &long_opt, EF_CONSTRUCTION_OPT},
+    {"bench_vamana", no_argument, &long_opt, BENCH_VAMANA_OPT},
+    {"beam_width", required_argument, &long_opt, BEAM_WIDTH_OPT},
+    {"degree", required_argument, &long_opt, DEGREE_OPT},
+    {"bench_filter", no_argument, &long_opt, BENCH_FILTER_OPT},
+    {"bench_range", no_argument, &long_opt, BENCH_RANGE_OPT},
+    {"bench_rerank", no_argument, &long_opt, BENCH_RERANK_OPT},
+    {"bench_binary", no_argument, &long_opt, BENCH_BINARY_OPT},
+    {"bench_rabitq", no_argument, &long_opt, BENCH_RABITQ_OPT},
+    {"bench_transform", no_argument, &long_opt, BENCH_TRANSFORM_OPT},
+    {"bench_numa", no_argument, &long_opt, BENCH_NUMA_OPT},
+    {"bench_working_set", no_argument, &long_opt, BENCH_WORKING_SET_OPT},
+    {"bench_blocked", no_argument, &long_opt, BENCH_BLOCKED_OPT},
+    {"bench_arena", no_argument, &long_opt, BENCH_ARENA_OPT},
+    {"bench_async", no_argument, &long_opt, BENCH_ASYNC_OPT},
+    {"bench_interleave", no_argument, &long_opt, BENCH_INTERLEAVE_OPT},
+    {"bench_concurrent", no_argument, &long_opt, BENCH_CONCURRENT_OPT},
+    {"bench_segments", no_argument, &long_opt, BENCH_SEGMENTS_OPT},
+    {"working_set", required_argument, &long_opt, WORKING_SET_OPT},
+
     
     /* undocumented developers option */
     {"VERBOSE", no_argument, &long_opt, VERBOSE_OPT},
@@ -144,6 +261,12 @@ print_help (void)
     cout << " --fvec_norm_L2sqr_ref\n";
     cout << " --fvec_L2sqr_ny_transposed_ref\n";
     cout << " --fvec_L2sqr_batch_4_ref\n";
+    cout << " --fvec_L2sqr_batch_N_ref\n";
+    cout << " --fvec_L2sqr_by_ids_ref\n";
+    cout << " --fvec_L2sqr_blocked_ref\n";
+    cout << " --fvec_L2sqr_bounded_ref\n";
+    cout << " --assign_to_nearest_ref\n";
+    cout << " --kmeans_minibatch_ref\n";
     cout << " --ivec_L2sqr_ref\n";
     cout << "\n";
     cout << " -I                      Test all inner product distance functions.";
@@ -151,20 +274,133 @@ print_help (void)
     cout << " Select specific inner product tests.\n";
     cout << " --fvec_inner_product_ref\n";
     cout << " --fvec_inner_products_batch_4_ref\n";
+    cout << " --fvec_inner_product_batch_N_ref\n";
+    cout << " --fvec_inner_products_by_ids_ref\n";
+    cout << " --fvec_inner_products_blocked_ref\n";
     cout << " --ivec_inner_products_ref\n";
     cout << "\n";
-    cout << " -C                       Test  Cosine distance function\n";
+    cout << " -C                       Test  Cosine distance functions\n";
+    cout << " Select specific cosine tests.\n";
+    cout << " --cosine_distance_ref\n";
+    cout << " --cosine_distances_blocked_ref\n";
     cout << "\n";
-    cout << " -H                       Test  Hamming distance function\n";
+    cout << " -H                       Test  Hamming distance functions\n";
+    cout << " Select specific Hamming tests.\n";
+    cout << " --hamming_distance_ref\n";
+    cout << " --bitplane_dot_ny_ref\n";
     cout << "\n";
     cout << " -J                       Test  Jaccard distance function\n";
     cout << "\n";
-    cout << " -M                       Test  Manhattan distance function\n";
+    cout << " -M                       Test  Manhattan distance functions\n";
+    cout << " Select specific Manhattan tests.\n";
+    cout << " --fvec_L1_ref\n";
+    cout << " --fvec_Linf_ref\n";
+    cout << " --fvec_madd_ref\n";
+    cout << " --fvec_madd_and_argmin_ref\n";
     cout << "\n";
     cout << " --run_optimized_code      Run the optimized C code versions\n";
     cout << " --run_intrinsic_code      Run the optimized intrinsic code versions\n";
     cout << " By default, the base and the optimized code versions are run.\n";
     cout << "\n";
+    cout << " --threads <num>           Number of threads used by the\n";
+    cout << "                           multi-threaded functions.  Default is\n";
+    cout << "                           the number of hardware threads.\n";
+    cout << " --affinity                Bind the worker threads to CPUs, one\n";
+    cout << "                           per core before sharing the cores.\n";
+    cout << " --huge_pages <pages>      Page size of the vectors, codes and\n";
+    cout << "                           graphs of the indexes: none, thp\n";
+    cout << "                           (transparent huge pages), 2mb or 1gb\n";
+    cout << "                           (reserved huge pages, falling back to\n";
+    cout << "                           the smaller pages).  Default is none.\n";
+    cout << "\n";
+    cout << " --run_custom              Compare the base and optimized versions\n";
+    cout << "                           of the selected function on the vector\n";
+    cout << "                           pairs in dataset/train.csv.  With\n";
+    cout << "                           --fvec_L2sqr_bounded_ref, also report\n";
+    cout << "                           the fraction of dimensions skipped in a\n";
+    cout << "                           top-k scan of the data.\n";
+    cout << "\n";
+    cout << " --bench_kmeans            Time the KMeans training on a synthetic\n";
+    cout << "                           clustered data set.\n";
+    cout << " --bench_flat              Time the IndexFlat search for each\n";
+    cout << "                           metric and check the results against\n";
+    cout << "                           the base functions.\n";
+    cout << " --bench_ivf               Report the recall and the QPS of\n";
+    cout << "                           IndexIVFFlat for increasing nprobe,\n";
+    cout << "                           with --ncentroids inverted lists.\n";
+    cout << " --bench_hnsw              Report the recall, the QPS and the\n";
+    cout << "                           latency of IndexHNSW for increasing\n";
+    cout << "                           ef_search.\n";
+    cout << " --hnsw_m <num>            Neighbors per HNSW node.  Default is\n";
+    cout << "                           " << BENCH_HNSW_M << ".\n";
+    cout << " --ef_construction <num>   HNSW construction candidate list size.\n";
+    cout << "                           Default is " << BENCH_EF_CONSTRUCTION << ".\n";
+    cout << " --bench_vamana            Build IndexVamanaDisk to a file and\n";
+    cout << "                           report the recall, the QPS and the\n";
+    cout << "                           reads per query for increasing search\n";
+    cout << "                           list sizes.\n";
+    cout << " --degree <num>            Degree of the Vamana graph.  Default is\n";
+    cout << "                           " << BENCH_DEGREE << ".\n";
+    cout << " --beam_width <num>        Vamana reads per round trip.  Default is\n";
+    cout << "                           " << BENCH_BEAM_WIDTH << ".\n";
+    cout << " --bench_filter            Time the filtered searches of IndexFlat\n";
+    cout << "                           and IndexIVFFlat for decreasing filter\n";
+    cout << "                           selectivities.\n";
+    cout << " --bench_range             Time the range searches of IndexFlat\n";
+    cout << "                           and IndexIVFFlat for increasing radii.\n";
+    cout << " --bench_rerank            Report the recall and the latency of\n";
+    cout << "                           the exact re-ranking of scalar quantized\n";
+    cout << "                           search candidates.\n";
+    cout << " --bench_binary            Report the recall of a Hamming search on\n";
+    cout << "                           1-bit codes re-ranked with the float\n";
+    cout << "                           vectors, for increasing oversampling.\n";
+    cout << " --bench_rabitq            Compare the recall and the QPS of RaBitQ\n";
+    cout << "                           codes with error-bounded re-ranking to\n";
+    cout << "                           8-bit scalar codes.\n";
+    cout << " --bench_transform         Report the recall of flat searches after\n";
+    cout << "                           PCA reductions, and of PQ after random\n";
+    cout << "                           and OPQ rotations.\n";
+    cout << " --bench_numa              Report the local and remote scan\n";
+    cout << "                           bandwidth of the kernels per NUMA node,\n";
+    cout << "                           and the QPS of sharded flat searches.\n";
+    cout << " --bench_working_set       Report the latency, the time and the\n";
+    cout << "                           TLB misses of random vector gathers for\n";
+    cout << "                           each page size.\n";
+    cout << " --working_set <num>       MiB of vectors of --bench_working_set.\n";
+    cout << "                           Default is " << BENCH_WORKING_SET_MB << ".\n";
+    cout << " --bench_blocked           Compare the distance kernels of the\n";
+    cout << "                           blocked layout to the row-major batch\n";
+    cout << "                           kernels.\n";
+    cout << " --bench_arena             Count the heap allocations per query\n";
+    cout << "                           of the searches of the indexes.\n";
+    cout << " --bench_async             Report the latency percentiles and the\n";
+    cout << "                           QPS of micro-batched asynchronous\n";
+    cout << "                           queries under an open-loop load.\n";
+    cout << " --bench_interleave        Compare the single thread QPS of the\n";
+    cout << "                           HNSW and IVF searches with queries\n";
+    cout << "                           interleaved as coroutines.\n";
+    cout << " --bench_concurrent        Report the search latency of the\n";
+    cout << "                           concurrent IVF and HNSW indexes\n";
+    cout << "                           while vectors are inserted.\n";
+    cout << " --bench_segments          Report the QPS and the recall of the\n";
+    cout << "                           segmented index as vectors are\n";
+    cout << "                           deleted and updated.\n";
+    cout << " --nb <num>                Number of vectors of the benchmark data\n";
+    cout << "                           set.  Default is " << BENCH_NB << ".\n";
+    cout << " --dim <num>               Dimension of the benchmark data set.\n";
+    cout << "                           Default is " << BENCH_DIM << ".\n";
+    cout << " --ncentroids <num>        Number of centroids of the benchmarks.\n";
+    cout << "                           Default is " << BENCH_NCENTROIDS << ".\n";
+    cout << " --nq <num>                Number of queries of the benchmarks.\n";
+    cout << "                           Default is " << BENCH_NQ << ".\n";
+    cout << " --k <num>                 Number of results per query.\n";
+    cout << "                           Default is " << BENCH_K << ".\n";
+    cout << " --dataset <prefix>        Use the data set in the files\n";
+    cout << "                           <prefix>_base.fvecs, _query.fvecs,\n";
+    cout << "                           _groundtruth.ivecs and the optional\n";
+    cout << "                           _learn.fvecs, for instance sift/sift\n";
+    cout << "                           for SIFT1M, instead of synthetic data.\n";
+    cout << "\n";
     cout << "\n";
     cout << " By default, all tests are run for array an size of 16.\n";
     cout << "\n";
@@ -210,6 +446,45 @@ print_cmd_opts (struct flags_t cmd_flags,
         cmd_flags.run_code_version[CODE_OPTIMIZED_PPC] << endl;
     cout << "Run intrinsic functions: " <<
         cmd_flags.run_code_version[CODE_INTRINSIC_PPC] << endl;
+    cout << "Run custom test: " << cmd_flags.run_custom << endl;
+    cout << "Run KMeans benchmark: " << cmd_flags.run_bench[BENCH_KMEANS]
+         << endl;
+    cout << "Run IndexFlat benchmark: " << cmd_flags.run_bench[BENCH_FLAT]
+         << endl;
+    cout << "Run IndexIVFFlat benchmark: " << cmd_flags.run_bench[BENCH_IVF]
+         << endl;
+    cout << "Run IndexHNSW benchmark: " << cmd_flags.run_bench[BENCH_HNSW]
+         << endl;
+    cout << "Run IndexVamanaDisk benchmark: "
+         << cmd_flags.run_bench[BENCH_VAMANA] << endl;
+    cout << "Run filtered search benchmark: "
+         << cmd_flags.run_bench[BENCH_FILTER] << endl;
+    cout << "Run range search benchmark: "
+         << cmd_flags.run_bench[BENCH_RANGE] << endl;
+    cout << "Run re-ranking benchmark: "
+         << cmd_flags.run_bench[BENCH_RERANK] << endl;
+    cout << "Run binary quantization benchmark: "
+         << cmd_flags.run_bench[BENCH_BINARY] << endl;
+    cout << "Run RaBitQ benchmark: "
+         << cmd_flags.run_bench[BENCH_RABITQ] << endl;
+    cout << "Run vector transform benchmark: "
+         << cmd_flags.run_bench[BENCH_TRANSFORM] << endl;
+    cout << "Run NUMA benchmark: "
+         << cmd_flags.run_bench[BENCH_NUMA] << endl;
+    cout << "Run working set benchmark: "
+         << cmd_flags.run_bench[BENCH_WORKING_SET] << endl;
+    cout << "Run blocked layout benchmark: "
+         << cmd_flags.run_bench[BENCH_BLOCKED] << endl;
+    cout << "Run arena benchmark: "
+         << cmd_flags.run_bench[BENCH_ARENA] << endl;
+    cout << "Run asynchronous search benchmark: "
+         << cmd_flags.run_bench[BENCH_ASYNC] << endl;
+    cout << "Run interleaved search benchmark: "
+         << cmd_flags.run_bench[BENCH_INTERLEAVE] << endl;
+    cout << "Run concurrent insert benchmark: "
+         << cmd_flags.run_bench[BENCH_CONCURRENT] << endl;
+    cout << "Run segmented index benchmark: "
+         << cmd_flags.run_bench[BENCH_SEGMENTS] << endl;
     cout << endl;
 }
 
@@ -271,6 +546,32 @@ get_size_arg (char *optarg, struct flags_t *cmd_flags)
     cmd_flags->num_array_sizes = cmd_flags->num_array_sizes + 1;
 }
 
+/* Set the page size of the default memory policy from the argument of
+   --huge_pages.  */
+static void
+set_huge_pages (const char *optarg)
+{
+    using namespace std;
+    vector_search::MemoryPolicy policy =
+        vector_search::get_default_memory_policy();
+
+    if (strcmp(optarg, "none") == 0)
+        policy.huge_pages = vector_search::HUGE_PAGES_NONE;
+    else if (strcmp(optarg, "thp") == 0)
+        policy.huge_pages = vector_search::HUGE_PAGES_TRANSPARENT;
+    else if (strcmp(optarg, "2mb") == 0)
+        policy.huge_pages = vector_search::HUGE_PAGES_2MB;
+    else if (strcmp(optarg, "1gb") == 0)
+        policy.huge_pages = vector_search::HUGE_PAGES_1GB;
+    else
+    {
+        cout << "ERROR: unknown huge page size " << optarg
+             << ", expected none, thp, 2mb or 1gb" << endl;
+        exit(-1);
+    }
+    vector_search::set_default_memory_policy(policy);
+}
+
 /*
  * The following function getopt_long was taken from:
  *   https://ftp.software.ibm.com/aix/freeSoftware/aixtoolbox/PATCHES/libzip-1.8.0-getopt.patch
@@ -526,6 +827,36 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
                 cmd_flags->run_func_flag[FVEC_L2SQR_BATCH_4_REF] = true;
                 break;
 
+            case FVEC_L2SQR_BATCH_N_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_L2SQR_BATCH_N_REF] = true;
+                break;
+
+            case FVEC_L2SQR_BY_IDS_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_L2SQR_BY_IDS_REF] = true;
+                break;
+
+            case FVEC_L2SQR_BLOCKED_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_L2SQR_BLOCKED_REF] = true;
+                break;
+
+            case FVEC_L2SQR_BOUNDED_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_L2SQR_BOUNDED_REF] = true;
+                break;
+
+            case ASSIGN_TO_NEAREST_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[ASSIGN_TO_NEAREST_REF] = true;
+                break;
+
+            case KMEANS_MINIBATCH_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[KMEANS_MINIBATCH_REF] = true;
+                break;
+
             case IVEC_L2SQR_REF_OPT:
                 run_subset_of_tests = true;
                 cmd_flags->run_func_flag[IVEC_L2SQR_REF] = true;
@@ -542,12 +873,60 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
                     = true;
                 break;
 
+            case FVEC_INNER_PRODUCT_BATCH_N_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_INNER_PRODUCT_BATCH_N_REF]
+                    = true;
+                break;
+
+            case FVEC_INNER_PRODUCTS_BY_IDS_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_INNER_PRODUCTS_BY_IDS_REF]
+                    = true;
+                break;
+
+            case FVEC_INNER_PRODUCTS_BLOCKED_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_INNER_PRODUCTS_BLOCKED_REF]
+                    = true;
+                break;
+
             case IVEC_INNER_PRODUCT_REF_OPT:
                 run_subset_of_tests = true;
                 cmd_flags->run_func_flag[IVEC_INNER_PRODUCT_REF]
                     = true;
                 break;
 
+            case FVEC_L1_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_L1_REF] = true;
+                break;
+
+            case FVEC_LINF_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_LINF_REF] = true;
+                break;
+
+            case FVEC_MADD_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_MADD_REF] = true;
+                break;
+
+            case FVEC_MADD_AND_ARGMIN_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[FVEC_MADD_AND_ARGMIN_REF] = true;
+                break;
+
+            case HAMMING_DISTANCE_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[HAMMING_DISTANCE_REF] = true;
+                break;
+
+            case BITPLANE_DOT_NY_REF_OPT:
+                run_subset_of_tests = true;
+                cmd_flags->run_func_flag[BITPLANE_DOT_NY_REF] = true;
+                break;
+
             case RUN_OPTIMIZED_CODE:
                 run_subset_of_code = true;
                 cmd_flags->run_code_version[CODE_OPTIMIZED_PPC] = true;
@@ -558,6 +937,161 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
                 cmd_flags->run_code_version[CODE_INTRINSIC_PPC] = true;
                 break;
 
+            case RUN_CUSTOM_OPT:
+                cmd_flags->run_custom = true;
+                break;
+
+            case THREADS_OPT:
+                vector_search::set_num_threads (atoi(optarg));
+                break;
+
+            case AFFINITY_OPT:
+                vector_search::set_thread_affinity (true);
+                break;
+
+            case HUGE_PAGES_OPT:
+                set_huge_pages (optarg);
+                break;
+
+            case BENCH_KMEANS_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_KMEANS] = true;
+                break;
+
+            case NB_OPT:
+                cmd_flags->bench_params.nb = atol(optarg);
+                break;
+
+            case DIM_OPT:
+                cmd_flags->bench_params.d = atol(optarg);
+                break;
+
+            case NCENTROIDS_OPT:
+                cmd_flags->bench_params.ncentroids = atol(optarg);
+                break;
+
+            case BENCH_FLAT_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_FLAT] = true;
+                break;
+
+            case NQ_OPT:
+                cmd_flags->bench_params.nq = atol(optarg);
+                break;
+
+            case K_OPT:
+                cmd_flags->bench_params.k = atol(optarg);
+                break;
+
+            case BENCH_IVF_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_IVF] = true;
+                break;
+
+            case DATASET_OPT:
+                cmd_flags->bench_params.dataset = optarg;
+                break;
+
+            case BENCH_HNSW_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_HNSW] = true;
+                break;
+
+            case HNSW_M_OPT:
+                cmd_flags->bench_params.hnsw_m = atol(optarg);
+                break;
+
+            case EF_CONSTRUCTION_OPT:
+                cmd_flags->bench_params.ef_construction = atol(optarg);
+                break;
+
+            case BENCH_VAMANA_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_VAMANA] = true;
+                break;
+
+            case BEAM_WIDTH_OPT:
+                cmd_flags->bench_params.beam_width = atol(optarg);
+                break;
+
+            case DEGREE_OPT:
+                cmd_flags->bench_params.degree = atol(optarg);
+                break;
+
+            case BENCH_FILTER_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_FILTER] = true;
+                break;
+
+            case BENCH_RANGE_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_RANGE] = true;
+                break;
+
+            case BENCH_RERANK_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_RERANK] = true;
+                break;
+
+            case BENCH_BINARY_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_BINARY] = true;
+                break;
+
+            case BENCH_RABITQ_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_RABITQ] = true;
+                break;
+
+            case BENCH_TRANSFORM_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_TRANSFORM] = true;
+                break;
+
+            case BENCH_NUMA_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_NUMA] = true;
+                break;
+
+            case BENCH_WORKING_SET_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_WORKING_SET] = true;
+                break;
+
+            case BENCH_BLOCKED_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_BLOCKED] = true;
+                break;
+
+            case BENCH_ARENA_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_ARENA] = true;
+                break;
+
+            case BENCH_ASYNC_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_ASYNC] = true;
+                break;
+
+            case BENCH_INTERLEAVE_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_INTERLEAVE] = true;
+                break;
+
+            case BENCH_CONCURRENT_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_CONCURRENT] = true;
+                break;
+
+            case BENCH_SEGMENTS_OPT:
+                cmd_flags->run_any_bench = true;
+                cmd_flags->run_bench[BENCH_SEGMENTS] = true;
+                break;
+
+            case WORKING_SET_OPT:
+                cmd_flags->bench_params.working_set = atol(optarg);
+                break;
+
             case VERBOSE_OPT:
                 cmd_flags->verbose_output = true;
                 break;
@@ -607,7 +1141,6 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
             check_short_opt_no_arg(optind, argv);
             run_subset_of_tests = true;
             enable_all_manhattan_tests = true;
-            cmd_flags->run_func_flag[FVEC_L1_REF] = true;
             break;
     
         case 'C':     /* Run all COSINE distance tests.  */
@@ -615,6 +1148,7 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
             run_subset_of_tests = true;
             enable_all_cosine_tests = true;
             cmd_flags->run_func_flag[COSINE_DISTANCE_REF] = true;
+            cmd_flags->run_func_flag[COSINE_DISTANCES_BLOCKED_REF] = true;
             break;
 
         case 'H':     /* Run all Hamming distance tests.  */
@@ -622,6 +1156,7 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
             run_subset_of_tests = true;
             enable_all_hamming_tests = true;
             cmd_flags->run_func_flag[HAMMING_DISTANCE_REF] = true;
+            cmd_flags->run_func_flag[BITPLANE_DOT_NY_REF] = true;
             break;
     
         case 'J':     /* Run all Jaccard distance tests.  */
@@ -654,6 +1189,12 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
         cmd_flags->run_func_flag[FVEC_NORM_L2SQR_REF] = true;
         cmd_flags->run_func_flag[FVEC_L2SQR_NY_TRANSPOSED_REF] = true;
         cmd_flags->run_func_flag[FVEC_L2SQR_BATCH_4_REF] = true;
+        cmd_flags->run_func_flag[FVEC_L2SQR_BATCH_N_REF] = true;
+        cmd_flags->run_func_flag[FVEC_L2SQR_BY_IDS_REF] = true;
+        cmd_flags->run_func_flag[FVEC_L2SQR_BLOCKED_REF] = true;
+        cmd_flags->run_func_flag[FVEC_L2SQR_BOUNDED_REF] = true;
+        cmd_flags->run_func_flag[ASSIGN_TO_NEAREST_REF] = true;
+        cmd_flags->run_func_flag[KMEANS_MINIBATCH_REF] = true;
         cmd_flags->run_func_flag[IVEC_L2SQR_REF] = true;
     }
 
@@ -662,6 +1203,9 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
     {
         cmd_flags->run_func_flag[FVEC_INNER_PRODUCT_REF] = true;
         cmd_flags->run_func_flag[FVEC_INNER_PRODUCT_BATCH_4_REF] = true;
+        cmd_flags->run_func_flag[FVEC_INNER_PRODUCT_BATCH_N_REF] = true;
+        cmd_flags->run_func_flag[FVEC_INNER_PRODUCTS_BY_IDS_REF] = true;
+        cmd_flags->run_func_flag[FVEC_INNER_PRODUCTS_BLOCKED_REF] = true;
         cmd_flags->run_func_flag[IVEC_INNER_PRODUCT_REF] = true;
     }
 
@@ -670,18 +1214,23 @@ read_cmd_opts (int argc, char **argv, struct flags_t *cmd_flags)
         || !run_subset_of_tests)
     {
         cmd_flags->run_func_flag[FVEC_L1_REF] = true;
+        cmd_flags->run_func_flag[FVEC_LINF_REF] = true;
+        cmd_flags->run_func_flag[FVEC_MADD_REF] = true;
+        cmd_flags->run_func_flag[FVEC_MADD_AND_ARGMIN_REF] = true;
     }
 
     if ((run_subset_of_tests && enable_all_cosine_tests)
          || !run_subset_of_tests)
     {
         cmd_flags->run_func_flag[COSINE_DISTANCE_REF] = true;
+        cmd_flags->run_func_flag[COSINE_DISTANCES_BLOCKED_REF] = true;
     }
 
     if ((run_subset_of_tests && enable_all_hamming_tests)
          || !run_subset_of_tests)
     {
         cmd_flags->run_func_flag[HAMMING_DISTANCE_REF] = true;
+        cmd_flags->run_func_flag[BITPLANE_DOT_NY_REF] = true;
     }
 
     if ((run_subset_of_tests && enable_all_jaccard_tests)
@@ -787,6 +1336,30 @@ initialize_group_func_names (char group_id_name[][GROUP_ID_NAME_MAX],
     setup_function_info (result, fun_id, EUCLIDEAN,
                          "fvec_L2sqr_batch_4_ref");
 
+    fun_id = FVEC_L2SQR_BATCH_N_REF;
+    setup_function_info (result, fun_id, EUCLIDEAN,
+                         "fvec_L2sqr_batch_N_ref");
+
+    fun_id = FVEC_L2SQR_BY_IDS_REF;
+    setup_function_info (result, fun_id, EUCLIDEAN,
+                         "fvec_L2sqr_by_ids_ref");
+
+    fun_id = FVEC_L2SQR_BLOCKED_REF;
+    setup_function_info (result, fun_id, EUCLIDEAN,
+                         "fvec_L2sqr_blocked_ref");
+
+    fun_id = FVEC_L2SQR_BOUNDED_REF;
+    setup_function_info (result, fun_id, EUCLIDEAN,
+                         "fvec_L2sqr_bounded_ref");
+
+    fun_id = ASSIGN_TO_NEAREST_REF;
+    setup_function_info (result, fun_id, EUCLIDEAN,
+                         "assign_to_nearest_ref");
+
+    fun_id = KMEANS_MINIBATCH_REF;
+    setup_function_info (result, fun_id, EUCLIDEAN,
+                         "kmeans_minibatch_ref");
+
     fun_id = IVEC_L2SQR_REF;
     /* Currently, no changes to optimize the function.  */
     setup_function_info (result, fun_id, EUCLIDEAN, "ivec_L2sqr_ref");
@@ -800,6 +1373,18 @@ initialize_group_func_names (char group_id_name[][GROUP_ID_NAME_MAX],
     setup_function_info (result, fun_id, INNER_PRODUCT,
                          "fvec_inner_products_batch_4_ref");
 
+    fun_id = FVEC_INNER_PRODUCT_BATCH_N_REF;
+    setup_function_info (result, fun_id, INNER_PRODUCT,
+                         "fvec_inner_product_batch_N_ref");
+
+    fun_id = FVEC_INNER_PRODUCTS_BY_IDS_REF;
+    setup_function_info (result, fun_id, INNER_PRODUCT,
+                         "fvec_inner_products_by_ids_ref");
+
+    fun_id = FVEC_INNER_PRODUCTS_BLOCKED_REF;
+    setup_function_info (result, fun_id, INNER_PRODUCT,
+                         "fvec_inner_products_blocked_ref");
+
     fun_id = IVEC_INNER_PRODUCT_REF;
     /* Attempts to optimize have not improved this function.  */
     setup_function_info (result, fun_id, INNER_PRODUCT,
@@ -811,14 +1396,34 @@ initialize_group_func_names (char group_id_name[][GROUP_ID_NAME_MAX],
     setup_function_info (result, fun_id, MANHATTAN,
                          "fvec_L1_ref");
 
+    fun_id = FVEC_LINF_REF;
+    setup_function_info (result, fun_id, MANHATTAN,
+                         "fvec_Linf_ref");
+
+    fun_id = FVEC_MADD_REF;
+    setup_function_info (result, fun_id, MANHATTAN,
+                         "fvec_madd_ref");
+
+    fun_id = FVEC_MADD_AND_ARGMIN_REF;
+    setup_function_info (result, fun_id, MANHATTAN,
+                         "fvec_madd_and_argmin_ref");
+
     fun_id = COSINE_DISTANCE_REF;
     setup_function_info (result, fun_id, COSINE,
                          "cosine_distance_ref");
 
+    fun_id = COSINE_DISTANCES_BLOCKED_REF;
+    setup_function_info (result, fun_id, COSINE,
+                         "cosine_distances_blocked_ref");
+
     fun_id = HAMMING_DISTANCE_REF;
     setup_function_info (result, fun_id, HAMMING,
                          "hamming_distance_ref");
 
+    fun_id = BITPLANE_DOT_NY_REF;
+    setup_function_info (result, fun_id, HAMMING,
+                         "bitplane_dot_ny_ref");
+
     fun_id = JACCARD_DISTANCE_REF;
     setup_function_info (result, fun_id, JACCARD,
                          "jaccard_distance_ref");
@@ -1184,6 +1789,42 @@ release_data_char (uint8_t **c1, uint8_t **c2)
     return;
 }
 
+void
+load_data_bitplanes (size_t size, size_t nplanes, size_t ny, uint8_t **planes,
+                     uint8_t **codes)
+{
+    using namespace std;
+    uint8_t *pp;
+    uint8_t *cp;
+
+    *planes = (uint8_t *)malloc(nplanes * size * sizeof(uint8_t));
+    *codes = (uint8_t *)malloc(ny * size * sizeof(uint8_t));
+
+    if (!(*planes) || !(*codes)) {
+        cout << "ERROR, failed to allocat the bit plane data arrays.\n";
+        free (*planes);
+        free (*codes);
+        exit (-1);
+    }
+    pp = *planes;
+    cp = *codes;
+
+    for (size_t p = 0; p < nplanes; p++)
+        for (size_t i = 0; i < size; i++)
+            pp[p * size + i] = (uint8_t) (i * (2 * p + 3) + p);
+
+    for (size_t j = 0; j < ny; j++)
+        for (size_t i = 0; i < size; i++)
+            cp[j * size + i] = (uint8_t) ((i + 1) * (j + 7));
+}
+
+void
+release_data_bitplanes (uint8_t **planes, uint8_t **codes)
+{
+    free (*planes);
+    free (*codes);
+}
+
 int
 load_data_float (size_t d, float **x, float **y0, float **y1, float **y2,
                  float **y3)
@@ -1254,6 +1895,86 @@ release_data_float (float **x, float **y0, float **y1,
     return;
 }
 
+int
+load_data_batch (size_t d, size_t n, float **db, int64_t **ids)
+{
+    using namespace std;
+    float *dbp;
+    int64_t *idsp;
+
+    /* Database of n contiguous vectors of dimension d for the batch_N
+       tests, plus a permutation of the vector ids for the gathered form of
+       the functions.  */
+    *db = (float *) malloc(n * d * sizeof(float));
+    *ids = (int64_t *) malloc(n * sizeof(int64_t));
+
+    if (!(*db) || !(*ids)) {
+        cout << "ERROR, failed to allocat the batch database arrays.\n";
+        free (*db);
+        free (*ids);
+        exit (-1);
+    }
+
+    dbp = *db;
+    idsp = *ids;
+
+    for (size_t j = 0; j < n; j++) {
+        for (size_t i = 0; i < d; i++)
+            dbp[j * d + i] = (float) ((i * (j + 3)) % 101) + 0.5 * j;
+
+        /* n is a power of 2, an odd multiplier gives a permutation.  */
+        idsp[j] = (j * 7 + 3) % n;
+    }
+
+    return 0;
+}
+
+void
+release_data_batch (float **db, int64_t **ids)
+{
+    free (*db);
+    free (*ids);
+}
+
+int
+load_data_kmeans (size_t d, size_t n, size_t k, float **x, float **centroids)
+{
+    using namespace std;
+    float *xp, *cp;
+
+    /* The vectors and the centroids follow different patterns so the
+       distances are of the same order as the norms.  */
+    *x = (float *) malloc(n * d * sizeof(float));
+    *centroids = (float *) malloc(k * d * sizeof(float));
+
+    if (!(*x) || !(*centroids)) {
+        cout << "ERROR, failed to allocat the kmeans data arrays.\n";
+        free (*x);
+        free (*centroids);
+        exit (-1);
+    }
+
+    xp = *x;
+    cp = *centroids;
+
+    for (size_t j = 0; j < n; j++)
+        for (size_t i = 0; i < d; i++)
+            xp[j * d + i] = (float) ((i * (j + 3)) % 101) + 0.5 * j;
+
+    for (size_t j = 0; j < k; j++)
+        for (size_t i = 0; i < d; i++)
+            cp[j * d + i] = (float) (((i + 7) * (j + 5)) % 97) + 1.25 * j;
+
+    return 0;
+}
+
+void
+release_data_kmeans (float **x, float **centroids)
+{
+    free (*x);
+    free (*centroids);
+}
+
 void
 load_data_int8 (size_t d, int8_t **x, int8_t **y)
 {
@@ -21,6 +21,7 @@
 #include <iostream>
 #include <fstream>
 #include "main-tests.h"
+#include "main-bench.h"
 #include <unistd.h>
 
 #define VERSION    "0.6"
@@ -69,10 +70,18 @@ int load_data_float (size_t d, float **x, float **y0, float **y1, float **y2,
                      float **y3);
 void release_data_float (float **x, float **y0, float **y1, float **y2,
                          float **y3, float *dis);
+int load_data_batch (size_t d, size_t n, float **db, int64_t **ids);
+void release_data_batch (float **db, int64_t **ids);
+int load_data_kmeans (size_t d, size_t n, size_t k, float **x,
+                      float **centroids);
+void release_data_kmeans (float **x, float **centroids);
 void load_data_int8 (size_t d, int8_t **x, int8_t **y);
 void release_data_int8 (int8_t **x, int8_t **y);
 void load_data_char (size_t d, uint8_t **c1, uint8_t **c2);
 void release_data_char (uint8_t **c1, uint8_t **c2);
+void load_data_bitplanes (size_t size, size_t nplanes, size_t ny,
+                          uint8_t **planes, uint8_t **codes);
+void release_data_bitplanes (uint8_t **planes, uint8_t **codes);
 
 /* Call each function NUM_RUNS to get a reasonably large execution time for
    the function.  Goal is to have the number of runs large enough relative
@@ -89,7 +98,11 @@ struct flags_t {
     bool run_excluded = false;
     bool verbose_output = false;
     bool run_subset = false;
+    bool run_custom = false;
     bool run_code_version[NUM_CODE_VERSIONS];
+    bool run_bench[BENCH_ID_MAX] = {};
+    bool run_any_bench = false;
+    struct bench_params_t bench_params;
 };
 
 /* The indexes to access the group names in group_id_name */
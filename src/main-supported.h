@@ -25,6 +25,20 @@
 #define VEC_POPCNT_SUPPORTED 1   /* 0 - not supported, Power 7;
                                     1 - supported Power 8 and newer.  */
 
+#define LIBRARY_INTRINSIC_CODE 0 /* Code version called by the library classes
+                                    (KMeans, the indexes) through
+                                    distances/distances.h.
+                                    0 - Use the optimized _ppc versions.
+                                    1 - Use the intrinsic _ippc versions.  */
+
+#define IO_URING_SUPPORTED 0     /* Read the sectors of the disk indexes with
+                                    io_uring, requires liburing and -luring
+                                    in the LDFLAGS of the Makefile.
+                                    0 - Use a pool of pread threads.
+                                    1 - Use io_uring, Linux only, falls back
+                                        to pread when the ring cannot be
+                                        created.  */
+
 #define GET_TIME_OF_DAY 0        /* Use the gettimeofday call to measure the
                                     time.  The xlc 16 compiler does not
                                     support the chrono library.
@@ -16,6 +16,11 @@
 
 #include "main-tests.h"
 #include "main-supported.h"
+#include "utils/blocked_layout.h"
+#include "clustering/kmeans.h"
+
+#include <cstdlib>
+#include <cstring>
 
 void
 check_fun_id (unsigned int fun_id)
@@ -444,33 +449,50 @@ test_fvec_L2sqr_batch_4_ref (struct results_data_t* distance_results,
 }
 
 int
-test_ivec_L2sqr_ref (struct results_data_t* distance_results,
-                     unsigned int fun_id, unsigned int array_index,
-                     unsigned int num_runs,
-                     bool run_code_version[NUM_CODE_VERSIONS], const int8_t* x,
-                     const int8_t* y, size_t d)
+test_fvec_L2sqr_batch_N_ref (struct results_data_t* distance_results,
+                             unsigned int fun_id, unsigned int array_index,
+                             unsigned int num_runs,
+                             bool run_code_version[NUM_CODE_VERSIONS],
+                             const float* x, const float* db,
+                             const int64_t* ids, size_t d)
 {
-
+    /* Each run evaluates all of the supported batch sizes: N = 16 and
+       N = 4 with the array of pointers form, N = 8 and N = 2 with the index
+       list form.  That is 30 distances to the BATCH_N_DB_SIZE vectors in db,
+       their sum is the recorded result.  */
     unsigned long long int  t0;
     unsigned long long int  t1;
-    int32_t result;
-    int i;
+    const float* yp[BATCH_N_DB_SIZE];
+    float dis[2 * BATCH_N_DB_SIZE];
+    float result;
+    int i, j;
 
     check_fun_id (fun_id);
 
+    for (j = 0; j < BATCH_N_DB_SIZE; j++)
+        yp[j] = db + j * d;
+
     /* Test the original code */
     t0 = get_time();
+    result = 0;
 
     for (i = 0; i < num_runs; i++)
-        result = base::ivec_L2sqr_ref (x, y, d);
+    {
+        base::fvec_L2sqr_batch_N_ref<16> (x, yp, d, dis);
+        base::fvec_L2sqr_batch_N_ref<8> (x, db, ids, d, dis + 16);
+        base::fvec_L2sqr_batch_N_ref<4> (x, yp + 4, d, dis + 24);
+        base::fvec_L2sqr_batch_N_ref<2> (x, db, ids + 8, d, dis + 28);
 
+        for (j = 0; j < 30; j++)
+            result += dis[j];
+    }
     t1 = get_time();
 
     record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
                  distance_results);
 
-    record_int_result (fun_id, array_index, CODE_VER_ORIG, result,
-                       distance_results);
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
 
     /* Test the ppc version of the code */
     if (run_code_version[RUN_OPTIMIZED_CODE])
@@ -479,15 +501,24 @@ test_ivec_L2sqr_ref (struct results_data_t* distance_results,
         t0 = get_time();
 
         for (i = 0; i < num_runs; i++)
-            result = powerpc::ivec_L2sqr_ref_ppc (x, y, d);
+        {
+            powerpc::fvec_L2sqr_batch_N_ref_ppc<16> (x, yp, d, dis);
+            powerpc::fvec_L2sqr_batch_N_ref_ppc<8> (x, db, ids, d, dis + 16);
+            powerpc::fvec_L2sqr_batch_N_ref_ppc<4> (x, yp + 4, d, dis + 24);
+            powerpc::fvec_L2sqr_batch_N_ref_ppc<2> (x, db, ids + 8, d,
+                                                    dis + 28);
+
+            for (j = 0; j < 30; j++)
+                result += dis[j];
+        }
 
         t1 = get_time();
 
         record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
                      distance_results);
 
-        record_int_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
-                           distance_results);
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
     }
 
     /* Test the ppc intrinsic version of the code */
@@ -497,33 +528,47 @@ test_ivec_L2sqr_ref (struct results_data_t* distance_results,
         t0 = get_time();
 
         for (i = 0; i < num_runs; i++)
-            result = powerpc::ivec_L2sqr_ref_ippc (x, y, d);
+        {
+            powerpc::fvec_L2sqr_batch_N_ref_ippc<16> (x, yp, d, dis);
+            powerpc::fvec_L2sqr_batch_N_ref_ippc<8> (x, db, ids, d, dis + 16);
+            powerpc::fvec_L2sqr_batch_N_ref_ippc<4> (x, yp + 4, d, dis + 24);
+            powerpc::fvec_L2sqr_batch_N_ref_ippc<2> (x, db, ids + 8, d,
+                                                     dis + 28);
+
+            for (j = 0; j < 30; j++)
+                result += dis[j];
+        }
 
         t1 = get_time();
 
         record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
                      distance_results);
 
-        record_int_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
-                           distance_results);
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
     }
 
     return 0;
 }
 
-/**********  Inner product tests *************/
 int
-test_fvec_inner_product_ref (struct results_data_t* inner_prod_result,
-                             unsigned int fun_id, unsigned int array_index,
-                             unsigned int num_runs,
-                             bool run_code_version[NUM_CODE_VERSIONS],
-                             const float* x, const float* y, size_t array_size)
+test_fvec_L2sqr_by_ids_ref (struct results_data_t* distance_results,
+                            unsigned int fun_id, unsigned int array_index,
+                            unsigned int num_runs,
+                            bool run_code_version[NUM_CODE_VERSIONS],
+                            const float* x, const float* db,
+                            const int64_t* ids, size_t d)
 {
-
+    /* Each run gathers the BATCH_N_DB_SIZE vectors of db in the order of
+       ids, then all but the last three, which leaves a partial group of
+       four.  The sum of the distances is the recorded result.  */
     unsigned long long int  t0;
     unsigned long long int  t1;
+    const size_t n1 = BATCH_N_DB_SIZE - 3;
+    float dis[2 * BATCH_N_DB_SIZE];
     float result;
     int i;
+    size_t j;
 
     check_fun_id (fun_id);
 
@@ -532,90 +577,121 @@ test_fvec_inner_product_ref (struct results_data_t* inner_prod_result,
     result = 0;
 
     for (i = 0; i < num_runs; i++)
-        result += base::fvec_inner_product_ref(x, y, (size_t)array_size);
+    {
+        base::fvec_L2sqr_by_ids_ref (dis, x, db, ids, d, BATCH_N_DB_SIZE,
+                                     BY_IDS_PREFETCH);
+        base::fvec_L2sqr_by_ids_ref (dis + BATCH_N_DB_SIZE, x, db, ids, d, n1,
+                                     BY_IDS_PREFETCH);
 
+        for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+            result += dis[j];
+    }
     t1 = get_time();
 
     record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
-                 inner_prod_result);
+                 distance_results);
+
     record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
-                         inner_prod_result);
+                         distance_results);
 
     /* Test the ppc version of the code */
     if (run_code_version[RUN_OPTIMIZED_CODE])
     {
-        t0 = get_time();
         result = 0;
+        t0 = get_time();
 
         for (i = 0; i < num_runs; i++)
-            result += powerpc::fvec_inner_product_ref_ppc (x, y,
-                                                           (size_t)array_size);
+        {
+            powerpc::fvec_L2sqr_by_ids_ref_ppc (dis, x, db, ids, d,
+                                                BATCH_N_DB_SIZE,
+                                                BY_IDS_PREFETCH);
+            powerpc::fvec_L2sqr_by_ids_ref_ppc (dis + BATCH_N_DB_SIZE, x, db,
+                                                ids, d, n1, BY_IDS_PREFETCH);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
 
         t1 = get_time();
 
         record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
-                     inner_prod_result);
+                     distance_results);
+
         record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
-                             inner_prod_result);
+                             distance_results);
     }
 
     /* Test the ppc intrinsic version of the code */
     if (run_code_version[RUN_INTRINSIC_CODE])
     {
-        t0 = get_time();
         result = 0;
+        t0 = get_time();
 
         for (i = 0; i < num_runs; i++)
-            result += powerpc::fvec_inner_product_ref_ippc (x, y,
-                                                           (size_t)array_size);
+        {
+            powerpc::fvec_L2sqr_by_ids_ref_ippc (dis, x, db, ids, d,
+                                                 BATCH_N_DB_SIZE,
+                                                 BY_IDS_PREFETCH);
+            powerpc::fvec_L2sqr_by_ids_ref_ippc (dis + BATCH_N_DB_SIZE, x, db,
+                                                 ids, d, n1, BY_IDS_PREFETCH);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
 
         t1 = get_time();
 
         record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
-                     inner_prod_result);
+                     distance_results);
+
         record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
-                             inner_prod_result);
+                             distance_results);
     }
 
     return 0;
 }
 
 int
-test_fvec_inner_product_batch_4_ref (struct results_data_t* distance_results,
-                                     unsigned int fun_id,
-                                     unsigned int array_index,
-                                     unsigned int num_runs,
-                                     bool run_code_version[NUM_CODE_VERSIONS],
-                                     const float* x, const float* y0,
-                                     const float* y1, const float* y2,
-                                     const float* y3, const size_t d,
-                                     float& dp0, float& dp1, float& dp2,
-                                     float& dp3)
+test_fvec_L2sqr_blocked_ref (struct results_data_t* distance_results,
+                             unsigned int fun_id, unsigned int array_index,
+                             unsigned int num_runs,
+                             bool run_code_version[NUM_CODE_VERSIONS],
+                             const float* x, const float* db, size_t d)
 {
-
+    /* The BATCH_N_DB_SIZE vectors of db are stored in the blocked layout of
+       BLOCKED_SIZE vectors.  Each run computes the squared L2 distances to
+       all of them, then to all but the last three, which leaves a partial
+       block.  The sum of the results is the recorded result.  */
     unsigned long long int  t0;
     unsigned long long int  t1;
+    const size_t n0 = BATCH_N_DB_SIZE;
+    const size_t n1 = BATCH_N_DB_SIZE - 3;
+    float dis[2 * BATCH_N_DB_SIZE];
+    float* dis1 = dis + BATCH_N_DB_SIZE;
+    float* yb;
     float result;
     int i;
+    size_t j;
 
     check_fun_id (fun_id);
 
-    /* Test the original code */
-
-    dp0 = 0;
-    dp1 = 0;
-    dp2 = 0;
-    dp3 = 0;
+    yb = (float *) malloc (vector_search::blocked_size (BATCH_N_DB_SIZE, d,
+                                                        BLOCKED_SIZE)
+                           * sizeof(float));
+    vector_search::fvec_to_blocked (yb, db, d, BATCH_N_DB_SIZE, BLOCKED_SIZE);
 
+    /* Test the original code */
     t0 = get_time();
     result = 0;
 
     for (i = 0; i < num_runs; i++)
     {
-        base::fvec_inner_product_batch_4_ref (x, y0, y1, y2, y3, d, dp0, dp1,
-                                              dp2, dp3);
-	    result += dp0 + dp1 + dp2 + dp3;
-	}
+        base::fvec_L2sqr_blocked_ref<BLOCKED_SIZE> (dis, x, yb, d, n0);
+        base::fvec_L2sqr_blocked_ref<BLOCKED_SIZE> (dis1, x, yb, d, n1);
+
+        for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+            result += dis[j];
+    }
     t1 = get_time();
 
     record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
@@ -632,9 +708,13 @@ test_fvec_inner_product_batch_4_ref (struct results_data_t* distance_results,
 
         for (i = 0; i < num_runs; i++)
         {
-            powerpc::fvec_inner_product_batch_4_ref_ppc (x, y0, y1, y2, y3, d,
-                                                         dp0, dp1, dp2, dp3);
-            result += dp0 + dp1 + dp2 + dp3;
+            powerpc::fvec_L2sqr_blocked_ref_ppc<BLOCKED_SIZE> (dis, x, yb, d,
+                                                               n0);
+            powerpc::fvec_L2sqr_blocked_ref_ppc<BLOCKED_SIZE> (dis1, x, yb, d,
+                                                               n1);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
         }
 
         t1 = get_time();
@@ -654,9 +734,13 @@ test_fvec_inner_product_batch_4_ref (struct results_data_t* distance_results,
 
         for (i = 0; i < num_runs; i++)
         {
-            powerpc::fvec_inner_product_batch_4_ref_ippc (x, y0, y1, y2, y3, d,
-                                                          dp0, dp1, dp2, dp3);
-            result += dp0 + dp1 + dp2 + dp3;
+            powerpc::fvec_L2sqr_blocked_ref_ippc<BLOCKED_SIZE> (dis, x, yb, d,
+                                                                n0);
+            powerpc::fvec_L2sqr_blocked_ref_ippc<BLOCKED_SIZE> (dis1, x, yb, d,
+                                                                n1);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
         }
 
         t1 = get_time();
@@ -668,243 +752,284 @@ test_fvec_inner_product_batch_4_ref (struct results_data_t* distance_results,
                              distance_results);
     }
 
+    free (yb);
     return 0;
 }
 
 int
-test_ivec_inner_product_ref (struct results_data_t* distance_results,
+test_fvec_L2sqr_bounded_ref (struct results_data_t* distance_results,
                              unsigned int fun_id, unsigned int array_index,
                              unsigned int num_runs,
                              bool run_code_version[NUM_CODE_VERSIONS],
-                             const int8_t* x, const int8_t* y, size_t d)
-{
+                             const float* x, const float* y, size_t d) {
 
     unsigned long long int  t0;
     unsigned long long int  t1;
-    int32_t result;
+    float result, threshold;
     int i;
 
     check_fun_id (fun_id);
 
+    /* Set the threshold to half of the distance so the functions abandon
+       part way through the vector once d spans several blocks.  */
+    threshold = 0.5 * base::fvec_L2sqr_ref(x, y, d);
+
     /* Test the original code */
     t0 = get_time();
+    result = 0;
 
-    for (i = 0; i < num_runs; i++)
-        result = base::ivec_inner_product_ref (x, y, d);
-
+    for (i = 0; i < num_runs; i++) {
+        result += base::fvec_L2sqr_bounded_ref(x, y, d, threshold);
+    }
     t1 = get_time();
 
     record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
                  distance_results);
-
-    record_int_result (fun_id, array_index, CODE_VER_ORIG, result,
-                       distance_results);
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
 
     /* Test the ppc version of the code */
     if (run_code_version[RUN_OPTIMIZED_CODE])
     {
-        result = 0;
         t0 = get_time();
+        result = 0;
 
         for (i = 0; i < num_runs; i++)
-            result = powerpc::ivec_inner_product_ref_ppc (x, y, d);
+            result += powerpc::fvec_L2sqr_bounded_ref_ppc (x, y, d,
+                                                           threshold);
 
         t1 = get_time();
 
         record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
                      distance_results);
-
-        record_int_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
-                           distance_results);
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
     }
 
-    /* Test the ppc intrinsic version of the code */
+    /* Test the intrinsic ppc version of the code */
     if (run_code_version[RUN_INTRINSIC_CODE])
     {
-        result = 0;
         t0 = get_time();
+        result = 0;
 
         for (i = 0; i < num_runs; i++)
-            result = powerpc::ivec_inner_product_ref_ippc (x, y, d);
+            result += powerpc::fvec_L2sqr_bounded_ref_ippc (x, y, d,
+                                                            threshold);
 
         t1 = get_time();
 
         record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
                      distance_results);
-
-        record_int_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
-                           distance_results);
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
     }
 
     return 0;
 }
 
-/**********  Manhattan distance test *************/
-
-int 
-test_fvec_L1_ref (struct results_data_t* distance_results,
-                  unsigned int fun_id, unsigned int array_index,
-                  unsigned int num_runs,
-                  bool run_code_version[NUM_CODE_VERSIONS],
-                  const float* x, const float* y, size_t d)
-{
+int
+test_assign_to_nearest_ref (struct results_data_t* distance_results,
+                            unsigned int fun_id, unsigned int array_index,
+                            unsigned int num_runs,
+                            bool run_code_version[NUM_CODE_VERSIONS],
+                            const float* x, size_t n, const float* centroids,
+                            size_t k, size_t d) {
 
     unsigned long long int  t0;
     unsigned long long int  t1;
     float result;
-    int i;
+    int64_t *ids;
+    float *dists;
+    unsigned int i, runs;
 
-    //std::cout<< num_runs << "\t"<< *x <<"\t" << *y << d << std::endl;
     check_fun_id (fun_id);
 
+    ids = (int64_t *) malloc (n * sizeof(int64_t));
+    dists = (float *) malloc (n * sizeof(float));
+    if (!ids || !dists) {
+        std::cout << "ERROR, failed to allocate the assign_to_nearest output arrays.\n";
+        exit (-1);
+    }
+
+    runs = num_runs / ASSIGN_RUNS_DIVISOR;
+    if (runs == 0)
+        runs = 1;
+
+    /* The result is the sum of the distances to the nearest centroids.  The
+       nearest centroid ids are not compared, ties may be broken differently
+       by the rounding of the fused versions.  */
+
     /* Test the original code */
     t0 = get_time();
 
-    for (i = 0; i < num_runs; i++)
-        result = base::fvec_L1_ref (x, y, d);
+    for (i = 0; i < runs; i++)
+        base::assign_to_nearest_ref (x, n, centroids, k, d, ids, dists);
 
     t1 = get_time();
 
+    result = 0;
+    for (size_t j = 0; j < n; j++)
+        result += dists[j];
+
     record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
                  distance_results);
-
     record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
-                       distance_results);
+                         distance_results);
 
     /* Test the ppc version of the code */
     if (run_code_version[RUN_OPTIMIZED_CODE])
     {
-        result = 0;
         t0 = get_time();
 
-        for (i = 0; i < num_runs; i++)
-            result = powerpc::fvec_L1_ref_ppc (x, y, d);
+        for (i = 0; i < runs; i++)
+            powerpc::assign_to_nearest_ref_ppc (x, n, centroids, k, d, ids,
+                                                dists);
 
         t1 = get_time();
 
+        result = 0;
+        for (size_t j = 0; j < n; j++)
+            result += dists[j];
+
         record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
                      distance_results);
-
         record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
                              distance_results);
     }
 
-    /* Test the ppc intrinsic version of the code */
+    /* Test the intrinsic ppc version of the code */
     if (run_code_version[RUN_INTRINSIC_CODE])
     {
-        result = 0;
         t0 = get_time();
 
-        for (i = 0; i < num_runs; i++)
-            result = powerpc::fvec_L1_ref_ippc (x, y, d);
+        for (i = 0; i < runs; i++)
+            powerpc::assign_to_nearest_ref_ippc (x, n, centroids, k, d, ids,
+                                                 dists);
 
         t1 = get_time();
 
+        result = 0;
+        for (size_t j = 0; j < n; j++)
+            result += dists[j];
+
         record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
                      distance_results);
-
         record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
                              distance_results);
     }
 
+    free (ids);
+    free (dists);
     return 0;
 }
 
-/**********  Cosine distance test *************/
-
-int 
-test_cosine_distance_ref (struct results_data_t* distance_results,
-                          unsigned int fun_id, unsigned int array_index,
-                          unsigned int num_runs,
-                          bool run_code_version[NUM_CODE_VERSIONS],
-                          const float* x, const float* y, size_t d)
-{
+int
+test_kmeans_minibatch_ref (struct results_data_t* distance_results,
+                           unsigned int fun_id, unsigned int array_index,
+                           bool run_code_version[NUM_CODE_VERSIONS],
+                           const float* x, size_t n, size_t d) {
 
     unsigned long long int  t0;
     unsigned long long int  t1;
     float result;
-    int i;
+    int64_t *ids;
+    float *dists;
 
-    //std::cout<< num_runs << "\t"<< *x <<"\t" << *y << d << std::endl;
     check_fun_id (fun_id);
 
-    /* Test the original code */
-    t0 = get_time();
+    /* The mini-batches see fewer vectors than there are centroids, most
+       centroids are still empty at the end of the iterations.  The training
+       must split them and return the objective of the final centroids on
+       the whole training set.  The original version records the objective
+       returned by train, the other versions recompute it with their
+       assign_to_nearest kernel.  The training runs once, it is the
+       termination that is tested.  */
+    vector_search::KMeansParams params;
 
-    for (i = 0; i < num_runs; i++)
-        result = base::cosine_distance_ref (x, y, d);
+    params.niter = KMEANS_NITER;
+    params.batch_size = KMEANS_BATCH_SIZE;
+
+    vector_search::KMeans kmeans (d, KMEANS_NUM_CENTROIDS, params);
 
+    t0 = get_time();
+    result = kmeans.train (n, x);
     t1 = get_time();
 
     record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
                  distance_results);
-
     record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
-                       distance_results);
+                         distance_results);
+
+    ids = (int64_t *) malloc (n * sizeof(int64_t));
+    dists = (float *) malloc (n * sizeof(float));
+    if (!ids || !dists) {
+        std::cout << "ERROR, failed to allocate the kmeans_minibatch output arrays.\n";
+        exit (-1);
+    }
 
     /* Test the ppc version of the code */
     if (run_code_version[RUN_OPTIMIZED_CODE])
     {
-        result = 0;
         t0 = get_time();
-
-        for (i = 0; i < num_runs; i++)
-            result = powerpc::cosine_distance_ref_ppc (x, y, d);
-
+        powerpc::assign_to_nearest_ref_ppc (x, n, kmeans.centroids.data(),
+                                            KMEANS_NUM_CENTROIDS, d, ids,
+                                            dists);
         t1 = get_time();
 
+        result = 0;
+        for (size_t j = 0; j < n; j++)
+            result += dists[j];
+
         record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
                      distance_results);
-
         record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
                              distance_results);
     }
 
-    /* Test the ppc intrinsic version of the code */
+    /* Test the intrinsic ppc version of the code */
     if (run_code_version[RUN_INTRINSIC_CODE])
     {
-        result = 0;
         t0 = get_time();
-
-        for (i = 0; i < num_runs; i++)
-            result = powerpc::cosine_distance_ref_ippc (x, y, d);
-
+        powerpc::assign_to_nearest_ref_ippc (x, n, kmeans.centroids.data(),
+                                             KMEANS_NUM_CENTROIDS, d, ids,
+                                             dists);
         t1 = get_time();
 
+        result = 0;
+        for (size_t j = 0; j < n; j++)
+            result += dists[j];
+
         record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
                      distance_results);
-
         record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
                              distance_results);
     }
 
+    free (ids);
+    free (dists);
     return 0;
 }
 
-/**********  Hamming distance test *************/
-
-int 
-test_hamming_distance_ref (struct results_data_t* distance_results,
-                           unsigned int fun_id, unsigned int array_index,
-                           unsigned int num_runs,
-                           bool run_code_version[NUM_CODE_VERSIONS],
-                           const uint8_t* vec1, const uint8_t* vec2,
-                           size_t size)
+int
+test_ivec_L2sqr_ref (struct results_data_t* distance_results,
+                     unsigned int fun_id, unsigned int array_index,
+                     unsigned int num_runs,
+                     bool run_code_version[NUM_CODE_VERSIONS], const int8_t* x,
+                     const int8_t* y, size_t d)
 {
 
     unsigned long long int  t0;
     unsigned long long int  t1;
-    size_t result;
+    int32_t result;
     int i;
 
-    //std::cout<< num_runs << "\t"<< *x <<"\t" << *y << d << std::endl;
     check_fun_id (fun_id);
 
     /* Test the original code */
     t0 = get_time();
 
     for (i = 0; i < num_runs; i++)
-        result = base::hamming_distance_ref (vec1, vec2, size);
+        result = base::ivec_L2sqr_ref (x, y, d);
 
     t1 = get_time();
 
@@ -921,11 +1046,8 @@ test_hamming_distance_ref (struct results_data_t* distance_results,
         t0 = get_time();
 
         for (i = 0; i < num_runs; i++)
-#if VEC_POPCNT_SUPPORTED
-            result = powerpc::hamming_distance_ref_ppc (vec1, vec2, size);
-#else
-            result = base::hamming_distance_ref (vec1, vec2, size);
-#endif
+            result = powerpc::ivec_L2sqr_ref_ppc (x, y, d);
+
         t1 = get_time();
 
         record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
@@ -942,11 +1064,7 @@ test_hamming_distance_ref (struct results_data_t* distance_results,
         t0 = get_time();
 
         for (i = 0; i < num_runs; i++)
-#if VEC_POPCNT_SUPPORTED
-            result = powerpc::hamming_distance_ref_ippc (vec1, vec2, size);
-#else
-            result = base::hamming_distance_ref (vec1, vec2, size);
-#endif
+            result = powerpc::ivec_L2sqr_ref_ippc (x, y, d);
 
         t1 = get_time();
 
@@ -960,6 +1078,1229 @@ test_hamming_distance_ref (struct results_data_t* distance_results,
     return 0;
 }
 
+/**********  Inner product tests *************/
+int
+test_fvec_inner_product_ref (struct results_data_t* inner_prod_result,
+                             unsigned int fun_id, unsigned int array_index,
+                             unsigned int num_runs,
+                             bool run_code_version[NUM_CODE_VERSIONS],
+                             const float* x, const float* y, size_t array_size)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    float result;
+    int i;
+
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+    t0 = get_time();
+    result = 0;
+
+    for (i = 0; i < num_runs; i++)
+        result += base::fvec_inner_product_ref(x, y, (size_t)array_size);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 inner_prod_result);
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         inner_prod_result);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        t0 = get_time();
+        result = 0;
+
+        for (i = 0; i < num_runs; i++)
+            result += powerpc::fvec_inner_product_ref_ppc (x, y,
+                                                           (size_t)array_size);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     inner_prod_result);
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             inner_prod_result);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        t0 = get_time();
+        result = 0;
+
+        for (i = 0; i < num_runs; i++)
+            result += powerpc::fvec_inner_product_ref_ippc (x, y,
+                                                           (size_t)array_size);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     inner_prod_result);
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             inner_prod_result);
+    }
+
+    return 0;
+}
+
+int
+test_fvec_inner_product_batch_4_ref (struct results_data_t* distance_results,
+                                     unsigned int fun_id,
+                                     unsigned int array_index,
+                                     unsigned int num_runs,
+                                     bool run_code_version[NUM_CODE_VERSIONS],
+                                     const float* x, const float* y0,
+                                     const float* y1, const float* y2,
+                                     const float* y3, const size_t d,
+                                     float& dp0, float& dp1, float& dp2,
+                                     float& dp3)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    float result;
+    int i;
+
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+
+    dp0 = 0;
+    dp1 = 0;
+    dp2 = 0;
+    dp3 = 0;
+
+    t0 = get_time();
+    result = 0;
+
+    for (i = 0; i < num_runs; i++)
+    {
+        base::fvec_inner_product_batch_4_ref (x, y0, y1, y2, y3, d, dp0, dp1,
+                                              dp2, dp3);
+	    result += dp0 + dp1 + dp2 + dp3;
+	}
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_product_batch_4_ref_ppc (x, y0, y1, y2, y3, d,
+                                                         dp0, dp1, dp2, dp3);
+            result += dp0 + dp1 + dp2 + dp3;
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_product_batch_4_ref_ippc (x, y0, y1, y2, y3, d,
+                                                          dp0, dp1, dp2, dp3);
+            result += dp0 + dp1 + dp2 + dp3;
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    return 0;
+}
+
+int
+test_fvec_inner_product_batch_N_ref (struct results_data_t* distance_results,
+                                     unsigned int fun_id,
+                                     unsigned int array_index,
+                                     unsigned int num_runs,
+                                     bool run_code_version[NUM_CODE_VERSIONS],
+                                     const float* x, const float* db,
+                                     const int64_t* ids, size_t d)
+{
+    /* Each run evaluates all of the supported batch sizes: N = 16 and
+       N = 4 with the array of pointers form, N = 8 and N = 2 with the index
+       list form.  That is 30 distances to the BATCH_N_DB_SIZE vectors in db,
+       their sum is the recorded result.  */
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    const float* yp[BATCH_N_DB_SIZE];
+    float dis[2 * BATCH_N_DB_SIZE];
+    float result;
+    int i, j;
+
+    check_fun_id (fun_id);
+
+    for (j = 0; j < BATCH_N_DB_SIZE; j++)
+        yp[j] = db + j * d;
+
+    /* Test the original code */
+    t0 = get_time();
+    result = 0;
+
+    for (i = 0; i < num_runs; i++)
+    {
+        base::fvec_inner_product_batch_N_ref<16> (x, yp, d, dis);
+        base::fvec_inner_product_batch_N_ref<8> (x, db, ids, d, dis + 16);
+        base::fvec_inner_product_batch_N_ref<4> (x, yp + 4, d, dis + 24);
+        base::fvec_inner_product_batch_N_ref<2> (x, db, ids + 8, d, dis + 28);
+
+        for (j = 0; j < 30; j++)
+            result += dis[j];
+    }
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_product_batch_N_ref_ppc<16> (x, yp, d, dis);
+            powerpc::fvec_inner_product_batch_N_ref_ppc<8> (x, db, ids, d,
+                                                            dis + 16);
+            powerpc::fvec_inner_product_batch_N_ref_ppc<4> (x, yp + 4, d,
+                                                            dis + 24);
+            powerpc::fvec_inner_product_batch_N_ref_ppc<2> (x, db, ids + 8, d,
+                                                            dis + 28);
+
+            for (j = 0; j < 30; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_product_batch_N_ref_ippc<16> (x, yp, d, dis);
+            powerpc::fvec_inner_product_batch_N_ref_ippc<8> (x, db, ids, d,
+                                                             dis + 16);
+            powerpc::fvec_inner_product_batch_N_ref_ippc<4> (x, yp + 4, d,
+                                                             dis + 24);
+            powerpc::fvec_inner_product_batch_N_ref_ippc<2> (x, db, ids + 8,
+                                                             d, dis + 28);
+
+            for (j = 0; j < 30; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    return 0;
+}
+
+int
+test_fvec_inner_products_by_ids_ref (struct results_data_t* distance_results,
+                                     unsigned int fun_id,
+                                     unsigned int array_index,
+                                     unsigned int num_runs,
+                                     bool run_code_version[NUM_CODE_VERSIONS],
+                                     const float* x, const float* db,
+                                     const int64_t* ids, size_t d)
+{
+    /* Each run gathers the BATCH_N_DB_SIZE vectors of db in the order of
+       ids, then all but the last three, which leaves a partial group of
+       four.  The sum of the distances is the recorded result.  */
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    const size_t n1 = BATCH_N_DB_SIZE - 3;
+    float dis[2 * BATCH_N_DB_SIZE];
+    float result;
+    int i;
+    size_t j;
+
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+    t0 = get_time();
+    result = 0;
+
+    for (i = 0; i < num_runs; i++)
+    {
+        base::fvec_inner_products_by_ids_ref (dis, x, db, ids, d,
+                                              BATCH_N_DB_SIZE, BY_IDS_PREFETCH);
+        base::fvec_inner_products_by_ids_ref (dis + BATCH_N_DB_SIZE, x, db, ids,
+                                              d, n1, BY_IDS_PREFETCH);
+
+        for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+            result += dis[j];
+    }
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_products_by_ids_ref_ppc (dis, x, db, ids, d,
+                                                         BATCH_N_DB_SIZE,
+                                                         BY_IDS_PREFETCH);
+            powerpc::fvec_inner_products_by_ids_ref_ppc (dis + BATCH_N_DB_SIZE,
+                                                         x, db, ids, d, n1,
+                                                         BY_IDS_PREFETCH);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_products_by_ids_ref_ippc (dis, x, db, ids, d,
+                                                          BATCH_N_DB_SIZE,
+                                                          BY_IDS_PREFETCH);
+            powerpc::fvec_inner_products_by_ids_ref_ippc (dis + BATCH_N_DB_SIZE,
+                                                          x, db, ids, d, n1,
+                                                          BY_IDS_PREFETCH);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    return 0;
+}
+
+int
+test_fvec_inner_products_blocked_ref (struct results_data_t* distance_results,
+                                      unsigned int fun_id,
+                                      unsigned int array_index,
+                                      unsigned int num_runs,
+                                      bool run_code_version[NUM_CODE_VERSIONS],
+                                      const float* x, const float* db, size_t d)
+{
+    /* The BATCH_N_DB_SIZE vectors of db are stored in the blocked layout of
+       BLOCKED_SIZE vectors.  Each run computes the inner products to all of
+       them, then to all but the last three, which leaves a partial block.
+       The sum of the results is the recorded result.  */
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    const size_t n0 = BATCH_N_DB_SIZE;
+    const size_t n1 = BATCH_N_DB_SIZE - 3;
+    float dis[2 * BATCH_N_DB_SIZE];
+    float* dis1 = dis + BATCH_N_DB_SIZE;
+    float* yb;
+    float result;
+    int i;
+    size_t j;
+
+    check_fun_id (fun_id);
+
+    yb = (float *) malloc (vector_search::blocked_size (BATCH_N_DB_SIZE, d,
+                                                        BLOCKED_SIZE)
+                           * sizeof(float));
+    vector_search::fvec_to_blocked (yb, db, d, BATCH_N_DB_SIZE, BLOCKED_SIZE);
+
+    /* Test the original code */
+    t0 = get_time();
+    result = 0;
+
+    for (i = 0; i < num_runs; i++)
+    {
+        base::fvec_inner_products_blocked_ref<BLOCKED_SIZE> (dis, x, yb, d, n0);
+        base::fvec_inner_products_blocked_ref<BLOCKED_SIZE> (dis1, x, yb, d,
+                                                             n1);
+
+        for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+            result += dis[j];
+    }
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_products_blocked_ref_ppc<BLOCKED_SIZE> (dis, x,
+                                                                        yb, d,
+                                                                        n0);
+            powerpc::fvec_inner_products_blocked_ref_ppc<BLOCKED_SIZE> (dis1, x,
+                                                                        yb, d,
+                                                                        n1);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::fvec_inner_products_blocked_ref_ippc<BLOCKED_SIZE> (dis, x,
+                                                                         yb, d,
+                                                                         n0);
+            powerpc::fvec_inner_products_blocked_ref_ippc<BLOCKED_SIZE> (dis1,
+                                                                         x, yb,
+                                                                         d, n1);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    free (yb);
+    return 0;
+}
+
+int
+test_ivec_inner_product_ref (struct results_data_t* distance_results,
+                             unsigned int fun_id, unsigned int array_index,
+                             unsigned int num_runs,
+                             bool run_code_version[NUM_CODE_VERSIONS],
+                             const int8_t* x, const int8_t* y, size_t d)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    int32_t result;
+    int i;
+
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < num_runs; i++)
+        result = base::ivec_inner_product_ref (x, y, d);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_int_result (fun_id, array_index, CODE_VER_ORIG, result,
+                       distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::ivec_inner_product_ref_ppc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                           distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::ivec_inner_product_ref_ippc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                           distance_results);
+    }
+
+    return 0;
+}
+
+/**********  Manhattan distance test *************/
+
+int 
+test_fvec_L1_ref (struct results_data_t* distance_results,
+                  unsigned int fun_id, unsigned int array_index,
+                  unsigned int num_runs,
+                  bool run_code_version[NUM_CODE_VERSIONS],
+                  const float* x, const float* y, size_t d)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    float result;
+    int i;
+
+    //std::cout<< num_runs << "\t"<< *x <<"\t" << *y << d << std::endl;
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < num_runs; i++)
+        result = base::fvec_L1_ref (x, y, d);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                       distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::fvec_L1_ref_ppc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::fvec_L1_ref_ippc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    return 0;
+}
+
+int 
+test_fvec_Linf_ref (struct results_data_t* distance_results,
+                    unsigned int fun_id, unsigned int array_index,
+                    unsigned int num_runs,
+                    bool run_code_version[NUM_CODE_VERSIONS],
+                    const float* x, const float* y, size_t d)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    float result;
+    int i;
+
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < num_runs; i++)
+        result = base::fvec_Linf_ref (x, y, d);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                       distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::fvec_Linf_ref_ppc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::fvec_Linf_ref_ippc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    return 0;
+}
+
+int
+test_fvec_madd_ref (struct results_data_t* distance_results,
+                    unsigned int fun_id, unsigned int array_index,
+                    unsigned int num_runs,
+                    bool run_code_version[NUM_CODE_VERSIONS], const float* a,
+                    float bf, const float* b, size_t n)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    float result;
+    float *c;
+    int i;
+
+    check_fun_id (fun_id);
+
+    c = (float *) malloc (n * sizeof(float));
+    if (!c) {
+        std::cout << "ERROR, failed to allocate the fvec_madd output array.\n";
+        exit (-1);
+    }
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < num_runs; i++)
+        base::fvec_madd_ref (n, a, bf, b, c);
+
+    t1 = get_time();
+
+    /* The result is the sum of the output array.  */
+    result = 0;
+    for (size_t k = 0; k < n; k++)
+        result += c[k];
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        memset (c, 0, n * sizeof(float));
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            powerpc::fvec_madd_ref_ppc (n, a, bf, b, c);
+
+        t1 = get_time();
+
+        result = 0;
+        for (size_t k = 0; k < n; k++)
+            result += c[k];
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        memset (c, 0, n * sizeof(float));
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            powerpc::fvec_madd_ref_ippc (n, a, bf, b, c);
+
+        t1 = get_time();
+
+        result = 0;
+        for (size_t k = 0; k < n; k++)
+            result += c[k];
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    free (c);
+    return 0;
+}
+
+int
+test_fvec_madd_and_argmin_ref (struct results_data_t* distance_results,
+                               unsigned int fun_id, unsigned int array_index,
+                               unsigned int num_runs,
+                               bool run_code_version[NUM_CODE_VERSIONS],
+                               const float* a, float bf, const float* b,
+                               size_t n)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    int result;
+    float *c;
+    int i;
+
+    check_fun_id (fun_id);
+
+    c = (float *) malloc (n * sizeof(float));
+    if (!c) {
+        std::cout << "ERROR, failed to allocate the fvec_madd output array.\n";
+        exit (-1);
+    }
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < num_runs; i++)
+        result = base::fvec_madd_and_argmin_ref (n, a, bf, b, c);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_int_result (fun_id, array_index, CODE_VER_ORIG, result,
+                       distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::fvec_madd_and_argmin_ref_ppc (n, a, bf, b, c);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                           distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::fvec_madd_and_argmin_ref_ippc (n, a, bf, b, c);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                           distance_results);
+    }
+
+    free (c);
+    return 0;
+}
+
+/**********  Cosine distance test *************/
+
+int 
+test_cosine_distance_ref (struct results_data_t* distance_results,
+                          unsigned int fun_id, unsigned int array_index,
+                          unsigned int num_runs,
+                          bool run_code_version[NUM_CODE_VERSIONS],
+                          const float* x, const float* y, size_t d)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    float result;
+    int i;
+
+    //std::cout<< num_runs << "\t"<< *x <<"\t" << *y << d << std::endl;
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < num_runs; i++)
+        result = base::cosine_distance_ref (x, y, d);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                       distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::cosine_distance_ref_ppc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+            result = powerpc::cosine_distance_ref_ippc (x, y, d);
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    return 0;
+}
+
+int
+test_cosine_distances_blocked_ref (struct results_data_t* distance_results,
+                                   unsigned int fun_id,
+                                   unsigned int array_index,
+                                   unsigned int num_runs,
+                                   bool run_code_version[NUM_CODE_VERSIONS],
+                                   const float* x, const float* db, size_t d)
+{
+    /* The BATCH_N_DB_SIZE vectors of db are stored in the blocked layout of
+       BLOCKED_SIZE vectors.  Each run computes the cosine distances to all of
+       them, then to all but the last three, which leaves a partial block.
+       The sum of the results is the recorded result.  */
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    const size_t n0 = BATCH_N_DB_SIZE;
+    const size_t n1 = BATCH_N_DB_SIZE - 3;
+    float dis[2 * BATCH_N_DB_SIZE];
+    float* dis1 = dis + BATCH_N_DB_SIZE;
+    float* yb;
+    float result;
+    int i;
+    size_t j;
+
+    check_fun_id (fun_id);
+
+    yb = (float *) malloc (vector_search::blocked_size (BATCH_N_DB_SIZE, d,
+                                                        BLOCKED_SIZE)
+                           * sizeof(float));
+    vector_search::fvec_to_blocked (yb, db, d, BATCH_N_DB_SIZE, BLOCKED_SIZE);
+
+    /* Test the original code */
+    t0 = get_time();
+    result = 0;
+
+    for (i = 0; i < num_runs; i++)
+    {
+        base::cosine_distances_blocked_ref<BLOCKED_SIZE> (dis, x, yb, d, n0);
+        base::cosine_distances_blocked_ref<BLOCKED_SIZE> (dis1, x, yb, d, n1);
+
+        for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+            result += dis[j];
+    }
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_float_result (fun_id, array_index, CODE_VER_ORIG, result,
+                         distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::cosine_distances_blocked_ref_ppc<BLOCKED_SIZE> (dis, x, yb,
+                                                                     d, n0);
+            powerpc::cosine_distances_blocked_ref_ppc<BLOCKED_SIZE> (dis1, x,
+                                                                     yb, d, n1);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                             distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+        {
+            powerpc::cosine_distances_blocked_ref_ippc<BLOCKED_SIZE> (dis, x,
+                                                                      yb, d,
+                                                                      n0);
+            powerpc::cosine_distances_blocked_ref_ippc<BLOCKED_SIZE> (dis1, x,
+                                                                      yb, d,
+                                                                      n1);
+
+            for (j = 0; j < BATCH_N_DB_SIZE + n1; j++)
+                result += dis[j];
+        }
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_float_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                             distance_results);
+    }
+
+    free (yb);
+    return 0;
+}
+
+/**********  Hamming distance test *************/
+
+int 
+test_hamming_distance_ref (struct results_data_t* distance_results,
+                           unsigned int fun_id, unsigned int array_index,
+                           unsigned int num_runs,
+                           bool run_code_version[NUM_CODE_VERSIONS],
+                           const uint8_t* vec1, const uint8_t* vec2,
+                           size_t size)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    size_t result;
+    int i;
+
+    //std::cout<< num_runs << "\t"<< *x <<"\t" << *y << d << std::endl;
+    check_fun_id (fun_id);
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < num_runs; i++)
+        result = base::hamming_distance_ref (vec1, vec2, size);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_int_result (fun_id, array_index, CODE_VER_ORIG, result,
+                       distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+#if VEC_POPCNT_SUPPORTED
+            result = powerpc::hamming_distance_ref_ppc (vec1, vec2, size);
+#else
+            result = base::hamming_distance_ref (vec1, vec2, size);
+#endif
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_OPTIMIZED_PPC, result,
+                           distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        result = 0;
+        t0 = get_time();
+
+        for (i = 0; i < num_runs; i++)
+#if VEC_POPCNT_SUPPORTED
+            result = powerpc::hamming_distance_ref_ippc (vec1, vec2, size);
+#else
+            result = base::hamming_distance_ref (vec1, vec2, size);
+#endif
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_INTRINSIC_PPC, result,
+                           distance_results);
+    }
+
+    return 0;
+}
+
+/**********  Bit plane dot products test *************/
+
+/* The result is the sum of the ny dot products.  */
+static long int
+sum_dot_products (const uint32_t* dis, size_t ny)
+{
+    long int sum = 0;
+
+    for (size_t i = 0; i < ny; i++)
+        sum += dis[i];
+    return sum;
+}
+
+int
+test_bitplane_dot_ny_ref (struct results_data_t* distance_results,
+                          unsigned int fun_id, unsigned int array_index,
+                          unsigned int num_runs,
+                          bool run_code_version[NUM_CODE_VERSIONS],
+                          const uint8_t* planes, size_t nplanes,
+                          const uint8_t* codes, size_t code_size, size_t ny)
+{
+
+    unsigned long long int  t0;
+    unsigned long long int  t1;
+    uint32_t *dis;
+    unsigned int runs;
+    int i;
+
+    check_fun_id (fun_id);
+
+    dis = (uint32_t *) malloc (ny * sizeof(uint32_t));
+    if (!dis) {
+        std::cout << "ERROR, failed to allocate the bitplane_dot_ny output array.\n";
+        exit (-1);
+    }
+
+    /* A call computes ny dot products, divide the number of runs to keep
+       the test time similar to the other tests.  */
+    runs = num_runs / ny;
+    if (runs == 0)
+        runs = 1;
+
+    /* Test the original code */
+    t0 = get_time();
+
+    for (i = 0; i < runs; i++)
+        base::bitplane_dot_ny_ref (dis, planes, nplanes, codes,
+                                   code_size, ny);
+
+    t1 = get_time();
+
+    record_time (fun_id, array_index, CODE_VER_ORIG, t0, t1,
+                 distance_results);
+
+    record_int_result (fun_id, array_index, CODE_VER_ORIG,
+                       sum_dot_products (dis, ny), distance_results);
+
+    /* Test the ppc version of the code */
+    if (run_code_version[RUN_OPTIMIZED_CODE])
+    {
+        memset (dis, 0, ny * sizeof(uint32_t));
+        t0 = get_time();
+
+        for (i = 0; i < runs; i++)
+#if VEC_POPCNT_SUPPORTED
+            powerpc::bitplane_dot_ny_ref_ppc (dis, planes, nplanes,
+                                              codes, code_size, ny);
+#else
+            base::bitplane_dot_ny_ref (dis, planes, nplanes, codes,
+                                       code_size, ny);
+#endif
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_OPTIMIZED_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_OPTIMIZED_PPC,
+                           sum_dot_products (dis, ny),
+                           distance_results);
+    }
+
+    /* Test the ppc intrinsic version of the code */
+    if (run_code_version[RUN_INTRINSIC_CODE])
+    {
+        memset (dis, 0, ny * sizeof(uint32_t));
+        t0 = get_time();
+
+        for (i = 0; i < runs; i++)
+#if VEC_POPCNT_SUPPORTED
+            powerpc::bitplane_dot_ny_ref_ippc (dis, planes, nplanes,
+                                               codes, code_size, ny);
+#else
+            base::bitplane_dot_ny_ref (dis, planes, nplanes, codes,
+                                       code_size, ny);
+#endif
+
+        t1 = get_time();
+
+        record_time (fun_id, array_index, CODE_INTRINSIC_PPC, t0, t1,
+                     distance_results);
+
+        record_int_result (fun_id, array_index, CODE_INTRINSIC_PPC,
+                           sum_dot_products (dis, ny),
+                           distance_results);
+    }
+
+    free (dis);
+    return 0;
+}
+
 /**********  Jaccard distance test *************/
 
 int 
@@ -58,6 +58,32 @@
 #define RUN_OPTIMIZED_CODE  1
 #define RUN_INTRINSIC_CODE  2
 
+#define BATCH_N_DB_SIZE     16  /* Number of database vectors used by the
+                                   batch_N tests, largest supported N.  */
+
+#define ASSIGN_NUM_X        250 /* Number of vectors and centroids used by */
+#define ASSIGN_NUM_CENTROIDS 100 /* the assign_to_nearest test, not
+                                   multiples of the tile sizes.  */
+#define ASSIGN_RUNS_DIVISOR 1000 /* A call does ASSIGN_NUM_X *
+                                   ASSIGN_NUM_CENTROIDS distances, divide the
+                                   number of runs to keep the test time
+                                   similar to the other tests.  */
+
+#define KMEANS_NUM_CENTROIDS 64 /* The kmeans_minibatch test trains on the */
+#define KMEANS_BATCH_SIZE   16  /* ASSIGN_NUM_X vectors, KMEANS_NITER */
+#define KMEANS_NITER        2   /* batches of KMEANS_BATCH_SIZE vectors do
+                                   not cover KMEANS_NUM_CENTROIDS.  */
+
+#define BY_IDS_PREFETCH     4   /* Prefetch distance of the by_ids tests,
+                                   less than BATCH_N_DB_SIZE.  */
+
+#define BLOCKED_SIZE        8   /* Vectors per block of the blocked layout
+                                   tests, BATCH_N_DB_SIZE - 3 vectors leave
+                                   a partial block.  */
+
+#define BITPLANE_NUM_PLANES 4   /* Number of bit planes and of codes used */
+#define BITPLANE_NY         64  /* by the bitplane_dot_ny test.  */
+
 struct results_data_t {
     char function_name[NAME_LEN];
     unsigned long long int execution_time[MAX_ARRAY_SIZES][NUM_CODE_VERSIONS];
@@ -72,13 +98,27 @@ enum func_id {
     FVEC_NORM_L2SQR_REF,
     FVEC_L2SQR_NY_TRANSPOSED_REF,
     FVEC_L2SQR_BATCH_4_REF,
+    FVEC_L2SQR_BATCH_N_REF,
+    FVEC_L2SQR_BY_IDS_REF,
+    FVEC_L2SQR_BLOCKED_REF,
+    FVEC_L2SQR_BOUNDED_REF,
+    ASSIGN_TO_NEAREST_REF,
+    KMEANS_MINIBATCH_REF,
     IVEC_L2SQR_REF,
     FVEC_INNER_PRODUCT_REF,
     FVEC_INNER_PRODUCT_BATCH_4_REF,
+    FVEC_INNER_PRODUCT_BATCH_N_REF,
+    FVEC_INNER_PRODUCTS_BY_IDS_REF,
+    FVEC_INNER_PRODUCTS_BLOCKED_REF,
     IVEC_INNER_PRODUCT_REF,
     FVEC_L1_REF,
+    FVEC_LINF_REF,
+    FVEC_MADD_REF,
+    FVEC_MADD_AND_ARGMIN_REF,
     COSINE_DISTANCE_REF,
+    COSINE_DISTANCES_BLOCKED_REF,
     HAMMING_DISTANCE_REF,
+    BITPLANE_DOT_NY_REF,
     JACCARD_DISTANCE_REF,
     FUNC_ID_MAX,
 };
@@ -144,6 +184,50 @@ test_fvec_L2sqr_batch_4_ref (struct results_data_t* result,
                              float& dis0, float& dis1, float& dis2,
                              float& dis3);
 
+int
+test_fvec_L2sqr_batch_N_ref (struct results_data_t* result,
+                             unsigned int fun_id, unsigned int array_index,
+                             unsigned int num_runs,
+                             bool run_code_version[NUM_CODE_VERSIONS],
+                             const float* x, const float* db,
+                             const int64_t* ids, size_t d);
+
+int
+test_fvec_L2sqr_by_ids_ref (struct results_data_t* result,
+                            unsigned int fun_id, unsigned int array_index,
+                            unsigned int num_runs,
+                            bool run_code_version[NUM_CODE_VERSIONS],
+                            const float* x, const float* db,
+                            const int64_t* ids, size_t d);
+
+int
+test_fvec_L2sqr_blocked_ref (struct results_data_t* distance_results,
+                             unsigned int fun_id, unsigned int array_index,
+                             unsigned int num_runs,
+                             bool run_code_version[NUM_CODE_VERSIONS],
+                             const float* x, const float* db, size_t d);
+
+int
+test_fvec_L2sqr_bounded_ref (struct results_data_t* result,
+                             unsigned int fun_id, unsigned int array_index,
+                             unsigned int num_runs,
+                             bool run_code_version[NUM_CODE_VERSIONS],
+                             const float* x, const float* y, size_t d);
+
+int
+test_assign_to_nearest_ref (struct results_data_t* result,
+                            unsigned int fun_id, unsigned int array_index,
+                            unsigned int num_runs,
+                            bool run_code_version[NUM_CODE_VERSIONS],
+                            const float* x, size_t n, const float* centroids,
+                            size_t k, size_t d);
+
+int
+test_kmeans_minibatch_ref (struct results_data_t* result,
+                           unsigned int fun_id, unsigned int array_index,
+                           bool run_code_version[NUM_CODE_VERSIONS],
+                           const float* x, size_t n, size_t d);
+
 int
 test_ivec_L2sqr_ref(struct results_data_t* result,
                     unsigned int fun_id, unsigned int array_index,
@@ -171,6 +255,33 @@ test_fvec_inner_product_batch_4_ref (struct results_data_t* distance_results,
                                      float& dp0, float& dp1, float& dp2,
                                      float& dp3);
 
+int
+test_fvec_inner_product_batch_N_ref (struct results_data_t* distance_results,
+                                     unsigned int fun_id,
+                                     unsigned int array_index,
+                                     unsigned int num_runs,
+                                     bool run_code_version[NUM_CODE_VERSIONS],
+                                     const float* x, const float* db,
+                                     const int64_t* ids, size_t d);
+
+int
+test_fvec_inner_products_by_ids_ref (struct results_data_t* distance_results,
+                                     unsigned int fun_id,
+                                     unsigned int array_index,
+                                     unsigned int num_runs,
+                                     bool run_code_version[NUM_CODE_VERSIONS],
+                                     const float* x, const float* db,
+                                     const int64_t* ids, size_t d);
+
+int
+test_fvec_inner_products_blocked_ref (struct results_data_t* distance_results,
+                                      unsigned int fun_id,
+                                      unsigned int array_index,
+                                      unsigned int num_runs,
+                                      bool run_code_version[NUM_CODE_VERSIONS],
+                                      const float* x, const float* db,
+                                      size_t d);
+
 int
 test_ivec_inner_product_ref (struct results_data_t* distance_results,
                              unsigned int fun_id, unsigned int array_index,
@@ -186,6 +297,28 @@ test_fvec_L1_ref (struct results_data_t* distance_results,
                   bool run_code_version[NUM_CODE_VERSIONS], const float* x,
                   const float* y, size_t d);
 
+int
+test_fvec_Linf_ref (struct results_data_t* distance_results,
+                    unsigned int fun_id, unsigned int array_index,
+                    unsigned int num_runs,
+                    bool run_code_version[NUM_CODE_VERSIONS], const float* x,
+                    const float* y, size_t d);
+
+int
+test_fvec_madd_ref (struct results_data_t* distance_results,
+                    unsigned int fun_id, unsigned int array_index,
+                    unsigned int num_runs,
+                    bool run_code_version[NUM_CODE_VERSIONS], const float* a,
+                    float bf, const float* b, size_t n);
+
+int
+test_fvec_madd_and_argmin_ref (struct results_data_t* distance_results,
+                               unsigned int fun_id, unsigned int array_index,
+                               unsigned int num_runs,
+                               bool run_code_version[NUM_CODE_VERSIONS],
+                               const float* a, float bf, const float* b,
+                               size_t n);
+
 
 int 
 test_cosine_distance_ref (struct results_data_t* distance_results,
@@ -194,6 +327,14 @@ test_cosine_distance_ref (struct results_data_t* distance_results,
                           bool run_code_version[NUM_CODE_VERSIONS],
                           const float* x, const float* y, size_t d);
 
+int
+test_cosine_distances_blocked_ref (struct results_data_t* distance_results,
+                                   unsigned int fun_id,
+                                   unsigned int array_index,
+                                   unsigned int num_runs,
+                                   bool run_code_version[NUM_CODE_VERSIONS],
+                                   const float* x, const float* db, size_t d);
+
 int  
 test_hamming_distance_ref (struct results_data_t* distance_results,
                            unsigned int fun_id, unsigned int array_index,
@@ -202,6 +343,14 @@ test_hamming_distance_ref (struct results_data_t* distance_results,
                            const uint8_t* vec1, const uint8_t* vec2,
                            size_t size);
 
+int
+test_bitplane_dot_ny_ref (struct results_data_t* distance_results,
+                          unsigned int fun_id, unsigned int array_index,
+                          unsigned int num_runs,
+                          bool run_code_version[NUM_CODE_VERSIONS],
+                          const uint8_t* planes, size_t nplanes,
+                          const uint8_t* codes, size_t code_size, size_t ny);
+
 int 
 test_jaccard_distance_ref (struct results_data_t* distance_results,
                            unsigned int fun_id, unsigned int array_index,
@@ -29,11 +29,18 @@
 #include <iomanip>
 #include <limits>
 #include <stdexcept>
+#include <queue>
+#include <algorithm>
 
 #include "main-helpers.h"
 
 #define NY_DISTANCE 8
 
+/* Parameters of the top-k scan used to measure the early abandoning of
+   fvec_L2sqr_bounded on the custom data.  */
+#define BOUNDED_TOP_K        10
+#define BOUNDED_MAX_QUERIES  100
+
 std::vector<std::vector<float>> load_vectors_from_csv_safe(size_t &vector_dim)
 {
     std::ifstream file("dataset/train.csv");
@@ -97,6 +104,77 @@ std::vector<std::vector<float>> load_vectors_from_csv_safe(size_t &vector_dim)
     return data;
 }
 
+/* Simulate a brute force top-k search over the custom data with
+   fvec_L2sqr_bounded, using the current k-th best distance as the threshold.
+   Returns the fraction of the dimensions that were not scanned.  */
+double l2sqr_bounded_skipped_fraction(const float *data, size_t n, size_t d)
+{
+    size_t nq = std::min(n, (size_t)BOUNDED_MAX_QUERIES);
+    size_t dims_total = 0;
+    size_t dims_scanned_total = 0;
+
+    for (size_t q = 0; q < nq; q++)
+    {
+        const float *x = data + q * d;
+        std::priority_queue<float> top_k;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            if (i == q)
+                continue;
+
+            float threshold = std::numeric_limits<float>::infinity();
+            if (top_k.size() == BOUNDED_TOP_K)
+                threshold = top_k.top();
+
+            size_t dims_scanned;
+            float dist = base::fvec_L2sqr_bounded_ref(x, data + i * d, d,
+                                                      threshold,
+                                                      &dims_scanned);
+            dims_total += d;
+            dims_scanned_total += dims_scanned;
+
+            if (dist <= threshold)
+            {
+                top_k.push(dist);
+                if (top_k.size() > BOUNDED_TOP_K)
+                    top_k.pop();
+            }
+        }
+    }
+
+    if (dims_total == 0)
+        return 0.0;
+    return 1.0 - (double)dims_scanned_total / dims_total;
+}
+
+void report_l2sqr_bounded_pruning(const std::vector<std::vector<float>> &data,
+                                  size_t d)
+{
+    size_t n = data.size();
+    std::vector<float> flat(n * d);
+    std::vector<float> permuted(n * d);
+    std::vector<size_t> order(d);
+
+    for (size_t i = 0; i < n; i++)
+        std::copy(data[i].begin(), data[i].end(), flat.begin() + i * d);
+
+    /* Same scan with the dimensions stored by decreasing variance.  */
+    base::fvec_dim_order_by_variance_ref(flat.data(), n, d, order.data());
+    base::fvec_permute_dims_ref(flat.data(), n, d, order.data(),
+                                permuted.data());
+
+    std::cout << "fvec_L2sqr_bounded, top-" << BOUNDED_TOP_K << " scan of "
+              << std::min(n, (size_t)BOUNDED_MAX_QUERIES) << " queries"
+              << std::endl;
+    std::cout << "Fraction of dimensions skipped, original order: "
+              << l2sqr_bounded_skipped_fraction(flat.data(), n, d)
+              << std::endl;
+    std::cout << "Fraction of dimensions skipped, variance order: "
+              << l2sqr_bounded_skipped_fraction(permuted.data(), n, d)
+              << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
     int rtn;
@@ -116,6 +194,12 @@ int main(int argc, char *argv[])
     int8_t **yi_d = (int8_t **)malloc(sizeof(int8_t *));
     uint8_t **c1_d = (uint8_t **)malloc(sizeof(uint8_t *));
     uint8_t **c2_d = (uint8_t **)malloc(sizeof(uint8_t *));
+    uint8_t **planes_d = (uint8_t **)malloc(sizeof(uint8_t *));
+    uint8_t **codes_d = (uint8_t **)malloc(sizeof(uint8_t *));
+    float **db_d = (float **)malloc(sizeof(float *));
+    int64_t **ids_d = (int64_t **)malloc(sizeof(int64_t *));
+    float **kx_d = (float **)malloc(sizeof(float *));
+    float **centroids_d = (float **)malloc(sizeof(float *));
 
     float dp0 = 0.0f;
     float dp1 = 0.0f;
@@ -151,6 +235,48 @@ int main(int argc, char *argv[])
     {
         print_cmd_opts(cmd_flags, results, group_id_name);
     }
+    if (cmd_flags.run_any_bench)
+    {
+        if (cmd_flags.run_bench[BENCH_KMEANS])
+            bench_kmeans(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_FLAT])
+            bench_flat(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_IVF])
+            bench_ivf(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_HNSW])
+            bench_hnsw(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_VAMANA])
+            bench_vamana(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_FILTER])
+            bench_filter(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_RANGE])
+            bench_range(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_RERANK])
+            bench_rerank(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_BINARY])
+            bench_binary(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_RABITQ])
+            bench_rabitq(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_TRANSFORM])
+            bench_transform(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_NUMA])
+            bench_numa(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_WORKING_SET])
+            bench_working_set(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_BLOCKED])
+            bench_blocked(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_ARENA])
+            bench_arena(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_ASYNC])
+            bench_async(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_INTERLEAVE])
+            bench_interleave(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_CONCURRENT])
+            bench_concurrent(cmd_flags.bench_params);
+        if (cmd_flags.run_bench[BENCH_SEGMENTS])
+            bench_segments(cmd_flags.bench_params);
+        return 0;
+    }
     if (cmd_flags.run_custom)
     {
         std::cout << "Running custom test..." << std::endl;
@@ -215,6 +341,16 @@ int main(int argc, char *argv[])
                 scalar = base::fvec_L2sqr_ref(x, y, array_size);
                 vector = powerpc::fvec_L2sqr_ref_ppc(x, y, array_size);
             }
+            else if (cmd_flags.run_func_flag[FVEC_L2SQR_BOUNDED_REF])
+            {
+                /* No threshold, both versions must compute the full
+                   distance.  */
+                float threshold = std::numeric_limits<float>::infinity();
+                scalar = base::fvec_L2sqr_bounded_ref(x, y, array_size,
+                                                      threshold);
+                vector = powerpc::fvec_L2sqr_bounded_ref_ppc(x, y, array_size,
+                                                             threshold);
+            }
             else if (cmd_flags.run_func_flag[FVEC_INNER_PRODUCT_REF])
             {
                 scalar = base::fvec_inner_product_ref(x, y, array_size);
@@ -301,6 +437,9 @@ int main(int argc, char *argv[])
         std::cout << "Max Vector Value: " << max_vector << std::endl;
         std::cout << "Min Vector Value: " << min_vector << std::endl;
         std::cout << "Max Absolute Difference: " << max_diff << " at index " << max_diff_index << std::endl;
+
+        if (cmd_flags.run_func_flag[FVEC_L2SQR_BOUNDED_REF])
+            report_l2sqr_bounded_pruning(custom_data, array_size);
     }
     else
     {
@@ -344,6 +483,23 @@ int main(int argc, char *argv[])
             const uint8_t *c1 = *c1_d;
             const uint8_t *c2 = *c2_d;
 
+            load_data_bitplanes(size, BITPLANE_NUM_PLANES, BITPLANE_NY,
+                                planes_d, codes_d);
+
+            const uint8_t *planes = *planes_d;
+            const uint8_t *codes = *codes_d;
+
+            load_data_batch(size, BATCH_N_DB_SIZE, db_d, ids_d);
+
+            const float *db = *db_d;
+            const int64_t *ids = *ids_d;
+
+            load_data_kmeans(size, ASSIGN_NUM_X, ASSIGN_NUM_CENTROIDS, kx_d,
+                             centroids_d);
+
+            const float *kx = *kx_d;
+            const float *centroids = *centroids_d;
+
             float *dis = (float *)malloc(sizeof(float *) * NY_DISTANCE);
 
             /**********  Eulcidian tests *************/
@@ -378,6 +534,49 @@ int main(int argc, char *argv[])
                                             cmd_flags.run_code_version, x, y0, y1,
                                             y2, y3, size, dp0, dp1, dp2, dp3);
 
+            /* Test fvec_L2sqr_batch_N_ref   */
+            if (cmd_flags.run_func_flag[FVEC_L2SQR_BATCH_N_REF])
+                test_fvec_L2sqr_batch_N_ref(results, FVEC_L2SQR_BATCH_N_REF,
+                                            array_index, cmd_flags.num_runs,
+                                            cmd_flags.run_code_version, x, db,
+                                            ids, size);
+
+            /* Test fvec_L2sqr_by_ids_ref   */
+            if (cmd_flags.run_func_flag[FVEC_L2SQR_BY_IDS_REF])
+                test_fvec_L2sqr_by_ids_ref(results, FVEC_L2SQR_BY_IDS_REF,
+                                           array_index, cmd_flags.num_runs,
+                                           cmd_flags.run_code_version, x, db,
+                                           ids, size);
+
+            /* Test fvec_L2sqr_blocked_ref   */
+            if (cmd_flags.run_func_flag[FVEC_L2SQR_BLOCKED_REF])
+                test_fvec_L2sqr_blocked_ref(results, FVEC_L2SQR_BLOCKED_REF,
+                                            array_index, cmd_flags.num_runs,
+                                            cmd_flags.run_code_version, x, db,
+                                            size);
+
+            /* Test fvec_L2sqr_bounded_ref   */
+            if (cmd_flags.run_func_flag[FVEC_L2SQR_BOUNDED_REF])
+                test_fvec_L2sqr_bounded_ref(results, FVEC_L2SQR_BOUNDED_REF,
+                                            array_index, cmd_flags.num_runs,
+                                            cmd_flags.run_code_version, x, y2,
+                                            size);
+
+            /* Test assign_to_nearest_ref   */
+            if (cmd_flags.run_func_flag[ASSIGN_TO_NEAREST_REF])
+                test_assign_to_nearest_ref(results, ASSIGN_TO_NEAREST_REF,
+                                           array_index, cmd_flags.num_runs,
+                                           cmd_flags.run_code_version, kx,
+                                           ASSIGN_NUM_X, centroids,
+                                           ASSIGN_NUM_CENTROIDS, size);
+
+            /* Test kmeans_minibatch_ref   */
+            if (cmd_flags.run_func_flag[KMEANS_MINIBATCH_REF])
+                test_kmeans_minibatch_ref(results, KMEANS_MINIBATCH_REF,
+                                          array_index,
+                                          cmd_flags.run_code_version, kx,
+                                          ASSIGN_NUM_X, size);
+
             /* Test ivec_L2sqr_ref  */
             if (cmd_flags.run_func_flag[IVEC_L2SQR_REF])
                 test_ivec_L2sqr_ref(results, IVEC_L2SQR_REF, array_index,
@@ -402,6 +601,33 @@ int main(int argc, char *argv[])
                                                     x, y0, y1, y2, y3, size,
                                                     dp0, dp1, dp2, dp3);
 
+            /* Test fvec_inner_product_batch_N_ref  */
+            if (cmd_flags.run_func_flag[FVEC_INNER_PRODUCT_BATCH_N_REF])
+                test_fvec_inner_product_batch_N_ref(results,
+                                                    FVEC_INNER_PRODUCT_BATCH_N_REF,
+                                                    array_index,
+                                                    cmd_flags.num_runs,
+                                                    cmd_flags.run_code_version,
+                                                    x, db, ids, size);
+
+            /* Test fvec_inner_products_by_ids_ref  */
+            if (cmd_flags.run_func_flag[FVEC_INNER_PRODUCTS_BY_IDS_REF])
+                test_fvec_inner_products_by_ids_ref(results,
+                                                    FVEC_INNER_PRODUCTS_BY_IDS_REF,
+                                                    array_index,
+                                                    cmd_flags.num_runs,
+                                                    cmd_flags.run_code_version,
+                                                    x, db, ids, size);
+
+            /* Test fvec_inner_products_blocked_ref  */
+            if (cmd_flags.run_func_flag[FVEC_INNER_PRODUCTS_BLOCKED_REF])
+                test_fvec_inner_products_blocked_ref(results,
+                                                     FVEC_INNER_PRODUCTS_BLOCKED_REF,
+                                                     array_index,
+                                                     cmd_flags.num_runs,
+                                                     cmd_flags.run_code_version,
+                                                     x, db, size);
+
             /* Test ivec_inner_product_ref  */
             if (cmd_flags.run_func_flag[IVEC_INNER_PRODUCT_REF])
                 test_ivec_inner_product_ref(results, IVEC_INNER_PRODUCT_REF, array_index,
@@ -417,6 +643,31 @@ int main(int argc, char *argv[])
                                  cmd_flags.run_code_version, x, y0, size);
             }
 
+            if (cmd_flags.run_func_flag[FVEC_LINF_REF])
+            {
+                test_fvec_Linf_ref(results, FVEC_LINF_REF, array_index,
+                                   cmd_flags.num_runs,
+                                   cmd_flags.run_code_version, x, y0, size);
+            }
+
+            /* c = y2 + size * y1 is convex in the index, so the argmin is
+               in the middle of the array for the larger sizes.  */
+            if (cmd_flags.run_func_flag[FVEC_MADD_REF])
+            {
+                test_fvec_madd_ref(results, FVEC_MADD_REF, array_index,
+                                   cmd_flags.num_runs,
+                                   cmd_flags.run_code_version, y2,
+                                   (float)size, y1, size);
+            }
+
+            if (cmd_flags.run_func_flag[FVEC_MADD_AND_ARGMIN_REF])
+            {
+                test_fvec_madd_and_argmin_ref(results, FVEC_MADD_AND_ARGMIN_REF,
+                                              array_index, cmd_flags.num_runs,
+                                              cmd_flags.run_code_version, y2,
+                                              (float)size, y1, size);
+            }
+
             /**********  Cosine distance test *************/
 
             if (cmd_flags.run_func_flag[COSINE_DISTANCE_REF])
@@ -426,6 +677,16 @@ int main(int argc, char *argv[])
                                          cmd_flags.run_code_version, x, y0, size);
             }
 
+            if (cmd_flags.run_func_flag[COSINE_DISTANCES_BLOCKED_REF])
+            {
+                test_cosine_distances_blocked_ref(results,
+                                                  COSINE_DISTANCES_BLOCKED_REF,
+                                                  array_index,
+                                                  cmd_flags.num_runs,
+                                                  cmd_flags.run_code_version,
+                                                  x, db, size);
+            }
+
             /**********  Hamming distance test *************/
 
             if (cmd_flags.run_func_flag[HAMMING_DISTANCE_REF])
@@ -436,6 +697,15 @@ int main(int argc, char *argv[])
                                           size);
             }
 
+            if (cmd_flags.run_func_flag[BITPLANE_DOT_NY_REF])
+            {
+                test_bitplane_dot_ny_ref(results, BITPLANE_DOT_NY_REF,
+                                         array_index, cmd_flags.num_runs,
+                                         cmd_flags.run_code_version, planes,
+                                         BITPLANE_NUM_PLANES, codes, size,
+                                         BITPLANE_NY);
+            }
+
             /**********  Jaccard distance test *************/
 
             if (cmd_flags.run_func_flag[JACCARD_DISTANCE_REF])
@@ -451,6 +721,9 @@ int main(int argc, char *argv[])
             release_data_float(x_d, y0_d, y1_d, y2_d, y3_d, dis);
             release_data_int8(xi_d, yi_d);
             release_data_char(c1_d, c2_d);
+            release_data_bitplanes(planes_d, codes_d);
+            release_data_batch(db_d, ids_d);
+            release_data_kmeans(kx_d, centroids_d);
         }
 
         /* Print results */
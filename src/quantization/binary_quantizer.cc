@@ -0,0 +1,92 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "binary_quantizer.h"
+#include "random_rotation.h"
+
+#include "distances/distances.h"
+#include "utils/parallel.h"
+
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace vector_search {
+
+BinaryQuantizer::BinaryQuantizer(size_t d, bool rotate)
+    : d(d), rotate(rotate), thresholds(d, 0) {}
+
+void
+BinaryQuantizer::train(size_t n, const float* x) {
+    std::vector<double> sums(d, 0);
+    std::mutex sums_mutex;
+
+    if (rotate)
+        random_rotation(d, seed, rotation);
+
+    parallel_for(n, 1024, [&](size_t i0, size_t i1) {
+        std::vector<double> local(d, 0);
+        std::vector<float> y(d);
+
+        for (size_t i = i0; i < i1; i++) {
+            const float* xi = x + i * d;
+
+            if (rotate) {
+                fvec_inner_products_ny(y.data(), xi, rotation.data(), d, d);
+                xi = y.data();
+            }
+            for (size_t l = 0; l < d; l++)
+                local[l] += xi[l];
+        }
+
+        std::lock_guard<std::mutex> lock(sums_mutex);
+        for (size_t l = 0; l < d; l++)
+            sums[l] += local[l];
+    });
+
+    for (size_t l = 0; l < d; l++)
+        thresholds[l] = n ? sums[l] / n : 0;
+}
+
+void
+BinaryQuantizer::encode(size_t n, const float* x, uint8_t* codes) const {
+    size_t cs = code_size();
+
+    if (rotate && rotation.empty()) {
+        std::cout << "ERROR, BinaryQuantizer::encode before train.\n";
+        exit (-1);
+    }
+
+    parallel_for(n, 1024, [&](size_t i0, size_t i1) {
+        std::vector<float> y(d);
+
+        for (size_t i = i0; i < i1; i++) {
+            const float* xi = x + i * d;
+            uint8_t* code = codes + i * cs;
+
+            if (rotate) {
+                fvec_inner_products_ny(y.data(), xi, rotation.data(), d, d);
+                xi = y.data();
+            }
+
+            memset(code, 0, cs);
+            for (size_t l = 0; l < d; l++)
+                code[l >> 3] |= (uint8_t)(xi[l] > thresholds[l]) << (l & 7);
+        }
+    });
+}
+
+}  // namespace vector_search
@@ -0,0 +1,59 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef QUANTIZATION_BINARY_QUANTIZER_H
+#define QUANTIZATION_BINARY_QUANTIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vector_search {
+
+/// 1-bit quantizer.  Bit l of a code is set when dimension l of the
+/// vector is above the threshold of the dimension, the mean of the
+/// training set.  With rotate, the vectors are first multiplied by a
+/// random orthogonal matrix, which spreads the variance over all the
+/// dimensions so that each bit carries about the same information.
+///
+/// The codes are d bits, padded to whole bytes with zero bits, bit l in
+/// byte l / 8 at position l % 8.  They are compared with the Hamming
+/// distance, for instance in an IndexFlat with METRIC_HAMMING of
+/// 8 * code_size() bits.
+struct BinaryQuantizer {
+    size_t d;                       ///< dimension of the vectors
+    bool rotate;                    ///< apply the random rotation
+    int seed = 1234;                ///< seed of the random rotation
+    std::vector<float> thresholds;  ///< per dimension, after the rotation
+    std::vector<float> rotation;    ///< d x d, row major, when rotate
+
+    explicit BinaryQuantizer(size_t d = 0, bool rotate = false);
+
+    /// bytes per code
+    size_t code_size() const {
+        return (d + 7) / 8;
+    }
+
+    /// Draw the rotation and compute the thresholds on the n vectors x
+    void train(size_t n, const float* x);
+
+    /// Encode the n vectors x into n * code_size() bytes
+    void encode(size_t n, const float* x, uint8_t* codes) const;
+};
+
+}  // namespace vector_search
+
+#endif /* QUANTIZATION_BINARY_QUANTIZER_H */
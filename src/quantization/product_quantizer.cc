@@ -0,0 +1,109 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "product_quantizer.h"
+
+#include "distances/distances.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace vector_search {
+
+ProductQuantizer::ProductQuantizer(size_t d, size_t M)
+    : d(d), M(M), dsub(M ? d / M : 0) {
+    if (M == 0 || d % M != 0) {
+        std::cout << "ERROR, ProductQuantizer dimension " << d
+                  << " is not a multiple of M = " << M << ".\n";
+        exit (-1);
+    }
+}
+
+/* The sub-vectors of sub-space m are gathered contiguously, for the
+   k-means training and for the assign_to_nearest kernel.  */
+static void
+extract_subvectors(size_t n, const float* x, size_t d, size_t dsub,
+                   size_t m, std::vector<float>& xsub) {
+    xsub.resize(n * dsub);
+    for (size_t i = 0; i < n; i++)
+        std::copy(x + i * d + m * dsub, x + i * d + (m + 1) * dsub,
+                  xsub.data() + i * dsub);
+}
+
+void
+ProductQuantizer::train(size_t n, const float* x) {
+    std::vector<float> xsub;
+
+    centroids.resize(M * PQ_KSUB * dsub);
+    for (size_t m = 0; m < M; m++) {
+        KMeans km(dsub, PQ_KSUB, params);
+
+        extract_subvectors(n, x, d, dsub, m, xsub);
+        km.train(n, xsub.data());
+        std::copy(km.centroids.begin(), km.centroids.end(),
+                  centroids.begin() + m * PQ_KSUB * dsub);
+    }
+}
+
+void
+ProductQuantizer::encode(size_t n, const float* x, uint8_t* codes) const {
+    if (centroids.empty()) {
+        std::cout << "ERROR, ProductQuantizer::encode before train.\n";
+        exit (-1);
+    }
+
+    parallel_for(n, 1024, [&](size_t i0, size_t i1) {
+        std::vector<float> xsub, dists(i1 - i0);
+        std::vector<int64_t> ids(i1 - i0);
+
+        for (size_t m = 0; m < M; m++) {
+            extract_subvectors(i1 - i0, x + i0 * d, d, dsub, m, xsub);
+            assign_to_nearest(xsub.data(), i1 - i0, get_centroid(m, 0),
+                              PQ_KSUB, dsub, ids.data(), dists.data());
+            for (size_t i = i0; i < i1; i++)
+                codes[i * M + m] = ids[i - i0];
+        }
+    });
+}
+
+void
+ProductQuantizer::decode(size_t n, const uint8_t* codes, float* x) const {
+    for (size_t i = 0; i < n; i++)
+        for (size_t m = 0; m < M; m++) {
+            const float* c = get_centroid(m, codes[i * M + m]);
+
+            std::copy(c, c + dsub, x + i * d + m * dsub);
+        }
+}
+
+/* PQ_KSUB is a multiple of 16, the centroids are compared to the
+   sub-vector 16 at a time with the batch kernel.  */
+void
+ProductQuantizer::compute_distance_table(const float* x,
+                                         float* table) const {
+    const float* c[16];
+
+    for (size_t m = 0; m < M; m++)
+        for (size_t j = 0; j < PQ_KSUB; j += 16) {
+            for (size_t t = 0; t < 16; t++)
+                c[t] = get_centroid(m, j + t);
+            fvec_L2sqr_batch_N<16>(x + m * dsub, c, dsub,
+                                   table + m * PQ_KSUB + j);
+        }
+}
+
+}  // namespace vector_search
@@ -0,0 +1,83 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef QUANTIZATION_PRODUCT_QUANTIZER_H
+#define QUANTIZATION_PRODUCT_QUANTIZER_H
+
+#include "clustering/kmeans.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Number of centroids of each sub-quantizer, one byte per sub-code.  */
+#define PQ_KSUB 256
+
+namespace vector_search {
+
+/// Product quantizer.  The vectors are split into M sub-vectors of
+/// dsub = d / M dimensions, each encoded by the index of its nearest
+/// centroid among the PQ_KSUB of its sub-space, a code is M bytes.  The
+/// queries are compared to the codes through a table of their distances
+/// to all the centroids.
+struct ProductQuantizer {
+    size_t d;                       ///< dimension of the vectors
+    size_t M;                       ///< number of sub-quantizers
+    size_t dsub;                    ///< dimension of the sub-vectors
+    KMeansParams params;            ///< of the sub-quantizer training
+
+    /// M * PQ_KSUB * dsub centroids, those of sub-quantizer m first
+    std::vector<float> centroids;
+
+    ProductQuantizer(size_t d = 0, size_t M = 1);
+
+    /// bytes per code
+    size_t code_size() const {
+        return M;
+    }
+
+    /// Centroid j of sub-quantizer m
+    const float* get_centroid(size_t m, size_t j) const {
+        return centroids.data() + (m * PQ_KSUB + j) * dsub;
+    }
+
+    /// Train the sub-quantizers on the n vectors x
+    void train(size_t n, const float* x);
+
+    /// Encode the n vectors x into n * M bytes
+    void encode(size_t n, const float* x, uint8_t* codes) const;
+
+    /// Decode n codes into n * d floats
+    void decode(size_t n, const uint8_t* codes, float* x) const;
+
+    /// M * PQ_KSUB squared L2 distances between the sub-vectors of x and
+    /// the centroids
+    void compute_distance_table(const float* x, float* table) const;
+
+    /// Squared L2 distance between a query and a code, from the distance
+    /// table of the query
+    float L2sqr_to_code(const float* table, const uint8_t* code) const {
+        float dis = 0;
+
+        for (size_t m = 0; m < M; m++)
+            dis += table[m * PQ_KSUB + code[m]];
+        return dis;
+    }
+};
+
+}  // namespace vector_search
+
+#endif /* QUANTIZATION_PRODUCT_QUANTIZER_H */
@@ -0,0 +1,179 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rabitq.h"
+#include "random_rotation.h"
+
+#include "distances/distances.h"
+#include "utils/arena.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace vector_search {
+
+RaBitQuantizer::RaBitQuantizer(size_t d) : d(d), center(d, 0) {}
+
+void
+RaBitQuantizer::train(size_t n, const float* x) {
+    std::vector<double> sums(d, 0);
+    std::mutex sums_mutex;
+
+    random_rotation(d, seed, rotation);
+
+    parallel_for(n, 1024, [&](size_t i0, size_t i1) {
+        std::vector<double> local(d, 0);
+
+        for (size_t i = i0; i < i1; i++)
+            for (size_t l = 0; l < d; l++)
+                local[l] += x[i * d + l];
+
+        std::lock_guard<std::mutex> lock(sums_mutex);
+        for (size_t l = 0; l < d; l++)
+            sums[l] += local[l];
+    });
+
+    for (size_t l = 0; l < d; l++)
+        center[l] = n ? sums[l] / n : 0;
+}
+
+/* With y = P (x - c), <x_bar, o> = sum |y_l| / (sqrt(d) ||y||).  The
+   error of the estimate of <o, q> is sqrt((1 - <x_bar, o>^2) /
+   <x_bar, o>^2) / sqrt(d - 1), see the RaBitQ paper (Gao and Long,
+   SIGMOD 2024).  A vector equal to the center has an exact estimate.  */
+void
+RaBitQuantizer::encode(size_t n, const float* x, uint8_t* codes,
+                       RaBitQFactors* factors) const {
+    size_t cs = code_size();
+
+    if (rotation.empty()) {
+        std::cout << "ERROR, RaBitQuantizer::encode before train.\n";
+        exit (-1);
+    }
+
+    parallel_for(n, 1024, [&](size_t i0, size_t i1) {
+        std::vector<float> r(d), y(d);
+
+        for (size_t i = i0; i < i1; i++) {
+            uint8_t* code = codes + i * cs;
+            RaBitQFactors& f = factors[i];
+            uint32_t popcount = 0;
+            float abs_sum = 0;
+
+            for (size_t l = 0; l < d; l++)
+                r[l] = x[i * d + l] - center[l];
+            fvec_inner_products_ny(y.data(), r.data(), rotation.data(), d, d);
+
+            memset(code, 0, cs);
+            for (size_t l = 0; l < d; l++) {
+                bool bit = y[l] > 0;
+
+                code[l >> 3] |= (uint8_t)bit << (l & 7);
+                popcount += bit;
+                abs_sum += fabsf(y[l]);
+            }
+
+            f.norm = sqrtf(fvec_norm_L2sqr(r.data(), d));
+            f.popcount = popcount;
+            if (f.norm > 0 && abs_sum > 0) {
+                f.ip = abs_sum / (f.norm * sqrtf(d));
+                f.ip = std::min(f.ip, 1.0f);
+                f.error = d > 1 ? sqrtf((1 - f.ip * f.ip) / (d - 1)) / f.ip
+                                : 0;
+            } else {
+                f.ip = 1;
+                f.error = 0;
+            }
+        }
+    });
+}
+
+/* The components of the rotated unit residual z are quantized to the
+   2^RABITQ_QUERY_BITS levels vmin + u * delta, rounded to the nearest
+   level.  */
+void
+RaBitQuantizer::prepare_query(const float* x, RaBitQQuery& q) const {
+    const unsigned int max_level = (1u << RABITQ_QUERY_BITS) - 1;
+    size_t cs = code_size();
+    ArenaScope scope;
+    float* r = scope.alloc<float>(d);
+    float* z = scope.alloc<float>(d);
+    float vmax;
+
+    for (size_t l = 0; l < d; l++)
+        r[l] = x[l] - center[l];
+    fvec_inner_products_ny(z, r, rotation.data(), d, d);
+
+    q.norm = sqrtf(fvec_norm_L2sqr(r, d));
+    q.planes.assign(RABITQ_QUERY_BITS * cs, 0);
+    q.vmin = q.delta = q.sum = 0;
+    if (q.norm == 0 || d == 0)
+        return;
+
+    for (size_t l = 0; l < d; l++)
+        z[l] /= q.norm;
+    q.vmin = *std::min_element(z, z + d);
+    vmax = *std::max_element(z, z + d);
+    q.delta = (vmax - q.vmin) / max_level;
+
+    unsigned int sum = 0;
+
+    for (size_t l = 0; q.delta > 0 && l < d; l++) {
+        unsigned int u = (unsigned int)((z[l] - q.vmin) / q.delta + 0.5f);
+
+        u = std::min(u, max_level);
+        sum += u;
+        for (size_t p = 0; p < RABITQ_QUERY_BITS; p++)
+            q.planes[p * cs + (l >> 3)] |= (uint8_t)((u >> p) & 1) << (l & 7);
+    }
+    q.sum = sum;
+}
+
+/* With the quantized query z ~ vmin + delta * u,
+       <b, z> ~ delta <b, u> + vmin popcount(b)
+       <x_bar, z> = (2 <b, z> - sum z) / sqrt(d)
+   and <b, u> is computed on the bit planes of u by bitplane_dot_ny.  */
+void
+RaBitQuantizer::estimate(const RaBitQQuery& q, size_t n,
+                         const uint8_t* codes, const RaBitQFactors* factors,
+                         float* distances, float* lower_bounds) const {
+    ArenaScope scope;
+    uint32_t* dots = scope.alloc<uint32_t>(n);
+    float inv_sqrt_d = d ? 1 / sqrtf(d) : 0;
+    float sum_z = q.delta * q.sum + q.vmin * d;
+    float q_norm2 = q.norm * q.norm;
+
+    bitplane_dot_ny(dots, q.planes.data(), RABITQ_QUERY_BITS, codes,
+                    code_size(), n);
+
+    for (size_t i = 0; i < n; i++) {
+        const RaBitQFactors& f = factors[i];
+        float ip_bz = q.delta * dots[i] + q.vmin * f.popcount;
+        float ip_xq = (2 * ip_bz - sum_z) * inv_sqrt_d / f.ip;
+        float base = f.norm * f.norm + q_norm2;
+        float scale = 2 * f.norm * q.norm;
+
+        distances[i] = base - scale * ip_xq;
+        if (lower_bounds)
+            lower_bounds[i] = base - scale * (ip_xq + epsilon * f.error);
+    }
+}
+
+}  // namespace vector_search
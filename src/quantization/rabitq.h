@@ -0,0 +1,96 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef QUANTIZATION_RABITQ_H
+#define QUANTIZATION_RABITQ_H
+
+#include "utils/arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Bits per component of the quantized queries.  */
+#define RABITQ_QUERY_BITS 4
+
+namespace vector_search {
+
+/// Per code terms of the RaBitQ distance estimate
+struct RaBitQFactors {
+    float norm;         ///< ||x - c||, distance to the center
+    float ip;           ///< <x_bar, o>, o the unit residual, x_bar its code
+    float error;        ///< standard error of the <o, q> estimate
+    uint32_t popcount;  ///< number of bits set in the code
+};
+
+/// Query prepared for the estimates: the rotated unit residual of the
+/// query, quantized to RABITQ_QUERY_BITS bits per component and stored as
+/// bit planes, plane p holding bit p of each component.
+struct RaBitQQuery {
+    ScratchVector<uint8_t> planes;  ///< RABITQ_QUERY_BITS * code_size bytes
+    float norm = 0;                 ///< ||q - c||
+    float vmin = 0;                 ///< value of the quantization level 0
+    float delta = 0;                ///< step between the levels
+    float sum = 0;                  ///< sum of the quantized components
+};
+
+/// RaBitQ 1-bit quantizer with error-bounded distance estimates.  The
+/// residual of a vector to the center c, the mean of the training set, is
+/// normalized to the unit vector o and multiplied by a random orthogonal
+/// matrix P, the code stores the signs of the components.  The code stands
+/// for the unit vector x_bar = P^T (2 b - 1) / sqrt(d).
+///
+/// The inner product <o, q> with the unit residual q of a query is
+/// estimated by <x_bar, q> / <x_bar, o>.  The estimate is unbiased and,
+/// thanks to the random rotation, its error is below epsilon times
+/// error with high probability, which bounds the squared L2 distance
+///     ||x - c||^2 + ||q - c||^2 - 2 ||x - c|| ||q - c|| <o, q>.
+/// <x_bar, q> is computed with popcounts of the code and of the bit
+/// planes of the quantized query.
+struct RaBitQuantizer {
+    size_t d;                       ///< dimension of the vectors
+    int seed = 1234;                ///< seed of the random rotation
+    float epsilon = 1.9f;           ///< width of the bounds, in errors
+    std::vector<float> center;      ///< d, subtracted before the rotation
+    std::vector<float> rotation;    ///< d x d, row major
+
+    explicit RaBitQuantizer(size_t d = 0);
+
+    /// bytes per code
+    size_t code_size() const {
+        return (d + 7) / 8;
+    }
+
+    /// Compute the center and draw the rotation from the n vectors x
+    void train(size_t n, const float* x);
+
+    /// Encode the n vectors x into n * code_size() bytes and n factors
+    void encode(size_t n, const float* x, uint8_t* codes,
+                RaBitQFactors* factors) const;
+
+    /// Rotate and quantize the query x
+    void prepare_query(const float* x, RaBitQQuery& q) const;
+
+    /// Estimated squared L2 distances between the query and n codes, and
+    /// their lower bounds.  lower_bounds may be null.
+    void estimate(const RaBitQQuery& q, size_t n, const uint8_t* codes,
+                  const RaBitQFactors* factors, float* distances,
+                  float* lower_bounds) const;
+};
+
+}  // namespace vector_search
+
+#endif /* QUANTIZATION_RABITQ_H */
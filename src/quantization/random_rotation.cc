@@ -0,0 +1,54 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "random_rotation.h"
+
+#include "distances/distances.h"
+
+#include <cmath>
+#include <random>
+
+namespace vector_search {
+
+/* The rows of a Gaussian matrix orthonormalized with the modified
+   Gram-Schmidt process.  */
+void
+random_rotation(size_t d, int seed, std::vector<float>& r) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+    r.resize(d * d);
+    for (float& v : r)
+        v = gaussian(rng);
+
+    for (size_t i = 0; i < d; i++) {
+        float* ri = &r[i * d];
+
+        for (size_t j = 0; j < i; j++) {
+            const float* rj = &r[j * d];
+            float dot = fvec_inner_product(ri, rj, d);
+
+            for (size_t l = 0; l < d; l++)
+                ri[l] -= dot * rj[l];
+        }
+
+        float norm = sqrtf(fvec_norm_L2sqr(ri, d));
+        for (size_t l = 0; l < d; l++)
+            ri[l] /= norm;
+    }
+}
+
+}  // namespace vector_search
@@ -0,0 +1,32 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef QUANTIZATION_RANDOM_ROTATION_H
+#define QUANTIZATION_RANDOM_ROTATION_H
+
+#include <cstddef>
+#include <vector>
+
+namespace vector_search {
+
+/// Random orthogonal d x d matrix, row major, drawn from the given seed.
+/// Rotating the vectors by it spreads their variance evenly over the
+/// dimensions, which the 1-bit quantizers rely on.
+void random_rotation(size_t d, int seed, std::vector<float>& r);
+
+}  // namespace vector_search
+
+#endif /* QUANTIZATION_RANDOM_ROTATION_H */
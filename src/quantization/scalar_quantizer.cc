@@ -0,0 +1,109 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scalar_quantizer.h"
+
+#include "distances/distances.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+/* The codes are decoded in blocks of this many dimensions before calling
+   the distance kernels.  */
+#define SQ_DECODE_BLOCK 256
+
+namespace vector_search {
+
+ScalarQuantizer::ScalarQuantizer(size_t d) : d(d), vmin(d, 0), vdiff(d, 0) {}
+
+void
+ScalarQuantizer::train(size_t n, const float* x) {
+    std::vector<float> vmax(d, -HUGE_VALF);
+
+    std::fill(vmin.begin(), vmin.end(), HUGE_VALF);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t l = 0; l < d; l++) {
+            vmin[l] = std::min(vmin[l], x[i * d + l]);
+            vmax[l] = std::max(vmax[l], x[i * d + l]);
+        }
+    }
+    for (size_t l = 0; l < d; l++) {
+        if (n == 0)
+            vmin[l] = vmax[l] = 0;
+        vdiff[l] = vmax[l] - vmin[l];
+    }
+}
+
+void
+ScalarQuantizer::encode(size_t n, const float* x, uint8_t* codes) const {
+    parallel_for(n, 1024, [&](size_t i0, size_t i1) {
+        for (size_t i = i0; i < i1; i++) {
+            for (size_t l = 0; l < d; l++) {
+                float v = 0;
+
+                if (vdiff[l] > 0)
+                    v = (x[i * d + l] - vmin[l]) / vdiff[l];
+                v = std::min(std::max(v, 0.0f), 1.0f);
+                codes[i * d + l] = (uint8_t)std::min(255.0f, v * 256.0f);
+            }
+        }
+    });
+}
+
+void
+ScalarQuantizer::decode(size_t n, const uint8_t* codes, float* x) const {
+    /* Each level decodes to the middle of its interval.  */
+    for (size_t i = 0; i < n; i++)
+        for (size_t l = 0; l < d; l++)
+            x[i * d + l] = vmin[l]
+                           + (codes[i * d + l] + 0.5f) / 256.0f * vdiff[l];
+}
+
+float
+ScalarQuantizer::L2sqr_to_code(const float* x, const uint8_t* code) const {
+    float y[SQ_DECODE_BLOCK];
+    float dis = 0;
+
+    for (size_t l0 = 0; l0 < d; l0 += SQ_DECODE_BLOCK) {
+        size_t nl = std::min((size_t)SQ_DECODE_BLOCK, d - l0);
+
+        for (size_t l = 0; l < nl; l++)
+            y[l] = vmin[l0 + l] + (code[l0 + l] + 0.5f) / 256.0f
+                                  * vdiff[l0 + l];
+        dis += fvec_L2sqr(x + l0, y, nl);
+    }
+    return dis;
+}
+
+float
+ScalarQuantizer::inner_product_to_code(const float* x,
+                                       const uint8_t* code) const {
+    float y[SQ_DECODE_BLOCK];
+    float ip = 0;
+
+    for (size_t l0 = 0; l0 < d; l0 += SQ_DECODE_BLOCK) {
+        size_t nl = std::min((size_t)SQ_DECODE_BLOCK, d - l0);
+
+        for (size_t l = 0; l < nl; l++)
+            y[l] = vmin[l0 + l] + (code[l0 + l] + 0.5f) / 256.0f
+                                  * vdiff[l0 + l];
+        ip += fvec_inner_product(x + l0, y, nl);
+    }
+    return ip;
+}
+
+}  // namespace vector_search
@@ -0,0 +1,59 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef QUANTIZATION_SCALAR_QUANTIZER_H
+#define QUANTIZATION_SCALAR_QUANTIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vector_search {
+
+/// 8-bit scalar quantizer.  Each dimension is mapped to 256 levels
+/// uniformly spread between its minimum and maximum over the training
+/// set, a code is d bytes.
+struct ScalarQuantizer {
+    size_t d;                   ///< dimension of the vectors
+    std::vector<float> vmin;    ///< minimum of each dimension
+    std::vector<float> vdiff;   ///< maximum - minimum of each dimension
+
+    explicit ScalarQuantizer(size_t d = 0);
+
+    /// bytes per code
+    size_t code_size() const {
+        return d;
+    }
+
+    /// Compute the range of each dimension on the n vectors x
+    void train(size_t n, const float* x);
+
+    /// Encode the n vectors x into n * d bytes
+    void encode(size_t n, const float* x, uint8_t* codes) const;
+
+    /// Decode n codes into n * d floats
+    void decode(size_t n, const uint8_t* codes, float* x) const;
+
+    /// Squared L2 distance between the float vector x and a code
+    float L2sqr_to_code(const float* x, const uint8_t* code) const;
+
+    /// Inner product between the float vector x and a code
+    float inner_product_to_code(const float* x, const uint8_t* code) const;
+};
+
+}  // namespace vector_search
+
+#endif /* QUANTIZATION_SCALAR_QUANTIZER_H */
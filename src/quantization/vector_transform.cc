@@ -0,0 +1,280 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vector_transform.h"
+#include "random_rotation.h"
+
+#include "distances/distances.h"
+#include "utils/linalg.h"
+#include "utils/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/* Number of vectors transformed together by the VSX LinearTransform::apply,
+   the largest batch of fvec_inner_products_ny.  */
+#define TRANSFORM_BLOCK 16
+
+/* Rows of the cross product matrices computed by each task.  */
+#define TRANSFORM_ROW_BLOCK 16
+
+namespace vector_search {
+
+LinearTransform::LinearTransform(size_t d_in, size_t d_out)
+    : VectorTransform(d_in, d_out) {}
+
+/* xt = x A^T + b.  On Power10 the product is one call of the MMA GEMM
+   kernel.  Otherwise the TRANSFORM_BLOCK input vectors are contiguous, so
+   that a row of A is loaded once for all of them and the vectors stay in
+   the cache across the d_out rows.  */
+void
+LinearTransform::apply(size_t n, const float* x, float* xt) const {
+    if (!is_trained) {
+        std::cout << "ERROR, vector transform applied before train.\n";
+        exit (-1);
+    }
+
+#if defined(__MMA__)
+    fvec_inner_products_gemm(xt, x, n, A.data(), d_out, d_in);
+
+    if (!b.empty())
+        parallel_for(n, 64, [&](size_t i0, size_t i1) {
+            for (size_t i = i0; i < i1; i++)
+                for (size_t r = 0; r < d_out; r++)
+                    xt[i * d_out + r] += b[r];
+        });
+#else
+    parallel_for(n, 64, [&](size_t i0, size_t i1) {
+        float dis[TRANSFORM_BLOCK];
+
+        for (size_t j0 = i0; j0 < i1; j0 += TRANSFORM_BLOCK) {
+            size_t nb = std::min((size_t)TRANSFORM_BLOCK, i1 - j0);
+
+            for (size_t r = 0; r < d_out; r++) {
+                float bias = b.empty() ? 0 : b[r];
+
+                fvec_inner_products_ny(dis, A.data() + r * d_in,
+                                       x + j0 * d_in, d_in, nb);
+                for (size_t t = 0; t < nb; t++)
+                    xt[(j0 + t) * d_out + r] = dis[t] + bias;
+            }
+        }
+    });
+#endif
+}
+
+RandomRotation::RandomRotation(size_t d_in, size_t d_out)
+    : LinearTransform(d_in, d_out ? d_out : d_in) {
+    if (this->d_out > d_in) {
+        std::cout << "ERROR, RandomRotation output dimension " << this->d_out
+                  << " larger than the input dimension " << d_in << ".\n";
+        exit (-1);
+    }
+    is_trained = false;
+}
+
+void
+RandomRotation::train(size_t /*n*/, const float* /*x*/) {
+    random_rotation(d_in, seed, A);
+    A.resize(d_out * d_in);
+    is_trained = true;
+}
+
+/* m = sum over the n vectors of y_i^T x_i, a dy x dx matrix.  The rows of
+   m are spread over the threads, each streams the vectors once.  */
+static void
+cross_products(size_t n, const float* y, size_t dy, const float* x,
+               size_t dx, std::vector<double>& m) {
+    m.assign(dy * dx, 0);
+
+    parallel_for(dy, TRANSFORM_ROW_BLOCK, [&](size_t r0, size_t r1) {
+        for (size_t i = 0; i < n; i++) {
+            const float* xi = x + i * dx;
+
+            for (size_t r = r0; r < r1; r++) {
+                double a = y[i * dy + r];
+                double* mr = &m[r * dx];
+
+                for (size_t j = 0; j < dx; j++)
+                    mr[j] += a * xi[j];
+            }
+        }
+    });
+}
+
+PCATransform::PCATransform(size_t d_in, size_t d_out)
+    : LinearTransform(d_in, d_out), mean(d_in, 0) {
+    if (d_out > d_in) {
+        std::cout << "ERROR, PCATransform output dimension " << d_out
+                  << " larger than the input dimension " << d_in << ".\n";
+        exit (-1);
+    }
+    is_trained = false;
+}
+
+/* The covariance is E[x x^T] - mean mean^T, computed in double precision,
+   its eigenvectors of the largest eigenvalues are the rows of A.  */
+void
+PCATransform::train(size_t n, const float* x) {
+    std::vector<double> cov, values;
+
+    if (n == 0) {
+        std::cout << "ERROR, PCATransform trained on no vectors.\n";
+        exit (-1);
+    }
+
+    for (size_t l = 0; l < d_in; l++) {
+        double sum = 0;
+
+        for (size_t i = 0; i < n; i++)
+            sum += x[i * d_in + l];
+        mean[l] = sum / n;
+    }
+
+    cross_products(n, x, d_in, x, d_in, cov);
+    for (size_t i = 0; i < d_in; i++)
+        for (size_t j = 0; j < d_in; j++)
+            cov[i * d_in + j] = cov[i * d_in + j] / n
+                                - (double)mean[i] * mean[j];
+
+    symmetric_eigen(d_in, cov, values);
+    eigenvalues.assign(values.begin(), values.end());
+
+    A.resize(d_out * d_in);
+    b.resize(d_out);
+    for (size_t r = 0; r < d_out; r++) {
+        double scale = 1;
+
+        if (eigen_power != 0)
+            scale = pow(std::max(values[r], 1e-30), eigen_power);
+        for (size_t j = 0; j < d_in; j++)
+            A[r * d_in + j] = scale * cov[r * d_in + j];
+        b[r] = -fvec_inner_product(&A[r * d_in], mean.data(), d_in);
+    }
+    is_trained = true;
+}
+
+float
+PCATransform::explained_variance() const {
+    double kept = 0, total = 0;
+
+    for (size_t l = 0; l < eigenvalues.size(); l++) {
+        total += std::max(eigenvalues[l], 0.0f);
+        if (l < d_out)
+            kept += std::max(eigenvalues[l], 0.0f);
+    }
+    return total > 0 ? kept / total : 1;
+}
+
+OPQTransform::OPQTransform(size_t d, size_t M)
+    : LinearTransform(d, d), M(M), pq(d, M) {
+    is_trained = false;
+}
+
+/* Starting from a random rotation, each iteration trains the PQ on the
+   rotated vectors x R^T, reconstructs them as y, and replaces R by the
+   orthogonal matrix minimizing || x R^T - y ||, the orthogonal factor of
+   y^T x.  */
+void
+OPQTransform::train(size_t n, const float* x) {
+    size_t ns = max_train ? std::min(n, max_train) : n;
+    std::vector<float> xr(ns * d_in), y(ns * d_in);
+    std::vector<uint8_t> codes(ns * M);
+    std::vector<double> m;
+
+    random_rotation(d_in, seed, A);
+    is_trained = true;
+
+    for (int it = 0; it < niter; it++) {
+        apply(ns, x, xr.data());
+
+        pq.params.niter = niter_pq;
+        pq.params.seed = seed + it;
+        pq.train(ns, xr.data());
+        pq.encode(ns, xr.data(), codes.data());
+        pq.decode(ns, codes.data(), y.data());
+
+        if (verbose) {
+            double err = 0;
+
+            for (size_t i = 0; i < ns; i++)
+                err += fvec_L2sqr(&xr[i * d_in], &y[i * d_in], d_in);
+            std::cout << "OPQ iteration " << it << ", reconstruction error "
+                      << err / ns << "\n";
+        }
+
+        cross_products(ns, y.data(), d_in, x, d_in, m);
+        nearest_orthogonal(d_in, m, A);
+    }
+
+    /* Final PQ, with the default number of k-means iterations.  */
+    apply(ns, x, xr.data());
+    pq.params = KMeansParams();
+    pq.train(ns, xr.data());
+}
+
+void
+TransformChain::add(std::unique_ptr<VectorTransform> t) {
+    if (!transforms.empty() && t->d_in != d_out()) {
+        std::cout << "ERROR, transform of input dimension " << t->d_in
+                  << " appended after output dimension " << d_out()
+                  << ".\n";
+        exit (-1);
+    }
+    transforms.push_back(std::move(t));
+}
+
+/* The last transform is trained but its output is not needed.  */
+void
+TransformChain::train(size_t n, const float* x) {
+    std::vector<float> cur, next;
+    const float* in = x;
+
+    for (size_t i = 0; i < transforms.size(); i++) {
+        VectorTransform& t = *transforms[i];
+
+        if (!t.is_trained)
+            t.train(n, in);
+        if (i + 1 == transforms.size())
+            break;
+        next.resize(n * t.d_out);
+        t.apply(n, in, next.data());
+        cur.swap(next);
+        in = cur.data();
+    }
+}
+
+void
+TransformChain::apply(size_t n, const float* x, float* xt) const {
+    std::vector<float> cur, next;
+    const float* in = x;
+
+    for (size_t i = 0; i < transforms.size(); i++) {
+        const VectorTransform& t = *transforms[i];
+
+        if (i + 1 == transforms.size()) {
+            t.apply(n, in, xt);
+            break;
+        }
+        next.resize(n * t.d_out);
+        t.apply(n, in, next.data());
+        cur.swap(next);
+        in = cur.data();
+    }
+}
+
+}  // namespace vector_search
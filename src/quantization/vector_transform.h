@@ -0,0 +1,128 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef QUANTIZATION_VECTOR_TRANSFORM_H
+#define QUANTIZATION_VECTOR_TRANSFORM_H
+
+#include "product_quantizer.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace vector_search {
+
+/// Transform of vectors of d_in dimensions into vectors of d_out
+/// dimensions, applied to the database and the query vectors before an
+/// index or a quantizer.
+struct VectorTransform {
+    size_t d_in;                ///< input dimension
+    size_t d_out;               ///< output dimension
+    bool is_trained = true;
+
+    VectorTransform(size_t d_in, size_t d_out) : d_in(d_in), d_out(d_out) {}
+
+    virtual ~VectorTransform() {}
+
+    /// Fit the transform to the n vectors x, when it needs training
+    virtual void train(size_t /*n*/, const float* /*x*/) {}
+
+    /// Transform the n vectors x into the n * d_out floats xt
+    virtual void apply(size_t n, const float* x, float* xt) const = 0;
+};
+
+/// xt = A x + b.  The vectors are transformed 16 at a time, each row of A
+/// being multiplied by the 16 vectors with the batch inner product kernel.
+struct LinearTransform : VectorTransform {
+    std::vector<float> A;       ///< d_out x d_in, row major
+    std::vector<float> b;       ///< d_out, empty for no bias
+
+    LinearTransform(size_t d_in, size_t d_out);
+
+    void apply(size_t n, const float* x, float* xt) const override;
+};
+
+/// Random orthogonal rotation, or with d_out < d_in the projection on
+/// d_out random orthonormal directions.
+struct RandomRotation : LinearTransform {
+    int seed = 1234;            ///< seed of the random matrix
+
+    explicit RandomRotation(size_t d_in, size_t d_out = 0);
+
+    /// Draw the matrix, the vectors are not used
+    void train(size_t n, const float* x) override;
+};
+
+/// Projection on the d_out principal components of the training set,
+/// after subtracting its mean.  The components are scaled by their
+/// eigenvalue to the power eigen_power, -0.5 whitens the output.
+struct PCATransform : LinearTransform {
+    float eigen_power = 0;              ///< scaling of the components
+    std::vector<float> mean;            ///< d_in, of the training set
+    std::vector<float> eigenvalues;     ///< d_in, in decreasing order
+
+    PCATransform(size_t d_in, size_t d_out);
+
+    void train(size_t n, const float* x) override;
+
+    /// Fraction of the variance of the training set kept by the d_out
+    /// components
+    float explained_variance() const;
+};
+
+/// Optimized product quantization rotation (Ge et al., CVPR 2013).  The
+/// rotation R and a product quantizer of M sub-quantizers are trained
+/// alternately: the PQ is trained on the rotated vectors, then R is the
+/// orthogonal matrix that best maps the vectors to their PQ
+/// reconstructions, which balances the variance between the sub-spaces.
+struct OPQTransform : LinearTransform {
+    size_t M;                   ///< sub-quantizers of the target PQ
+    int niter = 25;             ///< alternating iterations
+    int niter_pq = 4;           ///< k-means iterations of each PQ training
+    size_t max_train = 65536;   ///< training vectors used, 0 for all
+    int seed = 1234;            ///< seed of the initial rotation
+    bool verbose = false;       ///< print the reconstruction error
+
+    /// PQ trained with the final rotation, on the rotated training set
+    ProductQuantizer pq;
+
+    OPQTransform(size_t d, size_t M);
+
+    void train(size_t n, const float* x) override;
+};
+
+/// Sequence of transforms, each applied to the output of the previous
+/// one.  Training trains the transforms in order on the transformed
+/// training set.
+struct TransformChain {
+    std::vector<std::unique_ptr<VectorTransform>> transforms;
+
+    /// Append t, whose d_in must be the current d_out()
+    void add(std::unique_ptr<VectorTransform> t);
+
+    size_t d_out() const {
+        return transforms.empty() ? 0 : transforms.back()->d_out;
+    }
+
+    void train(size_t n, const float* x);
+
+    /// Transform the n vectors x into the n * d_out() floats xt
+    void apply(size_t n, const float* x, float* xt) const;
+};
+
+}  // namespace vector_search
+
+#endif /* QUANTIZATION_VECTOR_TRANSFORM_H */
@@ -0,0 +1,169 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_ALIGNED_BUFFER_H
+#define UTILS_ALIGNED_BUFFER_H
+
+#include "memory.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+/* Alignment of the buffers, the size of a POWER cache line.  */
+#define BUFFER_ALIGNMENT 128
+
+namespace vector_search {
+
+/// Growable array of trivially copyable elements, whose data is aligned on
+/// a cache line.  The capacity grows geometrically, the existing elements
+/// are copied when the buffer is reallocated.
+///
+/// The buffer starts with the default memory policy.  When the policy maps
+/// the data, it is allocated with memory_alloc, on huge pages or on given
+/// NUMA nodes, otherwise from the heap.
+template <typename T>
+struct AlignedBuffer {
+    AlignedBuffer() = default;
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    AlignedBuffer(AlignedBuffer&& other) noexcept {
+        swap(other);
+    }
+
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~AlignedBuffer() {
+        release();
+    }
+
+    T* data() {
+        return ptr;
+    }
+
+    const T* data() const {
+        return ptr;
+    }
+
+    size_t size() const {
+        return n;
+    }
+
+    T& operator[](size_t i) {
+        return ptr[i];
+    }
+
+    const T& operator[](size_t i) const {
+        return ptr[i];
+    }
+
+    const MemoryPolicy& get_policy() const {
+        return policy;
+    }
+
+    /// Store the data according to new_policy.  The existing elements are
+    /// moved to a new allocation.
+    void set_policy(const MemoryPolicy& new_policy) {
+        policy = new_policy;
+        if (capacity)
+            reallocate(capacity);
+    }
+
+    /// Make room for at least new_capacity elements
+    void reserve(size_t new_capacity) {
+        if (new_capacity > capacity)
+            reallocate(new_capacity);
+    }
+
+    /// Append the count elements src
+    void append(const T* src, size_t count) {
+        if (n + count > capacity)
+            reserve(std::max(n + count, 2 * capacity));
+        memcpy(ptr + n, src, count * sizeof(T));
+        n += count;
+    }
+
+    /// Set the number of elements to new_size, the added elements are set
+    /// to value
+    void resize(size_t new_size, const T& value = T()) {
+        if (new_size > capacity)
+            reserve(std::max(new_size, 2 * capacity));
+        for (size_t i = n; i < new_size; i++)
+            ptr[i] = value;
+        n = new_size;
+    }
+
+    /// Remove all the elements, the memory is kept
+    void clear() {
+        n = 0;
+    }
+
+    void swap(AlignedBuffer& other) noexcept {
+        std::swap(ptr, other.ptr);
+        std::swap(n, other.n);
+        std::swap(capacity, other.capacity);
+        std::swap(mapped_size, other.mapped_size);
+        std::swap(policy, other.policy);
+    }
+
+  private:
+    T* ptr = nullptr;
+    size_t n = 0;
+    size_t capacity = 0;
+    size_t mapped_size = 0;     ///< bytes of the mapping, 0 for the heap
+    MemoryPolicy policy = get_default_memory_policy();
+
+    void reallocate(size_t new_capacity) {
+        void* new_ptr;
+        size_t new_mapped_size = 0;
+
+        if (policy.maps(new_capacity * sizeof(T))) {
+            new_mapped_size = new_capacity * sizeof(T);
+            new_ptr = memory_alloc(new_mapped_size, policy);
+            new_capacity = new_mapped_size / sizeof(T);
+        } else if (posix_memalign(&new_ptr, BUFFER_ALIGNMENT,
+                                  new_capacity * sizeof(T)) != 0) {
+            std::cout << "ERROR, failed to allocate "
+                      << new_capacity * sizeof(T) << " bytes.\n";
+            exit(-1);
+        }
+        if (n)
+            memcpy(new_ptr, ptr, n * sizeof(T));
+        release();
+        ptr = (T*)new_ptr;
+        capacity = new_capacity;
+        mapped_size = new_mapped_size;
+    }
+
+    void release() {
+        if (mapped_size)
+            memory_free(ptr, mapped_size);
+        else
+            free(ptr);
+    }
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_ALIGNED_BUFFER_H */
@@ -0,0 +1,198 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+/* Alignment of the arena chunks, enough for the O_DIRECT buffers.  */
+#define ARENA_CHUNK_ALIGNMENT 4096
+
+/* Size classes of the pools, 2^SCRATCH_MIN_CLASS to 2^SCRATCH_MAX_CLASS
+   bytes.  Larger buffers are allocated and freed directly.  */
+#define SCRATCH_MIN_CLASS 6
+#define SCRATCH_MAX_CLASS 30
+#define SCRATCH_NUM_CLASSES (SCRATCH_MAX_CLASS + 1)
+
+/* Bytes of free buffers a pool keeps per size class, and the least number
+   of buffers it keeps of the large classes.  */
+#define SCRATCH_CLASS_BYTES (4 << 20)
+#define SCRATCH_MIN_FREE 4
+
+/* Header before each pooled buffer, holding its size class.  Keeps the
+   buffers aligned for any type of the containers.  */
+#define SCRATCH_HEADER 16
+
+namespace vector_search {
+
+static std::atomic<size_t> heap_allocations(0);
+
+Arena::Arena(size_t chunk_size) : chunk_size(chunk_size) {}
+
+Arena::~Arena() {
+    for (Chunk& c : chunks)
+        ::operator delete(c.data, std::align_val_t(ARENA_CHUNK_ALIGNMENT));
+}
+
+void
+Arena::add_chunk(size_t size) {
+    Chunk c;
+
+    c.size = size;
+    c.data = (char*)::operator new(size,
+                                   std::align_val_t(ARENA_CHUNK_ALIGNMENT));
+    heap_allocations++;
+    chunks.push_back(c);
+    current = chunks.size() - 1;
+    offset = 0;
+}
+
+/* An allocation that does not fit in the current chunk goes to the next
+   one, or to a new chunk as large as all the others together.  */
+void*
+Arena::allocate(size_t size, size_t align) {
+    for (;;) {
+        if (current < chunks.size()) {
+            Chunk& c = chunks[current];
+            uintptr_t base = (uintptr_t)c.data;
+            size_t start = ((base + offset + align - 1) & ~(align - 1)) - base;
+
+            if (start + size <= c.size) {
+                offset = start + size;
+                return c.data + start;
+            }
+            if (current + 1 < chunks.size()) {
+                current++;
+                offset = 0;
+                continue;
+            }
+        }
+        add_chunk(std::max(std::max(chunk_size, capacity()), size + align));
+    }
+}
+
+void
+Arena::release(const Mark& m) {
+    current = m.chunk;
+    offset = m.offset;
+
+    if (current == 0 && offset == 0 && chunks.size() > 1) {
+        size_t total = capacity();
+
+        for (Chunk& c : chunks)
+            ::operator delete(c.data,
+                              std::align_val_t(ARENA_CHUNK_ALIGNMENT));
+        chunks.clear();
+        add_chunk(total);
+    }
+}
+
+size_t
+Arena::capacity() const {
+    size_t total = 0;
+
+    for (const Chunk& c : chunks)
+        total += c.size;
+    return total;
+}
+
+Arena&
+thread_arena() {
+    static thread_local Arena arena;
+
+    return arena;
+}
+
+/* Free lists of a thread, linked through the first bytes of the buffers.
+   The buffers freed after the pool of their thread is destroyed, by the
+   destructors of other thread_local objects, go back to the heap.  */
+struct ScratchPool {
+    void* free_lists[SCRATCH_NUM_CLASSES] = {};
+    size_t nfree[SCRATCH_NUM_CLASSES] = {};
+
+    ~ScratchPool();
+};
+
+static thread_local bool pool_destroyed = false;
+static thread_local ScratchPool pool;
+
+ScratchPool::~ScratchPool() {
+    for (size_t c = 0; c < SCRATCH_NUM_CLASSES; c++) {
+        while (free_lists[c]) {
+            void* p = free_lists[c];
+
+            free_lists[c] = *(void**)p;
+            ::operator delete((char*)p - SCRATCH_HEADER);
+        }
+    }
+    pool_destroyed = true;
+}
+
+static size_t
+size_class(size_t size) {
+    size_t c = SCRATCH_MIN_CLASS;
+
+    while (c <= SCRATCH_MAX_CLASS && ((size_t)1 << c) < size)
+        c++;
+    return c;
+}
+
+void*
+scratch_allocate(size_t size) {
+    size_t c = size_class(size);
+    char* p;
+
+    if (c <= SCRATCH_MAX_CLASS && !pool_destroyed && pool.free_lists[c]) {
+        p = (char*)pool.free_lists[c];
+        pool.free_lists[c] = *(void**)p;
+        pool.nfree[c]--;
+        return p;
+    }
+
+    if (c <= SCRATCH_MAX_CLASS)
+        size = (size_t)1 << c;
+    p = (char*)::operator new(size + SCRATCH_HEADER);
+    heap_allocations++;
+    *(size_t*)p = c;
+    return p + SCRATCH_HEADER;
+}
+
+void
+scratch_deallocate(void* p) {
+    char* base = (char*)p - SCRATCH_HEADER;
+    size_t c = *(size_t*)base;
+
+    if (c > SCRATCH_MAX_CLASS || pool_destroyed
+        || pool.nfree[c] >= std::max((size_t)SCRATCH_MIN_FREE,
+                                     (size_t)SCRATCH_CLASS_BYTES >> c)) {
+        ::operator delete(base);
+        return;
+    }
+    *(void**)p = pool.free_lists[c];
+    pool.free_lists[c] = p;
+    pool.nfree[c]++;
+}
+
+size_t
+scratch_heap_allocations() {
+    return heap_allocations;
+}
+
+}  // namespace vector_search
@@ -0,0 +1,169 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef UTILS_ARENA_H
+#define UTILS_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+/* Alignment of the arena allocations, the size of a POWER cache line.  */
+#define ARENA_ALIGNMENT 128
+
+/* Size of the first chunk of an arena.  */
+#define ARENA_CHUNK_SIZE (256 * 1024)
+
+namespace vector_search {
+
+/// Bump allocator for the temporaries of a search: distance buffers, label
+/// lists, query norms.  An allocation advances a pointer in the current
+/// chunk, and release() frees all the allocations made after a mark(), in
+/// the reverse order of the marks, which ArenaScope does.  When a query
+/// needs more than the chunk, another chunk is added, and once all the
+/// allocations are released the chunks are replaced by one chunk of their
+/// total size, so that after the first queries the arena of a thread does
+/// not allocate anymore.  The memory is not initialized.  An arena is used
+/// by one thread.
+struct Arena {
+    /// Position in the arena
+    struct Mark {
+        size_t chunk;
+        size_t offset;
+    };
+
+    explicit Arena(size_t chunk_size = ARENA_CHUNK_SIZE);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// size bytes aligned on align, a power of 2 up to the page size
+    void* allocate(size_t size, size_t align = ARENA_ALIGNMENT);
+
+    /// n uninitialized objects of the trivial type T
+    template <typename T>
+    T* alloc(size_t n) {
+        return (T*)allocate(n * sizeof(T));
+    }
+
+    Mark mark() const {
+        return Mark{current, offset};
+    }
+
+    /// Free the allocations made since m was returned by mark()
+    void release(const Mark& m);
+
+    /// Total size of the chunks
+    size_t capacity() const;
+
+  private:
+    struct Chunk {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t current = 0;     ///< chunk of the next allocation
+    size_t offset = 0;      ///< bytes used in chunks[current]
+    size_t chunk_size;
+
+    void add_chunk(size_t size);
+};
+
+/// Arena of the calling thread
+Arena&
+thread_arena();
+
+/// Frees, when it is destroyed, the allocations made in an arena during its
+/// lifetime.  A search opens one per call or per query.
+struct ArenaScope {
+    explicit ArenaScope(Arena& arena = thread_arena())
+        : arena(arena), start(arena.mark()) {}
+
+    ~ArenaScope() {
+        arena.release(start);
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    template <typename T>
+    T* alloc(size_t n) {
+        return arena.alloc<T>(n);
+    }
+
+    Arena& arena;
+
+  private:
+    Arena::Mark start;
+};
+
+/// Buffers of the containers of the searches, heaps, candidate queues and
+/// result lists, kept on free lists per size class, the powers of 2, in a
+/// pool per thread.  A freed buffer goes to the pool of the freeing thread,
+/// where the next allocation of its class takes it.  The pools keep a
+/// bounded number of buffers of each class.
+void*
+scratch_allocate(size_t size);
+
+/// Return a buffer of scratch_allocate to the pool of the calling thread
+void
+scratch_deallocate(void* p);
+
+/// Number of heap allocations made by the arenas and the pools of all the
+/// threads.  Constant at the steady state of a search workload.
+size_t
+scratch_heap_allocations();
+
+/// Allocator of the pooled buffers, for the standard containers
+template <typename T>
+struct ScratchAllocator {
+    typedef T value_type;
+
+    ScratchAllocator() = default;
+
+    template <typename U>
+    ScratchAllocator(const ScratchAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return (T*)scratch_allocate(n * sizeof(T));
+    }
+
+    void deallocate(T* p, size_t) {
+        scratch_deallocate(p);
+    }
+};
+
+template <typename T, typename U>
+bool
+operator==(const ScratchAllocator<T>&, const ScratchAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool
+operator!=(const ScratchAllocator<T>&, const ScratchAllocator<U>&) {
+    return false;
+}
+
+/// Vector whose buffer comes from the pool of the thread
+template <typename T>
+using ScratchVector = std::vector<T, ScratchAllocator<T>>;
+
+}  // namespace vector_search
+
+#endif /* UTILS_ARENA_H */
@@ -0,0 +1,55 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "blocked_layout.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vector_search {
+
+/* The blocks are written in order, so that the output is streamed, and
+   the block vectors are read one component at a time.  */
+void
+fvec_to_blocked(float* yb, const float* y, size_t d, size_t n, size_t block) {
+    size_t nb = blocked_num_blocks(n, block);
+
+    for (size_t b = 0; b < nb; b++) {
+        size_t nt = std::min(block, n - b * block);
+        float* out = yb + b * block * d;
+
+        if (nt < block)
+            memset(out, 0, sizeof(float) * block * d);
+
+        for (size_t l = 0; l < d; l++)
+            for (size_t t = 0; t < nt; t++)
+                out[l * block + t] = y[(b * block + t) * d + l];
+    }
+}
+
+void
+fvec_from_blocked(float* y, const float* yb, size_t d, size_t n,
+                  size_t block) {
+    for (size_t i = 0; i < n; i++) {
+        const float* in = yb + (i / block) * block * d + i % block;
+
+        for (size_t l = 0; l < d; l++)
+            y[i * d + l] = in[l * block];
+    }
+}
+
+}  // namespace vector_search
@@ -0,0 +1,56 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef UTILS_BLOCKED_LAYOUT_H
+#define UTILS_BLOCKED_LAYOUT_H
+
+#include <cstddef>
+
+namespace vector_search {
+
+/// Blocked layout of a set of vectors, used by the _blocked distance
+/// kernels.  The vectors are grouped in blocks of block vectors, and each
+/// block stores its vectors dimension-interleaved: component l of vector
+/// b * block + t is at yb[(b * d + l) * block + t].  A vector load at
+/// (b, l) thus reads component l of consecutive vectors, one per lane.
+/// The last block is padded with zero vectors.
+
+/// Number of blocks of block vectors holding n vectors
+inline size_t
+blocked_num_blocks(size_t n, size_t block) {
+    return (n + block - 1) / block;
+}
+
+/// Number of floats of the blocked layout of n vectors of dimension d
+inline size_t
+blocked_size(size_t n, size_t d, size_t block) {
+    return blocked_num_blocks(n, block) * block * d;
+}
+
+/// Store the n row-major vectors y in the blocked layout yb, of
+/// blocked_size(n, d, block) floats
+void
+fvec_to_blocked(float* yb, const float* y, size_t d, size_t n, size_t block);
+
+/// Inverse of fvec_to_blocked, the n vectors of yb to row-major y
+void
+fvec_from_blocked(float* y, const float* yb, size_t d, size_t n,
+                  size_t block);
+
+}  // namespace vector_search
+
+#endif /* UTILS_BLOCKED_LAYOUT_H */
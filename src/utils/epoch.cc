@@ -0,0 +1,122 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "epoch.h"
+
+#include <algorithm>
+#include <thread>
+
+/* Number of retired structures above which retire() reclaims, added to
+   the number that the last reclaim could not free.  */
+#define EPOCH_RECLAIM_BATCH 64
+
+namespace vector_search {
+
+EpochManager::EpochManager() : next_reclaim(EPOCH_RECLAIM_BATCH) {}
+
+EpochManager::~EpochManager() {
+    for (const Retired& r : retired)
+        r.deleter(r.p);
+}
+
+/* The reader first looks for a free slot from the one it used last.  The
+   fence after the slot is taken orders the publication of the epoch before
+   the loads of the structures, against the fence of reclaim_locked: either
+   the writer sees the slot, or the reader loads the new structures.  The
+   epoch is loaded with acquire, so that a reader that sees an epoch
+   advanced by retire() also sees the structure replaced before.  */
+size_t
+EpochManager::pin() {
+    static thread_local size_t hint = 0;
+
+    for (;;) {
+        for (size_t t = 0; t < EPOCH_MAX_READERS; t++) {
+            size_t s = (hint + t) % EPOCH_MAX_READERS;
+            uint64_t expected = 0;
+
+            if (slots[s].epoch.load(std::memory_order_relaxed) != 0)
+                continue;
+            if (!slots[s].epoch.compare_exchange_strong(
+                    expected, epoch.load(std::memory_order_acquire)))
+                continue;
+
+            size_t n = nslots.load(std::memory_order_relaxed);
+            while (n <= s && !nslots.compare_exchange_weak(n, s + 1))
+                ;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            hint = s;
+            return s;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void
+EpochManager::unpin(size_t slot) {
+    slots[slot].epoch.store(0, std::memory_order_release);
+}
+
+/* A structure retired at epoch e may be used by the readers that took
+   their slot at epoch e or before.  The readers that take a slot later see
+   the epoch advanced past e, after the structure was replaced.  */
+void
+EpochManager::retire(void* p, void (*deleter)(void*)) {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+
+    retired.push_back(Retired{epoch.fetch_add(1), p, deleter});
+    if (retired.size() >= next_reclaim)
+        reclaim_locked();
+}
+
+void
+EpochManager::reclaim() {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+
+    reclaim_locked();
+}
+
+void
+EpochManager::reclaim_locked() {
+    uint64_t oldest = UINT64_MAX;
+    size_t n = nslots.load(std::memory_order_acquire), kept = 0;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (size_t s = 0; s < n; s++) {
+        uint64_t e = slots[s].epoch.load(std::memory_order_acquire);
+
+        if (e != 0)
+            oldest = std::min(oldest, e);
+    }
+
+    for (const Retired& r : retired) {
+        if (r.epoch < oldest)
+            r.deleter(r.p);
+        else
+            retired[kept++] = r;
+    }
+    retired.resize(kept);
+    next_reclaim = kept + EPOCH_RECLAIM_BATCH;
+}
+
+size_t
+EpochManager::pending() const {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+
+    return retired.size();
+}
+
+}  // namespace vector_search
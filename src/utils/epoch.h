@@ -0,0 +1,118 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef UTILS_EPOCH_H
+#define UTILS_EPOCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/* Number of readers that may hold an EpochGuard of one manager at once.
+   A reader beyond it waits for a slot.  */
+#define EPOCH_MAX_READERS 256
+
+/* Size of the slots of the readers, the size of a POWER cache line.  */
+#define EPOCH_SLOT_SIZE 128
+
+namespace vector_search {
+
+/// Epoch-based reclamation of the structures that the writers of an index
+/// replace while readers may still be using them, such as an inverted list
+/// that is reallocated to grow or a neighbor list that is rebuilt.
+///
+/// A reader holds an EpochGuard while it uses the structures: the guard
+/// publishes the current epoch in a slot of the reader.  A writer that
+/// replaces a structure publishes the new one, then passes the old one to
+/// retire(), which tags it with the current epoch and advances the epoch.
+/// The old structure is freed once no reader holds a guard taken at or
+/// before its epoch, so a reader never waits for a writer and never sees a
+/// freed structure.
+struct EpochManager {
+    EpochManager();
+
+    /// Frees all the retired structures, no reader may hold a guard
+    ~EpochManager();
+
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    /// Free p with deleter once the readers that may use it are done
+    void retire(void* p, void (*deleter)(void*));
+
+    template <typename T>
+    void retire(T* p) {
+        retire(p, [](void* q) { delete (T*)q; });
+    }
+
+    /// Free the retired structures that no reader can use anymore
+    void reclaim();
+
+    /// Number of retired structures not freed yet
+    size_t pending() const;
+
+    /// Take a free slot and publish the current epoch in it, the slot is
+    /// returned.  Used by EpochGuard.
+    size_t pin();
+
+    void unpin(size_t slot);
+
+  private:
+    struct alignas(EPOCH_SLOT_SIZE) Slot {
+        std::atomic<uint64_t> epoch{0};     ///< 0 when free
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void* p;
+        void (*deleter)(void*);
+    };
+
+    std::atomic<uint64_t> epoch{1};
+    std::atomic<size_t> nslots{0};      ///< slots used so far
+    Slot slots[EPOCH_MAX_READERS];
+
+    mutable std::mutex retired_mutex;
+    std::vector<Retired> retired;
+    size_t next_reclaim;                ///< size of retired to reclaim at
+
+    void reclaim_locked();
+};
+
+/// Pins the epoch of a manager while it exists.  The structures loaded
+/// from the index during its lifetime stay valid until it is destroyed.
+struct EpochGuard {
+    explicit EpochGuard(EpochManager& manager)
+        : manager(manager), slot(manager.pin()) {}
+
+    ~EpochGuard() {
+        manager.unpin(slot);
+    }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+  private:
+    EpochManager& manager;
+    size_t slot;
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_EPOCH_H */
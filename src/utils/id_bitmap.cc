@@ -0,0 +1,137 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "id_bitmap.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace vector_search {
+
+IDBitmap::IDBitmap(size_t n)
+    : n(n), words((n + 63) / 64, 0),
+      block_counts((n + 64 * ID_BITMAP_BLOCK_WORDS - 1)
+                   / (64 * ID_BITMAP_BLOCK_WORDS), 0) {}
+
+/* Replace word w, keeping the counters up to date.  */
+void
+IDBitmap::set_word(size_t w, uint64_t value) {
+    int before = __builtin_popcountll(words[w]);
+    int after = __builtin_popcountll(value);
+
+    nwords_set += (after != 0) - (before != 0);
+    nset += after - before;
+    block_counts[w / ID_BITMAP_BLOCK_WORDS] += after - before;
+    words[w] = value;
+}
+
+void
+IDBitmap::set(int64_t id) {
+    if (id < 0 || (size_t)id >= n) {
+        std::cout << "ERROR, label " << id << " out of the range of a "
+                  << "bitmap of " << n << " labels.\n";
+        exit (-1);
+    }
+    set_word(id >> 6, words[id >> 6] | (uint64_t(1) << (id & 63)));
+}
+
+void
+IDBitmap::unset(int64_t id) {
+    if (id < 0 || (size_t)id >= n)
+        return;
+    set_word(id >> 6, words[id >> 6] & ~(uint64_t(1) << (id & 63)));
+}
+
+void
+IDBitmap::set_range(size_t i0, size_t i1) {
+    i1 = std::min(i1, n);
+
+    while (i0 < i1) {
+        size_t w = i0 / 64;
+        size_t end = std::min(i1, (w + 1) * 64);
+        uint64_t mask = end - i0 == 64 ? ~uint64_t(0)
+                        : ((uint64_t(1) << (end - i0)) - 1) << (i0 & 63);
+
+        set_word(w, words[w] | mask);
+        i0 = end;
+    }
+}
+
+/* The blocks with no allowed label are skipped with their counter, the
+   other words are tested whole.  */
+bool
+IDBitmap::any(size_t i0, size_t i1) const {
+    i1 = std::min(i1, n);
+
+    while (i0 < i1) {
+        size_t w = i0 / 64;
+        size_t b = w / ID_BITMAP_BLOCK_WORDS;
+
+        if (block_counts[b] == 0) {
+            i0 = (b + 1) * ID_BITMAP_BLOCK_WORDS * 64;
+            continue;
+        }
+
+        size_t end = std::min(i1, (w + 1) * 64);
+        uint64_t bits = words[w] >> (i0 & 63);
+
+        if (end - i0 < 64)
+            bits &= (uint64_t(1) << (end - i0)) - 1;
+        if (bits)
+            return true;
+        i0 = end;
+    }
+    return false;
+}
+
+void
+IDBitmap::get_ids(size_t i0, size_t i1, std::vector<int64_t>& ids) const {
+    size_t n0 = ids.size();
+
+    ids.resize(n0 + count());
+    ids.resize(n0 + get_ids(i0, i1, ids.data() + n0));
+}
+
+size_t
+IDBitmap::get_ids(size_t i0, size_t i1, int64_t* ids) const {
+    size_t nids = 0;
+
+    i1 = std::min(i1, n);
+
+    while (i0 < i1) {
+        size_t w = i0 / 64;
+        size_t b = w / ID_BITMAP_BLOCK_WORDS;
+
+        if (block_counts[b] == 0) {
+            i0 = (b + 1) * ID_BITMAP_BLOCK_WORDS * 64;
+            continue;
+        }
+
+        size_t end = std::min(i1, (w + 1) * 64);
+        uint64_t bits = words[w] >> (i0 & 63);
+
+        if (end - i0 < 64)
+            bits &= (uint64_t(1) << (end - i0)) - 1;
+        while (bits) {
+            ids[nids++] = i0 + __builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+        i0 = end;
+    }
+    return nids;
+}
+
+}  // namespace vector_search
@@ -0,0 +1,94 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_ID_BITMAP_H
+#define UTILS_ID_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Number of 64-bit words summarized by one counter, 4096 ids.  */
+#define ID_BITMAP_BLOCK_WORDS 64
+
+namespace vector_search {
+
+/// Set of the labels allowed by a filtered search, one bit per label in
+/// 64-bit words.  Like the containers of a roaring bitmap, the words are
+/// grouped in blocks of ID_BITMAP_BLOCK_WORDS words whose number of set
+/// bits is kept, so that the scans skip the empty blocks without reading
+/// their words.  The bitmap also counts its set bits and its non-zero
+/// words, which the searches use to choose between a scan with the filter
+/// and a brute-force search over the allowed labels.
+struct IDBitmap {
+    explicit IDBitmap(size_t n = 0);
+
+    /// Number of labels covered, the labels >= size() are not allowed
+    size_t size() const {
+        return n;
+    }
+
+    /// Number of allowed labels
+    size_t count() const {
+        return nset;
+    }
+
+    /// Number of words with at least one allowed label
+    size_t nonzero_words() const {
+        return nwords_set;
+    }
+
+    bool get(int64_t id) const {
+        return (size_t)id < n && ((words[id >> 6] >> (id & 63)) & 1);
+    }
+
+    /// Word w, the bits of the labels 64 * w .. 64 * w + 63.  0 past the
+    /// end of the bitmap.
+    uint64_t word(size_t w) const {
+        return w < words.size() ? words[w] : 0;
+    }
+
+    void set(int64_t id);
+    void unset(int64_t id);
+
+    /// Allow the labels [i0, i1)
+    void set_range(size_t i0, size_t i1);
+
+    /// true if a label of [i0, i1) is allowed
+    bool any(size_t i0, size_t i1) const;
+
+    /// Append the allowed labels of [i0, i1) to ids, in increasing order
+    void get_ids(size_t i0, size_t i1, std::vector<int64_t>& ids) const;
+
+    /// Store the allowed labels of [i0, i1) in ids, of at least count()
+    /// entries, in increasing order, and return their number
+    size_t get_ids(size_t i0, size_t i1, int64_t* ids) const;
+
+  private:
+    size_t n;
+    size_t nset = 0;
+    size_t nwords_set = 0;
+    std::vector<uint64_t> words;
+
+    /// number of set bits per block of ID_BITMAP_BLOCK_WORDS words
+    std::vector<uint32_t> block_counts;
+
+    void set_word(size_t w, uint64_t value);
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_ID_BITMAP_H */
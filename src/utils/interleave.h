@@ -0,0 +1,113 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef UTILS_INTERLEAVE_H
+#define UTILS_INTERLEAVE_H
+
+#include "arena.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+
+namespace vector_search {
+
+/// Coroutine searching one query, run by run_interleaved.  The search
+/// prefetches the data it needs next, the neighbor list or the vectors of
+/// the candidates, and suspends with co_await SuspendForPrefetch(), so that
+/// the other queries of the thread run while the cache lines arrive.
+///
+/// The frames of the coroutines come from the scratch pools.  A task must
+/// not hold an ArenaScope across a suspension, the scopes of the
+/// interleaved tasks would not be released in order.
+struct SearchTask {
+    struct promise_type {
+        SearchTask get_return_object() {
+            return SearchTask{
+                std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+
+        static void* operator new(size_t size) {
+            return scratch_allocate(size);
+        }
+
+        static void operator delete(void* p) {
+            scratch_deallocate(p);
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/// Awaited by a SearchTask after its prefetches
+struct SuspendForPrefetch {
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+    void await_resume() const noexcept {}
+};
+
+/// Run the n tasks make_task(i, slot), i in [0, n), on the calling thread
+/// with up to width of them in flight.  slot, in [0, width), identifies
+/// the per-task state, such as a visited table, the task may use.  The
+/// tasks in flight are resumed round robin, so that a task resumes after
+/// the other width - 1 have each run up to their next suspension, which
+/// is the time its prefetches have to complete.
+template <typename F>
+void
+run_interleaved(size_t n, size_t width, F make_task) {
+    ScratchVector<std::coroutine_handle<>> slots(width ? width : 1);
+    size_t next = 0, running = 0;
+
+    do {
+        for (size_t s = 0; s < slots.size(); s++) {
+            if (!slots[s] && next < n) {
+                slots[s] = make_task(next++, s).handle;
+                running++;
+            }
+            if (!slots[s])
+                continue;
+            slots[s].resume();
+            if (slots[s].done()) {
+                slots[s].destroy();
+                slots[s] = nullptr;
+                running--;
+            }
+        }
+    } while (running > 0 || next < n);
+}
+
+}  // namespace vector_search
+
+#endif /* UTILS_INTERLEAVE_H */
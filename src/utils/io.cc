@@ -0,0 +1,108 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "io.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace vector_search {
+
+/* The .fvecs and .ivecs files have the same layout with 4 byte values.
+   The rows are read one at a time into x, without their dimension.  */
+template <typename T>
+static std::vector<T>
+vecs_read(const std::string& path, size_t* d, size_t* n) {
+    std::ifstream file(path, std::ios::binary);
+    int32_t dim;
+
+    if (!file.is_open()) {
+        std::cout << "ERROR, could not open " << path << ".\n";
+        exit (-1);
+    }
+
+    if (!file.read((char*)&dim, sizeof(dim)) || dim <= 0) {
+        std::cout << "ERROR, invalid vector file " << path << ".\n";
+        exit (-1);
+    }
+
+    file.seekg(0, std::ios::end);
+    size_t file_size = file.tellg();
+    size_t row_size = sizeof(int32_t) * (dim + 1);
+
+    if (file_size % row_size != 0) {
+        std::cout << "ERROR, the size of " << path << " is not a multiple "
+                  << "of the row size " << row_size << ".\n";
+        exit (-1);
+    }
+
+    *d = dim;
+    *n = file_size / row_size;
+
+    std::vector<T> x(*n * dim);
+    file.seekg(0, std::ios::beg);
+
+    for (size_t i = 0; i < *n; i++) {
+        int32_t row_dim;
+
+        file.read((char*)&row_dim, sizeof(row_dim));
+        if (row_dim != dim) {
+            std::cout << "ERROR, vector " << i << " of " << path
+                      << " has a different dimension.\n";
+            exit (-1);
+        }
+        file.read((char*)&x[i * dim], sizeof(T) * dim);
+    }
+    return x;
+}
+
+std::vector<float>
+fvecs_read(const std::string& path, size_t* d, size_t* n) {
+    return vecs_read<float>(path, d, n);
+}
+
+std::vector<int32_t>
+ivecs_read(const std::string& path, size_t* d, size_t* n) {
+    return vecs_read<int32_t>(path, d, n);
+}
+
+void
+fvecs_write(const std::string& path, size_t d, size_t n, const float* x) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    int32_t dim = d;
+
+    if (!file.is_open()) {
+        std::cout << "ERROR, could not create " << path << ".\n";
+        exit (-1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        file.write((const char*)&dim, sizeof(dim));
+        file.write((const char*)(x + i * d), sizeof(float) * d);
+    }
+    if (!file) {
+        std::cout << "ERROR, could not write " << path << ".\n";
+        exit (-1);
+    }
+}
+
+bool
+file_exists(const std::string& path) {
+    std::ifstream file(path);
+
+    return file.good();
+}
+
+}  // namespace vector_search
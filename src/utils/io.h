@@ -0,0 +1,48 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_IO_H
+#define UTILS_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vector_search {
+
+/// Read a .fvecs file, as distributed with the SIFT1M and GIST1M data sets:
+/// each vector is stored as its dimension (int32) followed by its values
+/// (float32).  Sets d and n, returns the n * d values.
+std::vector<float>
+fvecs_read(const std::string& path, size_t* d, size_t* n);
+
+/// Read a .ivecs file, same layout as .fvecs with int32 values, such as
+/// the ground truth files.
+std::vector<int32_t>
+ivecs_read(const std::string& path, size_t* d, size_t* n);
+
+/// Write the n vectors x of dimension d to a .fvecs file
+void
+fvecs_write(const std::string& path, size_t d, size_t n, const float* x);
+
+/// true if the file exists and can be read
+bool
+file_exists(const std::string& path);
+
+}  // namespace vector_search
+
+#endif /* UTILS_IO_H */
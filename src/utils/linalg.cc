@@ -0,0 +1,265 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "linalg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace vector_search {
+
+/* Householder reduction of the symmetric matrix v to a tridiagonal matrix
+   of diagonal d and subdiagonal e[1 ..], v receives the accumulated
+   orthogonal transformation.  This and tql2 follow the EISPACK routines
+   of the same names, through their public domain JAMA version.  */
+static void
+tred2(long n, double* v, double* d, double* e) {
+    auto V = [&](long i, long j) -> double& { return v[i * n + j]; };
+
+    for (long j = 0; j < n; j++)
+        d[j] = V(n - 1, j);
+
+    for (long i = n - 1; i > 0; i--) {
+        double scale = 0, h = 0;
+
+        for (long k = 0; k < i; k++)
+            scale += fabs(d[k]);
+
+        if (scale == 0) {
+            e[i] = d[i - 1];
+            for (long j = 0; j < i; j++) {
+                d[j] = V(i - 1, j);
+                V(i, j) = 0;
+                V(j, i) = 0;
+            }
+        } else {
+            for (long k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+
+            double f = d[i - 1];
+            double g = f > 0 ? -sqrt(h) : sqrt(h);
+
+            e[i] = scale * g;
+            h -= f * g;
+            d[i - 1] = f - g;
+            for (long j = 0; j < i; j++)
+                e[j] = 0;
+
+            for (long j = 0; j < i; j++) {
+                f = d[j];
+                V(j, i) = f;
+                g = e[j] + V(j, j) * f;
+                for (long k = j + 1; k < i; k++) {
+                    g += V(k, j) * d[k];
+                    e[k] += V(k, j) * f;
+                }
+                e[j] = g;
+            }
+
+            f = 0;
+            for (long j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+
+            double hh = f / (h + h);
+
+            for (long j = 0; j < i; j++)
+                e[j] -= hh * d[j];
+            for (long j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (long k = j; k < i; k++)
+                    V(k, j) -= f * e[k] + g * d[k];
+                d[j] = V(i - 1, j);
+                V(i, j) = 0;
+            }
+        }
+        d[i] = h;
+    }
+
+    /* Accumulate the transformations.  */
+    for (long i = 0; i < n - 1; i++) {
+        double h = d[i + 1];
+
+        V(n - 1, i) = V(i, i);
+        V(i, i) = 1;
+        if (h != 0) {
+            for (long k = 0; k <= i; k++)
+                d[k] = V(k, i + 1) / h;
+            for (long j = 0; j <= i; j++) {
+                double g = 0;
+
+                for (long k = 0; k <= i; k++)
+                    g += V(k, i + 1) * V(k, j);
+                for (long k = 0; k <= i; k++)
+                    V(k, j) -= g * d[k];
+            }
+        }
+        for (long k = 0; k <= i; k++)
+            V(k, i + 1) = 0;
+    }
+    for (long j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+        V(n - 1, j) = 0;
+    }
+    V(n - 1, n - 1) = 1;
+    e[0] = 0;
+}
+
+/* Implicit QL iterations on the tridiagonal matrix (d, e).  w holds the
+   transformation of tred2 transposed, the eigenvectors end up in its rows,
+   so that the plane rotations update contiguous rows.  */
+static void
+tql2(long n, double* w, double* d, double* e) {
+    const double eps = pow(2.0, -52.0);
+    double f = 0, tst1 = 0;
+
+    for (long i = 1; i < n; i++)
+        e[i - 1] = e[i];
+    e[n - 1] = 0;
+
+    for (long l = 0; l < n; l++) {
+        long m = l;
+
+        tst1 = std::max(tst1, fabs(d[l]) + fabs(e[l]));
+        while (m < n - 1 && fabs(e[m]) > eps * tst1)
+            m++;
+
+        if (m > l) {
+            do {
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2 * e[l]);
+                double r = hypot(p, 1.0);
+
+                if (p < 0)
+                    r = -r;
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+
+                for (long i = l + 2; i < n; i++)
+                    d[i] -= h;
+                f += h;
+
+                p = d[m];
+
+                double c = 1, c2 = 1, c3 = 1, s = 0, s2 = 0;
+                double el1 = e[l + 1];
+
+                for (long i = m - 1; i >= l; i--) {
+                    double* wi = w + i * n;
+                    double* wi1 = wi + n;
+
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+
+                    for (long k = 0; k < n; k++) {
+                        h = wi1[k];
+                        wi1[k] = s * wi[k] + c * h;
+                        wi[k] = c * wi[k] - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (fabs(e[l]) > eps * tst1);
+        }
+        d[l] += f;
+        e[l] = 0;
+    }
+}
+
+void
+symmetric_eigen(size_t d, std::vector<double>& a,
+                std::vector<double>& eigenvalues) {
+    std::vector<double> w(d * d), e(d), values(d);
+    std::vector<size_t> order(d);
+
+    if (d == 0)
+        return;
+
+    tred2(d, a.data(), values.data(), e.data());
+    for (size_t i = 0; i < d; i++)
+        for (size_t j = 0; j < d; j++)
+            w[j * d + i] = a[i * d + j];
+    tql2(d, w.data(), values.data(), e.data());
+
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+        return values[i] > values[j];
+    });
+
+    eigenvalues.resize(d);
+    for (size_t i = 0; i < d; i++) {
+        eigenvalues[i] = values[order[i]];
+        std::copy(w.begin() + order[i] * d, w.begin() + (order[i] + 1) * d,
+                  a.begin() + i * d);
+    }
+}
+
+/* r = m (m^T m)^(-1/2), with m^T m = W diag(lambda) W^T.  The eigenvalues
+   of a rank deficient m are clamped so that r stays finite, it is then
+   only orthogonal on the range of m.  */
+void
+nearest_orthogonal(size_t d, const std::vector<double>& m,
+                   std::vector<float>& r) {
+    std::vector<double> mtm(d * d, 0), lambda, s(d * d, 0);
+
+    for (size_t k = 0; k < d; k++)
+        for (size_t i = 0; i < d; i++)
+            for (size_t j = 0; j < d; j++)
+                mtm[i * d + j] += m[k * d + i] * m[k * d + j];
+    symmetric_eigen(d, mtm, lambda);
+
+    double floor = std::max(lambda.empty() ? 0 : lambda[0], 1e-30) * 1e-12;
+
+    /* s = W diag(lambda^-1/2) W^T, the rows of mtm being the columns of W */
+    for (size_t l = 0; l < d; l++) {
+        double scale = 1 / sqrt(std::max(lambda[l], floor));
+        const double* wl = &mtm[l * d];
+
+        for (size_t i = 0; i < d; i++)
+            for (size_t j = 0; j < d; j++)
+                s[i * d + j] += scale * wl[i] * wl[j];
+    }
+
+    r.assign(d * d, 0);
+    for (size_t i = 0; i < d; i++)
+        for (size_t j = 0; j < d; j++) {
+            double sum = 0;
+
+            for (size_t k = 0; k < d; k++)
+                sum += m[i * d + k] * s[k * d + j];
+            r[i * d + j] = sum;
+        }
+}
+
+}  // namespace vector_search
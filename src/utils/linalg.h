@@ -0,0 +1,41 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_LINALG_H
+#define UTILS_LINALG_H
+
+#include <cstddef>
+#include <vector>
+
+namespace vector_search {
+
+/// Eigen decomposition of the symmetric d x d matrix a, row major.  On
+/// return, eigenvalues holds the d eigenvalues in decreasing order and row
+/// i of a the unit eigenvector of eigenvalue i.
+void
+symmetric_eigen(size_t d, std::vector<double>& a,
+                std::vector<double>& eigenvalues);
+
+/// Orthogonal d x d matrix r nearest to the d x d matrix m in the Frobenius
+/// norm, the orthogonal factor of its polar decomposition.  It minimizes
+/// || X r^T - Y || when m = Y^T X, with X and Y of d columns.
+void
+nearest_orthogonal(size_t d, const std::vector<double>& m,
+                   std::vector<float>& r);
+
+}  // namespace vector_search
+
+#endif /* UTILS_LINALG_H */
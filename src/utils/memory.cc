@@ -0,0 +1,166 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory.h"
+#include "numa.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+
+/* Sizes of the huge pages.  POWER also has 16 MB pages with the hash MMU,
+   the 2 MB pages are those of the radix MMU.  */
+#define MEMORY_HUGE_2MB         (2UL << 20)
+#define MEMORY_HUGE_1GB         (1UL << 30)
+
+namespace vector_search {
+
+static std::mutex default_policy_mutex;
+static MemoryPolicy default_policy;
+
+bool
+MemoryPolicy::maps(size_t size) const {
+    return node >= 0 || interleave
+           || (huge_pages != HUGE_PAGES_NONE && size >= MEMORY_HUGE_2MB);
+}
+
+void
+set_default_memory_policy(const MemoryPolicy& policy) {
+    std::lock_guard<std::mutex> lock(default_policy_mutex);
+    default_policy = policy;
+}
+
+MemoryPolicy
+get_default_memory_policy() {
+    std::lock_guard<std::mutex> lock(default_policy_mutex);
+    return default_policy;
+}
+
+static size_t
+round_up(size_t size, size_t page) {
+    return (size + page - 1) / page * page;
+}
+
+/* Reserved huge pages of page_size bytes, null when there are none.  */
+static void*
+map_hugetlb(size_t& size, size_t page_size) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    int shift = page_size == MEMORY_HUGE_1GB ? 30 : 21;
+    size_t rounded = round_up(size, page_size);
+    void* p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB
+                   | (shift << MAP_HUGE_SHIFT), -1, 0);
+
+    if (p != MAP_FAILED) {
+        size = rounded;
+        return p;
+    }
+#else
+    (void)size;
+    (void)page_size;
+#endif
+    return nullptr;
+}
+
+/* Base pages.  For transparent huge pages, the mapping is aligned on a
+   huge page and a whole number of huge pages, so that all of it can be
+   backed by huge pages.  */
+static void*
+map_pages(size_t& size, bool transparent) {
+    size_t rounded = transparent ? round_up(size, MEMORY_HUGE_2MB) : size;
+    size_t extra = transparent ? MEMORY_HUGE_2MB : 0;
+    char* p = (char*)mmap(nullptr, rounded + extra, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p == MAP_FAILED) {
+        std::cout << "ERROR, could not map " << size << " bytes: "
+                  << strerror(errno) << ".\n";
+        exit (-1);
+    }
+
+    if (transparent) {
+        char* aligned = (char*)round_up((uintptr_t)p, MEMORY_HUGE_2MB);
+
+        if (aligned > p)
+            munmap(p, aligned - p);
+        if (aligned + rounded < p + rounded + extra)
+            munmap(aligned + rounded, p + extra - aligned);
+        p = aligned;
+#ifdef MADV_HUGEPAGE
+        madvise(p, rounded, MADV_HUGEPAGE);
+#endif
+    }
+    size = rounded;
+    return p;
+}
+
+void*
+memory_alloc(size_t& size, const MemoryPolicy& policy) {
+    void* p = nullptr;
+
+    if (policy.huge_pages == HUGE_PAGES_1GB && size >= MEMORY_HUGE_1GB)
+        p = map_hugetlb(size, MEMORY_HUGE_1GB);
+    if (!p && policy.huge_pages >= HUGE_PAGES_2MB
+        && size >= MEMORY_HUGE_2MB)
+        p = map_hugetlb(size, MEMORY_HUGE_2MB);
+    if (!p)
+        p = map_pages(size, policy.huge_pages != HUGE_PAGES_NONE);
+
+    numa_bind(p, size, policy.node, policy.interleave);
+    return p;
+}
+
+void
+memory_free(void* p, size_t size) {
+    if (p)
+        munmap(p, size);
+}
+
+/* The mappings of /proc/self/smaps start with a line "begin-end perms ...",
+   followed by "Name: value kB" lines.  */
+void
+memory_page_info(const void* p, size_t& page_size, size_t& thp_bytes) {
+    std::ifstream in("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+
+    page_size = thp_bytes = 0;
+    while (std::getline(in, line)) {
+        unsigned long begin, end, kb;
+        char name[64];
+
+        if (sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2) {
+            if (inside)
+                break;
+            inside = (uintptr_t)p >= begin && (uintptr_t)p < end;
+        } else if (inside
+                   && sscanf(line.c_str(), "%63[^:]: %lu kB", name, &kb)
+                      == 2) {
+            if (strcmp(name, "KernelPageSize") == 0)
+                page_size = kb << 10;
+            else if (strcmp(name, "AnonHugePages") == 0)
+                thp_bytes = kb << 10;
+        }
+    }
+}
+
+}  // namespace vector_search
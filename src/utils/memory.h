@@ -0,0 +1,72 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_MEMORY_H
+#define UTILS_MEMORY_H
+
+#include <cstddef>
+
+namespace vector_search {
+
+/// Page size of the mapped buffers
+enum HugePages {
+    HUGE_PAGES_NONE = 0,        ///< base pages
+    HUGE_PAGES_TRANSPARENT,     ///< transparent huge pages, madvise
+    HUGE_PAGES_2MB,             ///< reserved 2 MB pages, MAP_HUGETLB
+    HUGE_PAGES_1GB,             ///< reserved 1 GB pages, MAP_HUGETLB
+};
+
+/// Placement of the pages of a buffer
+struct MemoryPolicy {
+    int node = -1;              ///< preferred node of the pages, -1 for none
+    bool interleave = false;    ///< spread the pages over all the nodes
+    HugePages huge_pages = HUGE_PAGES_NONE;
+
+    /// true when a buffer of size bytes is mapped directly by memory_alloc
+    /// rather than allocated from the heap.  Buffers smaller than a huge
+    /// page only use huge pages when they are also placed on nodes.
+    bool maps(size_t size) const;
+};
+
+/// Policy of the buffers created afterwards, so that the vectors, the codes
+/// and the graphs of all the indexes are stored the same way
+void
+set_default_memory_policy(const MemoryPolicy& policy);
+
+MemoryPolicy
+get_default_memory_policy();
+
+/// Page aligned memory of at least size bytes, mapped with the page size of
+/// policy and placed on the NUMA nodes of policy when it is first touched.
+/// size is rounded up to the size of the mapping, to be passed to
+/// memory_free.  Reserved huge pages are only used for buffers of at least
+/// one page; without them, or when none is left, the buffer falls back to
+/// the smaller reserved pages, then to transparent huge pages, then to base
+/// pages.
+void*
+memory_alloc(size_t& size, const MemoryPolicy& policy);
+
+void
+memory_free(void* p, size_t size);
+
+/// Size of the pages of the mapping that contains p and number of its bytes
+/// backed by transparent huge pages, 0 when unknown
+void
+memory_page_info(const void* p, size_t& page_size, size_t& thp_bytes);
+
+}  // namespace vector_search
+
+#endif /* UTILS_MEMORY_H */
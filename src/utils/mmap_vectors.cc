@@ -0,0 +1,89 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mmap_vectors.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vector_search {
+
+MmapVectors::MmapVectors(const std::string& path) {
+    open(path);
+}
+
+MmapVectors::~MmapVectors() {
+    close();
+}
+
+void
+MmapVectors::open(const std::string& path) {
+    struct stat st;
+    int32_t dim;
+    int fd;
+    void* p;
+
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::cout << "ERROR, could not open " << path << ": "
+                  << strerror(errno) << ".\n";
+        exit (-1);
+    }
+
+    if (pread(fd, &dim, sizeof(dim), 0) != sizeof(dim) || dim <= 0
+        || st.st_size % (sizeof(float) * (dim + 1)) != 0) {
+        std::cout << "ERROR, invalid vector file " << path << ".\n";
+        exit (-1);
+    }
+
+    p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cout << "ERROR, could not map " << path << ": "
+                  << strerror(errno) << ".\n";
+        exit (-1);
+    }
+
+    /* The re-ranking reads scattered vectors, the read-ahead of the kernel
+       would mostly load unused pages.  */
+#ifdef MADV_RANDOM
+    madvise(p, st.st_size, MADV_RANDOM);
+#endif
+
+    data = (const float*)p;
+    map_size = st.st_size;
+    d = dim;
+    stride = d + 1;
+    n = map_size / (sizeof(float) * stride);
+}
+
+void
+MmapVectors::close() {
+    if (data)
+        munmap((void*)data, map_size);
+    data = nullptr;
+    map_size = 0;
+    d = n = stride = 0;
+}
+
+}  // namespace vector_search
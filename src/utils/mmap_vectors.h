@@ -0,0 +1,59 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_MMAP_VECTORS_H
+#define UTILS_MMAP_VECTORS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vector_search {
+
+/// Read-only memory mapping of a .fvecs file.  The vectors are used in
+/// place: vector i starts after the dimension of row i, rows are stride
+/// floats apart.  The pages are only read from the file when accessed,
+/// so a store larger than the memory can be used for re-ranking.
+struct MmapVectors {
+    size_t d = 0;           ///< dimension of the vectors
+    size_t n = 0;           ///< number of vectors
+    size_t stride = 0;      ///< floats between two vectors, d + 1
+
+    MmapVectors() {}
+    explicit MmapVectors(const std::string& path);
+    ~MmapVectors();
+
+    MmapVectors(const MmapVectors&) = delete;
+    MmapVectors& operator=(const MmapVectors&) = delete;
+
+    /// Map the file path, unmapping the previous one
+    void open(const std::string& path);
+
+    /// Unmap the file
+    void close();
+
+    const float* get_vector(int64_t i) const {
+        return data + i * stride + 1;
+    }
+
+  private:
+    const float* data = nullptr;
+    size_t map_size = 0;
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_MMAP_VECTORS_H */
@@ -0,0 +1,137 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Memory policies of mbind and the flags of get_mempolicy, from
+   linux/mempolicy.h, called through syscall so that libnuma is not
+   needed.  */
+#define NUMA_MPOL_PREFERRED     1
+#define NUMA_MPOL_INTERLEAVE    3
+#define NUMA_MPOL_F_NODE        1
+#define NUMA_MPOL_F_ADDR        2
+
+/* Largest number of nodes of the node masks.  */
+#define NUMA_MAX_NODES          256
+
+namespace vector_search {
+
+/* Parse a sysfs list such as "0-3,8,10-11".  */
+static std::vector<int>
+parse_list(const std::string& path) {
+    std::ifstream in(path);
+    std::vector<int> values;
+    std::string range;
+
+    while (std::getline(in, range, ',')) {
+        int first, last;
+        char dash;
+        std::istringstream is(range);
+
+        if (!(is >> first))
+            continue;
+        last = first;
+        if (is >> dash >> last && dash != '-')
+            last = first;
+        for (int v = first; v <= last; v++)
+            values.push_back(v);
+    }
+    return values;
+}
+
+int
+numa_num_nodes() {
+    static const int num_nodes = [] {
+        std::vector<int> nodes =
+            parse_list("/sys/devices/system/node/online");
+
+        return nodes.empty() ? 1 : *std::max_element(nodes.begin(),
+                                                     nodes.end()) + 1;
+    }();
+
+    return num_nodes;
+}
+
+std::vector<int>
+numa_node_cpus(int node) {
+    std::vector<int> cpus;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    bool known = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    for (int cpu : parse_list("/sys/devices/system/node/node"
+                              + std::to_string(node) + "/cpulist"))
+        if (!known || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+            cpus.push_back(cpu);
+#endif
+
+    /* Without topology, node 0 has all the CPUs.  */
+    if (cpus.empty() && node == 0 && numa_num_nodes() == 1)
+        for (unsigned int cpu = 0; cpu < std::thread::hardware_concurrency();
+             cpu++)
+            cpus.push_back(cpu);
+    return cpus;
+}
+
+/* The policy must be set before any page of the mapping is touched.  A
+   failing mbind, for instance in a container that forbids it, leaves the
+   default policy.  */
+void
+numa_bind(void* p, size_t size, int node, bool interleave) {
+#if defined(__linux__) && defined(SYS_mbind)
+    int num_nodes = std::min(numa_num_nodes(), NUMA_MAX_NODES);
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {};
+    const int bits = 8 * sizeof(unsigned long);
+
+    if (interleave && num_nodes > 1) {
+        for (int i = 0; i < num_nodes; i++)
+            mask[i / bits] |= 1UL << (i % bits);
+        syscall(SYS_mbind, p, size, NUMA_MPOL_INTERLEAVE, mask,
+                NUMA_MAX_NODES + 1, 0);
+    } else if (node >= 0 && node < num_nodes) {
+        mask[node / bits] |= 1UL << (node % bits);
+        syscall(SYS_mbind, p, size, NUMA_MPOL_PREFERRED, mask,
+                NUMA_MAX_NODES + 1, 0);
+    }
+#endif
+}
+
+int
+numa_node_of_address(const void* p) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+    int node = -1;
+
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, p,
+                NUMA_MPOL_F_NODE | NUMA_MPOL_F_ADDR) == 0)
+        return node;
+#endif
+    return -1;
+}
+
+}  // namespace vector_search
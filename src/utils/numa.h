@@ -0,0 +1,45 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_NUMA_H
+#define UTILS_NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+namespace vector_search {
+
+/// Number of NUMA nodes of the system, 1 when unknown
+int
+numa_num_nodes();
+
+/// CPUs of node that the process may run on
+std::vector<int>
+numa_node_cpus(int node);
+
+/// Place the pages of the mapping [p, p + size) on node, or interleave
+/// them over all the nodes, when they are first touched.  No effect where
+/// mbind is not available.
+void
+numa_bind(void* p, size_t size, int node, bool interleave);
+
+/// Node of the touched page at address p, -1 when unknown
+int
+numa_node_of_address(const void* p);
+
+}  // namespace vector_search
+
+#endif /* UTILS_NUMA_H */
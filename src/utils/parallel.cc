@@ -0,0 +1,119 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "parallel.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/* Largest number of ranges per thread of a parallel_for, enough for the
+   work stealing to even out ranges of unequal cost.  */
+#define PARALLEL_RANGES_PER_THREAD 4
+
+namespace vector_search {
+
+static std::atomic<int> num_threads_setting(0);
+static std::atomic<bool> pin_threads(false);
+
+/* The pool is started by the first parallel_for, and restarted when the
+   number of threads or the affinity change.  The running calls keep their
+   pool alive.  */
+static std::mutex pool_mutex;
+static std::shared_ptr<ThreadPool> pool;
+static bool pool_pinned = false;
+
+static thread_local int inline_depth = 0;
+
+void
+set_num_threads(int num_threads) {
+    num_threads_setting = std::max(num_threads, 0);
+}
+
+int
+get_num_threads(void) {
+    int num_threads = num_threads_setting;
+
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    return num_threads;
+}
+
+void
+set_thread_affinity(bool pin) {
+    pin_threads = pin;
+}
+
+InlineParallelScope::InlineParallelScope() {
+    inline_depth++;
+}
+
+InlineParallelScope::~InlineParallelScope() {
+    inline_depth--;
+}
+
+static std::shared_ptr<ThreadPool>
+get_pool(size_t nworkers) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    bool pin = pin_threads;
+
+    if (!pool || pool->num_workers() != nworkers || pool_pinned != pin) {
+        pool.reset();
+        pool = std::make_shared<ThreadPool>(nworkers, pin);
+        pool_pinned = pin;
+    }
+    return pool;
+}
+
+void
+parallel_for(size_t n, size_t min_chunk,
+             const std::function<void(size_t, size_t)>& fn) {
+    size_t num_threads, grain;
+
+    if (n == 0)
+        return;
+
+    ThreadPool* current = ThreadPool::current();
+
+    min_chunk = std::max(min_chunk, (size_t)1);
+    if (inline_depth > 0)
+        num_threads = 1;
+    else if (current)
+        num_threads = current->num_workers();
+    else
+        num_threads = get_num_threads();
+
+    if (num_threads <= 1 || n < 2 * min_chunk) {
+        fn(0, n);
+        return;
+    }
+
+    grain = (n + num_threads * PARALLEL_RANGES_PER_THREAD - 1)
+            / (num_threads * PARALLEL_RANGES_PER_THREAD);
+    grain = std::max(grain, min_chunk);
+
+    /* Nested calls stay on the pool of their worker, which may be a pool
+       bound to a NUMA node rather than the shared pool.  */
+    if (current)
+        current->parallel_for(n, grain, fn);
+    else
+        get_pool(num_threads - 1)->parallel_for(n, grain, fn);
+}
+
+}  // namespace vector_search
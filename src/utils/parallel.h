@@ -0,0 +1,77 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_PARALLEL_H
+#define UTILS_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace vector_search {
+
+/// Set the number of threads used by parallel_for, the calling thread
+/// included.  0 selects the number of hardware threads.  Must not be
+/// called while parallel_for calls are running.
+void
+set_num_threads(int num_threads);
+
+/// Number of threads used by parallel_for.
+int
+get_num_threads(void);
+
+/// Bind the worker threads to CPUs, spread over the cores before using
+/// their other hardware threads.  Takes effect when the workers are next
+/// started, same restriction as set_num_threads.
+void
+set_thread_affinity(bool pin);
+
+/// Split [0, n) into contiguous ranges of at least min_chunk elements and
+/// call fn(begin, end) for each range, spread over get_num_threads()
+/// threads of a shared work-stealing pool.  The calling thread processes
+/// ranges too and returns when all the ranges are done.  The ranges are
+/// only split while idle threads take them, up to a few ranges per thread.
+/// Runs inline on the calling thread when there is only one range, and
+/// may be called from inside fn.  From a worker of another ThreadPool, the
+/// loop runs on the workers of that pool.
+void
+parallel_for(size_t n, size_t min_chunk,
+             const std::function<void(size_t, size_t)>& fn);
+
+/// Same, for a lambda or other callable.  fn is passed by reference, which
+/// the std::function stores without allocating, so a search run inline
+/// does not touch the heap for its loop.
+template <typename F>
+void
+parallel_for(size_t n, size_t min_chunk, const F& fn) {
+    parallel_for(n, min_chunk,
+                 std::function<void(size_t, size_t)>(std::cref(fn)));
+}
+
+/// While an object of this class exists, the parallel_for calls of the
+/// thread that created it run inline, as a single range on that thread.
+/// For latency critical single queries, which would not gain from the
+/// hand-off to the workers.
+struct InlineParallelScope {
+    InlineParallelScope();
+    ~InlineParallelScope();
+
+    InlineParallelScope(const InlineParallelScope&) = delete;
+    InlineParallelScope& operator=(const InlineParallelScope&) = delete;
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_PARALLEL_H */
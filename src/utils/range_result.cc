@@ -0,0 +1,165 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "range_result.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vector_search {
+
+void
+RangeSearchPartial::reserve(size_t n) {
+    if (nhits + n <= labels.size())
+        return;
+
+    size_t size = std::max(nhits + n, 2 * labels.size());
+
+    labels.resize(size);
+    distances.resize(size);
+}
+
+void
+RangeSearchPartial::count_hits(size_t q, size_t nh) {
+    if (nh == 0)
+        return;
+    if (queries.empty() || queries.back().first != q)
+        queries.emplace_back(q, 0);
+    queries.back().second += nh;
+    nhits += nh;
+}
+
+/* The hits are compacted without branches: every candidate is written at
+   the end of the hits, and the end only moves past it when it is within
+   the radius.  */
+template <bool LARGEST>
+static size_t
+compact_range(const float* dis, size_t n, int64_t label0, float radius,
+              const uint64_t* excluded, int64_t* labels, float* distances) {
+    size_t nh = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        int64_t label = label0 + i;
+        bool hit = LARGEST ? dis[i] > radius : dis[i] < radius;
+
+        if (excluded)
+            hit &= !((excluded[label >> 6] >> (label & 63)) & 1);
+        labels[nh] = label;
+        distances[nh] = dis[i];
+        nh += hit;
+    }
+    return nh;
+}
+
+template <bool LARGEST>
+static size_t
+compact_labels(const float* dis, size_t n, const int64_t* ids, float radius,
+               int64_t* labels, float* distances) {
+    size_t nh = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        labels[nh] = ids[i];
+        distances[nh] = dis[i];
+        nh += LARGEST ? dis[i] > radius : dis[i] < radius;
+    }
+    return nh;
+}
+
+void
+RangeSearchPartial::add_range(size_t q, const float* dis, size_t n,
+                              int64_t label0, float radius, bool largest,
+                              const uint64_t* excluded) {
+    size_t nh;
+
+    reserve(n);
+    if (largest)
+        nh = compact_range<true>(dis, n, label0, radius, excluded,
+                                 labels.data() + nhits,
+                                 distances.data() + nhits);
+    else
+        nh = compact_range<false>(dis, n, label0, radius, excluded,
+                                  labels.data() + nhits,
+                                  distances.data() + nhits);
+    count_hits(q, nh);
+}
+
+void
+RangeSearchPartial::add_labels(size_t q, const float* dis, size_t n,
+                               const int64_t* ids, float radius,
+                               bool largest) {
+    size_t nh;
+
+    reserve(n);
+    if (largest)
+        nh = compact_labels<true>(dis, n, ids, radius,
+                                  labels.data() + nhits,
+                                  distances.data() + nhits);
+    else
+        nh = compact_labels<false>(dis, n, ids, radius,
+                                   labels.data() + nhits,
+                                   distances.data() + nhits);
+    count_hits(q, nh);
+}
+
+void
+merge_range_results(size_t nq, std::vector<RangeSearchPartial>& partials,
+                    RangeSearchResult& result) {
+    std::vector<std::vector<size_t>> offsets(partials.size());
+    std::vector<size_t> next(nq + 1, 0);
+
+    result.nq = nq;
+    result.lims.assign(nq + 1, 0);
+
+    for (const RangeSearchPartial& p : partials)
+        for (const auto& qc : p.queries)
+            result.lims[qc.first + 1] += qc.second;
+    for (size_t q = 0; q < nq; q++)
+        result.lims[q + 1] += result.lims[q];
+
+    /* The hits of a query found by several partial results are stored in
+       the order of the partial results.  */
+    std::copy(result.lims.begin(), result.lims.end(), next.begin());
+    for (size_t i = 0; i < partials.size(); i++) {
+        for (const auto& qc : partials[i].queries) {
+            offsets[i].push_back(next[qc.first]);
+            next[qc.first] += qc.second;
+        }
+    }
+
+    result.labels.resize(result.lims[nq]);
+    result.distances.resize(result.lims[nq]);
+
+    parallel_for(partials.size(), 1, [&](size_t i0, size_t i1) {
+        for (size_t i = i0; i < i1; i++) {
+            const RangeSearchPartial& p = partials[i];
+            size_t src = 0;
+
+            for (size_t t = 0; t < p.queries.size(); t++) {
+                size_t count = p.queries[t].second;
+
+                memcpy(result.labels.data() + offsets[i][t],
+                       p.labels.data() + src, count * sizeof(int64_t));
+                memcpy(result.distances.data() + offsets[i][t],
+                       p.distances.data() + src, count * sizeof(float));
+                src += count;
+            }
+        }
+    });
+}
+
+}  // namespace vector_search
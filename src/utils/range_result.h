@@ -0,0 +1,76 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_RANGE_RESULT_H
+#define UTILS_RANGE_RESULT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace vector_search {
+
+/// Results of a range search, in compressed sparse row layout: the hits of
+/// query q are labels[lims[q] .. lims[q + 1] - 1] with their distances.
+/// The hits of a query are in no particular order.
+struct RangeSearchResult {
+    size_t nq = 0;
+    std::vector<size_t> lims;       ///< nq + 1 offsets
+    std::vector<int64_t> labels;
+    std::vector<float> distances;
+};
+
+/// Hits found by one thread.  Each thread appends to its own partial
+/// result, the partial results are then copied to their place in the
+/// RangeSearchResult by merge_range_results.  The buffers grow
+/// geometrically, there is no allocation per hit.
+struct RangeSearchPartial {
+    /// (query, number of hits) in the order of the hits.  A query may
+    /// appear in several partial results, or several times in one.
+    std::vector<std::pair<size_t, size_t>> queries;
+    std::vector<int64_t> labels;
+    std::vector<float> distances;
+    size_t nhits = 0;               ///< hits stored, labels may be larger
+
+    /// Keep as hits of query q the labels label0 + i whose distance dis[i]
+    /// is within radius, i < n: smaller than radius, or larger with
+    /// largest = true.  When excluded is not null, the labels whose bit is
+    /// set in it are dropped.
+    void add_range(size_t q, const float* dis, size_t n, int64_t label0,
+                   float radius, bool largest,
+                   const uint64_t* excluded = nullptr);
+
+    /// Same as add_range for the labels ids[0 .. n - 1]
+    void add_labels(size_t q, const float* dis, size_t n, const int64_t* ids,
+                    float radius, bool largest);
+
+  private:
+    void reserve(size_t n);
+    void count_hits(size_t q, size_t nh);
+};
+
+/// Fill result with the hits of the partial results of nq queries.
+/// Computes the offset of each query from the counts of the partial
+/// results, then each partial result copies its hits to their place in
+/// parallel, without locks.
+void
+merge_range_results(size_t nq, std::vector<RangeSearchPartial>& partials,
+                    RangeSearchResult& result);
+
+}  // namespace vector_search
+
+#endif /* UTILS_RANGE_RESULT_H */
@@ -0,0 +1,204 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sector_reader.h"
+
+#include "main-supported.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+#if IO_URING_SUPPORTED
+#include <liburing.h>
+#endif
+
+namespace vector_search {
+
+/* Completion counter of the reads of one PreadPool::read call.  */
+struct PreadPool::Batch {
+    size_t pending;
+    std::condition_variable done;
+};
+
+PreadPool::PreadPool(int fd, size_t nthreads) : fd(fd) {
+    for (size_t t = 0; t < nthreads; t++)
+        threads.emplace_back(&PreadPool::worker, this);
+}
+
+PreadPool::~PreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+static void
+pread_full(int fd, const ReadRequest& req) {
+    size_t done = 0;
+
+    while (done < req.size) {
+        ssize_t ret = pread(fd, (char*)req.buf + done, req.size - done,
+                            req.offset + done);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0) {
+            std::cout << "ERROR, read of " << req.size << " bytes at offset "
+                      << req.offset << " failed: " << strerror(errno)
+                      << ".\n";
+            exit (-1);
+        }
+        done += ret;
+    }
+}
+
+void
+PreadPool::worker() {
+    for (;;) {
+        std::pair<ReadRequest*, Batch*> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            cond.wait(lock, [this] { return stop || !queue.empty(); });
+            if (queue.empty())
+                return;
+            item = queue.front();
+            queue.pop_front();
+        }
+
+        pread_full(fd, *item.first);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--item.second->pending == 0)
+            item.second->done.notify_one();
+    }
+}
+
+void
+PreadPool::read(std::vector<ReadRequest>& requests) {
+    Batch batch;
+
+    if (requests.empty())
+        return;
+
+    /* Without threads, the reads are done by the caller.  */
+    if (threads.empty()) {
+        for (const ReadRequest& req : requests)
+            pread_full(fd, req);
+        return;
+    }
+
+    batch.pending = requests.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (ReadRequest& req : requests)
+            queue.emplace_back(&req, &batch);
+    }
+    cond.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    batch.done.wait(lock, [&batch] { return batch.pending == 0; });
+}
+
+struct PreadReader : SectorReader {
+    PreadPool* pool;
+
+    explicit PreadReader(PreadPool* pool) : pool(pool) {}
+
+    void read(std::vector<ReadRequest>& requests) override {
+        pool->read(requests);
+    }
+};
+
+#if IO_URING_SUPPORTED
+/* One ring per reader.  The batch is submitted with a single system call
+   and the completions are reaped as they arrive.  */
+struct UringReader : SectorReader {
+    int fd;
+    size_t depth;
+    struct io_uring ring;
+    bool initialized = false;
+
+    UringReader(int fd, size_t depth) : fd(fd), depth(depth) {}
+
+    ~UringReader() {
+        if (initialized)
+            io_uring_queue_exit(&ring);
+    }
+
+    bool init() {
+        initialized = io_uring_queue_init(depth, &ring, 0) == 0;
+        return initialized;
+    }
+
+    void read(std::vector<ReadRequest>& requests) override {
+        for (size_t r0 = 0; r0 < requests.size(); r0 += depth) {
+            size_t r1 = std::min(r0 + depth, requests.size());
+
+            for (size_t r = r0; r < r1; r++) {
+                struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+
+                io_uring_prep_read(sqe, fd, requests[r].buf, requests[r].size,
+                                   requests[r].offset);
+                io_uring_sqe_set_data(sqe, &requests[r]);
+            }
+            io_uring_submit(&ring);
+
+            for (size_t r = r0; r < r1; r++) {
+                struct io_uring_cqe* cqe;
+
+                if (io_uring_wait_cqe(&ring, &cqe) < 0 || cqe->res < 0) {
+                    std::cout << "ERROR, io_uring read failed.\n";
+                    exit (-1);
+                }
+                ReadRequest* req = (ReadRequest*)io_uring_cqe_get_data(cqe);
+
+                /* Short reads are completed synchronously.  */
+                if ((size_t)cqe->res < req->size) {
+                    ReadRequest rest = {req->offset + cqe->res,
+                                        req->size - cqe->res,
+                                        (char*)req->buf + cqe->res};
+                    pread_full(fd, rest);
+                }
+                io_uring_cqe_seen(&ring, cqe);
+            }
+        }
+    }
+};
+#endif
+
+std::unique_ptr<SectorReader>
+make_sector_reader(int fd, size_t depth, PreadPool* pool) {
+#if IO_URING_SUPPORTED
+    std::unique_ptr<UringReader> reader(new UringReader(fd, depth));
+
+    if (reader->init())
+        return std::unique_ptr<SectorReader>(reader.release());
+#endif
+    (void)fd;
+    (void)depth;
+    return std::unique_ptr<SectorReader>(new PreadReader(pool));
+}
+
+}  // namespace vector_search
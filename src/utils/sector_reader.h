@@ -0,0 +1,81 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_SECTOR_READER_H
+#define UTILS_SECTOR_READER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Size of a disk sector, the unit of the reads of the disk indexes.  */
+#define SECTOR_SIZE 4096
+
+namespace vector_search {
+
+/// One read of size bytes at offset of a file into buf.  With O_DIRECT,
+/// the offset, the size and buf are multiples of SECTOR_SIZE.
+struct ReadRequest {
+    uint64_t offset;
+    size_t size;
+    void* buf;
+};
+
+/// Issues batches of reads on a file.  A reader is used by one thread at a
+/// time.
+struct SectorReader {
+    virtual ~SectorReader() {}
+
+    /// Issue all the reads, return when they are all complete
+    virtual void read(std::vector<ReadRequest>& requests) = 0;
+};
+
+/// Threads that serve the reads of the PreadReaders of a file with pread.
+/// Shared by all the searching threads.
+struct PreadPool {
+    PreadPool(int fd, size_t nthreads);
+    ~PreadPool();
+
+    /// Issue all the reads, return when they are all complete
+    void read(std::vector<ReadRequest>& requests);
+
+  private:
+    struct Batch;
+
+    int fd;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::pair<ReadRequest*, Batch*>> queue;
+    bool stop = false;
+
+    void worker();
+};
+
+/// Open a reader for the file fd.  Uses io_uring with depth entries when
+/// IO_URING_SUPPORTED is set and the ring can be created, otherwise the
+/// reads are served by pool.
+std::unique_ptr<SectorReader>
+make_sector_reader(int fd, size_t depth, PreadPool* pool);
+
+}  // namespace vector_search
+
+#endif /* UTILS_SECTOR_READER_H */
@@ -0,0 +1,120 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef UTILS_SEGMENTED_ARRAY_H
+#define UTILS_SEGMENTED_ARRAY_H
+
+#include "aligned_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/* Rows of the first segment of a SegmentedArray, each next segment has
+   twice the rows of the previous one.  */
+#define SEGMENTED_FIRST_ROWS 1024
+
+/* Number of segments, enough for SEGMENTED_FIRST_ROWS * 2^48 rows.  */
+#define SEGMENTED_MAX_SEGMENTS 48
+
+namespace vector_search {
+
+/// Append-only array of rows of width trivially copyable elements, which
+/// can be read while rows are appended.  The rows are stored in segments
+/// that are never reallocated, segment s holds SEGMENTED_FIRST_ROWS * 2^s
+/// rows, so that a row stays at the same address once appended.  append()
+/// copies the rows, then publishes the new number of rows with a release
+/// store: a reader that loads size() may read all the rows below it
+/// without a lock.  One writer appends at a time.
+template <typename T>
+struct SegmentedArray {
+    size_t width;               ///< elements per row
+
+    explicit SegmentedArray(size_t width = 1) : width(width) {}
+
+    SegmentedArray(const SegmentedArray&) = delete;
+    SegmentedArray& operator=(const SegmentedArray&) = delete;
+
+    /// Number of rows published
+    size_t size() const {
+        return n.load(std::memory_order_acquire);
+    }
+
+    /// Row i, i below a value returned by size()
+    const T* row(size_t i) const {
+        size_t s, offset;
+
+        locate(i, &s, &offset);
+        return segments[s] + offset * width;
+    }
+
+    /// Number of rows stored contiguously from row i, up to the end of its
+    /// segment, for the kernels that scan contiguous rows
+    static size_t contiguous(size_t i) {
+        size_t s, offset;
+
+        locate(i, &s, &offset);
+        return ((size_t)SEGMENTED_FIRST_ROWS << s) - offset;
+    }
+
+    /// Append the count rows src and publish them
+    void append(const T* src, size_t count) {
+        size_t i = n.load(std::memory_order_relaxed), done = 0;
+
+        while (done < count) {
+            size_t s, offset;
+
+            locate(i + done, &s, &offset);
+            if (offset == 0 && buffers.size() <= s) {
+                size_t rows = (size_t)SEGMENTED_FIRST_ROWS << s;
+
+                if (s >= SEGMENTED_MAX_SEGMENTS) {
+                    std::cout << "ERROR, SegmentedArray is full.\n";
+                    exit (-1);
+                }
+                buffers.emplace_back();
+                buffers.back().reserve(rows * width);
+                segments[s] = buffers.back().data();
+            }
+
+            size_t m = std::min(count - done, contiguous(i + done));
+
+            buffers[s].append(src + done * width, m * width);
+            done += m;
+        }
+        n.store(i + count, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<size_t> n{0};
+    T* segments[SEGMENTED_MAX_SEGMENTS] = {};
+
+    /// owners of the segments, used by the writer only
+    std::vector<AlignedBuffer<T>> buffers;
+
+    static void locate(size_t i, size_t* s, size_t* offset) {
+        size_t t = i / SEGMENTED_FIRST_ROWS + 1;
+
+        *s = 63 - __builtin_clzll(t);
+        *offset = i - SEGMENTED_FIRST_ROWS * ((((size_t)1) << *s) - 1);
+    }
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_SEGMENTED_ARRAY_H */
@@ -0,0 +1,276 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/* Number of times an idle worker looks for a task before sleeping.  */
+#define POOL_SPIN_COUNT 64
+
+namespace vector_search {
+
+/* Pool and queue of the current thread, when it is a worker.  */
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local size_t current_queue = 0;
+
+/* The first CPU is left to the calling thread.  */
+ThreadPool::ThreadPool(size_t nworkers, bool pin) {
+    start_workers(nworkers, pin ? cpu_order() : std::vector<int>(), 1);
+}
+
+ThreadPool::ThreadPool(const std::vector<int>& cpus) {
+    start_workers(cpus.size(), cpus, 0);
+}
+
+/* Worker i is bound to cpus[first_cpu + i], modulo the number of CPUs,
+   or not bound when cpus is empty.  */
+void
+ThreadPool::start_workers(size_t nworkers, const std::vector<int>& cpus,
+                          size_t first_cpu) {
+    for (size_t q = 0; q <= nworkers; q++)
+        queues.emplace_back(new Queue);
+
+    workers.reserve(nworkers);
+    for (size_t i = 0; i < nworkers; i++) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i + 1);
+
+#ifdef __linux__
+        if (!cpus.empty()) {
+            cpu_set_t set;
+
+            CPU_ZERO(&set);
+            CPU_SET(cpus[(first_cpu + i) % cpus.size()], &set);
+            pthread_setaffinity_np(workers.back().native_handle(),
+                                   sizeof(set), &set);
+        }
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stop = true;
+    }
+    wakeup.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void
+ThreadPool::push(size_t q, const Task& task) {
+    {
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        queues[q]->tasks.push_back(task);
+    }
+
+    /* A worker going to sleep increments nsleeping before checking
+       nqueued, so either it sees the task or it is woken up.  */
+    nqueued++;
+    if (nsleeping > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wakeup.notify_one();
+    }
+}
+
+bool
+ThreadPool::pop(size_t q, Task& task) {
+    std::lock_guard<std::mutex> lock(queues[q]->mutex);
+
+    if (queues[q]->tasks.empty())
+        return false;
+    task = queues[q]->tasks.back();
+    queues[q]->tasks.pop_back();
+    nqueued--;
+    return true;
+}
+
+/* The oldest task of a queue is the largest range pushed by its owner.  */
+bool
+ThreadPool::steal(size_t thief, Task& task) {
+    size_t nq = queues.size();
+
+    for (size_t i = 1; i < nq; i++) {
+        Queue& victim = *queues[(thief + i) % nq];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+
+        /* A busy queue is skipped, the thief looks again later.  */
+        if (!lock.owns_lock() || victim.tasks.empty())
+            continue;
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        nqueued--;
+        return true;
+    }
+    return false;
+}
+
+void
+ThreadPool::run(size_t q, Task task) {
+    Loop* loop = task.loop;
+
+    while (task.end - task.begin >= 2 * loop->grain) {
+        size_t mid = task.begin + (task.end - task.begin) / 2;
+
+        push(q, Task{loop, mid, task.end});
+        task.end = mid;
+    }
+
+    (*loop->fn)(task.begin, task.end);
+
+    /* The loop may be released as soon as remaining reaches 0.  */
+    loop->remaining -= task.end - task.begin;
+}
+
+void
+ThreadPool::worker_loop(size_t q) {
+    current_pool = this;
+    current_queue = q;
+
+    for (;;) {
+        Task task;
+        int spin;
+
+        if (pop(q, task) || steal(q, task)) {
+            run(q, task);
+            continue;
+        }
+
+        for (spin = 0; spin < POOL_SPIN_COUNT && nqueued == 0; spin++)
+            std::this_thread::yield();
+        if (spin < POOL_SPIN_COUNT)
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        nsleeping++;
+        wakeup.wait(lock, [this] { return stop || nqueued > 0; });
+        nsleeping--;
+        if (stop)
+            return;
+    }
+}
+
+/* The calling thread runs the first range and then the tasks it can find,
+   any loop, until all the elements of its own loop are processed.  */
+void
+ThreadPool::parallel_for(size_t n, size_t grain,
+                         const std::function<void(size_t, size_t)>& fn) {
+    size_t q = current_pool == this ? current_queue : 0;
+    Loop loop;
+
+    loop.fn = &fn;
+    loop.grain = std::max(grain, (size_t)1);
+    loop.remaining = n;
+
+    run(q, Task{&loop, 0, n});
+
+    while (loop.remaining > 0) {
+        Task task;
+
+        if (pop(q, task) || steal(q, task))
+            run(q, task);
+        else
+            std::this_thread::yield();
+    }
+}
+
+/* The loop is queued whole on the shared queue, the worker that takes it
+   splits it.  */
+void
+ThreadPool::start(Loop& loop, size_t n, size_t grain,
+                  const std::function<void(size_t, size_t)>& fn) {
+    loop.fn = &fn;
+    loop.grain = std::max(grain, (size_t)1);
+    loop.remaining = n;
+
+    if (n == 0)
+        return;
+    if (workers.empty()) {
+        fn(0, n);
+        loop.remaining = 0;
+        return;
+    }
+    push(0, Task{&loop, 0, n});
+}
+
+void
+ThreadPool::wait(const Loop& loop) {
+    while (loop.remaining > 0)
+        std::this_thread::yield();
+}
+
+ThreadPool*
+ThreadPool::current() {
+    return current_pool;
+}
+
+static int
+read_topology(int cpu, const char* name) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu)
+                     + "/topology/" + name);
+    int value = -1;
+
+    in >> value;
+    return value;
+}
+
+/* The cores are identified by their package and core ids.  A CPU whose
+   topology is unknown is a core of its own.  */
+std::vector<int>
+ThreadPool::cpu_order() {
+    std::vector<int> cpus;
+
+#ifdef __linux__
+    std::map<std::pair<int, int>, int> siblings;
+    std::vector<std::pair<int, int>> ranked;
+    cpu_set_t set;
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &set))
+                continue;
+
+            int package = read_topology(cpu, "physical_package_id");
+            int core = read_topology(cpu, "core_id");
+
+            if (core < 0)
+                package = -1 - cpu;
+            ranked.emplace_back(siblings[{package, core}]++, cpu);
+        }
+        std::stable_sort(ranked.begin(), ranked.end());
+        for (auto& r : ranked)
+            cpus.push_back(r.second);
+    }
+#endif
+
+    if (cpus.empty())
+        for (unsigned int cpu = 0; cpu < std::thread::hardware_concurrency();
+             cpu++)
+            cpus.push_back(cpu);
+    return cpus;
+}
+
+}  // namespace vector_search
@@ -0,0 +1,122 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_THREAD_POOL_H
+#define UTILS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vector_search {
+
+/// Work-stealing pool of worker threads.  Each worker owns a deque of
+/// tasks: it pushes and pops its own tasks at the back, idle workers steal
+/// from the front of the other deques.  Threads outside the pool share one
+/// more deque.
+///
+/// A parallel_for starts as a single range task.  A thread running a range
+/// larger than the grain pushes its upper half and keeps the lower half,
+/// so the ranges are only split when there are threads to take them.  The
+/// calling thread runs tasks until its loop is done, which also makes
+/// parallel_for calls from inside a task safe.
+struct ThreadPool {
+    /// Pool of nworkers threads, in addition to the calling threads.  With
+    /// pin, the workers are bound to the CPUs returned by cpu_order().
+    ThreadPool(size_t nworkers, bool pin);
+
+    /// Pool of one worker per CPU of cpus, bound to it, for instance the
+    /// CPUs of a NUMA node
+    explicit ThreadPool(const std::vector<int>& cpus);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t num_workers() const {
+        return workers.size();
+    }
+
+    /// Call fn(begin, end) over ranges of [0, n) of at least grain
+    /// elements, and return when they are all done.
+    void parallel_for(size_t n, size_t grain,
+                      const std::function<void(size_t, size_t)>& fn);
+
+    /// State of a loop started with start(), owned by the caller
+    struct Loop {
+        const std::function<void(size_t, size_t)>* fn = nullptr;
+        size_t grain = 1;
+        std::atomic<size_t> remaining{0};   ///< elements not processed yet
+    };
+
+    /// Same loop as parallel_for, run by the workers only, and return at
+    /// once.  loop and fn must remain valid until wait(loop) returns.  For
+    /// a thread that hands loops to several pools, one per NUMA node.
+    void start(Loop& loop, size_t n, size_t grain,
+               const std::function<void(size_t, size_t)>& fn);
+
+    /// Wait until the loop started with start() is done
+    static void wait(const Loop& loop);
+
+    /// Pool of the calling thread when it is a worker, null otherwise
+    static ThreadPool* current();
+
+    /// The CPUs the process may run on, one hardware thread of each core
+    /// first, then the second hardware threads of the cores, and so on, so
+    /// that the first workers do not share a core.
+    static std::vector<int> cpu_order();
+
+  private:
+    struct Task {
+        Loop* loop;
+        size_t begin, end;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    /// queues[0] is shared by the external threads, queues[i + 1] belongs
+    /// to worker i
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> nqueued{0};   ///< tasks in all the queues
+    std::atomic<size_t> nsleeping{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wakeup;
+    bool stop = false;
+
+    void start_workers(size_t nworkers, const std::vector<int>& cpus,
+                       size_t first_cpu);
+    void push(size_t q, const Task& task);
+    bool pop(size_t q, Task& task);
+    bool steal(size_t thief, Task& task);
+    void run(size_t q, Task task);
+    void worker_loop(size_t q);
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_THREAD_POOL_H */
@@ -0,0 +1,124 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_TOPK_H
+#define UTILS_TOPK_H
+
+#include "arena.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace vector_search {
+
+/// The k best (distance, label) pairs seen so far.  With largest = false
+/// the best pairs are those with the smallest distances, with largest =
+/// true (similarities such as the inner product) those with the largest
+/// ones.  The pairs are kept in a binary heap whose root is the worst
+/// pair kept, so a candidate is rejected with one comparison.  The heap
+/// is a pooled buffer, and extract() sorts in the arena of the thread, so
+/// a search reusing its heaps does not allocate.
+struct TopK {
+    size_t k;
+    bool largest;
+    ScratchVector<std::pair<float, int64_t>> heap;
+
+    explicit TopK(size_t k = 0, bool largest = false)
+        : k(k), largest(largest) {
+        heap.reserve(k);
+    }
+
+    /// The copies reserve k pairs as well, for the arrays of heaps
+    TopK(const TopK& other) : k(other.k), largest(other.largest) {
+        heap.reserve(k);
+        heap.assign(other.heap.begin(), other.heap.end());
+    }
+
+    TopK& operator=(const TopK& other) = default;
+
+    /// true if distance a is better than distance b
+    bool better(float a, float b) const {
+        return largest ? a > b : a < b;
+    }
+
+    /// A candidate must be better than this distance to be kept
+    float threshold() const {
+        if (heap.size() < k)
+            return largest ? -HUGE_VALF : HUGE_VALF;
+        return heap.front().first;
+    }
+
+    void push(float distance, int64_t label) {
+        auto worst_first = [this](const std::pair<float, int64_t>& a,
+                                  const std::pair<float, int64_t>& b) {
+            return better(a.first, b.first);
+        };
+
+        if (k == 0)
+            return;
+        if (heap.size() < k) {
+            heap.emplace_back(distance, label);
+            std::push_heap(heap.begin(), heap.end(), worst_first);
+        } else if (better(distance, heap.front().first)) {
+            std::pop_heap(heap.begin(), heap.end(), worst_first);
+            heap.back() = std::make_pair(distance, label);
+            std::push_heap(heap.begin(), heap.end(), worst_first);
+        }
+    }
+
+    /// Add the pairs kept by other
+    void merge(const TopK& other) {
+        for (const auto& p : other.heap)
+            push(p.first, p.second);
+    }
+
+    /// Store the k pairs, best first, in distances and labels.  Missing
+    /// results have label -1 and the worst possible distance.
+    void extract(float* distances, int64_t* labels) const {
+        ArenaScope scope;
+        size_t n = heap.size();
+        auto* sorted = scope.alloc<std::pair<float, int64_t>>(n);
+
+        std::copy(heap.begin(), heap.end(), sorted);
+        std::sort(sorted, sorted + n,
+                  [this](const std::pair<float, int64_t>& a,
+                         const std::pair<float, int64_t>& b) {
+                      if (a.first != b.first)
+                          return better(a.first, b.first);
+                      return a.second < b.second;
+                  });
+        for (size_t i = 0; i < k; i++) {
+            if (i < n) {
+                distances[i] = sorted[i].first;
+                labels[i] = sorted[i].second;
+            } else {
+                distances[i] = largest ? -HUGE_VALF : HUGE_VALF;
+                labels[i] = -1;
+            }
+        }
+    }
+
+    void clear() {
+        heap.clear();
+    }
+};
+
+}  // namespace vector_search
+
+#endif /* UTILS_TOPK_H */
@@ -0,0 +1,147 @@
+/**
+ * © Copyright IBM Corporation 2024. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTILS_VISITED_TABLE_H
+#define UTILS_VISITED_TABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vector_search {
+
+/// Set of visited nodes of a graph search.  A node is visited when its
+/// tag equals the current epoch, so clearing the set between two searches
+/// only increments the epoch.
+struct VisitedTable {
+    std::vector<uint32_t> tags;
+    uint32_t epoch = 1;
+
+    explicit VisitedTable(size_t n = 0) : tags(n, 0) {}
+
+    bool get(size_t i) const {
+        return tags[i] == epoch;
+    }
+
+    void set(size_t i) {
+        tags[i] = epoch;
+    }
+
+    /// Forget all the visited nodes
+    void advance() {
+        if (++epoch == 0) {
+            std::fill(tags.begin(), tags.end(), 0);
+            epoch = 1;
+        }
+    }
+};
+
+/// Set of visited nodes in an open-addressing hash table, used by the
+/// queries interleaved on a thread.  Its size follows the number of nodes
+/// a query visits, a few times ef * M, rather than the size of the graph,
+/// so that interleaving does not multiply the largest per-query buffer.
+struct VisitedHashSet {
+    std::vector<int64_t> keys;  ///< node of each entry, -1 when empty
+    size_t count = 0;           ///< number of nodes in the set
+    int shift = 54;             ///< 64 - log2 of the number of entries
+
+    VisitedHashSet() : keys(1024, -1) {}
+
+    size_t bucket(size_t i) const {
+        return (size_t)((i * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+
+    bool get(size_t i) const {
+        size_t mask = keys.size() - 1;
+
+        for (size_t h = bucket(i); keys[h] >= 0; h = (h + 1) & mask)
+            if (keys[h] == (int64_t)i)
+                return true;
+        return false;
+    }
+
+    void set(size_t i) {
+        size_t mask, h;
+
+        /* At most half full, so that the probes stay short.  */
+        if (2 * (count + 1) > keys.size())
+            grow();
+        mask = keys.size() - 1;
+        for (h = bucket(i); keys[h] >= 0; h = (h + 1) & mask)
+            if (keys[h] == (int64_t)i)
+                return;
+        keys[h] = i;
+        count++;
+    }
+
+    /// Prefetch the first entry probed for node i
+    void prefetch(size_t i) const {
+        __builtin_prefetch(&keys[bucket(i)]);
+    }
+
+    /// Forget all the visited nodes, keeps the capacity of the largest
+    /// query so far
+    void advance() {
+        std::fill(keys.begin(), keys.end(), -1);
+        count = 0;
+    }
+
+    void grow() {
+        std::vector<int64_t> old(keys.size() * 2, -1);
+
+        old.swap(keys);
+        shift--;
+        count = 0;
+        for (int64_t v : old)
+            if (v >= 0)
+                set(v);
+    }
+};
+
+/// Table of the calling thread, with room for n nodes and no node visited.
+/// The searches use it rather than allocating and clearing a table of the
+/// size of the graph per call.  Not to be kept across a parallel_for call,
+/// whose tasks may run on the thread and use its table.
+inline VisitedTable&
+thread_visited_table(size_t n) {
+    static thread_local VisitedTable table;
+
+    if (table.tags.size() < n)
+        table.tags.resize(n, 0);
+    table.advance();
+    return table;
+}
+
+/// Empty hash set of the calling thread for the interleaved query using
+/// slot, see run_interleaved.  Same restriction as thread_visited_table.
+inline VisitedHashSet&
+thread_visited_set(size_t slot) {
+    static thread_local std::deque<VisitedHashSet> sets;
+
+    while (sets.size() <= slot)
+        sets.emplace_back();
+
+    VisitedHashSet& set = sets[slot];
+
+    set.advance();
+    return set;
+}
+
+}  // namespace vector_search
+
+#endif /* UTILS_VISITED_TABLE_H */